@@ -8,16 +8,27 @@
 
 #include "../src/Render/Renderer/RendererPrototype.hpp"
 #include "../src/Render/Renderer/RendererInstance.hpp"
+#include "../src/Render/Renderer/InstanceGroupBuilder.hpp"
 #include "../src/Render/Renderer/Camera.hpp"
+#include "../src/Render/Renderer/RenderGraph.hpp"
+#include "../src/Render/Renderer/ParallelRecorder.hpp"
 #include "../src/Render/Setup/Frame.hpp"
+#include "../src/Render/Setup/FramePacer.hpp"
 
 #include "../src/Resources/Material.hpp"
 #include "../src/Resources/Mesh.hpp"
+#include "../src/Resources/CookedMesh.hpp"
+#include "../src/Resources/VertexFormat.hpp"
 #include "../src/Resources/Texture.hpp"
+#include "../src/Resources/TextureEncoder.hpp"
+#include "../src/Resources/CookedTexture.hpp"
+#include "../src/Resources/TextureStreamer.hpp"
 #include "../src/Resources/MaterialInstance.hpp"
 #include "../src/Resources/ResourceManager.hpp"
 
 #include "../src/Util/Clock.hpp"
 
 #include "../src/Util/Serializers/JsonSerializer.hpp"
-#include "../src/Util/ShaderCompiler/SlangCompiler.hpp"
\ No newline at end of file
+#include "../src/Util/ShaderCompiler/SlangCompiler.hpp"
+#include "../src/Util/ShaderCompiler/ShaderCompilerService.hpp"
+#include "../src/Util/ShaderCompiler/ShaderHotReloader.hpp"
\ No newline at end of file
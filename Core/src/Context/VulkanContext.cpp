@@ -26,17 +26,43 @@ void cp::VulkanContext::Initialize(VulkanContextInfo& _contextInfo)
 	_contextInfo.extensions.instanceLayers.push_back("VK_LAYER_KHRONOS_validation");
 	#endif
 
+	apiVersion = vulkanVersion;
+
 	CreateInstance(vulkanVersion, _contextInfo.appName, _contextInfo.appVersion, _contextInfo.extensions);
 	CreateDebugMessenger();
 	PickPhysicalDevice();
 
-	CreateLogicalDevice();
+	CreateLogicalDevice(_contextInfo.dynamicRendering);
 	CreateCommandPool();
 
-	pipelinesManager = new cp::PipelinesManager(GetDevice());
+	pipelinesManager = new cp::PipelinesManager(GetDevice(), GetPhysicalDevice());
 	layoutsManager = new cp::LayoutsManager(GetDevice());
 	descriptorSetLayoutsManager = new cp::DescriptorSetLayoutsManager(GetDevice());
 	descriptorSetManager = new cp::DescriptorSetManager(GetDevice());
+	samplerCache = new cp::SamplerCache(GetDevice(), GetPhysicalDevice());
+
+	if (supportsBindless)
+		bindlessManager = new cp::BindlessManager(GetDevice(), GetPhysicalDevice());
+	else
+		LOG_WARNING("Descriptor indexing unsupported, bindless descriptors disabled");
+
+	if (useDynamicRendering)
+		LOG_INFO("Using dynamic rendering, no render pass or framebuffer objects");
+}
+
+void cp::VulkanContext::BeginRendering(vk::CommandBuffer _commandBuffer, const vk::RenderingInfo& _renderingInfo) const
+{
+	cmdBeginRendering(static_cast<VkCommandBuffer>(_commandBuffer), reinterpret_cast<const VkRenderingInfo*>(&_renderingInfo));
+}
+
+void cp::VulkanContext::EndRendering(vk::CommandBuffer _commandBuffer) const
+{
+	cmdEndRendering(static_cast<VkCommandBuffer>(_commandBuffer));
+}
+
+vk::Result cp::VulkanContext::WaitForPresent(vk::SwapchainKHR _swapchain, uint64_t _presentId, uint64_t _timeout) const
+{
+	return static_cast<vk::Result>(waitForPresent(static_cast<VkDevice>(device), static_cast<VkSwapchainKHR>(_swapchain), _presentId, _timeout));
 }
 
 void cp::VulkanContext::Shutdown()
@@ -49,6 +75,8 @@ void cp::VulkanContext::Shutdown()
 	layoutsManager->Cleanup();
 	descriptorSetLayoutsManager->Cleanup();
 	descriptorSetManager->Cleanup();
+	samplerCache->Cleanup();
+	if (bindlessManager) bindlessManager->Cleanup();
 
 	device.destroy();
 
@@ -62,6 +90,8 @@ void cp::VulkanContext::Shutdown()
 	delete layoutsManager;
 	delete descriptorSetLayoutsManager;
 	delete descriptorSetManager;
+	delete samplerCache;
+	delete bindlessManager;
 }
 
 std::string cp::VulkanContext::VersionToString(const uint32& _version)
@@ -105,7 +135,7 @@ void cp::VulkanContext::PickPhysicalDevice()
 	}
 }
 
-void cp::VulkanContext::CreateLogicalDevice()
+void cp::VulkanContext::CreateLogicalDevice(bool _dynamicRendering)
 {
 	queueFamilyIndices = FindQueueFamilies(physicalDevice);
 
@@ -136,8 +166,89 @@ void cp::VulkanContext::CreateLogicalDevice()
 	features2.features.samplerAnisotropy = VK_TRUE;
 	features2.features.tessellationShader = VK_TRUE;
 	features2.features.geometryShader = VK_TRUE;
+
+	// Cooked textures fall back to RGBA8 when BC formats are unavailable
+	supportsBlockCompression = physicalDevice.getFeatures().textureCompressionBC;
+	features2.features.textureCompressionBC = supportsBlockCompression ? VK_TRUE : VK_FALSE;
 	features2.pNext = &v12features;
 
+	// Only what the BindlessManager relies on, the global set is skipped entirely otherwise
+	supportsBindless = cp::BindlessManager::IsSupported(physicalDevice);
+	if (supportsBindless)
+	{
+		v12features.descriptorIndexing = VK_TRUE;
+		v12features.runtimeDescriptorArray = VK_TRUE;
+		v12features.descriptorBindingPartiallyBound = VK_TRUE;
+		v12features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+		v12features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		v12features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+		v12features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	}
+
+	auto availableExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+	auto isExtensionAvailable = [&availableExtensions](const char* _name)
+	{
+		return std::any_of(availableExtensions.begin(), availableExtensions.end(), [_name](const vk::ExtensionProperties& _extension) { return strcmp(_extension.extensionName, _name) == 0; });
+	};
+
+	// The frame pacer runs on a single timeline semaphore, core since 1.2
+	supportsTimelineSemaphore = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>().get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore;
+	v12features.timelineSemaphore = supportsTimelineSemaphore ? VK_TRUE : VK_FALSE;
+
+	// Core in 1.3, the extension only exists for 1.2 devices and drivers
+	vk::PhysicalDeviceVulkan13Features v13features;
+	vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures;
+	bool dynamicRenderingCore = std::min(apiVersion, physicalDevice.getProperties().apiVersion) >= VK_API_VERSION_1_3;
+
+	if (_dynamicRendering && dynamicRenderingCore)
+	{
+		auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan13Features>();
+		useDynamicRendering = features.get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering;
+
+		v13features.dynamicRendering = useDynamicRendering ? VK_TRUE : VK_FALSE;
+		v12features.pNext = &v13features;
+	}
+	else if (_dynamicRendering)
+	{
+		if (isExtensionAvailable(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+		{
+			auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDynamicRenderingFeaturesKHR>();
+			useDynamicRendering = features.get<vk::PhysicalDeviceDynamicRenderingFeaturesKHR>().dynamicRendering;
+		}
+
+		if (useDynamicRendering)
+		{
+			deviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+			dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+			v12features.pNext = &dynamicRenderingFeatures;
+		}
+	}
+
+	if (_dynamicRendering && !useDynamicRendering)
+		LOG_WARNING("Dynamic rendering unsupported, falling back to render passes");
+
+	// Lets the frame pacer wait for the display instead of only the GPU
+	vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures;
+	vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures;
+
+	if (isExtensionAvailable(VK_KHR_PRESENT_ID_EXTENSION_NAME) && isExtensionAvailable(VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+	{
+		auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR, vk::PhysicalDevicePresentWaitFeaturesKHR>();
+		supportsPresentWait = features.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId && features.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+	}
+
+	if (supportsPresentWait)
+	{
+		deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+
+		presentIdFeatures.presentId = VK_TRUE;
+		presentWaitFeatures.presentWait = VK_TRUE;
+		presentIdFeatures.pNext = &presentWaitFeatures;
+		presentWaitFeatures.pNext = v12features.pNext;
+		v12features.pNext = &presentIdFeatures;
+	}
+
 	vk::DeviceCreateInfo deviceInfo({}, 
 		static_cast<uint32>(queueCreateInfos.size()), queueCreateInfos.data(), 
 		static_cast<uint32>(deviceLayers.size()), deviceLayers.data(),
@@ -145,6 +256,27 @@ void cp::VulkanContext::CreateLogicalDevice()
 		nullptr, &features2);
 
 	device = physicalDevice.createDevice(deviceInfo);
+
+	if (useDynamicRendering)
+	{
+		const char* beginName = dynamicRenderingCore ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR";
+		const char* endName = dynamicRenderingCore ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR";
+
+		cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRendering>(device.getProcAddr(beginName));
+		cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRendering>(device.getProcAddr(endName));
+
+		if (!cmdBeginRendering || !cmdEndRendering)
+		{
+			LOG_ERROR("Dynamic rendering is enabled but its commands could not be loaded");
+			throw std::runtime_error("Failed to load dynamic rendering commands");
+		}
+	}
+
+	if (supportsPresentWait)
+	{
+		waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(device.getProcAddr("vkWaitForPresentKHR"));
+		supportsPresentWait = waitForPresent != nullptr;
+	}
 }
 
 void cp::VulkanContext::CreateDebugMessenger()
@@ -11,6 +11,8 @@
 #include "../Render/Pipeline/LayoutsManager.hpp"
 #include "../Render/Pipeline/SetLayoutsManager.hpp"
 #include "../Render/Pipeline/DescriptorSetManager.hpp"
+#include "../Render/Pipeline/SamplerCache.hpp"
+#include "../Render/Pipeline/BindlessManager.hpp"
 
 typedef uint32_t uint32;
 
@@ -28,6 +30,8 @@ namespace cp
 		uint32 appVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
 
 		VulkanExtensions extensions = {};
+
+		bool dynamicRendering = false; // Opt in, used when the device supports it, render passes and framebuffers otherwise. Renderers still calling beginRenderPass (EditorRenderer) need it off
 	};
 
 	struct QueueFamilyIndices;
@@ -50,7 +54,20 @@ namespace cp
 		inline cp::LayoutsManager* GetLayoutsManager() const { return layoutsManager; }
 		inline cp::DescriptorSetLayoutsManager* GetDescriptorSetLayoutsManager() const { return descriptorSetLayoutsManager; }
 		inline cp::DescriptorSetManager* GetDescriptorSetManager() const { return descriptorSetManager; }
-		inline constexpr vk::DescriptorPool GetDescriptorPool() const { return descriptorSetManager->GetDescriptorPool(); }
+		inline cp::SamplerCache* GetSamplerCache() const { return samplerCache; }
+		inline cp::BindlessManager* GetBindlessManager() const { return bindlessManager; } // nullptr when descriptor indexing is unsupported
+		inline constexpr bool SupportsBlockCompression() const { return supportsBlockCompression; }
+		inline constexpr bool SupportsBindless() const { return supportsBindless; }
+		inline constexpr bool UsesDynamicRendering() const { return useDynamicRendering; }
+		inline constexpr bool SupportsTimelineSemaphore() const { return supportsTimelineSemaphore; }
+		inline constexpr bool SupportsPresentWait() const { return supportsPresentWait; }
+
+		// vkCmdBeginRendering or its KHR alias, only valid when UsesDynamicRendering
+		void BeginRendering(vk::CommandBuffer _commandBuffer, const vk::RenderingInfo& _renderingInfo) const;
+		void EndRendering(vk::CommandBuffer _commandBuffer) const;
+
+		// vkWaitForPresentKHR, only valid when SupportsPresentWait
+		vk::Result WaitForPresent(vk::SwapchainKHR _swapchain, uint64_t _presentId, uint64_t _timeout) const;
 
 		static std::string VersionToString(const uint32& _version);
 #pragma endregion
@@ -71,16 +88,29 @@ namespace cp
 
 		vk::CommandPool commandPool;
 
+		bool supportsBlockCompression = false; // textureCompressionBC
+		bool supportsBindless = false; // Descriptor indexing features required by the BindlessManager
+		bool useDynamicRendering = false; // Requested and supported, through Vulkan 1.3 or VK_KHR_dynamic_rendering
+		bool supportsTimelineSemaphore = false; // Required by the FramePacer
+		bool supportsPresentWait = false; // VK_KHR_present_id and VK_KHR_present_wait, for FramePacingMode::PresentWait
+
+		uint32 apiVersion = 0; // Instance version, the device may report a higher one it can't be used at
+		PFN_vkCmdBeginRendering cmdBeginRendering = nullptr;
+		PFN_vkCmdEndRendering cmdEndRendering = nullptr;
+		PFN_vkWaitForPresentKHR waitForPresent = nullptr;
+
 		cp::PipelinesManager* pipelinesManager;
 		cp::LayoutsManager* layoutsManager;
 		cp::DescriptorSetLayoutsManager* descriptorSetLayoutsManager;
 		cp::DescriptorSetManager* descriptorSetManager;
+		cp::SamplerCache* samplerCache;
+		cp::BindlessManager* bindlessManager = nullptr;
 #pragma endregion
 
 #pragma region Context Creation
 		void CreateInstance(const uint32& _vulkanVersion, const std::string& _appName, const uint32& _appVersion, const VulkanExtensions& _extensions);
 		void PickPhysicalDevice();
-		void CreateLogicalDevice();
+		void CreateLogicalDevice(bool _dynamicRendering);
 		void CreateDebugMessenger();
 		void CreateCommandPool();
 #pragma endregion
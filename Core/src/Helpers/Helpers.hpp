@@ -43,6 +43,7 @@ namespace Helper
 	{
 		vk::Format FindSupportedFormat(const vk::PhysicalDevice& physicalDevice, const std::vector<vk::Format>& candidates, vk::ImageTiling tiling, vk::FormatFeatureFlags features);
 		vk::Format FindDepthFormat(const vk::PhysicalDevice& physicalDevice);
+		vk::ImageAspectFlags GetAspectFlags(vk::Format format); // Depth and/or stencil for depth stencil formats, color otherwise
 	}
 
 	namespace File
@@ -53,11 +54,11 @@ namespace Helper
 
 	namespace Image
 	{
-		void CreateImage(const vk::Device& device, const vk::PhysicalDevice& physicalDevice, uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Image& image, vk::DeviceMemory& imageMemory);
-		void TransitionImageLayout(const vk::Device& device, const vk::CommandPool& commandPool, const vk::Queue& queue, const vk::Image& image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+		void CreateImage(const vk::Device& device, const vk::PhysicalDevice& physicalDevice, uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Image& image, vk::DeviceMemory& imageMemory, uint32_t mipLevels = 1);
+		void TransitionImageLayout(const vk::Device& device, const vk::CommandPool& commandPool, const vk::Queue& queue, const vk::Image& image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels = 1);
 		void CopyBufferToImage(const vk::Device& device, const vk::CommandPool& commandPool, const vk::Queue& queue, const vk::Buffer& buffer, const vk::Image& image, uint32_t width, uint32_t height);
-		void CreateImageView(const vk::Device& device, const vk::Image& image, vk::Format format, vk::ImageAspectFlags aspectFlags, vk::ImageView& imageView);
-		void CreateSampler(const vk::Device& device, const vk::PhysicalDevice& physicalDevice, vk::Sampler& sampler);
+		void CreateImageView(const vk::Device& device, const vk::Image& image, vk::Format format, vk::ImageAspectFlags aspectFlags, vk::ImageView& imageView, uint32_t mipLevels = 1);
+		void GenerateMipmaps(const vk::Device& device, const vk::PhysicalDevice& physicalDevice, const vk::CommandPool& commandPool, const vk::Queue& queue, const vk::Image& image, vk::Format format, uint32_t width, uint32_t height, uint32_t mipLevels); // Expects every level in TransferDstOptimal, leaves them in ShaderReadOnlyOptimal
 	}
 
 	namespace CommandBuffer
@@ -0,0 +1,347 @@
+#include "pch.hpp"
+#include "BindlessManager.hpp"
+
+namespace cp
+{
+	BindlessManager::BindlessManager(vk::Device _device, vk::PhysicalDevice _physicalDevice, const BindlessSettings& _settings) : device(_device), settings(_settings)
+	{
+		auto properties = _physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+		const auto& v12properties = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+
+		settings.maxTextures = std::min({ settings.maxTextures, v12properties.maxPerStageDescriptorUpdateAfterBindSampledImages, v12properties.maxDescriptorSetUpdateAfterBindSampledImages });
+		settings.maxSamplers = std::min({ settings.maxSamplers, v12properties.maxPerStageDescriptorUpdateAfterBindSamplers, v12properties.maxDescriptorSetUpdateAfterBindSamplers });
+
+		std::array<vk::DescriptorSetLayoutBinding, 3> bindings;
+		bindings[TEXTURES_BINDING] = vk::DescriptorSetLayoutBinding(TEXTURES_BINDING, vk::DescriptorType::eSampledImage, settings.maxTextures, vk::ShaderStageFlagBits::eAll);
+		bindings[SAMPLERS_BINDING] = vk::DescriptorSetLayoutBinding(SAMPLERS_BINDING, vk::DescriptorType::eSampler, settings.maxSamplers, vk::ShaderStageFlagBits::eAll);
+		bindings[MATERIALS_BINDING] = vk::DescriptorSetLayoutBinding(MATERIALS_BINDING, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eAll);
+
+		vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+		std::array<vk::DescriptorBindingFlags, 3> flags = { bindingFlags, bindingFlags, bindingFlags };
+
+		vk::DescriptorSetLayoutBindingFlagsCreateInfo flagsInfo(flags);
+
+		vk::DescriptorSetLayoutCreateInfo layoutInfo(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, bindings, &flagsInfo);
+		layout = device.createDescriptorSetLayout(layoutInfo);
+
+		std::array<vk::DescriptorPoolSize, 3> poolSizes = {
+			vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, settings.maxTextures),
+			vk::DescriptorPoolSize(vk::DescriptorType::eSampler, settings.maxSamplers),
+			vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1)
+		};
+
+		vk::DescriptorPoolCreateInfo poolInfo(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, 1, poolSizes);
+		pool = device.createDescriptorPool(poolInfo);
+
+		vk::DescriptorSetAllocateInfo allocInfo(pool, 1, &layout);
+		set = device.allocateDescriptorSets(allocInfo)[0];
+
+		// Any host visible type, parameter edits are flushed by range when the driver picks non coherent memory
+		materialBuffer = Helper::Memory::CreateBuffer(device, _physicalDevice, settings.materialBufferSize, vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible, materialMemory);
+		materialData = static_cast<uint8_t*>(device.mapMemory(materialMemory, 0, VK_WHOLE_SIZE));
+		std::memset(materialData, 0, settings.materialBufferSize);
+
+		vk::MemoryRequirements memoryRequirements = device.getBufferMemoryRequirements(materialBuffer);
+		uint32_t memoryType = Helper::Memory::FindMemoryType(_physicalDevice, memoryRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eHostVisible);
+		materialCoherent = static_cast<bool>(_physicalDevice.getMemoryProperties().memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+		materialAllocationSize = memoryRequirements.size;
+		nonCoherentAtomSize = std::max<vk::DeviceSize>(properties.get<vk::PhysicalDeviceProperties2>().properties.limits.nonCoherentAtomSize, 1);
+
+		if (!materialCoherent)
+		{
+			device.flushMappedMemoryRanges(vk::MappedMemoryRange(materialMemory, 0, VK_WHOLE_SIZE));
+		}
+
+		freeBlocks[0] = settings.materialBufferSize;
+
+		vk::DescriptorBufferInfo bufferInfo(materialBuffer, 0, VK_WHOLE_SIZE);
+		vk::WriteDescriptorSet write(set, MATERIALS_BINDING, 0, vk::DescriptorType::eStorageBuffer, {}, bufferInfo);
+		device.updateDescriptorSets(write, {});
+
+		LOG_INFO(MF("Bindless descriptor set created (", settings.maxTextures, " textures, ", settings.maxSamplers, " samplers, ", settings.materialBufferSize / 1024, "KB of material data)"));
+	}
+
+	bool BindlessManager::IsSupported(vk::PhysicalDevice _physicalDevice)
+	{
+		auto features = _physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+		const auto& v12features = features.get<vk::PhysicalDeviceVulkan12Features>();
+
+		return v12features.descriptorIndexing
+			&& v12features.runtimeDescriptorArray
+			&& v12features.descriptorBindingPartiallyBound
+			&& v12features.descriptorBindingUpdateUnusedWhilePending
+			&& v12features.descriptorBindingSampledImageUpdateAfterBind
+			&& v12features.descriptorBindingStorageBufferUpdateAfterBind
+			&& v12features.shaderSampledImageArrayNonUniformIndexing;
+	}
+
+	void BindlessManager::Cleanup()
+	{
+		device.unmapMemory(materialMemory);
+		Helper::Memory::DestroyBuffer(device, materialBuffer, materialMemory);
+
+		device.destroyDescriptorPool(pool); // Frees the set
+		device.destroyDescriptorSetLayout(layout);
+
+		samplers.clear();
+		samplerSlots.clear();
+		freeSamplers.clear();
+		retiredSamplers.clear();
+		freeTextures.clear();
+		retiredTextures.clear();
+		freeBlocks.clear();
+		retiredBlocks.clear();
+		dirtyRanges.clear();
+	}
+
+	void BindlessManager::WriteTexture(uint32_t _index, vk::ImageView _view)
+	{
+		vk::DescriptorImageInfo imageInfo({}, _view, vk::ImageLayout::eShaderReadOnlyOptimal);
+		vk::WriteDescriptorSet write(set, TEXTURES_BINDING, _index, vk::DescriptorType::eSampledImage, imageInfo);
+		device.updateDescriptorSets(write, {});
+	}
+
+	uint32_t BindlessManager::RegisterTexture(vk::ImageView _view)
+	{
+		uint32_t index;
+
+		if (!freeTextures.empty())
+		{
+			index = freeTextures.back();
+			freeTextures.pop_back();
+		}
+		else
+		{
+			if (textureCount >= settings.maxTextures)
+			{
+				LOG_ERROR(MF("Bindless texture array is full (", settings.maxTextures, " textures)"));
+				throw std::runtime_error("Bindless texture array is full");
+			}
+
+			index = textureCount++;
+		}
+
+		WriteTexture(index, _view);
+
+		return index;
+	}
+
+	uint32_t BindlessManager::ReplaceTexture(uint32_t _index, vk::ImageView _view)
+	{
+		// Frames in flight may sample _index, UPDATE_UNUSED_WHILE_PENDING only allows writing the slots they don't use
+		// The old view is kept alive as long as its slot by its owner (see TextureStreamer::Retire)
+		uint32_t index = RegisterTexture(_view);
+		ReleaseTexture(_index);
+
+		return index;
+	}
+
+	void BindlessManager::ReleaseTexture(uint32_t _index)
+	{
+		if (_index == INVALID_INDEX) return;
+
+		retiredTextures.push_back({ _index, frame });
+	}
+
+	uint32_t BindlessManager::RegisterSampler(vk::Sampler _sampler)
+	{
+		auto it = samplers.find(static_cast<VkSampler>(_sampler));
+		if (it != samplers.end())
+		{
+			it->second.references++;
+			return it->second.index;
+		}
+
+		uint32_t index;
+
+		if (!freeSamplers.empty())
+		{
+			index = freeSamplers.back();
+			freeSamplers.pop_back();
+		}
+		else
+		{
+			if (samplerCount >= settings.maxSamplers)
+			{
+				LOG_ERROR(MF("Bindless sampler array is full (", settings.maxSamplers, " samplers in use)"));
+				throw std::runtime_error("Bindless sampler array is full");
+			}
+
+			index = samplerCount++;
+			samplerSlots.push_back(VK_NULL_HANDLE);
+		}
+
+		vk::DescriptorImageInfo samplerInfo(_sampler, {}, {});
+		vk::WriteDescriptorSet write(set, SAMPLERS_BINDING, index, vk::DescriptorType::eSampler, samplerInfo);
+		device.updateDescriptorSets(write, {});
+
+		samplers[static_cast<VkSampler>(_sampler)] = { index, 1 };
+		samplerSlots[index] = static_cast<VkSampler>(_sampler);
+
+		return index;
+	}
+
+	void BindlessManager::ReleaseSampler(uint32_t _index)
+	{
+		if (_index == INVALID_INDEX || _index >= samplerSlots.size() || samplerSlots[_index] == VK_NULL_HANDLE) return;
+
+		auto it = samplers.find(samplerSlots[_index]);
+		if (--it->second.references > 0) return;
+
+		// Same as textures, the slot may still be read by the frames in flight
+		samplers.erase(it);
+		samplerSlots[_index] = VK_NULL_HANDLE;
+		retiredSamplers.push_back({ _index, frame });
+	}
+
+	BindlessMaterialBlock BindlessManager::AllocateMaterialBlock(vk::DeviceSize _size)
+	{
+		vk::DeviceSize size = (std::max<vk::DeviceSize>(_size, 1) + 15) & ~vk::DeviceSize(15); // Blocks are indexed in 16 bytes units
+
+		// First fit, blocks are small and allocated at load time
+		for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+		{
+			if (it->second < size) continue;
+
+			BindlessMaterialBlock block;
+			block.offset = it->first;
+			block.size = size;
+			block.frame = frame;
+
+			vk::DeviceSize remaining = it->second - size;
+			freeBlocks.erase(it);
+
+			if (remaining > 0)
+			{
+				freeBlocks[block.offset + size] = remaining;
+			}
+
+			return block;
+		}
+
+		LOG_ERROR(MF("Bindless material buffer is full, couldn't allocate ", size, " bytes (", settings.materialBufferSize, " bytes total)"));
+		throw std::runtime_error("Bindless material buffer is full");
+	}
+
+	void BindlessManager::WriteMaterialBlock(const BindlessMaterialBlock& _block, const void* _data, vk::DeviceSize _size, vk::DeviceSize _offset)
+	{
+		if (_offset + _size > _block.size)
+		{
+			LOG_ERROR(MF("Material block write of ", _size, " bytes at offset ", _offset, " exceeds the block size (", _block.size, ")"));
+			return;
+		}
+
+		if (_block.frame != frame)
+		{
+			LOG_ERROR(MF("Material block at offset ", _block.offset, " may be read by frames in flight, use UpdateMaterialBlock"));
+			return;
+		}
+
+		std::memcpy(materialData + _block.offset + _offset, _data, _size);
+
+		if (!materialCoherent)
+		{
+			dirtyRanges.push_back({ _block.offset + _offset, _size });
+		}
+	}
+
+	void BindlessManager::UpdateMaterialBlock(BindlessMaterialBlock& _block, const void* _data, vk::DeviceSize _size)
+	{
+		// Frames in flight keep reading the old parameters from the old block, it is recycled after framesInFlight frames like a texture slot
+		if (_block.frame != frame)
+		{
+			BindlessMaterialBlock block = AllocateMaterialBlock(_block.size);
+			FreeMaterialBlock(_block);
+			_block = block;
+		}
+
+		WriteMaterialBlock(_block, _data, _size);
+	}
+
+	void BindlessManager::FlushMaterialWrites()
+	{
+		if (dirtyRanges.empty()) return;
+
+		std::sort(dirtyRanges.begin(), dirtyRanges.end());
+
+		// Ranges are widened to whole atoms, neighbours overlapping after that are merged into one flush
+		std::vector<vk::MappedMemoryRange> ranges;
+		for (const auto& [offset, size] : dirtyRanges)
+		{
+			vk::DeviceSize begin = offset - offset % nonCoherentAtomSize;
+			vk::DeviceSize end = std::min((offset + size + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize, materialAllocationSize);
+
+			if (!ranges.empty() && begin <= ranges.back().offset + ranges.back().size)
+			{
+				ranges.back().size = std::max(ranges.back().size, end - ranges.back().offset);
+				continue;
+			}
+
+			ranges.push_back(vk::MappedMemoryRange(materialMemory, begin, end - begin));
+		}
+
+		device.flushMappedMemoryRanges(ranges);
+		dirtyRanges.clear();
+	}
+
+	void BindlessManager::FreeMaterialBlock(const BindlessMaterialBlock& _block)
+	{
+		if (!_block.IsValid()) return;
+
+		retiredBlocks.push_back({ _block, frame });
+	}
+
+	void BindlessManager::ReleaseBlock(const BindlessMaterialBlock& _block)
+	{
+		vk::DeviceSize offset = _block.offset;
+		vk::DeviceSize size = _block.size;
+
+		auto next = freeBlocks.lower_bound(offset);
+		if (next != freeBlocks.end() && offset + size == next->first)
+		{
+			size += next->second;
+			next = freeBlocks.erase(next);
+		}
+
+		if (next != freeBlocks.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				previous->second += size;
+				return;
+			}
+		}
+
+		freeBlocks[offset] = size;
+	}
+
+	void BindlessManager::NextFrame()
+	{
+		frame++;
+
+		while (!retiredTextures.empty() && retiredTextures.front().frame + settings.framesInFlight < frame) // The frame recording when the slot was released is in flight too
+		{
+			freeTextures.push_back(retiredTextures.front().index);
+			retiredTextures.pop_front();
+		}
+
+		while (!retiredSamplers.empty() && retiredSamplers.front().frame + settings.framesInFlight < frame)
+		{
+			freeSamplers.push_back(retiredSamplers.front().index);
+			retiredSamplers.pop_front();
+		}
+
+		while (!retiredBlocks.empty() && retiredBlocks.front().second + settings.framesInFlight < frame)
+		{
+			ReleaseBlock(retiredBlocks.front().first);
+			retiredBlocks.pop_front();
+		}
+	}
+
+	vk::PushConstantRange BindlessManager::GetDrawConstantsRange(vk::ShaderStageFlags _stages)
+	{
+		return vk::PushConstantRange(_stages, 0, sizeof(BindlessDrawConstants));
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "../../pch.hpp"
+
+namespace cp
+{
+	struct BindlessSettings
+	{
+		uint32_t maxTextures = 16384; // Clamped to the device update-after-bind limits
+		uint32_t maxSamplers = 256;
+		vk::DeviceSize materialBufferSize = 4ull * 1024 * 1024; // Bytes of material parameter blocks, fixed for the lifetime of the context
+		uint32_t framesInFlight = 3; // Freed slots are only reused once no recorded frame can reference them anymore
+	};
+
+	// Per-draw indices into the global set, for shaders reading their parameters from the bindless buffer
+	// No renderer binds the set or pushes these yet, materials still go through their own descriptor sets
+	struct BindlessDrawConstants
+	{
+		uint32_t materialOffset; // In 16 bytes units, index into the material buffer viewed as a uint4 / float4 array
+		uint32_t textureBase; // Free for the material to use, e.g. the first texture index of its parameter block
+	};
+
+	struct BindlessMaterialBlock
+	{
+		vk::DeviceSize offset = 0;
+		vk::DeviceSize size = 0;
+		uint64_t frame = 0; // BindlessManager frame it was allocated in, no submitted frame reads it before the next one
+
+		inline constexpr bool IsValid() const { return size != 0; }
+		inline constexpr uint32_t GetIndex() const { return static_cast<uint32_t>(offset / 16); }
+	};
+
+	// Optional global descriptor set, created only when the device supports descriptor indexing
+	// Kept up to date by textures and material instances, a renderer opts in by binding GetDescriptorSet() to a layout built with GetDescriptorSetLayout(), none does yet
+	// binding 0 : sampled images, binding 1 : samplers, binding 2 : one storage buffer holding every material parameter block
+	// Every binding is UPDATE_AFTER_BIND and PARTIALLY_BOUND, so registering a resource never requires rebinding the set
+	// Slots are never rewritten while frames in flight may read them, a replaced resource gets a new slot and the old one is retired for framesInFlight frames
+	class BindlessManager
+	{
+	public:
+		static constexpr uint32_t TEXTURES_BINDING = 0;
+		static constexpr uint32_t SAMPLERS_BINDING = 1;
+		static constexpr uint32_t MATERIALS_BINDING = 2;
+
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	private:
+		struct RetiredSlot
+		{
+			uint32_t index;
+			uint64_t frame;
+		};
+
+		vk::Device device;
+		BindlessSettings settings;
+
+		vk::DescriptorSetLayout layout;
+		vk::DescriptorPool pool;
+		vk::DescriptorSet set;
+
+		vk::Buffer materialBuffer;
+		vk::DeviceMemory materialMemory;
+		uint8_t* materialData = nullptr; // Persistently mapped
+		bool materialCoherent = true;
+		vk::DeviceSize materialAllocationSize = 0;
+		vk::DeviceSize nonCoherentAtomSize = 1;
+		std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> dirtyRanges; // offset, size, written since the last flush, only tracked for non coherent memory
+
+		uint32_t textureCount = 0; // High water mark, slots below it are either live or in freeTextures
+		std::vector<uint32_t> freeTextures;
+		std::deque<RetiredSlot> retiredTextures;
+
+		struct SamplerSlot
+		{
+			uint32_t index;
+			uint32_t references;
+		};
+
+		std::unordered_map<VkSampler, SamplerSlot> samplers;
+		std::vector<VkSampler> samplerSlots; // index -> sampler, VK_NULL_HANDLE once released
+		uint32_t samplerCount = 0; // High water mark, slots below it are either live or in freeSamplers
+		std::vector<uint32_t> freeSamplers;
+		std::deque<RetiredSlot> retiredSamplers;
+
+		std::map<vk::DeviceSize, vk::DeviceSize> freeBlocks; // offset -> size, adjacent blocks are merged on release
+		std::deque<std::pair<BindlessMaterialBlock, uint64_t>> retiredBlocks;
+
+		uint64_t frame = 0;
+
+		void WriteTexture(uint32_t _index, vk::ImageView _view);
+		void ReleaseBlock(const BindlessMaterialBlock& _block);
+
+	public:
+		NO_COPY(BindlessManager)
+
+		BindlessManager(vk::Device _device, vk::PhysicalDevice _physicalDevice, const BindlessSettings& _settings = {});
+
+		static bool IsSupported(vk::PhysicalDevice _physicalDevice);
+
+		void Cleanup();
+
+		uint32_t RegisterTexture(vk::ImageView _view); // Expects the view in ShaderReadOnlyOptimal
+		uint32_t ReplaceTexture(uint32_t _index, vk::ImageView _view); // Registers _view in a new slot and releases _index, returns the new slot
+		void ReleaseTexture(uint32_t _index);
+
+		uint32_t RegisterSampler(vk::Sampler _sampler); // Deduplicated and reference counted, every call needs a matching ReleaseSampler. The SamplerCache owns the sampler itself
+		void ReleaseSampler(uint32_t _index);
+
+		BindlessMaterialBlock AllocateMaterialBlock(vk::DeviceSize _size);
+		void WriteMaterialBlock(const BindlessMaterialBlock& _block, const void* _data, vk::DeviceSize _size, vk::DeviceSize _offset = 0); // Writes straight into the mapped buffer, only for blocks allocated this frame. Visible to the device after the next flush
+		void UpdateMaterialBlock(BindlessMaterialBlock& _block, const void* _data, vk::DeviceSize _size); // Rewrites the whole block, moving it to a new one first when submitted frames may still read it
+		void FreeMaterialBlock(const BindlessMaterialBlock& _block);
+		void FlushMaterialWrites(); // Before each submit, flushes the merged dirty ranges when the memory is not host coherent
+
+		void NextFrame(); // Once per frame after submitting, recycles slots and blocks released more than framesInFlight frames ago
+
+		static vk::PushConstantRange GetDrawConstantsRange(vk::ShaderStageFlags _stages = vk::ShaderStageFlagBits::eAllGraphics);
+
+		inline constexpr vk::DescriptorSet GetDescriptorSet() const { return set; }
+		inline constexpr vk::DescriptorSetLayout GetDescriptorSetLayout() const { return layout; }
+		inline constexpr vk::Buffer GetMaterialBuffer() const { return materialBuffer; }
+		inline constexpr uint32_t GetMaxTextures() const { return settings.maxTextures; }
+		inline constexpr uint32_t GetMaxSamplers() const { return settings.maxSamplers; }
+	};
+}
@@ -0,0 +1,128 @@
+#include "pch.hpp"
+#include "DescriptorAllocator.hpp"
+
+namespace cp
+{
+	DescriptorAllocator::DescriptorAllocator(vk::Device _device, uint32_t _initialSets, const std::vector<DescriptorPoolRatio>& _ratios) : device(_device), ratios(_ratios), setsPerPool(_initialSets)
+	{
+		readyPools.push_back(CreatePool(setsPerPool));
+	}
+
+	const std::vector<DescriptorPoolRatio>& DescriptorAllocator::GetDefaultRatios()
+	{
+		static const std::vector<DescriptorPoolRatio> defaultRatios = {
+			{ vk::DescriptorType::eUniformBuffer, 2.0f },
+			{ vk::DescriptorType::eUniformBufferDynamic, 1.0f },
+			{ vk::DescriptorType::eStorageBuffer, 1.0f },
+			{ vk::DescriptorType::eStorageBufferDynamic, 0.5f },
+			{ vk::DescriptorType::eCombinedImageSampler, 4.0f },
+			{ vk::DescriptorType::eSampledImage, 4.0f },
+			{ vk::DescriptorType::eSampler, 1.0f },
+			{ vk::DescriptorType::eStorageImage, 1.0f },
+			{ vk::DescriptorType::eUniformTexelBuffer, 0.5f },
+			{ vk::DescriptorType::eStorageTexelBuffer, 0.5f },
+			{ vk::DescriptorType::eInputAttachment, 0.5f }
+		};
+
+		return defaultRatios;
+	}
+
+	std::vector<vk::DescriptorPoolSize> DescriptorAllocator::GetPoolSizes(const std::vector<DescriptorPoolRatio>& _ratios, uint32_t _setCount)
+	{
+		std::vector<vk::DescriptorPoolSize> poolSizes;
+		poolSizes.reserve(_ratios.size());
+
+		for (const auto& ratio : _ratios)
+		{
+			poolSizes.push_back(vk::DescriptorPoolSize(ratio.type, std::max(1u, static_cast<uint32_t>(ratio.ratio * _setCount))));
+		}
+
+		return poolSizes;
+	}
+
+	vk::DescriptorPool DescriptorAllocator::CreatePool(uint32_t _setCount)
+	{
+		std::vector<vk::DescriptorPoolSize> poolSizes = GetPoolSizes(ratios, _setCount);
+		vk::DescriptorPoolCreateInfo poolInfo({}, _setCount, poolSizes);
+
+		return device.createDescriptorPool(poolInfo);
+	}
+
+	vk::DescriptorPool DescriptorAllocator::GetPool()
+	{
+		if (!readyPools.empty())
+		{
+			vk::DescriptorPool pool = readyPools.back();
+			readyPools.pop_back();
+			return pool;
+		}
+
+		// Each new pool is bigger than the last, a busy scene ends up with a handful of large pools
+		setsPerPool = GetGrownSetCount(setsPerPool);
+
+		LOG_TRACE(MF("Descriptor allocator growing, new pool of ", setsPerPool, " sets (", GetPoolCount() + 1, " pools)"));
+
+		return CreatePool(setsPerPool);
+	}
+
+	vk::DescriptorSet DescriptorAllocator::Allocate(vk::DescriptorSetLayout _layout, const void* _next)
+	{
+		while (true)
+		{
+			const bool freshPool = readyPools.empty();
+			vk::DescriptorPool pool = GetPool();
+
+			try
+			{
+				vk::DescriptorSet set = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(pool, 1, &_layout, _next))[0];
+				readyPools.push_back(pool);
+				return set;
+			}
+			catch (const vk::SystemError& e) // Pool exhausted, move on to the next one
+			{
+				if (e.code() != vk::Result::eErrorOutOfPoolMemory && e.code() != vk::Result::eErrorFragmentedPool)
+					throw;
+
+				fullPools.push_back(pool);
+
+				if (freshPool && setsPerPool == MAX_SETS_PER_POOL)
+				{
+					LOG_ERROR("Descriptor set layout doesn't fit in an empty pool, check the pool ratios");
+					throw;
+				}
+			}
+		}
+	}
+
+	void DescriptorAllocator::Reset()
+	{
+		for (auto pool : readyPools)
+		{
+			device.resetDescriptorPool(pool);
+		}
+
+		for (auto pool : fullPools)
+		{
+			device.resetDescriptorPool(pool);
+			readyPools.push_back(pool);
+		}
+
+		fullPools.clear();
+	}
+
+	void DescriptorAllocator::Cleanup()
+	{
+		for (auto pool : readyPools)
+		{
+			device.destroyDescriptorPool(pool);
+		}
+
+		for (auto pool : fullPools)
+		{
+			device.destroyDescriptorPool(pool);
+		}
+
+		readyPools.clear();
+		fullPools.clear();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../../pch.hpp"
+
+namespace cp
+{
+	// Descriptors of each type reserved per set in a pool, a pool of N sets holds N * ratio descriptors of that type
+	struct DescriptorPoolRatio
+	{
+		vk::DescriptorType type;
+		float ratio;
+	};
+
+	// Hands out descriptor sets from a chain of pools, a new pool is created whenever the current one runs out
+	// Sets are never freed one by one (no eFreeDescriptorSet, so no fragmentation), Reset recycles every pool at once
+	class DescriptorAllocator
+	{
+	private:
+		vk::Device device;
+		std::vector<DescriptorPoolRatio> ratios;
+
+		std::vector<vk::DescriptorPool> fullPools;
+		std::vector<vk::DescriptorPool> readyPools;
+
+		uint32_t setsPerPool;
+
+		vk::DescriptorPool GetPool();
+		vk::DescriptorPool CreatePool(uint32_t _setCount);
+
+	public:
+		static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+		DescriptorAllocator() = default;
+		DescriptorAllocator(vk::Device _device, uint32_t _initialSets = 64, const std::vector<DescriptorPoolRatio>& _ratios = GetDefaultRatios());
+
+		static const std::vector<DescriptorPoolRatio>& GetDefaultRatios(); // Every descriptor type core uses
+		static std::vector<vk::DescriptorPoolSize> GetPoolSizes(const std::vector<DescriptorPoolRatio>& _ratios, uint32_t _setCount); // At least one descriptor of every type
+		static inline uint32_t GetGrownSetCount(uint32_t _setsPerPool) { return std::min(_setsPerPool * 2, MAX_SETS_PER_POOL); } // Doubles up to MAX_SETS_PER_POOL
+
+		vk::DescriptorSet Allocate(vk::DescriptorSetLayout _layout, const void* _next = nullptr);
+
+		void Reset(); // Every set allocated so far becomes invalid
+		void Cleanup();
+
+		inline size_t GetPoolCount() const { return fullPools.size() + readyPools.size(); }
+	};
+}
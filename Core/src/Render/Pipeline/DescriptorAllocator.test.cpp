@@ -0,0 +1,117 @@
+#include "pch.hpp"
+#include "DescriptorAllocator.hpp"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+	// Headless instance and device on the first physical device, recycling needs real pools
+	class DescriptorAllocatorDevice : public ::testing::Test
+	{
+	protected:
+		vk::Instance instance;
+		vk::Device device;
+		vk::DescriptorSetLayout layout;
+
+		void SetUp() override
+		{
+			try
+			{
+				vk::ApplicationInfo appInfo("CoreTests", 1, "Checkpoint", 1, VK_API_VERSION_1_2);
+				instance = vk::createInstance(vk::InstanceCreateInfo({}, &appInfo));
+
+				std::vector<vk::PhysicalDevice> physicalDevices = instance.enumeratePhysicalDevices();
+				if (physicalDevices.empty()) GTEST_SKIP() << "No Vulkan device";
+
+				float priority = 1.0f;
+				vk::DeviceQueueCreateInfo queueInfo({}, 0, 1, &priority);
+				device = physicalDevices[0].createDevice(vk::DeviceCreateInfo({}, queueInfo));
+
+				vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eAll);
+				layout = device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo({}, binding));
+			}
+			catch (const vk::SystemError& e)
+			{
+				GTEST_SKIP() << "No Vulkan driver : " << e.what();
+			}
+		}
+
+		void TearDown() override
+		{
+			if (layout) device.destroyDescriptorSetLayout(layout);
+			if (device) device.destroy();
+			if (instance) instance.destroy();
+		}
+	};
+}
+
+TEST(DescriptorAllocator, PoolSizesFollowTheRatios)
+{
+	std::vector<cp::DescriptorPoolRatio> ratios = { { vk::DescriptorType::eUniformBuffer, 2.0f }, { vk::DescriptorType::eStorageImage, 0.5f }, { vk::DescriptorType::eInputAttachment, 0.01f } };
+	std::vector<vk::DescriptorPoolSize> sizes = cp::DescriptorAllocator::GetPoolSizes(ratios, 64);
+
+	ASSERT_EQ(sizes.size(), 3u);
+	EXPECT_EQ(sizes[0], vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, 128));
+	EXPECT_EQ(sizes[1], vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, 32));
+	EXPECT_EQ(sizes[2], vk::DescriptorPoolSize(vk::DescriptorType::eInputAttachment, 1)); // Rounded down to 0, a pool always holds one
+}
+
+TEST(DescriptorAllocator, DefaultRatiosCoverEveryTypeOnce)
+{
+	std::set<vk::DescriptorType> types;
+	for (const auto& ratio : cp::DescriptorAllocator::GetDefaultRatios())
+	{
+		EXPECT_TRUE(types.insert(ratio.type).second);
+		EXPECT_GT(ratio.ratio, 0.0f);
+	}
+
+	EXPECT_TRUE(types.contains(vk::DescriptorType::eUniformBuffer));
+	EXPECT_TRUE(types.contains(vk::DescriptorType::eCombinedImageSampler));
+	EXPECT_TRUE(types.contains(vk::DescriptorType::eStorageBuffer));
+}
+
+TEST(DescriptorAllocator, PoolsGrowGeometricallyUpToTheCap)
+{
+	uint32_t sets = 64;
+	uint32_t pools = 1;
+
+	while (sets < cp::DescriptorAllocator::MAX_SETS_PER_POOL)
+	{
+		uint32_t grown = cp::DescriptorAllocator::GetGrownSetCount(sets);
+		EXPECT_EQ(grown, std::min(sets * 2, cp::DescriptorAllocator::MAX_SETS_PER_POOL));
+		sets = grown;
+		pools++;
+	}
+
+	EXPECT_LE(pools, 8u); // A handful of pools reach the cap
+	EXPECT_EQ(cp::DescriptorAllocator::GetGrownSetCount(cp::DescriptorAllocator::MAX_SETS_PER_POOL), cp::DescriptorAllocator::MAX_SETS_PER_POOL);
+}
+
+TEST_F(DescriptorAllocatorDevice, ResetRecyclesEveryPool)
+{
+	cp::DescriptorAllocator allocator(device, 2, { { vk::DescriptorType::eUniformBuffer, 1.0f } });
+
+	for (int i = 0; i < 32; i++)
+	{
+		EXPECT_TRUE(allocator.Allocate(layout));
+	}
+
+	size_t poolCount = allocator.GetPoolCount();
+	EXPECT_GE(poolCount, 1u);
+
+	// Drivers may hand out more sets than a pool was sized for, whatever was created is enough for the same load after a reset
+	for (int frame = 0; frame < 4; frame++)
+	{
+		allocator.Reset();
+
+		for (int i = 0; i < 32; i++)
+		{
+			EXPECT_TRUE(allocator.Allocate(layout));
+		}
+
+		EXPECT_EQ(allocator.GetPoolCount(), poolCount);
+	}
+
+	allocator.Cleanup();
+	EXPECT_EQ(allocator.GetPoolCount(), 0u);
+}
@@ -1,19 +1,74 @@
 #include "pch.hpp"
 #include "DescriptorSetManager.hpp"
 
-cp::DescriptorSetManager::DescriptorSetManager(vk::Device _device) : device(_device)
+cp::DescriptorSetManager::DescriptorSetManager(vk::Device _device) : device(_device), persistentAllocator(_device), updates(_device), queuedUpdates(_device)
 {
-	vk::DescriptorPoolSize poolSize = {};
-	poolSize.type = vk::DescriptorType::eUniformBuffer;
-	poolSize.descriptorCount = 100;
+}
+
+void cp::DescriptorSetManager::BeginFrame(uint32_t _frameIndex)
+{
+	// Allocators are created the first time a frame index shows up, the swapchain decides how many frames are in flight
+	while (frameAllocators.size() <= _frameIndex)
+	{
+		frameAllocators.emplace_back(device, 16);
+	}
 
-	vk::DescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.poolSizeCount = 1;
-	poolInfo.pPoolSizes = &poolSize;
-	poolInfo.maxSets = 100;
-	poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+	currentFrame = _frameIndex;
+	frameCounter++;
 
-	pool = device.createDescriptorPool(poolInfo);
+	FlushQueuedUpdates(); // Everything edited since the last frame, in one driver call
+
+	frameAllocators[currentFrame].Reset();
+
+	const uint64_t framesInFlight = frameAllocators.size();
+	while (!retiredSets.empty() && retiredSets.front().frame + framesInFlight <= frameCounter)
+	{
+		freeSets[retiredSets.front().layout].push_back(retiredSets.front().set);
+		retiredSets.pop_front();
+	}
+}
+
+vk::DescriptorSet cp::DescriptorSetManager::AllocateTransientDescriptorSet(const vk::DescriptorSetLayout& _layout)
+{
+	if (frameAllocators.empty())
+	{
+		frameAllocators.emplace_back(device, 16); // Used before the first BeginFrame, e.g. at load time
+	}
+
+	return frameAllocators[currentFrame].Allocate(_layout);
+}
+
+vk::DescriptorSet cp::DescriptorSetManager::AllocatePersistent(const vk::DescriptorSetLayout& _layout)
+{
+	vk::DescriptorSet set;
+
+	auto it = freeSets.find(_layout);
+	if (it != freeSets.end() && !it->second.empty())
+	{
+		set = it->second.back(); // Recycled sets keep their old descriptors, callers write every binding anyway
+		it->second.pop_back();
+	}
+	else
+	{
+		set = persistentAllocator.Allocate(_layout);
+	}
+
+	setLayouts[set] = _layout;
+
+	return set;
+}
+
+void cp::DescriptorSetManager::Retire(const vk::DescriptorSet& _set)
+{
+	auto it = setLayouts.find(_set);
+	if (it == setLayouts.end())
+	{
+		LOG_ERROR("Trying to destroy a descriptor set that wasn't allocated by the DescriptorSetManager");
+		return;
+	}
+
+	retiredSets.push_back({ _set, it->second, frameCounter });
+	setLayouts.erase(it);
 }
 
 vk::DescriptorSet& cp::DescriptorSetManager::GetDescriptorSet(const std::string& _name)
@@ -28,24 +83,7 @@ void cp::DescriptorSetManager::UpdateDescriptorSet(const std::string& _name, con
 		throw std::runtime_error("Descriptor set with name " + _name + " does not exist");
 #endif
 
-	vk::WriteDescriptorSet write = {};
-	write.dstSet = sets[_name];
-	write.dstBinding = _write.dstBinding;
-	write.dstArrayElement = _write.dstArrayElement;
-	write.descriptorType = _write.descriptorType;
-	write.descriptorCount = _write.descriptorCount;
-
-	switch (_write.updateType)
-	{
-	case DescriptorSetUpdateType::BUFFER:
-		write.pBufferInfo = new vk::DescriptorBufferInfo(_write.buffer, _write.offset, _write.range);
-		break;
-	case DescriptorSetUpdateType::IMAGE:
-		write.pImageInfo = new vk::DescriptorImageInfo(_write.sampler, _write.imageView, _write.imageLayout);
-		break;
-	}
-
-	device.updateDescriptorSets(1, &write, 0, nullptr);
+	updates.Write(sets[_name], _write).Flush();
 }
 
 void cp::DescriptorSetManager::UpdateDescriptorSet(const std::string& _name, const std::vector<DescriptorSetUpdate>& _writes)
@@ -55,31 +93,10 @@ void cp::DescriptorSetManager::UpdateDescriptorSet(const std::string& _name, con
 		throw std::runtime_error("Descriptor set with name " + _name + " does not exist");
 #endif
 
-	std::vector<vk::WriteDescriptorSet> writes;
+	for (const auto& write : _writes)
+		updates.Write(sets[_name], write);
 
-	for (const auto& writeIndex : _writes)
-	{
-		vk::WriteDescriptorSet write = {};
-		write.dstSet = sets[_name];
-		write.dstBinding = writeIndex.dstBinding;
-		write.dstArrayElement = writeIndex.dstArrayElement;
-		write.descriptorType = writeIndex.descriptorType;
-		write.descriptorCount = writeIndex.descriptorCount;
-
-		switch (writeIndex.updateType)
-		{
-		case DescriptorSetUpdateType::BUFFER:
-			write.pBufferInfo = new vk::DescriptorBufferInfo(writeIndex.buffer, writeIndex.offset, writeIndex.range);
-			break;
-		case DescriptorSetUpdateType::IMAGE:
-			write.pImageInfo = new vk::DescriptorImageInfo(writeIndex.sampler, writeIndex.imageView, writeIndex.imageLayout);
-			break;
-		}
-
-		writes.push_back(write);
-	}
-
-	device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	updates.Flush();
 }
 
 void cp::DescriptorSetManager::UpdateDescriptorSets(const std::vector<std::string>& _names, const std::vector<DescriptorSetUpdate>& _writes)
@@ -93,31 +110,10 @@ void cp::DescriptorSetManager::UpdateDescriptorSets(const std::vector<std::strin
 			throw std::runtime_error("Descriptor set with name " + name + " does not exist");
 #endif
 
-	std::vector<vk::WriteDescriptorSet> writes;
-
 	for (size_t i = 0; i < _names.size(); i++)
-	{
-		vk::WriteDescriptorSet write = {};
-		write.dstSet = sets[_names[i]];
-		write.dstBinding = _writes[i].dstBinding;
-		write.dstArrayElement = _writes[i].dstArrayElement;
-		write.descriptorType = _writes[i].descriptorType;
-		write.descriptorCount = _writes[i].descriptorCount;
-
-		switch (_writes[i].updateType)
-		{
-		case DescriptorSetUpdateType::BUFFER:
-			write.pBufferInfo = new vk::DescriptorBufferInfo(_writes[i].buffer, _writes[i].offset, _writes[i].range);
-			break;
-		case DescriptorSetUpdateType::IMAGE:
-			write.pImageInfo = new vk::DescriptorImageInfo(_writes[i].sampler, _writes[i].imageView, _writes[i].imageLayout);
-			break;
-		}
-
-		writes.push_back(write);
-	}
+		updates.Write(sets[_names[i]], _writes[i]);
 
-	device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	updates.Flush();
 }
 
 vk::DescriptorSet cp::DescriptorSetManager::CreateDescriptorSet(const std::string& _name, const vk::DescriptorSetLayout& _layout)
@@ -142,74 +138,99 @@ std::vector<vk::DescriptorSet> cp::DescriptorSetManager::CreateDescriptorSets(co
 			throw std::runtime_error("Descriptor set with name " + name + " already exists");
 #endif
 
-	std::vector<vk::DescriptorSet> results = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(pool, static_cast<uint32_t>(_names.size()), _layouts.data()));
+	std::vector<vk::DescriptorSet> results;
+	results.reserve(_names.size());
 
 	for (size_t i = 0; i < _names.size(); i++)
+	{
+		results.push_back(AllocatePersistent(_layouts[i]));
 		sets[_names[i]] = results[i];
+	}
 
 	return results;
 }
 
 vk::DescriptorSet cp::DescriptorSetManager::CreateOrphanedDescriptorSet(const vk::DescriptorSetLayout& _layout)
 {
-	return device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(pool, 1, &_layout))[0];
+	return AllocatePersistent(_layout);
 }
 
 void cp::DescriptorSetManager::UpdateOrphanedDescriptorSet(const vk::DescriptorSet& _set, const DescriptorSetUpdate& _write)
 {
-	vk::WriteDescriptorSet write = {};
-	write.dstSet = _set;
-	write.dstBinding = _write.dstBinding;
-	write.dstArrayElement = _write.dstArrayElement;
-	write.descriptorType = _write.descriptorType;
-	write.descriptorCount = _write.descriptorCount;
+	updates.Write(_set, _write).Flush();
+}
+
+void cp::DescriptorSetManager::UpdateOrphanedDescriptorSet(const vk::DescriptorSet& _set, const std::vector<DescriptorSetUpdate>& _writes)
+{
+	for (const auto& write : _writes)
+		updates.Write(_set, write);
+
+	updates.Flush();
+}
 
-	switch (_write.updateType)
+vk::DescriptorSet cp::DescriptorSetManager::QueueUpdate(const vk::DescriptorSet& _set, const std::vector<DescriptorSetUpdate>& _writes)
+{
+	auto it = setLayouts.find(_set);
+	if (it == setLayouts.end())
 	{
-	case DescriptorSetUpdateType::BUFFER:
-		write.pBufferInfo = new vk::DescriptorBufferInfo(_write.buffer, _write.offset, _write.range);
-		break;
-	case DescriptorSetUpdateType::IMAGE:
-		write.pImageInfo = new vk::DescriptorImageInfo(_write.sampler, _write.imageView, _write.imageLayout);
-		break;
+		LOG_ERROR("Trying to queue an update for a descriptor set that wasn't allocated by the DescriptorSetManager");
+		throw std::runtime_error("Trying to queue an update for a descriptor set that wasn't allocated by the DescriptorSetManager");
 	}
 
-	device.updateDescriptorSets(1, &write, 0, nullptr);
+	vk::DescriptorSet set = AllocatePersistent(it->second);
+	Retire(_set);
+
+	for (const auto& write : _writes)
+		queuedUpdates.Write(set, write);
+
+	return set;
 }
 
-void cp::DescriptorSetManager::UpdateOrphanedDescriptorSet(const vk::DescriptorSet& _set, const std::vector<DescriptorSetUpdate>& _writes)
+vk::DescriptorSet cp::DescriptorSetManager::QueueUpdate(const std::string& _name, const std::vector<DescriptorSetUpdate>& _writes)
+{
+#ifdef _DEBUG
+	if (sets.find(_name) == sets.end())
+		throw std::runtime_error("Descriptor set with name " + _name + " does not exist");
+#endif
+
+	sets[_name] = QueueUpdate(sets[_name], _writes);
+	return sets[_name];
+}
+
+void cp::DescriptorSetManager::FlushQueuedUpdates()
+{
+	queuedUpdates.Flush();
+}
+
+cp::DescriptorUpdateTemplate& cp::DescriptorSetManager::GetOrCreateUpdateTemplate(const vk::DescriptorSetLayout& _layout, const std::vector<DescriptorTemplateEntry>& _entries)
 {
-	std::vector<vk::WriteDescriptorSet> writes;
+	auto it = updateTemplates.find(_layout);
+	if (it != updateTemplates.end())
+	{
+		return it->second;
+	}
+
+	return updateTemplates.emplace(_layout, cp::DescriptorUpdateTemplate(device, _layout, _entries)).first->second;
+}
 
-	for (const auto& writeIndex : _writes)
+void cp::DescriptorSetManager::ReleaseLayout(const vk::DescriptorSetLayout& _layout)
+{
+	auto it = updateTemplates.find(_layout);
+	if (it != updateTemplates.end())
 	{
-		vk::WriteDescriptorSet write = {};
-		write.dstSet = _set;
-		write.dstBinding = writeIndex.dstBinding;
-		write.dstArrayElement = writeIndex.dstArrayElement;
-		write.descriptorType = writeIndex.descriptorType;
-		write.descriptorCount = writeIndex.descriptorCount;
-
-		switch (writeIndex.updateType)
-		{
-		case DescriptorSetUpdateType::BUFFER:
-			write.pBufferInfo = new vk::DescriptorBufferInfo(writeIndex.buffer, writeIndex.offset, writeIndex.range);
-			break;
-		case DescriptorSetUpdateType::IMAGE:
-			write.pImageInfo = new vk::DescriptorImageInfo(writeIndex.sampler, writeIndex.imageView, writeIndex.imageLayout);
-			break;
-		}
-
-		writes.push_back(write);
+		it->second.Cleanup();
+		updateTemplates.erase(it);
 	}
 
-	device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	freeSets.erase(_layout); // Their descriptors go back to the pools when those are destroyed
 
+	// Retired sets of this layout must not reach the free list of a new layout reusing the handle
+	retiredSets.erase(std::remove_if(retiredSets.begin(), retiredSets.end(), [&_layout](const RetiredSet& _retired) { return _retired.layout == _layout; }), retiredSets.end());
 }
 
 void cp::DescriptorSetManager::DestroyOrphanedDescriptorSet(const vk::DescriptorSet& _set)
 {
-	device.freeDescriptorSets(pool, _set);
+	Retire(_set);
 }
 
 void cp::DescriptorSetManager::DestroyDescriptorSet(const std::string& _name)
@@ -219,14 +240,28 @@ void cp::DescriptorSetManager::DestroyDescriptorSet(const std::string& _name)
 		throw std::runtime_error("Descriptor set with name " + _name + " does not exist");
 #endif
 
-	device.freeDescriptorSets(pool, sets[_name]);
+	Retire(sets[_name]);
 	sets.erase(_name);
 }
 
 void cp::DescriptorSetManager::Cleanup()
 {
-	for (auto& set : sets)
-		device.freeDescriptorSets(pool, set.second);
+	for (auto& [layout, updateTemplate] : updateTemplates)
+		updateTemplate.Cleanup();
+
+	updateTemplates.clear();
+	updates.Clear();
+	queuedUpdates.Clear();
+
+	// Destroying the pools frees every set, named, orphaned and transient alike
+	persistentAllocator.Cleanup();
+
+	for (auto& allocator : frameAllocators)
+		allocator.Cleanup();
 
-	device.destroyDescriptorPool(pool);
+	frameAllocators.clear();
+	sets.clear();
+	setLayouts.clear();
+	freeSets.clear();
+	retiredSets.clear();
 }
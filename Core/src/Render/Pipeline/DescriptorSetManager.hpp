@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../../pch.hpp"
+#include "DescriptorAllocator.hpp"
+#include "DescriptorUpdateBuilder.hpp"
 
 namespace cp
 {
@@ -28,17 +30,43 @@ namespace cp
 		uint32_t descriptorCount;
 	};
 
+	// Long-lived sets come from a growable allocator and are recycled through free lists keyed by layout
+	// Transient sets come from one allocator per frame in flight, reset wholesale when that frame starts again
 	class DescriptorSetManager
 	{
 	private:
+		struct RetiredSet
+		{
+			vk::DescriptorSet set;
+			vk::DescriptorSetLayout layout;
+			uint64_t frame;
+		};
+
 		vk::Device device;
-		vk::DescriptorPool pool;
+
+		cp::DescriptorAllocator persistentAllocator;
+		std::vector<cp::DescriptorAllocator> frameAllocators;
+		uint32_t currentFrame = 0;
+		uint64_t frameCounter = 0;
 
 		std::unordered_map<std::string, vk::DescriptorSet> sets;
+		std::unordered_map<VkDescriptorSet, vk::DescriptorSetLayout> setLayouts; // Layout of every live long-lived set, so it can go back to the right free list
+		std::unordered_map<VkDescriptorSetLayout, std::vector<vk::DescriptorSet>> freeSets;
+		std::deque<RetiredSet> retiredSets; // Destroyed sets wait until no frame in flight can still reference them
+
+		cp::DescriptorUpdateBuilder updates; // Immediate updates, one driver call per Update* call
+		cp::DescriptorUpdateBuilder queuedUpdates; // Only ever targets sets no frame has bound yet, flushed at the start of the next frame
+		std::unordered_map<VkDescriptorSetLayout, cp::DescriptorUpdateTemplate> updateTemplates; // Evicted by ReleaseLayout, a destroyed layout handle can be reused by the driver
+
+		vk::DescriptorSet AllocatePersistent(const vk::DescriptorSetLayout& _layout);
+		void Retire(const vk::DescriptorSet& _set);
 
 	public:
 		DescriptorSetManager(vk::Device _device);
 
+		void BeginFrame(uint32_t _frameIndex); // Call once the frame pacer waited on the slot, resets that slot transient sets
+		vk::DescriptorSet AllocateTransientDescriptorSet(const vk::DescriptorSetLayout& _layout); // Only valid until the same frame index starts again
+
 		void Cleanup();
 
 		vk::DescriptorSet& GetDescriptorSet(const std::string& _name);
@@ -55,8 +83,18 @@ namespace cp
 		void UpdateOrphanedDescriptorSet(const vk::DescriptorSet& _set, const std::vector<DescriptorSetUpdate>& _writes);
 		void DestroyOrphanedDescriptorSet(const vk::DescriptorSet& _set);
 
+		// Copy on write, the frames in flight may be reading _set and it isn't update after bind, so the writes go to a new set with the same layout
+		// _set is retired and the new one returned, _writes must cover every binding the shaders read since the new set may be a recycled one
+		// The writes are batched with every other queued write, bind the returned set only after FlushQueuedUpdates or the next BeginFrame. Nothing queues updates yet
+		vk::DescriptorSet QueueUpdate(const vk::DescriptorSet& _set, const std::vector<DescriptorSetUpdate>& _writes);
+		vk::DescriptorSet QueueUpdate(const std::string& _name, const std::vector<DescriptorSetUpdate>& _writes); // Same, GetDescriptorSet(_name) returns the new set afterwards
+		void FlushQueuedUpdates();
+
+		cp::DescriptorUpdateTemplate& GetOrCreateUpdateTemplate(const vk::DescriptorSetLayout& _layout, const std::vector<DescriptorTemplateEntry>& _entries); // One template per layout, _entries is only read on creation
+		void ReleaseLayout(const vk::DescriptorSetLayout& _layout); // Before destroying a layout, drops its update template and recycled sets
+
 		void DestroyDescriptorSet(const std::string& _name);
 
-		inline constexpr const vk::DescriptorPool GetDescriptorPool() const { return pool; }
+		inline size_t GetPersistentPoolCount() const { return persistentAllocator.GetPoolCount(); }
 	};
 }
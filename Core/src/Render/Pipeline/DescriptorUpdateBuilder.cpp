@@ -0,0 +1,118 @@
+#include "pch.hpp"
+#include "DescriptorUpdateBuilder.hpp"
+
+#include "DescriptorSetManager.hpp"
+
+namespace cp
+{
+	DescriptorUpdateBuilder& DescriptorUpdateBuilder::Write(vk::DescriptorSet _set, const DescriptorSetUpdate& _update)
+	{
+		// DescriptorSetUpdate only carries one info, so it always writes a single descriptor
+		switch (_update.updateType)
+		{
+		case DescriptorSetUpdateType::BUFFER:
+			return WriteBuffer(_set, _update.dstBinding, _update.descriptorType, _update.buffer, _update.offset, _update.range, _update.dstArrayElement);
+		case DescriptorSetUpdateType::IMAGE:
+			return WriteImage(_set, _update.dstBinding, _update.descriptorType, _update.imageView, _update.sampler, _update.imageLayout, _update.dstArrayElement);
+		}
+
+		return *this;
+	}
+
+	DescriptorUpdateBuilder& DescriptorUpdateBuilder::WriteBuffer(vk::DescriptorSet _set, uint32_t _binding, vk::DescriptorType _type, vk::Buffer _buffer, vk::DeviceSize _offset, vk::DeviceSize _range, uint32_t _arrayElement)
+	{
+		pending.push_back({ _set, _binding, _arrayElement, 1, _type, false, bufferInfos.size() });
+		bufferInfos.emplace_back(_buffer, _offset, _range);
+
+		return *this;
+	}
+
+	DescriptorUpdateBuilder& DescriptorUpdateBuilder::WriteImage(vk::DescriptorSet _set, uint32_t _binding, vk::DescriptorType _type, vk::ImageView _view, vk::Sampler _sampler, vk::ImageLayout _layout, uint32_t _arrayElement)
+	{
+		pending.push_back({ _set, _binding, _arrayElement, 1, _type, true, imageInfos.size() });
+		imageInfos.emplace_back(_sampler, _view, _layout);
+
+		return *this;
+	}
+
+	DescriptorUpdateBuilder& DescriptorUpdateBuilder::WriteImages(vk::DescriptorSet _set, uint32_t _binding, vk::DescriptorType _type, const std::vector<vk::DescriptorImageInfo>& _images, uint32_t _firstArrayElement)
+	{
+		if (_images.empty()) return *this;
+
+		pending.push_back({ _set, _binding, _firstArrayElement, static_cast<uint32_t>(_images.size()), _type, true, imageInfos.size() });
+		imageInfos.insert(imageInfos.end(), _images.begin(), _images.end());
+
+		return *this;
+	}
+
+	void DescriptorUpdateBuilder::Flush()
+	{
+		if (pending.empty()) return;
+
+		writes.clear();
+		writes.reserve(pending.size());
+
+		for (const auto& write : pending)
+		{
+			vk::WriteDescriptorSet descriptorWrite = {};
+			descriptorWrite.dstSet = write.set;
+			descriptorWrite.dstBinding = write.binding;
+			descriptorWrite.dstArrayElement = write.arrayElement;
+			descriptorWrite.descriptorCount = write.count;
+			descriptorWrite.descriptorType = write.type;
+
+			if (write.isImage)
+				descriptorWrite.pImageInfo = imageInfos.data() + write.firstInfo;
+			else
+				descriptorWrite.pBufferInfo = bufferInfos.data() + write.firstInfo;
+
+			writes.push_back(descriptorWrite);
+		}
+
+		device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+		Clear();
+	}
+
+	void DescriptorUpdateBuilder::Clear()
+	{
+		pending.clear();
+		bufferInfos.clear();
+		imageInfos.clear();
+	}
+
+	DescriptorUpdateTemplate::DescriptorUpdateTemplate(vk::Device _device, vk::DescriptorSetLayout _layout, const std::vector<DescriptorTemplateEntry>& _entries) : device(_device)
+	{
+		std::vector<vk::DescriptorUpdateTemplateEntry> entries;
+		entries.reserve(_entries.size());
+
+		for (const auto& entry : _entries)
+		{
+			entries.emplace_back(entry.binding, 0, entry.count, entry.type, slotCount * sizeof(DescriptorTemplateSlot), sizeof(DescriptorTemplateSlot));
+			slotCount += entry.count;
+		}
+
+		vk::DescriptorUpdateTemplateCreateInfo templateInfo({}, entries, vk::DescriptorUpdateTemplateType::eDescriptorSet, _layout);
+		handle = device.createDescriptorUpdateTemplate(templateInfo);
+	}
+
+	void DescriptorUpdateTemplate::Update(vk::DescriptorSet _set, const std::vector<DescriptorTemplateSlot>& _slots) const
+	{
+		if (_slots.size() < slotCount)
+		{
+			LOG_ERROR(MF("Descriptor template expects ", slotCount, " slots, got ", _slots.size()));
+			return;
+		}
+
+		device.updateDescriptorSetWithTemplate(_set, handle, _slots.data());
+	}
+
+	void DescriptorUpdateTemplate::Cleanup()
+	{
+		if (handle)
+		{
+			device.destroyDescriptorUpdateTemplate(handle);
+			handle = nullptr;
+		}
+	}
+}
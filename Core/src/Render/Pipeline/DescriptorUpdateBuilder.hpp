@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../../pch.hpp"
+
+namespace cp
+{
+	struct DescriptorSetUpdate;
+
+	// Collects descriptor writes in contiguous arenas and submits them with a single updateDescriptorSets call
+	// Infos are stored by index and only turned into pointers on Flush, so the arenas can grow while writes are queued
+	class DescriptorUpdateBuilder
+	{
+	private:
+		struct PendingWrite
+		{
+			vk::DescriptorSet set;
+			uint32_t binding;
+			uint32_t arrayElement;
+			uint32_t count;
+			vk::DescriptorType type;
+			bool isImage;
+			size_t firstInfo; // In bufferInfos or imageInfos
+		};
+
+		vk::Device device;
+
+		std::vector<PendingWrite> pending;
+		std::vector<vk::DescriptorBufferInfo> bufferInfos;
+		std::vector<vk::DescriptorImageInfo> imageInfos;
+		std::vector<vk::WriteDescriptorSet> writes; // Kept around so Flush doesn't reallocate every frame
+
+	public:
+		DescriptorUpdateBuilder(vk::Device _device) : device(_device) {}
+
+		DescriptorUpdateBuilder& Write(vk::DescriptorSet _set, const DescriptorSetUpdate& _update);
+		DescriptorUpdateBuilder& WriteBuffer(vk::DescriptorSet _set, uint32_t _binding, vk::DescriptorType _type, vk::Buffer _buffer, vk::DeviceSize _offset = 0, vk::DeviceSize _range = VK_WHOLE_SIZE, uint32_t _arrayElement = 0);
+		DescriptorUpdateBuilder& WriteImage(vk::DescriptorSet _set, uint32_t _binding, vk::DescriptorType _type, vk::ImageView _view, vk::Sampler _sampler = {}, vk::ImageLayout _layout = vk::ImageLayout::eShaderReadOnlyOptimal, uint32_t _arrayElement = 0);
+		DescriptorUpdateBuilder& WriteImages(vk::DescriptorSet _set, uint32_t _binding, vk::DescriptorType _type, const std::vector<vk::DescriptorImageInfo>& _images, uint32_t _firstArrayElement = 0);
+
+		void Flush(); // Submits everything queued so far, arenas keep their capacity
+		void Clear();
+
+		inline bool IsEmpty() const { return pending.empty(); }
+		inline size_t GetPendingCount() const { return pending.size(); }
+	};
+
+	// One template slot per descriptor, large enough for any info type so entries share a single stride
+	union DescriptorTemplateSlot
+	{
+		vk::DescriptorBufferInfo buffer;
+		vk::DescriptorImageInfo image;
+		vk::BufferView texelBuffer;
+
+		DescriptorTemplateSlot() : buffer() {}
+	};
+
+	struct DescriptorTemplateEntry
+	{
+		uint32_t binding;
+		vk::DescriptorType type;
+		uint32_t count = 1;
+	};
+
+	// vkUpdateDescriptorSetWithTemplate wrapper for layouts that are rewritten often
+	// The data is a flat array of DescriptorTemplateSlot, entries laid out in order, count slots each
+	class DescriptorUpdateTemplate
+	{
+	private:
+		vk::Device device;
+		vk::DescriptorUpdateTemplate handle;
+		uint32_t slotCount = 0;
+
+	public:
+		DescriptorUpdateTemplate() = default;
+		DescriptorUpdateTemplate(vk::Device _device, vk::DescriptorSetLayout _layout, const std::vector<DescriptorTemplateEntry>& _entries);
+
+		void Update(vk::DescriptorSet _set, const std::vector<DescriptorTemplateSlot>& _slots) const;
+		void Cleanup();
+
+		inline constexpr uint32_t GetSlotCount() const { return slotCount; }
+		inline constexpr vk::DescriptorUpdateTemplate GetHandle() const { return handle; }
+	};
+}
@@ -8,13 +8,20 @@ namespace cp
 
 	}
 
-	vk::PipelineLayout LayoutsManager::GetOrCreateLayout(const std::vector<vk::DescriptorSetLayout>& _descriptorSetLayouts, const std::vector<vk::PushConstantRange>& _pushConstantRanges)
+	vk::PipelineLayout LayoutsManager::GetOrCreateLayout(const std::vector<vk::DescriptorSetLayout>& _descriptorSetLayouts, const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& _setBindings, const std::vector<vk::PushConstantRange>& _pushConstantRanges)
 	{
-		std::size_t hash = HashLayout(_descriptorSetLayouts, _pushConstantRanges);
+		if (_descriptorSetLayouts.size() != _setBindings.size())
+		{
+			LOG_ERROR(MF("Pipeline layout got ", _descriptorSetLayouts.size(), " set layouts but the bindings of ", _setBindings.size()));
+			throw std::runtime_error("Pipeline layout set layouts and bindings don't match");
+		}
+
+		std::string key = GetContentKey(_setBindings, _pushConstantRanges);
 
-		if (layouts.find(hash) == layouts.end())
+		LayoutEntry& entry = layouts[key];
+		if (!entry.layout)
 		{
-			LOG_TRACE(MF("Creating new pipeline layout [", hash, "]"));
+			LOG_TRACE(MF("Creating new pipeline layout (", _descriptorSetLayouts.size(), " sets, ", _pushConstantRanges.size(), " push constant ranges)"));
 
 			vk::PipelineLayoutCreateInfo createInfo = {
 				{},
@@ -24,52 +31,84 @@ namespace cp
 				_pushConstantRanges.data()
 			};
 
-			layouts[hash] = device.createPipelineLayout(createInfo);
+			// The set layouts are only read here, their owner may destroy them while the pipeline layout lives on
+			entry.layout = device.createPipelineLayout(createInfo);
+			keys[entry.layout] = key;
 		}
 
-		return layouts[hash];
+		entry.references++;
+
+		return entry.layout;
 	}
 
 	void LayoutsManager::UnloadLayout(vk::PipelineLayout _layout)
 	{
-		for (auto it = layouts.begin(); it != layouts.end(); ++it)
+		auto keyIt = keys.find(_layout);
+		if (keyIt == keys.end())
 		{
-			if (it->second == _layout)
-			{
-				device.destroyPipelineLayout(it->second);
-				layouts.erase(it);
-				LOG_TRACE("Unloaded pipeline layout");
-				break;
-			}
+			LOG_WARNING("Pipeline layout not found");
+			return;
 		}
-		
-		LOG_WARNING("Pipeline layout not found");
+
+		auto it = layouts.find(keyIt->second);
+		if (--it->second.references > 0) return;
+
+		device.destroyPipelineLayout(it->second.layout);
+		layouts.erase(it);
+		keys.erase(keyIt);
+		LOG_TRACE("Unloaded pipeline layout");
+	}
+
+	const std::string& LayoutsManager::GetLayoutKey(vk::PipelineLayout _layout) const
+	{
+		auto it = keys.find(_layout);
+		if (it == keys.end())
+		{
+			LOG_ERROR("Pipeline layout wasn't created by the LayoutsManager");
+			throw std::runtime_error("Pipeline layout wasn't created by the LayoutsManager");
+		}
+
+		return it->second;
 	}
 
 	void LayoutsManager::Cleanup()
 	{
 		for (auto& layout : layouts)
 		{
-			device.destroyPipelineLayout(layout.second);
+			device.destroyPipelineLayout(layout.second.layout);
 		}
+
+		layouts.clear();
+		keys.clear();
 	}
 
-	std::size_t LayoutsManager::HashLayout(const std::vector<vk::DescriptorSetLayout>& _descriptorSetLayouts, const std::vector<vk::PushConstantRange>& _pushConstantRanges) const
+	std::string LayoutsManager::GetContentKey(const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& _setBindings, const std::vector<vk::PushConstantRange>& _pushConstantRanges)
 	{
-		std::size_t hash = 0;
+		std::string key;
+		auto Append = [&key](uint32_t _value) { key.append(reinterpret_cast<const char*>(&_value), sizeof(_value)); };
 
-		for (const auto& layout : _descriptorSetLayouts)
+		// Counts first, so the sets and ranges can't be split differently
+		Append(static_cast<uint32_t>(_setBindings.size()));
+		for (const auto& bindings : _setBindings)
 		{
-			hash ^= std::hash<std::uint64_t>()(reinterpret_cast<std::uint64_t>(VkDescriptorSetLayout(layout))) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			Append(static_cast<uint32_t>(bindings.size()));
+			for (const auto& binding : bindings)
+			{
+				Append(binding.binding);
+				Append(static_cast<uint32_t>(binding.descriptorType));
+				Append(binding.descriptorCount);
+				Append(static_cast<VkShaderStageFlags>(binding.stageFlags));
+			}
 		}
 
+		Append(static_cast<uint32_t>(_pushConstantRanges.size()));
 		for (const auto& range : _pushConstantRanges)
 		{
-			hash ^= std::hash<std::uint32_t>()(range.offset) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
-			hash ^= std::hash<std::uint32_t>()(range.size) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
-			hash ^= std::hash<std::uint32_t>()(VkShaderStageFlags(range.stageFlags)) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			Append(range.offset);
+			Append(range.size);
+			Append(static_cast<VkShaderStageFlags>(range.stageFlags));
 		}
 
-		return hash;
+		return key;
 	}
-}
\ No newline at end of file
+}
@@ -4,21 +4,33 @@
 
 namespace cp
 {
+	// Pipeline layouts are keyed by content, the bindings of every set and the push constant ranges, never by the set layout handles
+	// Identically defined layouts are compatible, so materials with the same bindings share one layout and can share pipelines keyed by GetLayoutKey
 	class LayoutsManager
 	{
 	private:
+		struct LayoutEntry
+		{
+			vk::PipelineLayout layout;
+			uint32_t references = 0;
+		};
+
 		vk::Device device;
 
-		std::unordered_map<std::size_t, vk::PipelineLayout> layouts;
+		std::unordered_map<std::string, LayoutEntry> layouts; // Content key -> layout
+		std::unordered_map<VkPipelineLayout, std::string> keys;
 
-		std::size_t HashLayout(const std::vector<vk::DescriptorSetLayout>& _descriptorSetLayouts, const std::vector<vk::PushConstantRange>& _pushConstantRanges) const;
+		static std::string GetContentKey(const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& _setBindings, const std::vector<vk::PushConstantRange>& _pushConstantRanges);
 
 	public:
 		LayoutsManager(vk::Device _device);
 
-		vk::PipelineLayout GetOrCreateLayout(const std::vector<vk::DescriptorSetLayout>& _descriptorSetLayouts, const std::vector<vk::PushConstantRange>& _pushConstantRanges);
-		void UnloadLayout(vk::PipelineLayout _layout);
+		// _setBindings holds the bindings _descriptorSetLayouts were created with, immutable samplers aren't supported. Every call takes a reference
+		vk::PipelineLayout GetOrCreateLayout(const std::vector<vk::DescriptorSetLayout>& _descriptorSetLayouts, const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& _setBindings, const std::vector<vk::PushConstantRange>& _pushConstantRanges);
+		void UnloadLayout(vk::PipelineLayout _layout); // Drops one reference, the last one destroys the layout
+
+		const std::string& GetLayoutKey(vk::PipelineLayout _layout) const; // PipelineCreateData::layoutKey
 
 		void Cleanup();
 	};
-}
\ No newline at end of file
+}
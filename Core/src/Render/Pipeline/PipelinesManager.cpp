@@ -1,51 +1,404 @@
 #include "pch.hpp"
 #include "PipelinesManager.hpp"
+#include "../Setup/FramePacer.hpp"
+
+#include <iomanip>
 
 namespace cp
 {
-	PipelinesManager::PipelinesManager(vk::Device _device)
+	PipelinesManager::PipelinesManager(vk::Device _device, vk::PhysicalDevice _physicalDevice, const std::string& _cacheDirectory)
 		: device(_device)
 	{
+		vk::PhysicalDeviceProperties properties = _physicalDevice.getProperties();
+
+		// The driver rejects caches from another device or driver version anyway, keeping one file per pair avoids thrashing when switching GPUs
+		std::stringstream fileName;
+		fileName << "pipelines_" << std::hex << properties.vendorID << "_" << properties.deviceID << "_" << properties.driverVersion << "_";
+		for (uint8_t byte : properties.pipelineCacheUUID)
+		{
+			fileName << std::setw(2) << std::setfill('0') << static_cast<uint32_t>(byte);
+		}
+		fileName << ".bin";
+
+		cachePath = (std::filesystem::path(_cacheDirectory) / fileName.str()).string();
+
+		LoadPipelineCache(_physicalDevice);
+
+		workers = std::make_unique<cp::ThreadPool>();
+	}
+
+	void GraphicsPipelineState::Apply(vk::GraphicsPipelineCreateInfo& _createInfo)
+	{
+		dynamicState.setDynamicStates(dynamicStates);
+		colorBlendState.setAttachments(colorBlendAttachments);
+		vertexInputState.setVertexBindingDescriptions(vertexBindings);
+		vertexInputState.setVertexAttributeDescriptions(vertexAttributes);
+		specializationInfo.setMapEntries(specializationEntries);
+		specializationInfo.setData<uint32_t>(specializationData);
+
+		_createInfo.pDynamicState = &dynamicState;
+		_createInfo.pViewportState = &viewportState;
+		_createInfo.pRasterizationState = &rasterizationState;
+		_createInfo.pMultisampleState = &multisampleState;
+		_createInfo.pDepthStencilState = &depthStencilState;
+		_createInfo.pColorBlendState = &colorBlendState;
+		_createInfo.pInputAssemblyState = &inputAssemblyState;
+		_createInfo.pVertexInputState = &vertexInputState;
+
+		if (attachmentFormats)
+		{
+			renderingInfo.setColorAttachmentFormats(attachmentFormats->colors);
+			renderingInfo.depthAttachmentFormat = attachmentFormats->depth;
+			renderingInfo.stencilAttachmentFormat = attachmentFormats->stencil;
+
+			_createInfo.pNext = &renderingInfo;
+			_createInfo.renderPass = nullptr;
+			_createInfo.subpass = 0;
+		}
+	}
+
+	vk::ShaderStageFlags PipelineData::GetPushConstantStages(uint32_t _offset, uint32_t _size) const
+	{
+		vk::ShaderStageFlags stages;
+		bool covered = false;
+
+		// vkCmdPushConstants needs the stages of every range touching the bytes, not just the one holding them
+		for (const auto& range : pushConstantRanges)
+		{
+			if (_offset >= range.offset + range.size || range.offset >= _offset + _size) continue;
+
+			stages |= range.stageFlags;
+			covered |= range.offset <= _offset && _offset + _size <= range.offset + range.size;
+		}
+
+		if (!covered)
+		{
+			LOG_ERROR(MF("Pipeline [", config.name, "] has no push constant range for bytes ", _offset, " to ", _offset + _size));
+			return {};
+		}
+
+		return stages;
+	}
+
+	void PipelinesManager::LoadPipelineCache(vk::PhysicalDevice _physicalDevice)
+	{
+		std::vector<char> data;
+
+		std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+		if (file.is_open())
+		{
+			data.resize(static_cast<size_t>(file.tellg()));
+			file.seekg(0);
+			file.read(data.data(), static_cast<std::streamsize>(data.size()));
+		}
+
+		// Validate the header ourselves, some drivers crash on foreign data instead of ignoring it
+		if (!data.empty())
+		{
+			vk::PhysicalDeviceProperties properties = _physicalDevice.getProperties();
+
+			VkPipelineCacheHeaderVersionOne header{};
+			bool valid = data.size() >= sizeof(header);
+
+			if (valid)
+			{
+				std::memcpy(&header, data.data(), sizeof(header));
+				valid = header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+					&& header.vendorID == properties.vendorID
+					&& header.deviceID == properties.deviceID
+					&& std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+			}
+
+			if (!valid)
+			{
+				LOG_WARNING(MF("Discarding incompatible pipeline cache [", cachePath, "]"));
+				data.clear();
+			}
+		}
+
+		vk::PipelineCacheCreateInfo cacheInfo({}, data.size(), data.empty() ? nullptr : data.data());
+		pipelineCache = device.createPipelineCache(cacheInfo);
+
+		LOG_TRACE(MF("Pipeline cache loaded [", cachePath, "] (", data.size(), " bytes)"));
+	}
+
+	void PipelinesManager::SavePipelineCache() const
+	{
+		std::vector<uint8_t> data = device.getPipelineCacheData(pipelineCache);
+		if (data.empty()) return;
+
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+		std::string tempPath = cachePath + ".tmp";
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			LOG_WARNING(MF("Failed to open pipeline cache for writing: ", cachePath));
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		bool success = file.good();
+		file.close();
+
+		if (!success)
+		{
+			std::filesystem::remove(tempPath, error);
+			return;
+		}
+
+		std::filesystem::rename(tempPath, cachePath, error);
+
+		LOG_TRACE(MF("Pipeline cache saved [", cachePath, "] (", data.size(), " bytes)"));
+	}
+
+	std::shared_ptr<const std::vector<char>> PipelinesManager::GetShaderCode(const std::string& _path)
+	{
+		std::error_code error;
+		auto writeTime = std::filesystem::last_write_time(_path, error);
+
+		std::lock_guard<std::mutex> lock(shaderCodesMutex);
+
+		auto it = shaderCodes.find(_path);
+		if (it != shaderCodes.end() && it->second.writeTime == writeTime)
+		{
+			return it->second.code;
+		}
+
+		// Jobs still compiling the previous version keep it alive through their own reference
+		auto code = std::make_shared<const std::vector<char>>(Helper::File::ReadShaderFile(_path));
+		shaderCodes[_path] = { code, writeTime };
+
+		return code;
+	}
+
+	void PipelinesManager::ComputeKey(PipelineCreateData& _pipelineData, const std::shared_ptr<const std::vector<char>>& _code)
+	{
+		// The shader code and entry points complete the state appended by the caller
+		PipelineConfig& config = _pipelineData.config;
+		if (!config.HasState()) return;
+
+		for (const auto& [stage, entryPoint] : _pipelineData.mains)
+		{
+			config.AppendState(static_cast<VkShaderStageFlags>(stage));
+			config.AppendState(entryPoint);
+		}
+
+		// Handles are reused by the driver once destroyed, a key holding them could hand back a pipeline built for another layout or pass
+		if ((_pipelineData.createInfo.layout && _pipelineData.layoutKey.empty()) || (_pipelineData.createInfo.renderPass && _pipelineData.renderPassKey.empty()))
+		{
+			LOG_ERROR(MF("Pipeline [", config.name, "] has a state but no layout or render pass key"));
+			throw std::runtime_error("Pipeline state is missing its layout or render pass key");
+		}
+
+		config.AppendState(_pipelineData.layoutKey);
+		config.AppendState(_pipelineData.renderPassKey);
+		config.AppendState(_pipelineData.createInfo.subpass);
+		if (_pipelineData.state && _pipelineData.state->attachmentFormats)
+		{
+			const AttachmentFormats& formats = *_pipelineData.state->attachmentFormats;
+
+			config.AppendState(static_cast<uint32_t>(formats.colors.size()));
+			for (vk::Format color : formats.colors)
+			{
+				config.AppendState(static_cast<VkFormat>(color));
+			}
+			config.AppendState(static_cast<VkFormat>(formats.depth));
+			config.AppendState(static_cast<VkFormat>(formats.stencil));
+		}
+
+		Helper::Hash::CombineHashes(config.stateHash, std::string_view(_code->data(), _code->size()));
+		config.shaderCode = _code;
+	}
+
+	vk::Pipeline PipelinesManager::Compile(PipelineCreateData& _pipelineData, const std::vector<char>& _code) const
+	{
+		if (_pipelineData.state)
+		{
+			_pipelineData.state->Apply(_pipelineData.createInfo);
+		}
+
+		vk::ShaderModuleCreateInfo moduleInfo({}, _code.size(), reinterpret_cast<const uint32_t*>(_code.data()));
+		vk::ShaderModule shaderModule;
+		vk::Result smResult = device.createShaderModule(&moduleInfo, nullptr, &shaderModule);
+
+		if (smResult != vk::Result::eSuccess)
+		{
+			LOG_ERROR(MF("Error creating the shader module code", smResult));
+			return nullptr;
+		}
+
+		const vk::SpecializationInfo* specializationInfo = _pipelineData.state ? _pipelineData.state->GetSpecializationInfo() : nullptr;
+
+		vk::Pipeline pipeline;
+
+		// The module is destroyed on every path, createGraphicsPipeline throws on failure
+		try
+		{
+			std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
+			for (const auto& path : _pipelineData.mains)
+			{
+				shaderStages.push_back(vk::PipelineShaderStageCreateInfo({}, path.first, shaderModule, path.second.c_str(), specializationInfo));
+			}
+
+			_pipelineData.createInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+			_pipelineData.createInfo.pStages = shaderStages.data();
 
+			pipeline = device.createGraphicsPipeline(pipelineCache, _pipelineData.createInfo, nullptr).value;
+		}
+		catch (...)
+		{
+			device.destroyShaderModule(shaderModule);
+			throw;
+		}
+
+		device.destroyShaderModule(shaderModule);
+
+		return pipeline;
 	}
 
 	PipelineData& PipelinesManager::CreatePipeline(PipelineCreateData& _pipelineData)
 	{
+		auto code = GetShaderCode(_pipelineData.shaderFile);
+		ComputeKey(_pipelineData, code);
+
+		auto it = pipelines.find(_pipelineData.config);
+		if (it != pipelines.end())
+		{
+			LOG_TRACE(MF("Reusing pipeline [", it->second.config.name, "] for [", _pipelineData.config.name, "]"));
+			it->second.references++;
+			return it->second;
+		}
+
 		PipelineData data;
 
 		LOG_TRACE(MF("Creating new pipeline [", _pipelineData.config.name, "]"));
 
 		data.shaderFile = _pipelineData.shaderFile;
 		data.mains = _pipelineData.mains;
+		data.config = _pipelineData.config;
+		data.references = 1;
+		data.pipeline = Compile(_pipelineData, *code);
+		data.pipelineLayout = _pipelineData.createInfo.layout;
+		data.descriptorSetLayouts = _pipelineData.descriptorSetLayouts;
+		data.pushConstantRanges = _pipelineData.pushConstantRanges;
 
-		std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
-		auto code = Helper::File::ReadShaderFile(_pipelineData.shaderFile);
+		pipelines[_pipelineData.config] = data;
 
-		vk::ShaderModule shaderModule;
-		vk::Result smResult = device.createShaderModule(new vk::ShaderModuleCreateInfo({}, code.size(), reinterpret_cast<const uint32_t*>(code.data())), nullptr, &shaderModule);
+		return pipelines[_pipelineData.config];
+	}
 
-		if (smResult != vk::Result::eSuccess)
+	PipelineData& PipelinesManager::CreatePipelineAsync(PipelineCreateData _pipelineData)
+	{
+		if (!_pipelineData.state)
 		{
-			LOG_ERROR(MF("Error creating the shader module code", smResult));
+			LOG_WARNING(MF("Pipeline [", _pipelineData.config.name, "] has no owned state, compiling it synchronously"));
+			return CreatePipeline(_pipelineData);
 		}
 
-		for (const auto& path : _pipelineData.mains)
+		auto code = GetShaderCode(_pipelineData.shaderFile);
+		ComputeKey(_pipelineData, code);
+
+		auto it = pipelines.find(_pipelineData.config);
+		if (it != pipelines.end())
 		{
-			shaderStages.push_back(vk::PipelineShaderStageCreateInfo({}, path.first, shaderModule, path.second.c_str()));
+			it->second.references++;
+			return it->second;
 		}
 
-		_pipelineData.createInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
-		_pipelineData.createInfo.pStages = shaderStages.data();
+		LOG_TRACE(MF("Queuing pipeline [", _pipelineData.config.name, "]"));
 
-		data.pipeline = device.createGraphicsPipeline({}, _pipelineData.createInfo, nullptr).value;
+		PipelineData& data = pipelines[_pipelineData.config];
+		data.shaderFile = _pipelineData.shaderFile;
+		data.mains = _pipelineData.mains;
+		data.config = _pipelineData.config;
+		data.references = 1;
+		data.pending = true;
 		data.pipelineLayout = _pipelineData.createInfo.layout;
 		data.descriptorSetLayouts = _pipelineData.descriptorSetLayouts;
+		data.pushConstantRanges = _pipelineData.pushConstantRanges;
 
-		device.destroyShaderModule(shaderModule);
+		workers->Submit([this, createData = std::move(_pipelineData), code]() mutable {
+			vk::Pipeline pipeline;
 
-		pipelines[_pipelineData.config] = data;
+			// Always hand a result back, a PipelineData left pending would wait for it forever
+			try
+			{
+				pipeline = Compile(createData, *code);
+			}
+			catch (const std::exception& e)
+			{
+				LOG_ERROR(MF("Pipeline [", createData.config.name, "] threw while compiling: ", e.what()));
+				pipeline = nullptr;
+			}
+			catch (...)
+			{
+				LOG_ERROR(MF("Pipeline [", createData.config.name, "] threw while compiling"));
+				pipeline = nullptr;
+			}
 
-		return pipelines[_pipelineData.config];
+			std::lock_guard<std::mutex> lock(compiledMutex);
+			compiled.push_back({ createData.config, pipeline });
+		});
+
+		return data;
+	}
+
+	static_assert(PipelinesManager::RETIRE_FRAMES > FramePacer::MAX_FRAMES_IN_FLIGHT, "A retired pipeline may still be used by every frame in flight");
+
+	void PipelinesManager::Update()
+	{
+		PublishCompiled();
+
+		frameCounter++;
+
+		while (!retiredPipelines.empty() && retiredPipelines.front().frame + RETIRE_FRAMES <= frameCounter)
+		{
+			device.destroyPipeline(retiredPipelines.front().pipeline);
+			retiredPipelines.pop_front();
+		}
+	}
+
+	void PipelinesManager::PublishCompiled()
+	{
+		std::vector<CompiledPipeline> finished;
+
+		{
+			std::lock_guard<std::mutex> lock(compiledMutex);
+			finished.swap(compiled);
+		}
+
+		for (auto& result : finished)
+		{
+			auto it = pipelines.find(result.config);
+
+			// Destroyed or recompiled while the job was running, nobody is waiting for this one
+			if (it == pipelines.end() || !it->second.pending)
+			{
+				if (result.pipeline) device.destroyPipeline(result.pipeline);
+				continue;
+			}
+
+			it->second.pipeline = result.pipeline;
+			it->second.pending = false;
+			it->second.failed = !result.pipeline;
+
+			if (it->second.failed)
+			{
+				LOG_ERROR(MF("Pipeline [", result.config.name, "] failed to compile"));
+				continue;
+			}
+
+			LOG_TRACE(MF("Pipeline [", result.config.name, "] ready"));
+		}
+	}
+
+	void PipelinesManager::WaitIdle()
+	{
+		workers->WaitIdle();
+		PublishCompiled();
 	}
 
 	PipelineData& PipelinesManager::GetPipeline(const PipelineCreateData& _pipelineData)
@@ -59,7 +412,9 @@ namespace cp
 
 		if (it != pipelines.end())
 		{
-			device.destroyPipeline(it->second.pipeline);
+			if (--it->second.references > 0) return;
+
+			if (it->second.pipeline) retiredPipelines.push_back({ it->second.pipeline, frameCounter }); // Pending pipelines are destroyed by Update once their job finishes
 			pipelines.erase(it);
 		}
 		else
@@ -70,9 +425,25 @@ namespace cp
 
 	void PipelinesManager::Cleanup()
 	{
+		WaitIdle();
+		workers.reset();
+
+		SavePipelineCache();
+
 		for (auto& pipeline : pipelines)
 		{
 			device.destroyPipeline(pipeline.second.pipeline);
 		}
+
+		for (const auto& retired : retiredPipelines)
+		{
+			device.destroyPipeline(retired.pipeline);
+		}
+
+		pipelines.clear();
+		retiredPipelines.clear();
+		shaderCodes.clear();
+
+		device.destroyPipelineCache(pipelineCache);
 	}
-}
\ No newline at end of file
+}
@@ -1,36 +1,123 @@
 #pragma once
 
 #include "../../pch.hpp"
+#include "../../Util/ThreadPool.hpp"
 
 namespace cp
 {
+	struct PipelineConfig
+	{
+		std::string name; // Debug label, and the key of pipelines created without a state
+		std::size_t stateHash = 0; // Hash of stateKey and shaderCode, only used to find the bucket
+		std::string stateKey; // Raw bytes of everything that changes the compiled pipeline, compared on lookup so a hash collision can't return another pipeline
+		std::shared_ptr<const std::vector<char>> shaderCode; // Set by CreatePipeline, compared by content
+
+		template<typename T>
+		inline void AppendState(const T& _value) // Folds one value into both the hash and the exact key
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Pipeline state is compared bytewise");
+
+			Helper::Hash::CombineHashes(stateHash, std::string_view(reinterpret_cast<const char*>(&_value), sizeof(T)));
+			stateKey.append(reinterpret_cast<const char*>(&_value), sizeof(T));
+		}
+
+		inline void AppendState(const std::string& _value)
+		{
+			AppendState(_value.size()); // Length first, so consecutive strings can't be split differently
+			Helper::Hash::CombineHashes(stateHash, _value);
+			stateKey.append(_value);
+		}
+
+		inline bool HasState() const { return !stateKey.empty(); }
+
+		bool operator==(const PipelineConfig& other) const
+		{
+			if (HasState() || other.HasState())
+			{
+				if (stateHash != other.stateHash || stateKey != other.stateKey) return false;
+				return shaderCode == other.shaderCode || (shaderCode && other.shaderCode && *shaderCode == *other.shaderCode);
+			}
+
+			return name == other.name;
+		}
+	};
+
+	struct PipelineConfigHasher
+	{
+		std::size_t operator()(const PipelineConfig& config) const
+		{
+			return config.HasState() ? config.stateHash : std::hash<std::string>()(config.name);
+		}
+	};
+
 	struct PipelineData
 	{
 		vk::Pipeline pipeline;
 		vk::PipelineLayout pipelineLayout;
 		std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+		std::vector<vk::PushConstantRange> pushConstantRanges; // Ranges pipelineLayout was created with
 
 		std::string shaderFile;
 		std::vector<std::pair<vk::ShaderStageFlagBits, std::string>> mains;
-	};
 
-	struct PipelineConfig
-	{
-		std::string name;
-		// TODO : Populate with more data such as bools for depth testing, alpha blending, etc.
+		PipelineConfig config; // Key the pipeline is stored under, pass it back to DestroyPipeline
+		uint32_t references = 0; // Identical states share one pipeline, it is destroyed with its last user
+		bool pending = false; // Still compiling on a worker, pipeline is null until PipelinesManager::Update picks up the result
+		bool failed = false; // Compilation finished without a pipeline, users keep their fallback instead of waiting
 
-		bool operator==(const PipelineConfig& other) const
+		inline bool IsReady() const { return !pending && pipeline; }
+		inline bool HasFailed() const { return !pending && failed; }
+
+		vk::ShaderStageFlags GetPushConstantStages(uint32_t _offset, uint32_t _size) const; // Every stage whose range overlaps the bytes, empty if a byte is outside all ranges
+
+		// Typed per draw values, no descriptor or buffer update involved, e.g. BindlessDrawConstants (the first instance comes from drawIndexed)
+		template<typename T>
+		inline void PushConstants(vk::CommandBuffer _commandBuffer, const T& _value, uint32_t _offset = 0) const
 		{
-			return name == other.name; //TODO : Add more checks when more data is added
+			static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % 4 == 0, "Push constants are copied as raw 32 bit words");
+
+			vk::ShaderStageFlags stages = GetPushConstantStages(_offset, sizeof(T));
+			if (!stages) return;
+
+			_commandBuffer.pushConstants(pipelineLayout, stages, _offset, sizeof(T), &_value);
 		}
 	};
 
-	struct PipelineConfigHasher
+	// What a dynamic rendering pipeline is compiled against instead of a render pass, any pass with the same formats can use it
+	struct AttachmentFormats
 	{
-		std::size_t operator()(const PipelineConfig& config) const
-		{
-			return std::hash<std::string>()(config.name); //TODO : Add more hashes when more data is added
-		}
+		std::vector<vk::Format> colors;
+		vk::Format depth = vk::Format::eUndefined;
+		vk::Format stencil = vk::Format::eUndefined;
+
+		inline bool IsEmpty() const { return colors.empty() && depth == vk::Format::eUndefined && stencil == vk::Format::eUndefined; }
+	};
+
+	// Owns every fixed function state struct a graphics pipeline points to, so the create info can outlive the function that filled it
+	struct GraphicsPipelineState
+	{
+		std::vector<vk::DynamicState> dynamicStates;
+		vk::PipelineDynamicStateCreateInfo dynamicState;
+		vk::PipelineViewportStateCreateInfo viewportState;
+		vk::PipelineRasterizationStateCreateInfo rasterizationState;
+		vk::PipelineMultisampleStateCreateInfo multisampleState;
+		vk::PipelineDepthStencilStateCreateInfo depthStencilState;
+		std::vector<vk::PipelineColorBlendAttachmentState> colorBlendAttachments;
+		vk::PipelineColorBlendStateCreateInfo colorBlendState;
+		vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState;
+		std::vector<vk::VertexInputBindingDescription> vertexBindings;
+		std::vector<vk::VertexInputAttributeDescription> vertexAttributes;
+		vk::PipelineVertexInputStateCreateInfo vertexInputState;
+
+		std::vector<vk::SpecializationMapEntry> specializationEntries; // Shared by every stage, one 32 bit value per entry
+		std::vector<uint32_t> specializationData;
+		vk::SpecializationInfo specializationInfo;
+
+		std::optional<AttachmentFormats> attachmentFormats; // Dynamic rendering, set instead of the create info render pass
+		vk::PipelineRenderingCreateInfo renderingInfo;
+
+		void Apply(vk::GraphicsPipelineCreateInfo& _createInfo); // Links the arrays into their create infos and points _createInfo at them
+		inline const vk::SpecializationInfo* GetSpecializationInfo() const { return specializationEntries.empty() ? nullptr : &specializationInfo; }
 	};
 
 	struct PipelineCreateData
@@ -40,21 +127,75 @@ namespace cp
 		std::string shaderFile;
 		std::vector<std::pair<vk::ShaderStageFlagBits, std::string>> mains;
 		std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+		std::vector<vk::PushConstantRange> pushConstantRanges;
+		std::string layoutKey; // LayoutsManager::GetLayoutKey of createInfo.layout, pipelines are keyed by layout content instead of the handle
+		std::string renderPassKey; // RenderpassDescription::GetCompatibilityKey, required with createInfo.renderPass for the same reason
+		std::shared_ptr<GraphicsPipelineState> state; // Required by CreatePipelineAsync, otherwise createInfo may point to caller owned state
 	};
 
+	// Pipelines are keyed by their full state, creating the same state twice returns the existing pipeline
+	// Every pipeline goes through a vk::PipelineCache saved per device and driver, so relaunching skips most of the compilation
+	// CreatePipelineAsync compiles on worker threads sharing that cache, callers render with a fallback until IsReady
 	class PipelinesManager
 	{
 	protected:
+		struct ShaderCode
+		{
+			std::shared_ptr<const std::vector<char>> code;
+			std::filesystem::file_time_type writeTime;
+		};
+
+		struct CompiledPipeline
+		{
+			PipelineConfig config;
+			vk::Pipeline pipeline;
+		};
+
+		struct RetiredPipeline
+		{
+			vk::Pipeline pipeline;
+			uint64_t frame;
+		};
+
 		std::unordered_map<PipelineConfig, cp::PipelineData, PipelineConfigHasher> pipelines;
 
 		vk::Device device;
+		vk::PipelineCache pipelineCache; // Internally synchronized, shared by every worker
+		std::string cachePath;
+
+		std::unordered_map<std::string, ShaderCode> shaderCodes; // SPIR-V by path, reloaded when the file changes on disk
+		std::mutex shaderCodesMutex;
+
+		std::unique_ptr<cp::ThreadPool> workers;
+		std::vector<CompiledPipeline> compiled; // Finished jobs, handed over to their PipelineData on the main thread
+		std::mutex compiledMutex;
+
+		std::deque<RetiredPipeline> retiredPipelines; // Destroyed pipelines wait until no frame in flight can still be drawing with them
+		uint64_t frameCounter = 0;
+
+		void LoadPipelineCache(vk::PhysicalDevice _physicalDevice);
+		void SavePipelineCache() const;
+
+		std::shared_ptr<const std::vector<char>> GetShaderCode(const std::string& _path);
+		static void ComputeKey(PipelineCreateData& _pipelineData, const std::shared_ptr<const std::vector<char>>& _code); // Pure, no device involved
+		vk::Pipeline Compile(PipelineCreateData& _pipelineData, const std::vector<char>& _code) const;
+		void PublishCompiled();
 
 	public:
-		PipelinesManager(vk::Device device);
+		static constexpr uint64_t RETIRE_FRAMES = 4; // Updates a destroyed pipeline is kept alive, FramePacer::MAX_FRAMES_IN_FLIGHT plus the frame being recorded when it was destroyed
 
-		PipelineData& CreatePipeline(PipelineCreateData& _pipelineData);
+		PipelinesManager(vk::Device _device, vk::PhysicalDevice _physicalDevice, const std::string& _cacheDirectory = "Cache");
+
+		PipelineData& CreatePipeline(PipelineCreateData& _pipelineData); // Writes the final key back into _pipelineData.config
+		PipelineData& CreatePipelineAsync(PipelineCreateData _pipelineData); // Returns at once, pending until a later Update
 		PipelineData& GetPipeline(const PipelineCreateData& _pipelineData);
-		void DestroyPipeline(const PipelineConfig& _pipelineConfig);
+		void DestroyPipeline(const PipelineConfig& _pipelineConfig); // Drops one reference, the last one retires the pipeline
+
+		inline constexpr vk::PipelineCache GetPipelineCache() const { return pipelineCache; }
+		inline size_t GetPipelineCount() const { return pipelines.size(); }
+
+		void Update(); // Once per frame on the render thread, publishes the pipelines compiled since the last call and destroys retired ones
+		void WaitIdle(); // Blocks until every queued compilation has finished and was published
 
 		void Cleanup();
 	};
@@ -0,0 +1,185 @@
+#include "pch.hpp"
+#include "PipelinesManager.hpp"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+	// Exposes the protected key computation, no manager (and no device) is ever constructed
+	class PipelineKeys : public cp::PipelinesManager
+	{
+	public:
+		using cp::PipelinesManager::ComputeKey;
+	};
+
+	template<typename T>
+	T FakeHandle(uint64_t _value) // Never dereferenced, only compared
+	{
+		typename T::CType handle = {};
+		std::memcpy(&handle, &_value, std::min(sizeof(handle), sizeof(_value)));
+		return T(handle);
+	}
+
+	std::shared_ptr<const std::vector<char>> MakeCode(const std::string& _bytes)
+	{
+		return std::make_shared<const std::vector<char>>(_bytes.begin(), _bytes.end());
+	}
+
+	cp::PipelineCreateData MakeCreateData(uint64_t _layoutHandle, uint64_t _renderPassHandle)
+	{
+		cp::PipelineCreateData data;
+		data.config.name = "Test";
+		data.config.AppendState(uint32_t(42)); // Stands for the fixed function state Material appends
+		data.mains = { { vk::ShaderStageFlagBits::eVertex, "vertexMain" }, { vk::ShaderStageFlagBits::eFragment, "fragmentMain" } };
+		data.createInfo.layout = FakeHandle<vk::PipelineLayout>(_layoutHandle);
+		data.createInfo.renderPass = FakeHandle<vk::RenderPass>(_renderPassHandle);
+		data.layoutKey = "layout";
+		data.renderPassKey = "pass";
+		return data;
+	}
+}
+
+TEST(PipelineConfig, SameStateIsEqual)
+{
+	cp::PipelineConfig a;
+	cp::PipelineConfig b;
+	a.AppendState(1.0f);
+	a.AppendState(std::string("opaque"));
+	b.AppendState(1.0f);
+	b.AppendState(std::string("opaque"));
+
+	EXPECT_EQ(a, b);
+	EXPECT_EQ(cp::PipelineConfigHasher()(a), cp::PipelineConfigHasher()(b));
+}
+
+TEST(PipelineConfig, StringsAreLengthPrefixed)
+{
+	cp::PipelineConfig a;
+	cp::PipelineConfig b;
+	a.AppendState(std::string("ab"));
+	a.AppendState(std::string("c"));
+	b.AppendState(std::string("a"));
+	b.AppendState(std::string("bc"));
+
+	EXPECT_NE(a, b);
+}
+
+TEST(PipelineConfig, EqualHashIsNotEnough)
+{
+	cp::PipelineConfig a;
+	cp::PipelineConfig b;
+	a.AppendState(uint32_t(1));
+	b.AppendState(uint32_t(2));
+	b.stateHash = a.stateHash; // Forced collision
+
+	EXPECT_NE(a, b);
+}
+
+TEST(PipelineConfig, StatelessConfigsCompareByName)
+{
+	cp::PipelineConfig a;
+	cp::PipelineConfig b;
+	a.name = "Grid";
+	b.name = "Grid";
+	EXPECT_EQ(a, b);
+
+	b.name = "Sky";
+	EXPECT_NE(a, b);
+
+	b.name = "Grid";
+	b.AppendState(uint32_t(0));
+	EXPECT_NE(a, b);
+}
+
+TEST(PipelineConfig, ShaderCodeIsComparedByContent)
+{
+	cp::PipelineConfig a;
+	cp::PipelineConfig b;
+	a.AppendState(uint32_t(1));
+	b.AppendState(uint32_t(1));
+
+	a.shaderCode = MakeCode("spirv");
+	b.shaderCode = MakeCode("spirv");
+	EXPECT_EQ(a, b);
+
+	b.shaderCode = MakeCode("other");
+	EXPECT_NE(a, b);
+}
+
+TEST(PipelineKey, ReusedHandlesDontMatter)
+{
+	cp::PipelineCreateData a = MakeCreateData(1, 2);
+	cp::PipelineCreateData b = MakeCreateData(3, 4); // Same layout and pass content behind other handles
+	PipelineKeys::ComputeKey(a, MakeCode("spirv"));
+	PipelineKeys::ComputeKey(b, MakeCode("spirv"));
+
+	EXPECT_EQ(a.config, b.config);
+
+	cp::PipelineCreateData c = MakeCreateData(1, 2);
+	c.layoutKey = "other layout"; // Same handle, destroyed and reused for another layout
+	PipelineKeys::ComputeKey(c, MakeCode("spirv"));
+
+	EXPECT_NE(a.config, c.config);
+}
+
+TEST(PipelineKey, CoversPassEntryPointsAndCode)
+{
+	cp::PipelineCreateData reference = MakeCreateData(1, 2);
+	PipelineKeys::ComputeKey(reference, MakeCode("spirv"));
+
+	cp::PipelineCreateData pass = MakeCreateData(1, 2);
+	pass.renderPassKey = "other pass";
+	PipelineKeys::ComputeKey(pass, MakeCode("spirv"));
+	EXPECT_NE(reference.config, pass.config);
+
+	cp::PipelineCreateData subpass = MakeCreateData(1, 2);
+	subpass.createInfo.subpass = 1;
+	PipelineKeys::ComputeKey(subpass, MakeCode("spirv"));
+	EXPECT_NE(reference.config, subpass.config);
+
+	cp::PipelineCreateData entryPoint = MakeCreateData(1, 2);
+	entryPoint.mains[1].second = "otherMain";
+	PipelineKeys::ComputeKey(entryPoint, MakeCode("spirv"));
+	EXPECT_NE(reference.config, entryPoint.config);
+
+	cp::PipelineCreateData code = MakeCreateData(1, 2);
+	PipelineKeys::ComputeKey(code, MakeCode("other spirv"));
+	EXPECT_NE(reference.config, code.config);
+}
+
+TEST(PipelineKey, CoversDynamicRenderingFormats)
+{
+	auto makeDynamic = [](vk::Format _color)
+	{
+		cp::PipelineCreateData data = MakeCreateData(1, 0);
+		data.renderPassKey.clear();
+		data.state = std::make_shared<cp::GraphicsPipelineState>();
+		data.state->attachmentFormats = cp::AttachmentFormats{ { _color }, vk::Format::eD32Sfloat };
+		PipelineKeys::ComputeKey(data, MakeCode("spirv"));
+		return data.config;
+	};
+
+	EXPECT_EQ(makeDynamic(vk::Format::eB8G8R8A8Srgb), makeDynamic(vk::Format::eB8G8R8A8Srgb));
+	EXPECT_NE(makeDynamic(vk::Format::eB8G8R8A8Srgb), makeDynamic(vk::Format::eR16G16B16A16Sfloat));
+}
+
+TEST(PipelineKey, RequiresLayoutAndPassKeys)
+{
+	cp::PipelineCreateData layout = MakeCreateData(1, 2);
+	layout.layoutKey.clear();
+	EXPECT_THROW(PipelineKeys::ComputeKey(layout, MakeCode("spirv")), std::runtime_error);
+
+	cp::PipelineCreateData pass = MakeCreateData(1, 2);
+	pass.renderPassKey.clear();
+	EXPECT_THROW(PipelineKeys::ComputeKey(pass, MakeCode("spirv")), std::runtime_error);
+}
+
+TEST(PipelineKey, StatelessPipelinesKeepTheirName)
+{
+	cp::PipelineCreateData data;
+	data.config.name = "Fullscreen";
+	PipelineKeys::ComputeKey(data, MakeCode("spirv"));
+
+	EXPECT_FALSE(data.config.HasState());
+	EXPECT_FALSE(data.config.shaderCode);
+}
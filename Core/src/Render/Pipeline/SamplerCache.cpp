@@ -0,0 +1,113 @@
+#include "pch.hpp"
+#include "SamplerCache.hpp"
+
+namespace cp
+{
+	SamplerDescription SamplerDescription::ForTexture(uint32_t _mipLevels, float _minLod)
+	{
+		SamplerDescription description;
+
+		if (_mipLevels <= 1)
+		{
+			description.magFilter = vk::Filter::eNearest;
+			description.minFilter = vk::Filter::eNearest;
+			description.mipmapMode = vk::SamplerMipmapMode::eNearest;
+		}
+
+		description.minLod = _minLod;
+		description.maxLod = static_cast<float>(_mipLevels > 0 ? _mipLevels - 1 : 0);
+
+		return description;
+	}
+
+	SamplerDescription SamplerDescription::DepthCompare()
+	{
+		SamplerDescription description;
+		description.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+		description.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+		description.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+		description.anisotropyEnable = false;
+		description.maxAnisotropy = 1.0f;
+		description.compareEnable = true;
+		description.compareOp = vk::CompareOp::eLessOrEqual;
+		description.maxLod = 0.0f;
+		description.borderColor = vk::BorderColor::eFloatOpaqueWhite;
+
+		return description;
+	}
+
+	std::size_t SamplerDescriptionHash::operator()(const SamplerDescription& _description) const
+	{
+		std::size_t seed = 0;
+
+		Helper::Hash::CombineHashes(seed, _description.magFilter);
+		Helper::Hash::CombineHashes(seed, _description.minFilter);
+		Helper::Hash::CombineHashes(seed, _description.mipmapMode);
+		Helper::Hash::CombineHashes(seed, _description.addressModeU);
+		Helper::Hash::CombineHashes(seed, _description.addressModeV);
+		Helper::Hash::CombineHashes(seed, _description.addressModeW);
+		Helper::Hash::CombineHashes(seed, _description.mipLodBias);
+		Helper::Hash::CombineHashes(seed, _description.anisotropyEnable);
+		Helper::Hash::CombineHashes(seed, _description.maxAnisotropy);
+		Helper::Hash::CombineHashes(seed, _description.compareEnable);
+		Helper::Hash::CombineHashes(seed, _description.compareOp);
+		Helper::Hash::CombineHashes(seed, _description.minLod);
+		Helper::Hash::CombineHashes(seed, _description.maxLod);
+		Helper::Hash::CombineHashes(seed, _description.borderColor);
+		Helper::Hash::CombineHashes(seed, _description.unnormalizedCoordinates);
+
+		return seed;
+	}
+
+	SamplerCache::SamplerCache(vk::Device _device, vk::PhysicalDevice _physicalDevice) : device(_device)
+	{
+		maxAnisotropy = _physicalDevice.getProperties().limits.maxSamplerAnisotropy;
+	}
+
+	vk::Sampler SamplerCache::GetOrCreateSampler(const SamplerDescription& _description)
+	{
+		// Clamp before the lookup so descriptions only differing above the device limit share a sampler
+		SamplerDescription description = _description;
+		description.maxAnisotropy = description.anisotropyEnable ? std::min(description.maxAnisotropy, maxAnisotropy) : 1.0f;
+
+		auto it = samplers.find(description);
+		if (it != samplers.end())
+		{
+			return it->second;
+		}
+
+		vk::SamplerCreateInfo samplerInfo;
+		samplerInfo.magFilter = description.magFilter;
+		samplerInfo.minFilter = description.minFilter;
+		samplerInfo.mipmapMode = description.mipmapMode;
+		samplerInfo.addressModeU = description.addressModeU;
+		samplerInfo.addressModeV = description.addressModeV;
+		samplerInfo.addressModeW = description.addressModeW;
+		samplerInfo.mipLodBias = description.mipLodBias;
+		samplerInfo.anisotropyEnable = description.anisotropyEnable ? VK_TRUE : VK_FALSE;
+		samplerInfo.maxAnisotropy = description.maxAnisotropy;
+		samplerInfo.compareEnable = description.compareEnable ? VK_TRUE : VK_FALSE;
+		samplerInfo.compareOp = description.compareOp;
+		samplerInfo.minLod = description.minLod;
+		samplerInfo.maxLod = description.maxLod;
+		samplerInfo.borderColor = description.borderColor;
+		samplerInfo.unnormalizedCoordinates = description.unnormalizedCoordinates ? VK_TRUE : VK_FALSE;
+
+		vk::Sampler sampler = device.createSampler(samplerInfo);
+		samplers[description] = sampler;
+
+		LOG_TRACE(MF("Created sampler [", samplers.size(), " cached]"));
+
+		return sampler;
+	}
+
+	void SamplerCache::Cleanup()
+	{
+		for (auto& sampler : samplers)
+		{
+			device.destroySampler(sampler.second);
+		}
+
+		samplers.clear();
+	}
+}
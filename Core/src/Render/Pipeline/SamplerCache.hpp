@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../../pch.hpp"
+
+namespace cp
+{
+	// Everything vk::SamplerCreateInfo holds, two equal descriptions always share the same vk::Sampler
+	struct SamplerDescription
+	{
+		vk::Filter magFilter = vk::Filter::eLinear;
+		vk::Filter minFilter = vk::Filter::eLinear;
+		vk::SamplerMipmapMode mipmapMode = vk::SamplerMipmapMode::eLinear;
+		vk::SamplerAddressMode addressModeU = vk::SamplerAddressMode::eRepeat;
+		vk::SamplerAddressMode addressModeV = vk::SamplerAddressMode::eRepeat;
+		vk::SamplerAddressMode addressModeW = vk::SamplerAddressMode::eRepeat;
+		float mipLodBias = 0.0f;
+		bool anisotropyEnable = true;
+		float maxAnisotropy = 16.0f; // Clamped to the device limit by the cache
+		bool compareEnable = false;
+		vk::CompareOp compareOp = vk::CompareOp::eAlways;
+		float minLod = 0.0f;
+		float maxLod = VK_LOD_CLAMP_NONE;
+		vk::BorderColor borderColor = vk::BorderColor::eIntOpaqueBlack;
+		bool unnormalizedCoordinates = false;
+
+		bool operator==(const SamplerDescription& _other) const = default;
+
+		static SamplerDescription ForTexture(uint32_t _mipLevels, float _minLod = 0.0f); // Trilinear when mipped, nearest for single level textures
+		static SamplerDescription DepthCompare(); // Shadow map comparison, clamped to a white border
+	};
+
+	struct SamplerDescriptionHash
+	{
+		std::size_t operator()(const SamplerDescription& _description) const;
+	};
+
+	class SamplerCache
+	{
+	private:
+		vk::Device device;
+		float maxAnisotropy;
+
+		std::unordered_map<SamplerDescription, vk::Sampler, SamplerDescriptionHash> samplers;
+
+	public:
+		SamplerCache(vk::Device _device, vk::PhysicalDevice _physicalDevice);
+
+		vk::Sampler GetOrCreateSampler(const SamplerDescription& _description); // Samplers are owned by the cache and live until Cleanup
+
+		inline size_t GetSamplerCount() const { return samplers.size(); }
+
+		void Cleanup();
+	};
+}
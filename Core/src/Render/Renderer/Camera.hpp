@@ -33,6 +33,7 @@ namespace cp
 		inline constexpr glm::mat4& GetViewMatrix() { return viewMatrix; }
 		inline constexpr glm::mat4& GetProjectionMatrix() { return projectionMatrix; }
 		inline constexpr glm::mat4 GetViewProjectionMatrix() const { return projectionMatrix * viewMatrix; }
+		inline float GetLODProjectionScale() const { return std::abs(projectionMatrix[1][1]) * 0.5f; } // Size / distance to fraction of the screen height, see Mesh::SelectLOD
 
 		inline constexpr vk::Buffer& GetUBOBuffer() { return uboBuffer; }
 		inline constexpr vk::DeviceMemory& GetUBOBufferMemory() { return uboBufferMemory; }
@@ -0,0 +1,77 @@
+#include "pch.hpp"
+#include "InstanceGroupBuilder.hpp"
+
+namespace cp
+{
+	float InstanceGroupBuilder::GetMaxScale(const glm::mat4& _modelMatrix)
+	{
+		return std::max({ glm::length(glm::vec3(_modelMatrix[0])), glm::length(glm::vec3(_modelMatrix[1])), glm::length(glm::vec3(_modelMatrix[2])) });
+	}
+
+	void InstanceGroupBuilder::Add(cp::Mesh& _mesh, const std::vector<cp::MaterialInstance*>& _slotInstances, const glm::mat4& _modelMatrix)
+	{
+		if (_slotInstances.empty()) return;
+
+		uint32_t lod = 0;
+		if (projectionScale > 0.0f)
+		{
+			const auto& bounds = _mesh.GetBounds();
+			const glm::vec3 worldCenter = glm::vec3(_modelMatrix * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+			const float scale = std::max(GetMaxScale(_modelMatrix), 1e-4f);
+			const float distance = glm::distance(viewPosition, worldCenter);
+
+			lod = _mesh.SelectLOD(distance / scale, projectionScale); // The LOD errors are in mesh units
+
+			// Streamed textures follow the projected size of the bounds, assuming the UVs span the mesh once
+			const float screenPixels = glm::length(bounds.max - bounds.min) * scale / std::max(distance, 1e-4f) * projectionScale * viewportHeight;
+			for (cp::MaterialInstance* materialInstance : _slotInstances)
+			{
+				if (materialInstance) materialInstance->ReportTextureUsage(screenPixels);
+			}
+		}
+
+		const glm::mat4 modelMatrix = _modelMatrix * _mesh.GetDequantizationMatrix();
+		const glm::mat4 normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(_modelMatrix))));
+
+		const auto& submeshes = _mesh.GetSubmeshes();
+		for (uint32_t submesh = 0; submesh < submeshes.size(); submesh++)
+		{
+			uint32_t slot = submeshes[submesh].materialSlot;
+			cp::MaterialInstance* materialInstance = slot < _slotInstances.size() && _slotInstances[slot] ? _slotInstances[slot] : _slotInstances[0];
+			if (!materialInstance || !materialInstance->GetMaterial()) continue; // Nothing to draw this submesh with
+
+			cp::Material* material = materialInstance->GetMaterial().get();
+			if (material->GetPipelineCreationData().vertexFormat != _mesh.GetVertexFormat())
+			{
+				if (formatMismatches.insert({ &_mesh, material }).second)
+				{
+					LOG_ERROR(MF("Material [", material->GetName(), "] expects vertex format ", static_cast<int>(material->GetPipelineCreationData().vertexFormat), " but the mesh is encoded with ", static_cast<int>(_mesh.GetVertexFormat()), ", skipping its draws (see MeshImportSettings::vertexFormat)"));
+				}
+				continue;
+			}
+
+			// Instances with identical parameters resolve to the same shared instance and are drawn in one group
+			groups[std::make_tuple(material, &_mesh, materialInstance->GetSharedInstance(), submesh, lod)].push_back({ modelMatrix, normalMatrix });
+		}
+	}
+
+	std::vector<InstanceGroup> InstanceGroupBuilder::Build()
+	{
+		std::vector<InstanceGroup> instanceGroups;
+		instanceGroups.reserve(groups.size());
+
+		for (auto& [key, transforms] : groups)
+		{
+			auto [material, mesh, materialInstance, submesh, lod] = key;
+			instanceGroups.push_back({ material, materialInstance, mesh, submesh, lod, std::move(transforms) });
+		}
+		groups.clear();
+
+		std::sort(instanceGroups.begin(), instanceGroups.end(), [](const InstanceGroup& _a, const InstanceGroup& _b)
+			{
+				return std::tie(_a.material, _a.materialInstance, _a.mesh, _a.submeshIndex, _a.lod) < std::tie(_b.material, _b.materialInstance, _b.mesh, _b.submeshIndex, _b.lod);
+			});
+
+		return instanceGroups;
+	}
+}
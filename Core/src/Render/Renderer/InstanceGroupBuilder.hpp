@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../../pch.hpp"
+
+#include "RendererPrototype.hpp"
+
+namespace cp
+{
+	// Turns the visible mesh instances of a frame into the InstanceGroups handed to RendererPrototype::Render
+	// Every submesh is drawn with the material instance of its material slot, instances resolving to the same material, mesh, shared parameters, submesh and LOD land in one group
+	// The LOD is picked per instance from the projected size of its bounds (see Mesh::SelectLOD), the same size is reported to the TextureStreamer for the textures of its material instances
+	class InstanceGroupBuilder
+	{
+	private:
+		using GroupKey = std::tuple<cp::Material*, cp::Mesh*, cp::MaterialInstance*, uint32_t, uint32_t>; // Material, mesh, shared instance, submesh, LOD
+
+		std::unordered_map<GroupKey, std::vector<TransformData>, Helper::Hash::TupleHash<cp::Material*, cp::Mesh*, cp::MaterialInstance*, uint32_t, uint32_t>> groups;
+
+		glm::vec3 viewPosition = glm::vec3(0.0f);
+		float projectionScale = 0.0f; // 0 : no view set, every instance uses LOD 0 and no texture usage is reported
+		float viewportHeight = 0.0f;
+
+		std::set<std::pair<const cp::Mesh*, const cp::Material*>> formatMismatches; // Already reported, so a mismatch logs once instead of every frame
+
+	public:
+		inline void SetView(const glm::vec3& _viewPosition, float _projectionScale, float _viewportHeight) { viewPosition = _viewPosition; projectionScale = _projectionScale; viewportHeight = _viewportHeight; } // Before the first Add of a frame, _projectionScale from Camera::GetLODProjectionScale
+
+		static float GetMaxScale(const glm::mat4& _modelMatrix); // Largest axis scale, so non uniformly scaled instances never pick a coarser LOD than their longest side needs
+
+		// _slotInstances : one material instance per mesh material slot, missing or null slots fall back to the first one
+		// Submeshes whose material pipeline expects another vertex format than the mesh is encoded with are skipped, they would decode garbage
+		void Add(cp::Mesh& _mesh, const std::vector<cp::MaterialInstance*>& _slotInstances, const glm::mat4& _modelMatrix);
+
+		std::vector<InstanceGroup> Build(); // Sorted by material, then shared instance, then mesh, so consecutive groups rebind as little as possible. Leaves the builder empty
+
+		inline void Clear() { groups.clear(); }
+	};
+}
@@ -0,0 +1,101 @@
+#include "pch.hpp"
+#include "ParallelRecorder.hpp"
+
+#include "../Setup/Frame.hpp"
+
+#include <atomic>
+
+namespace cp
+{
+	ParallelRecorder::ParallelRecorder(uint32_t _threadCount)
+	{
+		workers = std::make_unique<cp::ThreadPool>(_threadCount);
+		LOG_TRACE(MF("Recording draws on up to ", GetMaxChunkCount(), " threads"));
+	}
+
+	ParallelRecorder::~ParallelRecorder()
+	{
+
+	}
+
+	void ParallelRecorder::Record(cp::Frame& _frame, vk::CommandBuffer _primary, const SecondaryRecordInfo& _info, size_t _drawCount, const RecordFunction& _record)
+	{
+		if (_drawCount == 0) return;
+
+		uint32_t chunkCount = static_cast<uint32_t>(std::min<size_t>(GetMaxChunkCount(), (_drawCount + minDrawsPerChunk - 1) / minDrawsPerChunk));
+		size_t chunkSize = (_drawCount + chunkCount - 1) / chunkCount;
+
+		// Acquired here, the frame's worker pools are only touched by the job owning their index below
+		_frame.ReserveWorkers(chunkCount);
+
+		std::vector<vk::CommandBuffer> secondaries(chunkCount);
+		for (uint32_t i = 0; i < chunkCount; i++)
+		{
+			secondaries[i] = _frame.AcquireSecondaryCommandBuffer(i);
+		}
+
+		std::atomic<bool> failed(false);
+
+		auto recordChunk = [&](uint32_t _chunk)
+		{
+			size_t begin = _chunk * chunkSize;
+			size_t end = std::min(begin + chunkSize, _drawCount);
+
+			vk::CommandBuffer commandBuffer = secondaries[_chunk];
+
+			vk::CommandBufferInheritanceInfo inheritanceInfo(_info.renderPass, _info.subpass, _info.framebuffer);
+
+			vk::CommandBufferInheritanceRenderingInfo renderingInfo;
+			if (!_info.renderPass)
+			{
+				renderingInfo.setColorAttachmentFormats(_info.attachmentFormats.colors);
+				renderingInfo.depthAttachmentFormat = _info.attachmentFormats.depth;
+				renderingInfo.stencilAttachmentFormat = _info.attachmentFormats.stencil;
+				renderingInfo.rasterizationSamples = vk::SampleCountFlagBits::e1;
+				inheritanceInfo.pNext = &renderingInfo;
+			}
+			vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritanceInfo);
+
+			// Nothing escapes, the render thread has to reach WaitIdle before the captured state goes away
+			try
+			{
+				commandBuffer.begin(beginInfo);
+				commandBuffer.setViewport(0, _info.viewport);
+				commandBuffer.setScissor(0, _info.scissor);
+
+				if (begin < end) _record(commandBuffer, begin, end);
+			}
+			catch (const std::exception& e)
+			{
+				LOG_ERROR(MF("Recording draws [", begin, ", ", end, ") failed: ", e.what()));
+				failed = true;
+			}
+
+			try
+			{
+				commandBuffer.end();
+			}
+			catch (const std::exception& e)
+			{
+				LOG_ERROR(MF("Ending secondary command buffer failed: ", e.what()));
+				failed = true;
+			}
+		};
+
+		// The render thread takes the first chunk instead of idling
+		for (uint32_t i = 1; i < chunkCount; i++)
+		{
+			workers->Submit([&recordChunk, i]() { recordChunk(i); });
+		}
+
+		recordChunk(0);
+		workers->WaitIdle();
+
+		if (failed)
+		{
+			throw std::runtime_error("Failed to record secondary command buffers");
+		}
+
+		_primary.executeCommands(secondaries);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../../pch.hpp"
+#include "../../Context/VulkanContext.hpp"
+#include "../../Util/ThreadPool.hpp"
+
+namespace cp
+{
+	class Frame;
+
+	struct SecondaryRecordInfo
+	{
+		vk::RenderPass renderPass; // Null with dynamic rendering, the secondaries inherit attachmentFormats instead
+		uint32_t subpass = 0;
+		vk::Framebuffer framebuffer; // Optional, lets the driver specialize the secondaries
+		cp::AttachmentFormats attachmentFormats;
+		vk::Viewport viewport; // Dynamic state is not inherited, every secondary sets it again
+		vk::Rect2D scissor;
+	};
+
+	// Splits a sorted draw list into contiguous chunks recorded into secondary command buffers on worker threads
+	// The primary executes the chunks in list order, so the result matches a single threaded recording
+	// The record callback only reads shared renderer state, each chunk rebinds whatever it draws with
+	// Pipelines are resolved on the render thread before Record and stored in the draw list : MaterialInstance::GetPipelineData requests variants and is not thread safe, Material::GetPipelineData is a plain lookup and may be called from the callback
+	// Opt in, no renderer owns one yet. The owner calls Frame::ResetWorkerCommands on each frame it records into, once PrepareFrame returned
+	class ParallelRecorder
+	{
+	public:
+		using RecordFunction = std::function<void(vk::CommandBuffer _commandBuffer, size_t _begin, size_t _end)>;
+
+	private:
+		std::unique_ptr<cp::ThreadPool> workers;
+		size_t minDrawsPerChunk = 256; // Below this the cost of another secondary outweighs the parallelism
+
+	public:
+		NO_COPY(ParallelRecorder)
+
+		ParallelRecorder(uint32_t _threadCount = 0); // 0 : one thread per hardware thread, minus the render thread
+		~ParallelRecorder();
+
+		// Inside a render pass begun with vk::SubpassContents::eSecondaryCommandBuffers, or rendering begun with eContentsSecondaryCommandBuffers
+		void Record(cp::Frame& _frame, vk::CommandBuffer _primary, const SecondaryRecordInfo& _info, size_t _drawCount, const RecordFunction& _record);
+
+		inline void SetMinDrawsPerChunk(size_t _count) { minDrawsPerChunk = std::max<size_t>(_count, 1); }
+		inline size_t GetMinDrawsPerChunk() const { return minDrawsPerChunk; }
+		inline uint32_t GetMaxChunkCount() const { return static_cast<uint32_t>(workers->GetThreadCount()) + 1; }
+	};
+}
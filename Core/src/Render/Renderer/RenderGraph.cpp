@@ -0,0 +1,846 @@
+#include "pch.hpp"
+#include "RenderGraph.hpp"
+#include "../Setup/FramePacer.hpp"
+
+namespace cp
+{
+	namespace
+	{
+		struct AccessState
+		{
+			vk::ImageLayout layout;
+			vk::PipelineStageFlags stages;
+			vk::AccessFlags access;
+			bool write;
+		};
+
+		AccessState GetAccessState(RenderGraphAccess _access, vk::PipelineStageFlags _stages, bool _load)
+		{
+			const vk::PipelineStageFlags depthStages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+
+			switch (_access)
+			{
+			case RenderGraphAccess::ColorAttachment:
+				return { vk::ImageLayout::eColorAttachmentOptimal, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+					vk::AccessFlagBits::eColorAttachmentWrite | (_load ? vk::AccessFlagBits::eColorAttachmentRead : vk::AccessFlags()), true };
+			case RenderGraphAccess::DepthAttachment:
+				return { vk::ImageLayout::eDepthStencilAttachmentOptimal, depthStages,
+					vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentRead, true };
+			case RenderGraphAccess::DepthRead:
+				return { vk::ImageLayout::eDepthStencilReadOnlyOptimal, depthStages, vk::AccessFlagBits::eDepthStencilAttachmentRead, false };
+			case RenderGraphAccess::Sampled:
+				return { vk::ImageLayout::eShaderReadOnlyOptimal, _stages, vk::AccessFlagBits::eShaderRead, false };
+			case RenderGraphAccess::TransferSrc:
+				return { vk::ImageLayout::eTransferSrcOptimal, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead, false };
+			case RenderGraphAccess::TransferDst:
+				return { vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite, true };
+			}
+
+			return {};
+		}
+
+		vk::ImageUsageFlags GetAccessUsage(RenderGraphAccess _access)
+		{
+			switch (_access)
+			{
+			case RenderGraphAccess::ColorAttachment: return vk::ImageUsageFlagBits::eColorAttachment;
+			case RenderGraphAccess::DepthAttachment:
+			case RenderGraphAccess::DepthRead: return vk::ImageUsageFlagBits::eDepthStencilAttachment;
+			case RenderGraphAccess::Sampled: return vk::ImageUsageFlagBits::eSampled;
+			case RenderGraphAccess::TransferSrc: return vk::ImageUsageFlagBits::eTransferSrc;
+			case RenderGraphAccess::TransferDst: return vk::ImageUsageFlagBits::eTransferDst;
+			}
+
+			return {};
+		}
+
+		inline bool IsAttachment(RenderGraphAccess _access)
+		{
+			return _access == RenderGraphAccess::ColorAttachment || _access == RenderGraphAccess::DepthAttachment || _access == RenderGraphAccess::DepthRead;
+		}
+
+		inline bool IsWrite(RenderGraphAccess _access)
+		{
+			return _access == RenderGraphAccess::ColorAttachment || _access == RenderGraphAccess::DepthAttachment || _access == RenderGraphAccess::TransferDst;
+		}
+	}
+
+	RenderGraphHandle RenderGraphBuilder::Access(RenderGraphHandle _resource, RenderGraphAccess _access, std::optional<vk::ClearValue> _clear, vk::PipelineStageFlags _stages)
+	{
+		if (_resource >= graph.resources.size())
+		{
+			LOG_ERROR(MF("Pass [", graph.passes[pass].name, "] accesses an unknown render graph texture [", _resource, "]"));
+			throw std::runtime_error("Pass accesses an unknown render graph texture");
+		}
+
+		auto& accesses = graph.passes[pass].accesses;
+		if (std::any_of(accesses.begin(), accesses.end(), [_resource](const auto& _other) { return _other.resource == _resource; }))
+		{
+			LOG_ERROR(MF("Pass [", graph.passes[pass].name, "] accesses [", graph.resources[_resource].name, "] twice"));
+			throw std::runtime_error("Pass accesses a render graph texture twice");
+		}
+
+		accesses.push_back({ _resource, _access, _clear, _stages });
+		return _resource;
+	}
+
+	RenderGraphHandle RenderGraphBuilder::WriteColor(RenderGraphHandle _resource, std::optional<vk::ClearColorValue> _clear)
+	{
+		return Access(_resource, RenderGraphAccess::ColorAttachment, _clear ? std::optional<vk::ClearValue>(vk::ClearValue(*_clear)) : std::nullopt);
+	}
+
+	RenderGraphHandle RenderGraphBuilder::WriteDepth(RenderGraphHandle _resource, std::optional<vk::ClearDepthStencilValue> _clear)
+	{
+		return Access(_resource, RenderGraphAccess::DepthAttachment, _clear ? std::optional<vk::ClearValue>(vk::ClearValue(*_clear)) : std::nullopt);
+	}
+
+	RenderGraphHandle RenderGraphBuilder::ReadDepth(RenderGraphHandle _resource)
+	{
+		return Access(_resource, RenderGraphAccess::DepthRead);
+	}
+
+	RenderGraphHandle RenderGraphBuilder::ReadTexture(RenderGraphHandle _resource, vk::PipelineStageFlags _stages)
+	{
+		return Access(_resource, RenderGraphAccess::Sampled, std::nullopt, _stages);
+	}
+
+	RenderGraphHandle RenderGraphBuilder::CopyFrom(RenderGraphHandle _resource)
+	{
+		return Access(_resource, RenderGraphAccess::TransferSrc);
+	}
+
+	RenderGraphHandle RenderGraphBuilder::CopyTo(RenderGraphHandle _resource)
+	{
+		return Access(_resource, RenderGraphAccess::TransferDst);
+	}
+
+	void RenderGraphBuilder::SetSideEffect()
+	{
+		graph.passes[pass].sideEffect = true;
+	}
+
+	void RenderGraphBuilder::SetSecondaryCommandBuffers()
+	{
+		graph.passes[pass].secondaryCommandBuffers = true;
+	}
+
+	RenderGraph::RenderGraph(cp::VulkanContext* _context) : context(_context)
+	{
+
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		DestroyPhysicalResources();
+	}
+
+	RenderGraphHandle RenderGraph::CreateTexture(const std::string& _name, const RenderGraphTextureDesc& _desc)
+	{
+		if (GetHandle(_name) != INVALID_HANDLE)
+		{
+			LOG_ERROR(MF("Render graph texture [", _name, "] already exists"));
+			throw std::runtime_error("Render graph texture already exists");
+		}
+
+		Resource resource;
+		resource.name = _name;
+		resource.desc = _desc;
+		resource.aspect = Helper::Format::GetAspectFlags(_desc.format);
+
+		resources.push_back(std::move(resource));
+		compiled = false;
+
+		return static_cast<RenderGraphHandle>(resources.size() - 1);
+	}
+
+	RenderGraphHandle RenderGraph::ImportTexture(const std::string& _name, const RenderGraphTextureDesc& _desc, vk::ImageLayout _initialLayout, vk::ImageLayout _finalLayout)
+	{
+		RenderGraphHandle handle = CreateTexture(_name, _desc);
+
+		Resource& resource = resources[handle];
+		resource.imported = true;
+		resource.initialLayout = _initialLayout;
+		resource.finalLayout = _finalLayout;
+
+		return handle;
+	}
+
+	void RenderGraph::SetImportedTexture(RenderGraphHandle _resource, vk::Image _image, vk::ImageView _view)
+	{
+		Resource& resource = resources.at(_resource);
+
+		if (!resource.imported)
+		{
+			LOG_ERROR(MF("Render graph texture [", resource.name, "] is transient and owned by the graph"));
+			throw std::runtime_error("Render graph texture is not imported");
+		}
+
+		resource.image = _image;
+		resource.view = _view;
+	}
+
+	void RenderGraph::ReleaseImportedView(vk::ImageView _view)
+	{
+		RetireFramebuffers([&_view](const FramebufferKey& _key, const CachedFramebuffer&)
+			{
+				return std::find(_key.views.begin(), _key.views.end(), _view) != _key.views.end();
+			});
+
+		for (auto& resource : resources)
+		{
+			if (resource.imported && resource.view == _view)
+			{
+				resource.image = nullptr;
+				resource.view = nullptr;
+			}
+		}
+	}
+
+	void RenderGraph::AddPass(const std::string& _name, const SetupFunction& _setup, const ExecuteFunction& _execute)
+	{
+		Pass pass;
+		pass.name = _name;
+		pass.execute = _execute;
+		passes.push_back(std::move(pass));
+
+		RenderGraphBuilder builder(*this, static_cast<uint32_t>(passes.size() - 1));
+		_setup(builder);
+
+		compiled = false;
+	}
+
+	void RenderGraph::Compile()
+	{
+		DestroyPhysicalResources();
+
+		CullPasses();
+		ComputeLifetimes();
+		AllocateTransients();
+		PlaceTransitions();
+		CreateRenderPasses();
+
+		compiled = true;
+
+		size_t culledCount = std::count_if(passes.begin(), passes.end(), [](const Pass& _pass) { return _pass.culled; });
+		LOG_TRACE(MF("Compiled render graph, ", passes.size() - culledCount, " passes (", culledCount, " culled), ", resources.size(), " textures in ", memoryBlocks.size(), " transient allocations"));
+	}
+
+	void RenderGraph::CullPasses()
+	{
+		// Walked backwards, a pass lives if a later living pass or the outside of the graph reads what it writes
+		std::vector<bool> needed(resources.size(), false);
+
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			needed[i] = resources[i].imported;
+		}
+
+		for (auto pass = passes.rbegin(); pass != passes.rend(); ++pass)
+		{
+			pass->culled = !pass->sideEffect && std::none_of(pass->accesses.begin(), pass->accesses.end(),
+				[&needed](const ResourceAccess& _access) { return IsWrite(_access.access) && needed[_access.resource]; });
+
+			if (pass->culled)
+			{
+				LOG_TRACE(MF("Culling render graph pass [", pass->name, "], nothing reads its output"));
+				continue;
+			}
+
+			// A full overwrite ends the dependency chain, loads and reads extend it
+			for (const auto& access : pass->accesses)
+			{
+				if (IsWrite(access.access) && (access.clear || access.access == RenderGraphAccess::TransferDst)) needed[access.resource] = false;
+			}
+
+			for (const auto& access : pass->accesses)
+			{
+				if (!IsWrite(access.access) || (IsAttachment(access.access) && !access.clear)) needed[access.resource] = true;
+			}
+		}
+	}
+
+	void RenderGraph::ComputeLifetimes()
+	{
+		for (auto& resource : resources)
+		{
+			resource.firstPass = UINT32_MAX;
+			resource.lastPass = 0;
+			resource.usage = resource.desc.usage;
+		}
+
+		for (uint32_t i = 0; i < passes.size(); i++)
+		{
+			if (passes[i].culled) continue;
+
+			for (const auto& access : passes[i].accesses)
+			{
+				Resource& resource = resources[access.resource];
+				resource.firstPass = std::min(resource.firstPass, i);
+				resource.lastPass = std::max(resource.lastPass, i);
+				resource.usage |= GetAccessUsage(access.access);
+			}
+		}
+	}
+
+	void RenderGraph::AllocateTransients()
+	{
+		vk::Device device = context->GetDevice();
+
+		std::vector<vk::MemoryRequirements> requirements(resources.size());
+
+		for (RenderGraphHandle i = 0; i < resources.size(); i++)
+		{
+			Resource& resource = resources[i];
+			if (resource.imported || resource.firstPass == UINT32_MAX) continue; // Unused once culled, nothing to create
+
+			vk::ImageCreateInfo imageInfo;
+			imageInfo.imageType = vk::ImageType::e2D;
+			imageInfo.extent = vk::Extent3D(resource.desc.extent.width, resource.desc.extent.height, 1);
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = resource.desc.layers;
+			imageInfo.format = resource.desc.format;
+			imageInfo.tiling = vk::ImageTiling::eOptimal;
+			imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+			imageInfo.usage = resource.usage;
+			imageInfo.samples = vk::SampleCountFlagBits::e1;
+			imageInfo.sharingMode = vk::SharingMode::eExclusive;
+			imageInfo.flags = vk::ImageCreateFlagBits::eAlias;
+
+			resource.image = device.createImage(imageInfo);
+			requirements[i] = device.getImageMemoryRequirements(resource.image);
+		}
+
+		AssignMemoryBlocks(requirements);
+
+		vk::DeviceSize requestedSize = 0;
+		vk::DeviceSize allocatedSize = 0;
+
+		for (RenderGraphHandle i = 0; i < resources.size(); i++)
+		{
+			if (resources[i].memoryBlock >= 0) requestedSize += requirements[i].size;
+		}
+
+		for (auto& block : memoryBlocks)
+		{
+			vk::MemoryAllocateInfo allocInfo(block.size, Helper::Memory::FindMemoryType(context->GetPhysicalDevice(), block.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal));
+			block.memory = device.allocateMemory(allocInfo);
+			allocatedSize += block.size;
+
+			for (RenderGraphHandle handle : block.users)
+			{
+				Resource& resource = resources[handle];
+				device.bindImageMemory(resource.image, block.memory, 0);
+
+				vk::ImageViewCreateInfo viewInfo;
+				viewInfo.image = resource.image;
+				viewInfo.viewType = resource.desc.layers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
+				viewInfo.format = resource.desc.format;
+				viewInfo.subresourceRange = vk::ImageSubresourceRange(resource.aspect, 0, 1, 0, resource.desc.layers);
+
+				resource.view = device.createImageView(viewInfo);
+			}
+		}
+
+		if (requestedSize > allocatedSize) LOG_TRACE(MF("Render graph aliasing saved ", (requestedSize - allocatedSize) / 1024, " KiB of transient memory"));
+	}
+
+	void RenderGraph::AssignMemoryBlocks(const std::vector<vk::MemoryRequirements>& _requirements)
+	{
+		std::vector<RenderGraphHandle> transients;
+
+		for (RenderGraphHandle i = 0; i < resources.size(); i++)
+		{
+			if (!resources[i].imported && resources[i].firstPass != UINT32_MAX) transients.push_back(i);
+		}
+
+		// Largest first so the smaller textures fill blocks that are already big enough
+		std::stable_sort(transients.begin(), transients.end(), [&_requirements](RenderGraphHandle _a, RenderGraphHandle _b) { return _requirements[_a].size > _requirements[_b].size; });
+
+		for (RenderGraphHandle handle : transients)
+		{
+			Resource& resource = resources[handle];
+			const vk::MemoryRequirements& requirement = _requirements[handle];
+
+			auto overlaps = [this, &resource](RenderGraphHandle _other)
+			{
+				return resource.firstPass <= resources[_other].lastPass && resources[_other].firstPass <= resource.lastPass;
+			};
+
+			// Every texture is bound at offset 0, which satisfies any alignment
+			for (size_t i = 0; i < memoryBlocks.size(); i++)
+			{
+				MemoryBlock& block = memoryBlocks[i];
+				if (block.size < requirement.size || (block.memoryTypeBits & requirement.memoryTypeBits) == 0) continue;
+				if (std::any_of(block.users.begin(), block.users.end(), overlaps)) continue;
+
+				block.memoryTypeBits &= requirement.memoryTypeBits;
+				block.users.push_back(handle);
+				resource.memoryBlock = static_cast<int32_t>(i);
+				break;
+			}
+
+			if (resource.memoryBlock < 0)
+			{
+				MemoryBlock block;
+				block.size = requirement.size;
+				block.memoryTypeBits = requirement.memoryTypeBits;
+				block.users.push_back(handle);
+
+				memoryBlocks.push_back(std::move(block));
+				resource.memoryBlock = static_cast<int32_t>(memoryBlocks.size() - 1);
+			}
+		}
+	}
+
+	void RenderGraph::PlaceTransitions()
+	{
+		// Last known use of every texture, and of every memory block for the first use of its next occupant
+		std::vector<AccessState> states(resources.size());
+		std::vector<AccessState> blockStates(memoryBlocks.size(), { vk::ImageLayout::eUndefined, {}, {}, false });
+		std::vector<std::pair<uint32_t, size_t>> blockFirstUses(memoryBlocks.size(), { UINT32_MAX, 0 }); // Pass and transition of the first occupant of every block
+
+		// Imported textures were last touched outside the graph, all commands covers whatever stage the acquire or submit waited on
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			states[i] = { resources[i].initialLayout, vk::PipelineStageFlagBits::eAllCommands, {}, resources[i].imported };
+		}
+
+		for (uint32_t i = 0; i < passes.size(); i++)
+		{
+			Pass& pass = passes[i];
+			pass.transitions.clear();
+
+			if (pass.culled) continue;
+
+			for (const auto& access : pass.accesses)
+			{
+				Resource& resource = resources[access.resource];
+				AccessState& state = states[access.resource];
+
+				bool load = IsAttachment(access.access) && !access.clear;
+				AccessState required = GetAccessState(access.access, access.stages, load);
+
+				// Aliased memory holds garbage from its previous occupant, which has to be done with it first
+				if (!resource.imported && i == resource.firstPass)
+				{
+					const AccessState& block = blockStates[resource.memoryBlock];
+					if (blockFirstUses[resource.memoryBlock].first == UINT32_MAX) blockFirstUses[resource.memoryBlock] = { i, pass.transitions.size() };
+					pass.transitions.push_back({ access.resource, vk::ImageLayout::eUndefined, required.layout, block.stages, block.write ? block.access : vk::AccessFlags(), required.stages, required.access });
+					state = required;
+					continue;
+				}
+
+				// Read after read in the same layout only widens the set of readers a later write waits on
+				if (!state.write && !required.write && state.layout == required.layout)
+				{
+					state.stages |= required.stages;
+					state.access |= required.access;
+					continue;
+				}
+
+				// A clear discards the previous contents, no need to preserve them through the transition
+				vk::ImageLayout oldLayout = (IsAttachment(access.access) && access.clear) ? vk::ImageLayout::eUndefined : state.layout;
+
+				pass.transitions.push_back({ access.resource, oldLayout, required.layout, state.stages, state.write ? state.access : vk::AccessFlags(), required.stages, required.access });
+				state = required;
+			}
+
+			for (const auto& access : pass.accesses)
+			{
+				const Resource& resource = resources[access.resource];
+				if (!resource.imported && i == resource.lastPass) blockStates[resource.memoryBlock] = states[access.resource];
+			}
+		}
+
+		// Transients are reused by every frame in flight, the first occupant of a block waits on the last one of the previous Execute
+		for (size_t block = 0; block < memoryBlocks.size(); block++)
+		{
+			const auto& [passIndex, transitionIndex] = blockFirstUses[block];
+			if (passIndex == UINT32_MAX) continue;
+
+			Transition& transition = passes[passIndex].transitions[transitionIndex];
+			transition.srcStages = blockStates[block].stages;
+			transition.srcAccess = blockStates[block].write ? blockStates[block].access : vk::AccessFlags();
+		}
+
+		finalTransitions.clear();
+
+		for (RenderGraphHandle i = 0; i < resources.size(); i++)
+		{
+			const Resource& resource = resources[i];
+			const AccessState& state = states[i];
+
+			if (!resource.imported || resource.finalLayout == vk::ImageLayout::eUndefined || resource.finalLayout == state.layout) continue;
+
+			// Presentation is ordered by the submit semaphore, anything else may be used right after the graph
+			bool present = resource.finalLayout == vk::ImageLayout::ePresentSrcKHR;
+			finalTransitions.push_back({ i, state.layout, resource.finalLayout, state.stages, state.write ? state.access : vk::AccessFlags(),
+				present ? vk::PipelineStageFlags(vk::PipelineStageFlagBits::eBottomOfPipe) : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eAllCommands),
+				present ? vk::AccessFlags() : (vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite) });
+		}
+	}
+
+	void RenderGraph::CreateRenderPasses()
+	{
+		vk::Device device = context->GetDevice();
+
+		for (uint32_t i = 0; i < passes.size(); i++)
+		{
+			Pass& pass = passes[i];
+			pass.attachments.clear();
+			pass.clearValues.clear();
+			pass.attachmentFormats = {};
+
+			if (pass.culled) continue;
+
+			auto addAttachment = [&](const ResourceAccess& _access, bool _depth)
+			{
+				const Resource& resource = resources[_access.resource];
+
+				// Transients hold nothing before their first and after their last use
+				bool hasContent = resource.imported || i != resource.firstPass;
+				bool keepContent = resource.imported || i != resource.lastPass;
+
+				PassAttachment attachment;
+				attachment.resource = _access.resource;
+				attachment.layout = GetAccessState(_access.access, _access.stages, !_access.clear).layout;
+				attachment.loadOp = _access.clear ? vk::AttachmentLoadOp::eClear : (hasContent ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eDontCare);
+				attachment.storeOp = keepContent ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+				attachment.clearValue = _access.clear.value_or(vk::ClearValue());
+				attachment.depth = _depth;
+
+				if (pass.attachments.empty())
+				{
+					pass.extent = resource.desc.extent;
+					pass.layers = resource.desc.layers;
+				}
+				else if (resource.desc.extent != pass.extent)
+				{
+					LOG_ERROR(MF("Attachments of render graph pass [", pass.name, "] have different extents"));
+					throw std::runtime_error("Render graph pass attachments have different extents");
+				}
+
+				pass.layers = std::min(pass.layers, resource.desc.layers);
+				pass.attachments.push_back(attachment);
+				pass.clearValues.push_back(attachment.clearValue);
+
+				if (!_depth) pass.attachmentFormats.colors.push_back(resource.desc.format);
+				else
+				{
+					if (resource.aspect & vk::ImageAspectFlagBits::eDepth) pass.attachmentFormats.depth = resource.desc.format;
+					if (resource.aspect & vk::ImageAspectFlagBits::eStencil) pass.attachmentFormats.stencil = resource.desc.format;
+				}
+			};
+
+			for (const auto& access : pass.accesses)
+			{
+				if (access.access == RenderGraphAccess::ColorAttachment) addAttachment(access, false);
+			}
+
+			for (const auto& access : pass.accesses)
+			{
+				if (access.access != RenderGraphAccess::DepthAttachment && access.access != RenderGraphAccess::DepthRead) continue;
+
+				if (pass.attachmentFormats.depth != vk::Format::eUndefined || pass.attachmentFormats.stencil != vk::Format::eUndefined)
+				{
+					LOG_ERROR(MF("Render graph pass [", pass.name, "] uses more than one depth attachment"));
+					throw std::runtime_error("Render graph pass uses more than one depth attachment");
+				}
+
+				addAttachment(access, true);
+			}
+
+			// Dynamic rendering begins the pass straight from the attachment views
+			if (pass.attachments.empty() || context->UsesDynamicRendering()) continue;
+
+			std::vector<vk::AttachmentDescription> descriptions;
+			std::vector<vk::AttachmentReference> colorReferences;
+			std::optional<vk::AttachmentReference> depthReference;
+
+			for (const auto& attachment : pass.attachments)
+			{
+				const Resource& resource = resources[attachment.resource];
+				bool stencil = static_cast<bool>(resource.aspect & vk::ImageAspectFlagBits::eStencil);
+
+				descriptions.push_back(vk::AttachmentDescription({}, resource.desc.format, vk::SampleCountFlagBits::e1, attachment.loadOp, attachment.storeOp,
+					stencil ? attachment.loadOp : vk::AttachmentLoadOp::eDontCare, stencil ? attachment.storeOp : vk::AttachmentStoreOp::eDontCare, attachment.layout, attachment.layout));
+
+				vk::AttachmentReference reference(static_cast<uint32_t>(descriptions.size() - 1), attachment.layout);
+				if (attachment.depth) depthReference = reference;
+				else colorReferences.push_back(reference);
+			}
+
+			// Transitions are recorded as barriers before the pass, the render pass itself needs no external dependencies
+			vk::SubpassDescription subpass({}, vk::PipelineBindPoint::eGraphics, 0, nullptr, static_cast<uint32_t>(colorReferences.size()), colorReferences.data(), nullptr, depthReference ? &*depthReference : nullptr);
+
+			vk::RenderPassCreateInfo renderPassInfo({}, static_cast<uint32_t>(descriptions.size()), descriptions.data(), 1, &subpass);
+			pass.renderPass = device.createRenderPass(renderPassInfo);
+		}
+	}
+
+	std::size_t RenderGraph::FramebufferKeyHash::operator()(const FramebufferKey& _key) const
+	{
+		size_t hash = reinterpret_cast<uint64_t>(VkRenderPass(_key.renderPass));
+
+		for (vk::ImageView view : _key.views)
+		{
+			Helper::Hash::CombineHashes(hash, reinterpret_cast<uint64_t>(VkImageView(view)));
+		}
+
+		return hash;
+	}
+
+	vk::Framebuffer RenderGraph::GetFramebuffer(const Pass& _pass)
+	{
+		FramebufferKey key;
+		key.renderPass = _pass.renderPass;
+
+		for (const auto& attachment : _pass.attachments)
+		{
+			key.views.push_back(resources[attachment.resource].view);
+		}
+
+		auto it = framebuffers.find(key);
+		if (it != framebuffers.end())
+		{
+			it->second.lastUsed = executeCount;
+			return it->second.framebuffer;
+		}
+
+		vk::FramebufferCreateInfo framebufferInfo;
+		framebufferInfo.renderPass = _pass.renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(key.views.size());
+		framebufferInfo.pAttachments = key.views.data();
+		framebufferInfo.width = _pass.extent.width;
+		framebufferInfo.height = _pass.extent.height;
+		framebufferInfo.layers = _pass.layers;
+
+		vk::Framebuffer framebuffer = context->GetDevice().createFramebuffer(framebufferInfo);
+		framebuffers[std::move(key)] = { framebuffer, executeCount };
+
+		return framebuffer;
+	}
+
+	void RenderGraph::RetireFramebuffers(const std::function<bool(const FramebufferKey&, const CachedFramebuffer&)>& _predicate)
+	{
+		for (auto it = framebuffers.begin(); it != framebuffers.end();)
+		{
+			if (!_predicate(it->first, it->second))
+			{
+				++it;
+				continue;
+			}
+
+			retiredFramebuffers.push_back({ it->second.framebuffer, executeCount });
+			it = framebuffers.erase(it);
+		}
+	}
+
+	void RenderGraph::BeginPass(vk::CommandBuffer _commandBuffer, const Pass& _pass)
+	{
+		if (_pass.renderPass)
+		{
+			vk::RenderPassBeginInfo beginInfo(_pass.renderPass, GetFramebuffer(_pass), vk::Rect2D({ 0, 0 }, _pass.extent), _pass.clearValues);
+			_commandBuffer.beginRenderPass(beginInfo, _pass.secondaryCommandBuffers ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
+			return;
+		}
+
+		std::vector<vk::RenderingAttachmentInfo> colorAttachments;
+		std::optional<vk::RenderingAttachmentInfo> depthAttachment;
+
+		for (const auto& attachment : _pass.attachments)
+		{
+			vk::RenderingAttachmentInfo info;
+			info.imageView = resources[attachment.resource].view;
+			info.imageLayout = attachment.layout;
+			info.loadOp = attachment.loadOp;
+			info.storeOp = attachment.storeOp;
+			info.clearValue = attachment.clearValue;
+
+			if (attachment.depth) depthAttachment = info;
+			else colorAttachments.push_back(info);
+		}
+
+		vk::RenderingInfo renderingInfo;
+		renderingInfo.flags = _pass.secondaryCommandBuffers ? vk::RenderingFlagBits::eContentsSecondaryCommandBuffers : vk::RenderingFlags();
+		renderingInfo.renderArea = vk::Rect2D({ 0, 0 }, _pass.extent);
+		renderingInfo.layerCount = _pass.layers;
+		renderingInfo.setColorAttachments(colorAttachments);
+		renderingInfo.pDepthAttachment = (depthAttachment && _pass.attachmentFormats.depth != vk::Format::eUndefined) ? &*depthAttachment : nullptr;
+		renderingInfo.pStencilAttachment = (depthAttachment && _pass.attachmentFormats.stencil != vk::Format::eUndefined) ? &*depthAttachment : nullptr;
+
+		context->BeginRendering(_commandBuffer, renderingInfo);
+	}
+
+	void RenderGraph::RecordTransitions(vk::CommandBuffer _commandBuffer, const std::vector<Transition>& _transitions) const
+	{
+		if (_transitions.empty()) return;
+
+		// Batched into a single barrier per pass
+		std::vector<vk::ImageMemoryBarrier> barriers;
+		vk::PipelineStageFlags srcStages;
+		vk::PipelineStageFlags dstStages;
+
+		for (const auto& transition : _transitions)
+		{
+			const Resource& resource = resources[transition.resource];
+
+			vk::ImageMemoryBarrier barrier;
+			barrier.oldLayout = transition.oldLayout;
+			barrier.newLayout = transition.newLayout;
+			barrier.srcAccessMask = transition.srcAccess;
+			barrier.dstAccessMask = transition.dstAccess;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = resource.image;
+			barrier.subresourceRange = vk::ImageSubresourceRange(resource.aspect, 0, 1, 0, resource.desc.layers);
+
+			barriers.push_back(barrier);
+			srcStages |= transition.srcStages;
+			dstStages |= transition.dstStages;
+		}
+
+		if (!srcStages) srcStages = vk::PipelineStageFlagBits::eTopOfPipe;
+
+		_commandBuffer.pipelineBarrier(srcStages, dstStages, {}, nullptr, nullptr, barriers);
+	}
+
+	void RenderGraph::Execute(vk::CommandBuffer _commandBuffer)
+	{
+		if (!compiled) Compile();
+
+		executeCount++;
+
+		// Imported views that stopped showing up, e.g. from a recreated swapchain, would otherwise keep their framebuffers forever
+		constexpr uint64_t STALE_EXECUTES = 64;
+		RetireFramebuffers([this](const FramebufferKey&, const CachedFramebuffer& _cached) { return _cached.lastUsed + STALE_EXECUTES < executeCount; });
+
+		while (!retiredFramebuffers.empty() && retiredFramebuffers.front().execute + FramePacer::MAX_FRAMES_IN_FLIGHT < executeCount)
+		{
+			context->GetDevice().destroyFramebuffer(retiredFramebuffers.front().framebuffer);
+			retiredFramebuffers.pop_front();
+		}
+
+		for (const auto& resource : resources)
+		{
+			if (resource.imported && resource.firstPass != UINT32_MAX && !resource.image)
+			{
+				LOG_ERROR(MF("Imported render graph texture [", resource.name, "] was never set"));
+				throw std::runtime_error("Imported render graph texture was never set");
+			}
+		}
+
+		for (const auto& pass : passes)
+		{
+			if (pass.culled) continue;
+
+			RecordTransitions(_commandBuffer, pass.transitions);
+
+			RenderGraphContext passContext{ _commandBuffer, pass.renderPass, pass.attachmentFormats, pass.extent, *this };
+			bool rendering = !pass.attachments.empty();
+
+			if (rendering) BeginPass(_commandBuffer, pass);
+
+			if (pass.execute) pass.execute(passContext);
+
+			if (rendering && pass.renderPass) _commandBuffer.endRenderPass();
+			else if (rendering) context->EndRendering(_commandBuffer);
+		}
+
+		RecordTransitions(_commandBuffer, finalTransitions);
+	}
+
+	void RenderGraph::Reset()
+	{
+		DestroyPhysicalResources();
+
+		passes.clear();
+		resources.clear();
+		compiled = false;
+	}
+
+	void RenderGraph::DestroyPhysicalResources()
+	{
+		vk::Device device = context ? context->GetDevice() : vk::Device(); // Without a context nothing was ever created on a device
+
+		for (auto& [key, cached] : framebuffers)
+		{
+			device.destroyFramebuffer(cached.framebuffer);
+		}
+		framebuffers.clear();
+
+		for (const auto& retired : retiredFramebuffers)
+		{
+			device.destroyFramebuffer(retired.framebuffer);
+		}
+		retiredFramebuffers.clear();
+
+		for (auto& pass : passes)
+		{
+			if (pass.renderPass) device.destroyRenderPass(pass.renderPass);
+			pass.renderPass = nullptr;
+		}
+
+		for (auto& resource : resources)
+		{
+			if (resource.imported) continue;
+
+			if (resource.view) device.destroyImageView(resource.view);
+			if (resource.image) device.destroyImage(resource.image);
+
+			resource.view = nullptr;
+			resource.image = nullptr;
+			resource.memoryBlock = -1;
+		}
+
+		for (auto& block : memoryBlocks)
+		{
+			if (block.memory) device.freeMemory(block.memory);
+		}
+		memoryBlocks.clear();
+
+		compiled = false;
+	}
+
+	RenderGraphHandle RenderGraph::GetHandle(const std::string& _name) const
+	{
+		for (RenderGraphHandle i = 0; i < resources.size(); i++)
+		{
+			if (resources[i].name == _name) return i;
+		}
+
+		return INVALID_HANDLE;
+	}
+
+	const AttachmentFormats& RenderGraph::GetAttachmentFormats(const std::string& _passName) const
+	{
+		for (const auto& pass : passes)
+		{
+			if (pass.name == _passName) return pass.attachmentFormats;
+		}
+
+		LOG_ERROR(MF("Render graph has no pass [", _passName, "]"));
+		throw std::runtime_error("Render graph has no such pass");
+	}
+
+	vk::RenderPass RenderGraph::GetRenderPass(const std::string& _passName) const
+	{
+		for (const auto& pass : passes)
+		{
+			if (pass.name == _passName) return pass.renderPass;
+		}
+
+		LOG_WARNING(MF("Render graph has no pass [", _passName, "]"));
+		return nullptr;
+	}
+
+	bool RenderGraph::IsCulled(const std::string& _passName) const
+	{
+		for (const auto& pass : passes)
+		{
+			if (pass.name == _passName) return pass.culled;
+		}
+
+		return true;
+	}
+}
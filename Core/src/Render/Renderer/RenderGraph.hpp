@@ -0,0 +1,230 @@
+#pragma once
+
+#include "../../pch.hpp"
+#include "../../Context/VulkanContext.hpp"
+
+namespace cp
+{
+	class RenderGraph;
+
+	using RenderGraphHandle = uint32_t;
+
+	struct RenderGraphTextureDesc
+	{
+		vk::Format format = vk::Format::eUndefined;
+		vk::Extent2D extent;
+		uint32_t layers = 1;
+		vk::ImageUsageFlags usage; // Extra usages, the ones implied by the passes are added by Compile
+	};
+
+	enum class RenderGraphAccess : uint8_t
+	{
+		ColorAttachment,
+		DepthAttachment,
+		DepthRead, // Depth tested without writes, e.g. after a depth prepass
+		Sampled,
+		TransferSrc,
+		TransferDst
+	};
+
+	struct RenderGraphContext
+	{
+		vk::CommandBuffer commandBuffer;
+		vk::RenderPass renderPass; // Null for passes without attachments and with dynamic rendering, the pass is begun before the execute callback and ended after it
+		const AttachmentFormats& attachmentFormats; // What dynamic rendering pipelines and secondaries are created against
+		vk::Extent2D extent;
+		const RenderGraph& graph;
+	};
+
+	class RenderGraphBuilder
+	{
+	private:
+		RenderGraph& graph;
+		uint32_t pass;
+
+		RenderGraphHandle Access(RenderGraphHandle _resource, RenderGraphAccess _access, std::optional<vk::ClearValue> _clear = std::nullopt, vk::PipelineStageFlags _stages = {});
+
+	public:
+		RenderGraphBuilder(RenderGraph& _graph, uint32_t _pass) : graph(_graph), pass(_pass) {}
+
+		RenderGraphHandle WriteColor(RenderGraphHandle _resource, std::optional<vk::ClearColorValue> _clear = std::nullopt); // Without a clear the previous content is loaded
+		RenderGraphHandle WriteDepth(RenderGraphHandle _resource, std::optional<vk::ClearDepthStencilValue> _clear = std::nullopt);
+		RenderGraphHandle ReadDepth(RenderGraphHandle _resource);
+		RenderGraphHandle ReadTexture(RenderGraphHandle _resource, vk::PipelineStageFlags _stages = vk::PipelineStageFlagBits::eFragmentShader);
+		RenderGraphHandle CopyFrom(RenderGraphHandle _resource);
+		RenderGraphHandle CopyTo(RenderGraphHandle _resource);
+
+		void SetSideEffect(); // Never culled, for passes whose output leaves the graph some other way (readbacks, queries, ...)
+		void SetSecondaryCommandBuffers(); // The execute callback only records vkCmdExecuteCommands, e.g. through a ParallelRecorder
+	};
+
+	// Passes declare the named textures they read and write, Compile derives everything that was hand written per renderer
+	// - passes contributing to no imported texture are culled
+	// - layout transitions and barriers are placed from the declared accesses, read after read needs none
+	// - transient textures whose lifetimes don't overlap are bound to the same device memory
+	// The pass order is the declaration order, the graph only removes work and never reorders it
+	// No renderer records through a graph yet, EditorRenderer and RendererPrototype still begin their passes by hand
+	class RenderGraph
+	{
+		friend class RenderGraphBuilder;
+		friend struct RenderGraphTestAccess; // RenderGraph.test.cpp, plans a graph without a device
+
+	public:
+		static constexpr RenderGraphHandle INVALID_HANDLE = UINT32_MAX;
+
+		using SetupFunction = std::function<void(RenderGraphBuilder&)>;
+		using ExecuteFunction = std::function<void(const RenderGraphContext&)>;
+
+	private:
+		struct ResourceAccess
+		{
+			RenderGraphHandle resource;
+			RenderGraphAccess access;
+			std::optional<vk::ClearValue> clear;
+			vk::PipelineStageFlags stages; // Sampled reads only
+		};
+
+		struct Transition
+		{
+			RenderGraphHandle resource;
+			vk::ImageLayout oldLayout;
+			vk::ImageLayout newLayout;
+			vk::PipelineStageFlags srcStages;
+			vk::AccessFlags srcAccess;
+			vk::PipelineStageFlags dstStages;
+			vk::AccessFlags dstAccess;
+		};
+
+		struct PassAttachment
+		{
+			RenderGraphHandle resource;
+			vk::ImageLayout layout;
+			vk::AttachmentLoadOp loadOp;
+			vk::AttachmentStoreOp storeOp;
+			vk::ClearValue clearValue;
+			bool depth = false; // Depth stencil slot, color otherwise
+		};
+
+		struct Pass
+		{
+			std::string name;
+			std::vector<ResourceAccess> accesses;
+			ExecuteFunction execute;
+			bool sideEffect = false;
+			bool secondaryCommandBuffers = false;
+
+			bool culled = false;
+			std::vector<Transition> transitions; // Recorded before the pass
+			vk::RenderPass renderPass; // Only without dynamic rendering
+			std::vector<PassAttachment> attachments; // Framebuffer order, colors then depth
+			std::vector<vk::ClearValue> clearValues;
+			AttachmentFormats attachmentFormats;
+			vk::Extent2D extent;
+			uint32_t layers = 1;
+		};
+
+		struct Resource
+		{
+			std::string name;
+			RenderGraphTextureDesc desc;
+			vk::ImageAspectFlags aspect;
+			bool imported = false;
+			vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined; // Imported only, layout the texture is in when Execute starts
+			vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined; // Imported only, layout Execute leaves it in, undefined keeps the last one
+
+			vk::Image image;
+			vk::ImageView view;
+			vk::ImageUsageFlags usage;
+			uint32_t firstPass = UINT32_MAX;
+			uint32_t lastPass = 0;
+			int32_t memoryBlock = -1; // Transient only
+		};
+
+		struct FramebufferKey
+		{
+			vk::RenderPass renderPass;
+			std::vector<vk::ImageView> views; // Framebuffer order
+
+			bool operator==(const FramebufferKey& _other) const = default;
+		};
+
+		struct FramebufferKeyHash
+		{
+			std::size_t operator()(const FramebufferKey& _key) const;
+		};
+
+		struct CachedFramebuffer
+		{
+			vk::Framebuffer framebuffer;
+			uint64_t lastUsed = 0; // Execute it was last begun in
+		};
+
+		struct RetiredFramebuffer
+		{
+			vk::Framebuffer framebuffer;
+			uint64_t execute;
+		};
+
+		struct MemoryBlock
+		{
+			vk::DeviceMemory memory;
+			vk::DeviceSize size = 0;
+			uint32_t memoryTypeBits = ~0u;
+			std::vector<RenderGraphHandle> users;
+		};
+
+		cp::VulkanContext* context;
+
+		std::vector<Resource> resources;
+		std::vector<Pass> passes;
+		std::vector<MemoryBlock> memoryBlocks;
+		std::vector<Transition> finalTransitions; // Imported textures back to their final layout
+
+		std::unordered_map<FramebufferKey, CachedFramebuffer, FramebufferKeyHash> framebuffers; // Unused with dynamic rendering, imported views may change every frame so one is kept per view combination
+		std::deque<RetiredFramebuffer> retiredFramebuffers; // Destroyed once no frame in flight can still be inside them
+		uint64_t executeCount = 0;
+
+		bool compiled = false;
+
+		void CullPasses();
+		void ComputeLifetimes();
+		void AllocateTransients();
+		void AssignMemoryBlocks(const std::vector<vk::MemoryRequirements>& _requirements); // Indexed by handle, fills memoryBlocks without allocating them
+		void PlaceTransitions();
+		void CreateRenderPasses();
+		void DestroyPhysicalResources();
+
+		vk::Framebuffer GetFramebuffer(const Pass& _pass);
+		void RetireFramebuffers(const std::function<bool(const FramebufferKey&, const CachedFramebuffer&)>& _predicate);
+		void BeginPass(vk::CommandBuffer _commandBuffer, const Pass& _pass);
+		void RecordTransitions(vk::CommandBuffer _commandBuffer, const std::vector<Transition>& _transitions) const;
+
+	public:
+		NO_COPY(RenderGraph)
+
+		RenderGraph(cp::VulkanContext* _context); // Compile and Execute need a context, a null one only allows planning
+		~RenderGraph();
+
+		RenderGraphHandle CreateTexture(const std::string& _name, const RenderGraphTextureDesc& _desc); // Transient, owned and aliased by the graph
+		RenderGraphHandle ImportTexture(const std::string& _name, const RenderGraphTextureDesc& _desc, vk::ImageLayout _initialLayout, vk::ImageLayout _finalLayout);
+		void SetImportedTexture(RenderGraphHandle _resource, vk::Image _image, vk::ImageView _view); // Before each Execute, e.g. the acquired swapchain image
+		void ReleaseImportedView(vk::ImageView _view); // Before destroying a view given to SetImportedTexture, e.g. on swapchain recreation, so a reused handle never finds its framebuffers
+
+		void AddPass(const std::string& _name, const SetupFunction& _setup, const ExecuteFunction& _execute);
+
+		void Compile(); // Again after any change to the passes or texture descriptions, the device must be idle
+		void Execute(vk::CommandBuffer _commandBuffer); // Once per frame, framebuffers of imported views unused for a while are retired here
+		void Reset(); // Drops every pass and texture, the device must be idle
+
+		RenderGraphHandle GetHandle(const std::string& _name) const;
+		vk::RenderPass GetRenderPass(const std::string& _passName) const; // For pipeline creation, valid once compiled, null with dynamic rendering
+		const AttachmentFormats& GetAttachmentFormats(const std::string& _passName) const; // For dynamic rendering pipelines, valid once compiled
+		bool IsCulled(const std::string& _passName) const;
+
+		inline vk::Image GetImage(RenderGraphHandle _resource) const { return resources.at(_resource).image; }
+		inline vk::ImageView GetImageView(RenderGraphHandle _resource) const { return resources.at(_resource).view; }
+		inline const RenderGraphTextureDesc& GetDesc(RenderGraphHandle _resource) const { return resources.at(_resource).desc; }
+		inline size_t GetMemoryBlockCount() const { return memoryBlocks.size(); }
+		inline bool IsCompiled() const { return compiled; }
+	};
+}
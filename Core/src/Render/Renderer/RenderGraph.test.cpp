@@ -0,0 +1,308 @@
+#include "pch.hpp"
+#include "RenderGraph.hpp"
+
+#include <gtest/gtest.h>
+
+namespace cp
+{
+	// Runs the device independent half of Compile, every transient asks for width * height * 4 bytes of any memory type
+	struct RenderGraphTestAccess
+	{
+		static void Plan(RenderGraph& _graph)
+		{
+			_graph.CullPasses();
+			_graph.ComputeLifetimes();
+
+			std::vector<vk::MemoryRequirements> requirements(_graph.resources.size());
+			for (size_t i = 0; i < _graph.resources.size(); i++)
+			{
+				const vk::Extent2D& extent = _graph.resources[i].desc.extent;
+				requirements[i] = vk::MemoryRequirements(vk::DeviceSize(extent.width) * extent.height * 4, 256, ~0u);
+			}
+
+			_graph.AssignMemoryBlocks(requirements);
+			_graph.PlaceTransitions();
+		}
+
+		static const auto& GetTransitions(const RenderGraph& _graph, const std::string& _passName)
+		{
+			auto it = std::find_if(_graph.passes.begin(), _graph.passes.end(), [&_passName](const auto& _pass) { return _pass.name == _passName; });
+			return it->transitions;
+		}
+
+		static const auto& GetFinalTransitions(const RenderGraph& _graph) { return _graph.finalTransitions; }
+		static int32_t GetMemoryBlock(const RenderGraph& _graph, RenderGraphHandle _resource) { return _graph.resources[_resource].memoryBlock; }
+	};
+}
+
+namespace
+{
+	using Access = cp::RenderGraphTestAccess;
+
+	const vk::ClearColorValue CLEAR_COLOR = vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f });
+
+	cp::RenderGraphTextureDesc ColorDesc(uint32_t _size = 64)
+	{
+		return { vk::Format::eR8G8B8A8Unorm, vk::Extent2D(_size, _size) };
+	}
+
+	void NoExecute(const cp::RenderGraphContext&) {}
+
+	// Transient "Scene" sampled into the imported "Backbuffer", presented afterwards
+	struct SceneGraph
+	{
+		cp::RenderGraph graph{ nullptr };
+		cp::RenderGraphHandle scene;
+		cp::RenderGraphHandle backbuffer;
+
+		SceneGraph()
+		{
+			scene = graph.CreateTexture("Scene", ColorDesc());
+			backbuffer = graph.ImportTexture("Backbuffer", ColorDesc(), vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
+		}
+
+		void AddScenePass(const std::string& _name, bool _clear)
+		{
+			graph.AddPass(_name, [this, _clear](cp::RenderGraphBuilder& _builder) { _builder.WriteColor(scene, _clear ? std::optional(CLEAR_COLOR) : std::nullopt); }, NoExecute);
+		}
+
+		void AddCompositePass()
+		{
+			graph.AddPass("Composite", [this](cp::RenderGraphBuilder& _builder)
+				{
+					_builder.ReadTexture(scene);
+					_builder.WriteColor(backbuffer, CLEAR_COLOR);
+				}, NoExecute);
+		}
+	};
+}
+
+TEST(RenderGraphCulling, UnreadOutputIsCulled)
+{
+	SceneGraph scene;
+	scene.AddScenePass("Scene", true);
+	scene.graph.AddPass("Debug", [&scene](cp::RenderGraphBuilder& _builder) { _builder.WriteColor(scene.graph.CreateTexture("Debug", ColorDesc()), CLEAR_COLOR); }, NoExecute);
+	scene.AddCompositePass();
+	Access::Plan(scene.graph);
+
+	EXPECT_FALSE(scene.graph.IsCulled("Scene"));
+	EXPECT_TRUE(scene.graph.IsCulled("Debug"));
+	EXPECT_FALSE(scene.graph.IsCulled("Composite"));
+}
+
+TEST(RenderGraphCulling, SideEffectsAreKept)
+{
+	SceneGraph scene;
+	scene.graph.AddPass("Readback", [&scene](cp::RenderGraphBuilder& _builder)
+		{
+			_builder.WriteColor(scene.graph.CreateTexture("Readback", ColorDesc()), CLEAR_COLOR);
+			_builder.SetSideEffect();
+		}, NoExecute);
+	Access::Plan(scene.graph);
+
+	EXPECT_FALSE(scene.graph.IsCulled("Readback"));
+}
+
+TEST(RenderGraphCulling, ClearEndsTheDependencyChain)
+{
+	SceneGraph scene;
+	scene.AddScenePass("Overwritten", true);
+	scene.AddScenePass("Scene", true);
+	scene.AddCompositePass();
+	Access::Plan(scene.graph);
+
+	EXPECT_TRUE(scene.graph.IsCulled("Overwritten"));
+	EXPECT_FALSE(scene.graph.IsCulled("Scene"));
+}
+
+TEST(RenderGraphCulling, LoadExtendsTheDependencyChain)
+{
+	SceneGraph scene;
+	scene.AddScenePass("Opaque", true);
+	scene.AddScenePass("Transparent", false);
+	scene.AddCompositePass();
+	Access::Plan(scene.graph);
+
+	EXPECT_FALSE(scene.graph.IsCulled("Opaque"));
+	EXPECT_FALSE(scene.graph.IsCulled("Transparent"));
+}
+
+TEST(RenderGraphAliasing, DisjointLifetimesShareMemory)
+{
+	SceneGraph scene;
+	cp::RenderGraphHandle bloom = scene.graph.CreateTexture("Bloom", ColorDesc());
+
+	scene.AddScenePass("Scene", true); // Scene lives in passes 0 and 1
+	scene.graph.AddPass("Bloom", [&](cp::RenderGraphBuilder& _builder)
+		{
+			_builder.ReadTexture(scene.scene);
+			_builder.WriteColor(bloom, CLEAR_COLOR);
+		}, NoExecute);
+	scene.graph.AddPass("Composite", [&](cp::RenderGraphBuilder& _builder) // Bloom lives in passes 1 and 2, Scene is still read by Bloom
+		{
+			_builder.ReadTexture(bloom);
+			_builder.WriteColor(scene.backbuffer, CLEAR_COLOR);
+		}, NoExecute);
+	Access::Plan(scene.graph);
+
+	EXPECT_EQ(scene.graph.GetMemoryBlockCount(), 2u); // Both alive in pass 1
+	EXPECT_NE(Access::GetMemoryBlock(scene.graph, scene.scene), Access::GetMemoryBlock(scene.graph, bloom));
+
+	cp::RenderGraph graph(nullptr);
+	cp::RenderGraphHandle first = graph.CreateTexture("First", ColorDesc());
+	cp::RenderGraphHandle second = graph.CreateTexture("Second", ColorDesc());
+	cp::RenderGraphHandle third = graph.CreateTexture("Third", ColorDesc());
+	cp::RenderGraphHandle output = graph.ImportTexture("Output", ColorDesc(), vk::ImageLayout::eUndefined, vk::ImageLayout::eUndefined);
+
+	graph.AddPass("A", [&](cp::RenderGraphBuilder& _builder) { _builder.WriteColor(first, CLEAR_COLOR); }, NoExecute);
+	graph.AddPass("B", [&](cp::RenderGraphBuilder& _builder) { _builder.ReadTexture(first); _builder.WriteColor(second, CLEAR_COLOR); }, NoExecute);
+	graph.AddPass("C", [&](cp::RenderGraphBuilder& _builder) { _builder.ReadTexture(second); _builder.WriteColor(third, CLEAR_COLOR); }, NoExecute);
+	graph.AddPass("D", [&](cp::RenderGraphBuilder& _builder) { _builder.ReadTexture(third); _builder.WriteColor(output, CLEAR_COLOR); }, NoExecute);
+	Access::Plan(graph);
+
+	EXPECT_EQ(graph.GetMemoryBlockCount(), 2u); // First is done before Third starts
+	EXPECT_EQ(Access::GetMemoryBlock(graph, first), Access::GetMemoryBlock(graph, third));
+	EXPECT_NE(Access::GetMemoryBlock(graph, first), Access::GetMemoryBlock(graph, second));
+}
+
+TEST(RenderGraphAliasing, BlocksFitTheirLargestUser)
+{
+	cp::RenderGraph graph(nullptr);
+	cp::RenderGraphHandle small = graph.CreateTexture("Small", ColorDesc(32));
+	cp::RenderGraphHandle large = graph.CreateTexture("Large", ColorDesc(128));
+	cp::RenderGraphHandle output = graph.ImportTexture("Output", ColorDesc(), vk::ImageLayout::eUndefined, vk::ImageLayout::eUndefined);
+
+	graph.AddPass("Small", [&](cp::RenderGraphBuilder& _builder) { _builder.WriteColor(small, CLEAR_COLOR); }, NoExecute);
+	graph.AddPass("Copy", [&](cp::RenderGraphBuilder& _builder) { _builder.ReadTexture(small); _builder.WriteColor(output, CLEAR_COLOR); }, NoExecute);
+	graph.AddPass("Large", [&](cp::RenderGraphBuilder& _builder) { _builder.WriteColor(large, CLEAR_COLOR); }, NoExecute);
+	graph.AddPass("Blend", [&](cp::RenderGraphBuilder& _builder) { _builder.ReadTexture(large); _builder.WriteColor(output); }, NoExecute);
+	Access::Plan(graph);
+
+	EXPECT_EQ(graph.GetMemoryBlockCount(), 1u); // Large placed first, Small fits in its block
+	EXPECT_EQ(Access::GetMemoryBlock(graph, small), Access::GetMemoryBlock(graph, large));
+}
+
+TEST(RenderGraphBarriers, WriteThenSample)
+{
+	SceneGraph scene;
+	scene.AddScenePass("Scene", true);
+	scene.AddCompositePass();
+	Access::Plan(scene.graph);
+
+	const auto& transitions = Access::GetTransitions(scene.graph, "Composite");
+	auto sampled = std::find_if(transitions.begin(), transitions.end(), [&scene](const auto& _transition) { return _transition.resource == scene.scene; });
+	ASSERT_NE(sampled, transitions.end());
+
+	EXPECT_EQ(sampled->oldLayout, vk::ImageLayout::eColorAttachmentOptimal);
+	EXPECT_EQ(sampled->newLayout, vk::ImageLayout::eShaderReadOnlyOptimal);
+	EXPECT_EQ(sampled->srcStages, vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput));
+	EXPECT_EQ(sampled->srcAccess, vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite));
+	EXPECT_EQ(sampled->dstStages, vk::PipelineStageFlags(vk::PipelineStageFlagBits::eFragmentShader));
+	EXPECT_EQ(sampled->dstAccess, vk::AccessFlags(vk::AccessFlagBits::eShaderRead));
+}
+
+TEST(RenderGraphBarriers, ClearDiscardsThePreviousLayout)
+{
+	for (bool clear : { true, false })
+	{
+		cp::RenderGraph graph(nullptr);
+		cp::RenderGraphHandle history = graph.ImportTexture("History", ColorDesc(), vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+		graph.AddPass("Accumulate", [&](cp::RenderGraphBuilder& _builder) { _builder.WriteColor(history, clear ? std::optional(CLEAR_COLOR) : std::nullopt); }, NoExecute);
+		Access::Plan(graph);
+
+		const auto& transitions = Access::GetTransitions(graph, "Accumulate");
+		ASSERT_EQ(transitions.size(), 1u);
+		EXPECT_EQ(transitions[0].oldLayout, clear ? vk::ImageLayout::eUndefined : vk::ImageLayout::eShaderReadOnlyOptimal);
+		EXPECT_EQ(transitions[0].newLayout, vk::ImageLayout::eColorAttachmentOptimal);
+		EXPECT_EQ(transitions[0].srcStages, vk::PipelineStageFlags(vk::PipelineStageFlagBits::eAllCommands)); // Last touched outside the graph
+	}
+}
+
+TEST(RenderGraphBarriers, ReadAfterReadNeedsNone)
+{
+	SceneGraph scene;
+	scene.AddScenePass("Scene", true);
+	scene.graph.AddPass("Histogram", [&scene](cp::RenderGraphBuilder& _builder)
+		{
+			_builder.ReadTexture(scene.scene);
+			_builder.SetSideEffect();
+		}, NoExecute);
+	scene.AddCompositePass();
+	Access::Plan(scene.graph);
+
+	EXPECT_EQ(Access::GetTransitions(scene.graph, "Histogram").size(), 1u);
+
+	for (const auto& transition : Access::GetTransitions(scene.graph, "Composite"))
+	{
+		EXPECT_NE(transition.resource, scene.scene);
+	}
+}
+
+TEST(RenderGraphBarriers, WriteAfterReadWaitsOnEveryReader)
+{
+	SceneGraph scene;
+	scene.AddScenePass("Scene", true);
+	scene.graph.AddPass("Compute", [&scene](cp::RenderGraphBuilder& _builder)
+		{
+			_builder.ReadTexture(scene.scene, vk::PipelineStageFlagBits::eComputeShader);
+			_builder.SetSideEffect();
+		}, NoExecute);
+	scene.graph.AddPass("Sample", [&scene](cp::RenderGraphBuilder& _builder)
+		{
+			_builder.ReadTexture(scene.scene);
+			_builder.SetSideEffect();
+		}, NoExecute);
+	scene.AddScenePass("Overlay", false);
+	scene.AddCompositePass();
+	Access::Plan(scene.graph);
+
+	const auto& transitions = Access::GetTransitions(scene.graph, "Overlay");
+	ASSERT_EQ(transitions.size(), 1u);
+	EXPECT_EQ(transitions[0].oldLayout, vk::ImageLayout::eShaderReadOnlyOptimal);
+	EXPECT_EQ(transitions[0].srcStages, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eFragmentShader);
+	EXPECT_FALSE(transitions[0].srcAccess); // Reads have nothing to make available
+}
+
+TEST(RenderGraphBarriers, AliasedTextureWaitsOnThePreviousOccupant)
+{
+	cp::RenderGraph graph(nullptr);
+	cp::RenderGraphHandle first = graph.CreateTexture("First", ColorDesc());
+	cp::RenderGraphHandle second = graph.CreateTexture("Second", ColorDesc());
+	cp::RenderGraphHandle third = graph.CreateTexture("Third", ColorDesc());
+	cp::RenderGraphHandle output = graph.ImportTexture("Output", ColorDesc(), vk::ImageLayout::eUndefined, vk::ImageLayout::eUndefined);
+
+	graph.AddPass("A", [&](cp::RenderGraphBuilder& _builder) { _builder.WriteColor(first, CLEAR_COLOR); }, NoExecute);
+	graph.AddPass("B", [&](cp::RenderGraphBuilder& _builder) { _builder.ReadTexture(first, vk::PipelineStageFlagBits::eComputeShader); _builder.WriteColor(second, CLEAR_COLOR); }, NoExecute);
+	graph.AddPass("C", [&](cp::RenderGraphBuilder& _builder) { _builder.ReadTexture(second); _builder.WriteColor(third, CLEAR_COLOR); }, NoExecute);
+	graph.AddPass("D", [&](cp::RenderGraphBuilder& _builder) { _builder.ReadTexture(third); _builder.WriteColor(output, CLEAR_COLOR); }, NoExecute);
+	Access::Plan(graph);
+	ASSERT_EQ(Access::GetMemoryBlock(graph, first), Access::GetMemoryBlock(graph, third));
+
+	const auto& transitions = Access::GetTransitions(graph, "C");
+	auto aliased = std::find_if(transitions.begin(), transitions.end(), [third](const auto& _transition) { return _transition.resource == third; });
+	ASSERT_NE(aliased, transitions.end());
+
+	EXPECT_EQ(aliased->oldLayout, vk::ImageLayout::eUndefined);
+	EXPECT_EQ(aliased->srcStages, vk::PipelineStageFlags(vk::PipelineStageFlagBits::eComputeShader)); // Last read of First in B
+
+	// First is the first occupant of the block, it waits on Third from the previous Execute
+	const auto& firstTransitions = Access::GetTransitions(graph, "A");
+	ASSERT_EQ(firstTransitions.size(), 1u);
+	EXPECT_EQ(firstTransitions[0].srcStages, vk::PipelineStageFlags(vk::PipelineStageFlagBits::eFragmentShader));
+}
+
+TEST(RenderGraphBarriers, ImportedTexturesEndInTheirFinalLayout)
+{
+	SceneGraph scene;
+	scene.AddScenePass("Scene", true);
+	scene.AddCompositePass();
+	Access::Plan(scene.graph);
+
+	const auto& transitions = Access::GetFinalTransitions(scene.graph);
+	ASSERT_EQ(transitions.size(), 1u);
+	EXPECT_EQ(transitions[0].resource, scene.backbuffer);
+	EXPECT_EQ(transitions[0].oldLayout, vk::ImageLayout::eColorAttachmentOptimal);
+	EXPECT_EQ(transitions[0].newLayout, vk::ImageLayout::ePresentSrcKHR);
+	EXPECT_EQ(transitions[0].srcAccess, vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite));
+	EXPECT_EQ(transitions[0].dstStages, vk::PipelineStageFlags(vk::PipelineStageFlagBits::eBottomOfPipe));
+}
@@ -5,6 +5,9 @@
 
 #include "../Setup/Frame.hpp"
 
+#include "../../Resources/TextureStreamer.hpp"
+#include "../../Util/ShaderCompiler/ShaderHotReloader.hpp"
+
 void cp::RendererPrototype::CreateFixedPipelines(RendererInstance& _instance) {}
 void cp::RendererPrototype::CreateRenderPasses(RendererInstance& _instance) {}
 
@@ -16,24 +19,15 @@ uint32_t cp::RendererPrototype::PrepareFrame(cp::Swapchain* _swapchain)
 		return ~0u;
 	}
 
-	if (_swapchain->GetCurrentFrameIndex() >= _swapchain->GetFrameCount())
-	{
-		LOG_WARNING("Current frame index is out of bounds, resetting to 0");
-		_swapchain->SetCurrentFrame(0);
-		return -1;
-	}
-
-	if (context->GetDevice().waitForFences(1, &_swapchain->GetCurrentFrame()->GetInFlightFence(), VK_TRUE, std::numeric_limits<uint32_t>().max()) != vk::Result::eSuccess)
-	{
-		throw std::runtime_error("Failed to wait for fence");
-	}
+	cp::FramePacer* pacer = _swapchain->GetFramePacer();
+	vk::Queue graphicsQueue = context->GetDevice().getQueue(context->GetQueueFamilyIndices().graphicsFamily.value(), 0);
 
-	vk::Result result = context->GetDevice().resetFences(1, &_swapchain->GetCurrentFrame()->GetInFlightFence());
+	// Blocks until the frame that last used this slot completed, replaces the per frame fences
+	pacer->BeginFrame(_swapchain->GetSwapchain());
+	_swapchain->SetCurrentFrame(pacer->GetSlot());
 
-	if (result != vk::Result::eSuccess)
-	{
-		throw std::runtime_error("Failed to reset fence");
-	}
+	// The GPU is done with this slot, its transient descriptor sets can be reused
+	context->GetDescriptorSetManager()->BeginFrame(_swapchain->GetCurrentFrameIndex());
 
 	uint32 imageIndex;
 
@@ -43,61 +37,49 @@ uint32_t cp::RendererPrototype::PrepareFrame(cp::Swapchain* _swapchain)
 	}
 	catch (vk::OutOfDateKHRError e)
 	{
+		pacer->AbandonFrame(graphicsQueue);
 		_swapchain->Recreate();
 		return -1;
 	}
 
+	_swapchain->SetCurrentImage(imageIndex);
+
 	_swapchain->GetCurrentFrame()->GetCommandBuffer().reset();
 
 	vk::CommandBufferBeginInfo beginInfo = {};
 	_swapchain->GetCurrentFrame()->GetCommandBuffer().begin(beginInfo);
+	pacer->WriteBeginTimestamp(_swapchain->GetCurrentFrame()->GetCommandBuffer());
 
 	return imageIndex;
 }
 
 void cp::RendererPrototype::SubmitFrame(cp::Swapchain* _swapchain)
 {
-	_swapchain->GetCurrentFrame()->GetCommandBuffer().end();
-
-	vk::SubmitInfo submitInfo = {};
-	vk::Semaphore waitSemaphores[] = { _swapchain->GetCurrentFrame()->GetImageAvailableSemaphore() };
-	vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
-	vk::Semaphore signalSemaphores[] = { _swapchain->GetCurrentFrame()->GetRenderFinishedSemaphore() };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &_swapchain->GetCurrentFrame()->GetCommandBuffer();
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	cp::FramePacer* pacer = _swapchain->GetFramePacer();
+	cp::Frame* frame = _swapchain->GetCurrentFrame();
 
-	vk::Queue graphicsQueue = context->GetDevice().getQueue(context->GetQueueFamilyIndices().graphicsFamily.value(), 0);
+	pacer->WriteEndTimestamp(frame->GetCommandBuffer());
+	frame->GetCommandBuffer().end();
 
-	vk::Result result = graphicsQueue.submit(1, &submitInfo, _swapchain->GetCurrentFrame()->GetInFlightFence());
+	vk::Queue graphicsQueue = context->GetDevice().getQueue(context->GetQueueFamilyIndices().graphicsFamily.value(), 0);
 
-	if (result != vk::Result::eSuccess)
+	// Material parameters edited while recording reach the device with this submit
+	if (cp::BindlessManager* bindless = context->GetBindlessManager())
 	{
-		throw std::runtime_error("Failed to submit command buffer");
+		bindless->FlushMaterialWrites();
 	}
+
+	pacer->Submit(graphicsQueue, frame->GetCommandBuffer(), frame->GetImageAvailableSemaphore(), _swapchain->GetCurrentImageIndex());
 }
 
 void cp::RendererPrototype::PresentFrame(cp::Swapchain* _swapchain, uint32_t _index)
 {
 	vk::Result result = vk::Result::eSuccess;
 	vk::Queue graphicsQueue = context->GetDevice().getQueue(context->GetQueueFamilyIndices().graphicsFamily.value(), 0);
-	vk::Semaphore signalSemaphores[] = { _swapchain->GetCurrentFrame()->GetRenderFinishedSemaphore() };
-
-	vk::PresentInfoKHR presentInfo = {};
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
-	vk::SwapchainKHR swapchains[] = { _swapchain->GetSwapchain() };
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = swapchains;
-	presentInfo.pImageIndices = &_index;
 
 	try
 	{
-		result = graphicsQueue.presentKHR(presentInfo);
+		result = _swapchain->GetFramePacer()->Present(graphicsQueue, _swapchain->GetSwapchain(), _index);
 	}
 	catch (vk::OutOfDateKHRError e)
 	{
@@ -116,10 +98,29 @@ void cp::RendererPrototype::PresentFrame(cp::Swapchain* _swapchain, uint32_t _in
 
 void cp::RendererPrototype::EndFrame(cp::Swapchain* _swapchain)
 {
-	_swapchain->SetCurrentFrame((_swapchain->GetCurrentFrameIndex() + 1) % _swapchain->GetFrameCount());
+	// Residency changes happen between frames, after this frame's usage reports
+	if (cp::TextureStreamer* streamer = cp::TextureStreamer::Get())
+	{
+		streamer->Update();
+	}
+
+	if (cp::BindlessManager* bindless = context->GetBindlessManager())
+	{
+		bindless->NextFrame();
+	}
+
+	// Edited shaders queue their pipelines here so they are published with the rest below
+	if (cp::ShaderHotReloader* reloader = cp::ShaderHotReloader::Get())
+	{
+		reloader->Update();
+	}
+
+	context->GetPipelinesManager()->Update(); // Pipelines compiled in the background become visible to the next frame
 }
 
-cp::RendererPrototype::RendererPrototype(cp::VulkanContext* _context) : context(_context) {}
+cp::RendererPrototype::RendererPrototype(cp::VulkanContext* _context) : context(_context)
+{
+}
 
 cp::RendererPrototype::~RendererPrototype() {}
 
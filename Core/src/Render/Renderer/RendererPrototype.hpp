@@ -26,6 +26,8 @@ namespace cp
 		cp::Material* material;
 		cp::MaterialInstance* materialInstance;
 		cp::Mesh* mesh;
+		uint32_t submeshIndex = 0; // Index into mesh->GetSubmeshes(), the material instance is the one bound to that submesh's material slot
+		uint32_t lod = 0; // Instances are grouped per LOD, draw with mesh->GetSubmeshLOD(submeshIndex, lod)
 		std::vector<TransformData> transforms;
 		//uint32_t instanceOffset = 0;
 	};
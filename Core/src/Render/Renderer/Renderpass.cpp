@@ -5,14 +5,26 @@ cp::Subpass::Subpass(vk::PipelineBindPoint _bindPoint, std::vector<vk::Attachmen
 {
 	depthOnly = _depthOnly;
 
-	subpassDescription.pipelineBindPoint = _bindPoint;
-	subpassDescription.colorAttachmentCount = static_cast<uint32_t>(_colorAttachments.size());
-	subpassDescription.pColorAttachments = _colorAttachments.data();
-	subpassDescription.pDepthStencilAttachment = &_depthAttachment;
+	bindPoint = _bindPoint;
+	colorAttachments = std::move(_colorAttachments);
+	depthAttachment = _depthAttachment;
+}
+
+vk::SubpassDescription cp::Subpass::GetDescription() const
+{
+	vk::SubpassDescription subpassDescription;
+	subpassDescription.pipelineBindPoint = bindPoint;
+	subpassDescription.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+	subpassDescription.pColorAttachments = colorAttachments.data();
+	subpassDescription.pDepthStencilAttachment = &depthAttachment;
+
+	return subpassDescription;
 }
 
 vk::RenderPass cp::RenderpassDescription::Build()
 {
+	if (context->UsesDynamicRendering()) return nullptr;
+
 	std::vector<vk::SubpassDescription> subpasses;
 
 	for (auto& sp : this->subpasses)
@@ -31,6 +43,60 @@ vk::RenderPass cp::RenderpassDescription::Build()
 	return context->GetDevice().createRenderPass(renderPassInfo);
 }
 
+cp::AttachmentFormats cp::RenderpassDescription::GetAttachmentFormats() const
+{
+	cp::AttachmentFormats formats;
+
+	for (const auto& attachment : attachments)
+	{
+		vk::ImageAspectFlags aspect = Helper::Format::GetAspectFlags(attachment.format);
+
+		if (aspect & vk::ImageAspectFlagBits::eColor)
+		{
+			formats.colors.push_back(attachment.format);
+			continue;
+		}
+
+		if (aspect & vk::ImageAspectFlagBits::eDepth) formats.depth = attachment.format;
+		if (aspect & vk::ImageAspectFlagBits::eStencil) formats.stencil = attachment.format;
+	}
+
+	return formats;
+}
+
+std::string cp::RenderpassDescription::GetCompatibilityKey(uint32_t _subpass) const
+{
+	std::string key;
+	auto Append = [&key](uint32_t _value) { key.append(reinterpret_cast<const char*>(&_value), sizeof(_value)); };
+
+	// Stricter than the render pass compatibility rules, the load and store ops are part of it so a pipeline never outlives a pass it wasn't meant for
+	Append(static_cast<uint32_t>(attachments.size()));
+	for (const auto& attachment : attachments)
+	{
+		Append(static_cast<uint32_t>(attachment.format));
+		Append(static_cast<uint32_t>(attachment.samples));
+		Append(static_cast<uint32_t>(attachment.loadOp));
+		Append(static_cast<uint32_t>(attachment.storeOp));
+		Append(static_cast<uint32_t>(attachment.stencilLoadOp));
+		Append(static_cast<uint32_t>(attachment.stencilStoreOp));
+	}
+
+	Append(static_cast<uint32_t>(subpasses.size()));
+	for (const auto& subpass : subpasses)
+	{
+		Append(static_cast<uint32_t>(subpass.GetColorAttachments().size()));
+		for (const auto& reference : subpass.GetColorAttachments())
+		{
+			Append(reference.attachment);
+		}
+		Append(subpass.GetDepthAttachment().attachment);
+	}
+
+	Append(_subpass);
+
+	return key;
+}
+
 cp::RenderpassDescription::RenderpassDescription(cp::VulkanContext* _context, const std::string& _name)
 {
 	context = _context;
@@ -44,5 +110,5 @@ cp::Renderpass::Renderpass(cp::VulkanContext* _context, const RenderpassDescript
 
 cp::Renderpass::~Renderpass()
 {
-	context->GetDevice().destroyRenderPass(renderPass);
+	if (renderPass) context->GetDevice().destroyRenderPass(renderPass);
 }
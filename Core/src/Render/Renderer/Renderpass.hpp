@@ -11,12 +11,16 @@ namespace cp
 	protected:
 		bool depthOnly = false;
 
-		vk::SubpassDescription subpassDescription;
+		vk::PipelineBindPoint bindPoint;
+		std::vector<vk::AttachmentReference> colorAttachments;
+		vk::AttachmentReference depthAttachment;
 
 	public:
 		Subpass(vk::PipelineBindPoint _bindPoint, std::vector<vk::AttachmentReference> _colorAttachments, vk::AttachmentReference _depthAttachment, bool _depthOnly = false);
 
-		inline vk::SubpassDescription GetDescription() { return subpassDescription; }
+		vk::SubpassDescription GetDescription() const; // Points into this subpass, only valid while it lives and isn't moved
+		inline const std::vector<vk::AttachmentReference>& GetColorAttachments() const { return colorAttachments; }
+		inline const vk::AttachmentReference& GetDepthAttachment() const { return depthAttachment; }
 		inline constexpr bool IsDepthOnly() { return depthOnly; }
 	};
 
@@ -36,7 +40,9 @@ namespace cp
 		std::string name;
 
 	public:
-		vk::RenderPass Build();
+		vk::RenderPass Build(); // Null with dynamic rendering, pipelines use GetAttachmentFormats instead
+		cp::AttachmentFormats GetAttachmentFormats() const; // Attachment order, depth stencil formats fill the depth and stencil slots
+		std::string GetCompatibilityKey(uint32_t _subpass) const; // PipelineCreateData::renderPassKey, equal for render passes a pipeline of _subpass can be used with
 
 		inline void AddSubpass(const Subpass& _subpass) { subpasses.push_back(_subpass); }
 		inline void AddAttachment(const vk::AttachmentDescription& _attachment) { attachments.push_back(_attachment); }
@@ -64,5 +70,9 @@ namespace cp
 	public:
 		Renderpass(cp::VulkanContext* _context, const RenderpassDescription& _description);
 		~Renderpass();
+
+		inline vk::RenderPass GetRenderPass() const { return renderPass; }
+		inline const RenderpassDescription& GetDescription() const { return description; }
+		inline bool IsDynamic() const { return !renderPass; } // Begun with vkCmdBeginRendering, no framebuffer involved
 	};
 }
\ No newline at end of file
@@ -9,12 +9,6 @@ namespace cp
 		vk::SemaphoreCreateInfo semaphoreInfo;
 
 		imageAvailableSemaphore = context->GetDevice().createSemaphore(semaphoreInfo);
-		renderFinishedSemaphore = context->GetDevice().createSemaphore(semaphoreInfo);
-
-		vk::FenceCreateInfo fenceInfo;
-		fenceInfo.flags = vk::FenceCreateFlagBits::eSignaled;
-
-		inFlightFence = context->GetDevice().createFence(fenceInfo);
 
 		vk::CommandBufferAllocateInfo allocInfo;
 		allocInfo.commandPool = context->GetCommandPool();
@@ -29,19 +23,53 @@ namespace cp
 		context->GetDevice().waitIdle();
 
 		context->GetDevice().destroySemaphore(imageAvailableSemaphore);
-		context->GetDevice().destroySemaphore(renderFinishedSemaphore);
-		context->GetDevice().destroyFence(inFlightFence);
 
 		context->GetDevice().freeCommandBuffers(context->GetCommandPool(), commandBuffer);
 
-		for (auto& renderTarget : renderTargets)
+		for (auto& worker : workers)
+		{
+			context->GetDevice().destroyCommandPool(worker.pool); // Frees its secondaries
+		}
+	}
+
+	void Frame::ReserveWorkers(uint32_t _count)
+	{
+		while (workers.size() < _count)
 		{
-			delete renderTarget;
+			// Reset as a whole every frame, buffers are never reset one by one
+			vk::CommandPoolCreateInfo poolInfo(vk::CommandPoolCreateFlagBits::eTransient, context->GetQueueFamilyIndices().graphicsFamily.value());
+
+			WorkerCommands worker;
+			worker.pool = context->GetDevice().createCommandPool(poolInfo);
+			workers.push_back(std::move(worker));
 		}
 	}
 
-	void Frame::AddRenderTarget(RenderTarget* _renderTarget)
+	void Frame::ResetWorkerCommands()
 	{
-		renderTargets.push_back(_renderTarget);
+		for (auto& worker : workers)
+		{
+			if (worker.used == 0) continue;
+
+			context->GetDevice().resetCommandPool(worker.pool);
+			worker.used = 0;
+		}
+	}
+
+	vk::CommandBuffer Frame::AcquireSecondaryCommandBuffer(uint32_t _worker)
+	{
+		WorkerCommands& worker = workers.at(_worker);
+
+		if (worker.used == worker.secondaries.size())
+		{
+			vk::CommandBufferAllocateInfo allocInfo;
+			allocInfo.commandPool = worker.pool;
+			allocInfo.level = vk::CommandBufferLevel::eSecondary;
+			allocInfo.commandBufferCount = 1;
+
+			worker.secondaries.push_back(context->GetDevice().allocateCommandBuffers(allocInfo)[0]);
+		}
+
+		return worker.secondaries[worker.used++];
 	}
 }
\ No newline at end of file
@@ -9,13 +9,18 @@ namespace cp
 	class Frame
 	{
 	private:
-		std::vector<RenderTarget*> renderTargets;
+		// One per recording worker, a pool is only ever used by the job holding its index
+		struct WorkerCommands
+		{
+			vk::CommandPool pool;
+			std::vector<vk::CommandBuffer> secondaries;
+			uint32_t used = 0;
+		};
 
 		vk::CommandBuffer commandBuffer;
+		std::vector<WorkerCommands> workers;
 
-		vk::Semaphore imageAvailableSemaphore;
-		vk::Semaphore renderFinishedSemaphore;
-		vk::Fence inFlightFence;
+		vk::Semaphore imageAvailableSemaphore; // Unsignaled again once the pacer waited for the frame that last used this slot
 
 		cp::VulkanContext* context;
 
@@ -23,14 +28,12 @@ namespace cp
 		Frame(cp::VulkanContext*& _context);
 		~Frame();
 
-		void AddRenderTarget(RenderTarget* _renderTarget);
+		void ReserveWorkers(uint32_t _count); // On the render thread, before handing worker indices out
+		void ResetWorkerCommands(); // Once the pacer waited for this slot, recycles every secondary command buffer of the frame
+		vk::CommandBuffer AcquireSecondaryCommandBuffer(uint32_t _worker);
 
 		inline constexpr vk::Semaphore& GetImageAvailableSemaphore() { return imageAvailableSemaphore; }
-		inline constexpr vk::Semaphore& GetRenderFinishedSemaphore() { return renderFinishedSemaphore; }
-		inline constexpr vk::Fence& GetInFlightFence() { return inFlightFence; }
 		inline constexpr vk::CommandBuffer& GetCommandBuffer() { return commandBuffer; }
-		inline constexpr RenderTarget* GetRenderTarget(uint32_t _index) { return renderTargets[_index]; }
-		inline constexpr std::vector<RenderTarget*>& GetRenderTargets() { return renderTargets; }
-		inline constexpr RenderTarget* GetMainRenderTarget() { return renderTargets[0]; }
+		inline uint32_t GetWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
 	};
 }
\ No newline at end of file
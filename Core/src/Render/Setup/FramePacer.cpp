@@ -0,0 +1,233 @@
+#include "pch.hpp"
+#include "FramePacer.hpp"
+
+namespace cp
+{
+	namespace
+	{
+		constexpr uint64_t PRESENT_WAIT_TIMEOUT = 100'000'000; // ns, a present id can be skipped when the swapchain goes out of date
+
+		inline double MillisecondsSince(std::chrono::steady_clock::time_point _start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+		}
+	}
+
+	FramePacer::FramePacer(cp::VulkanContext* _context) : context(_context)
+	{
+		if (!context->SupportsTimelineSemaphore())
+		{
+			LOG_ERROR("Timeline semaphores are unsupported, frames cannot be paced");
+			throw std::runtime_error("Timeline semaphores are unsupported");
+		}
+
+		vk::SemaphoreTypeCreateInfo typeInfo(vk::SemaphoreType::eTimeline, 0);
+		vk::SemaphoreCreateInfo semaphoreInfo;
+		semaphoreInfo.pNext = &typeInfo;
+
+		timeline = context->GetDevice().createSemaphore(semaphoreInfo);
+
+		// GPU times come from two timestamps per slot, skipped on queues that can't write them
+		auto queueFamilies = context->GetPhysicalDevice().getQueueFamilyProperties();
+		uint32_t validBits = queueFamilies[context->GetQueueFamilyIndices().graphicsFamily.value()].timestampValidBits;
+
+		if (validBits > 0)
+		{
+			timestampPeriod = context->GetPhysicalDevice().getProperties().limits.timestampPeriod;
+			timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+			vk::QueryPoolCreateInfo queryPoolInfo({}, vk::QueryType::eTimestamp, MAX_FRAMES_IN_FLIGHT * 2);
+			timestamps = context->GetDevice().createQueryPool(queryPoolInfo);
+		}
+	}
+
+	FramePacer::~FramePacer()
+	{
+		context->GetDevice().waitIdle();
+
+		for (auto& semaphore : presentSemaphores)
+		{
+			context->GetDevice().destroySemaphore(semaphore);
+		}
+
+		if (timestamps) context->GetDevice().destroyQueryPool(timestamps);
+		context->GetDevice().destroySemaphore(timeline);
+	}
+
+	void FramePacer::CreatePresentSemaphores(uint32_t _imageCount)
+	{
+		for (auto& semaphore : presentSemaphores)
+		{
+			context->GetDevice().destroySemaphore(semaphore);
+		}
+
+		presentSemaphores.clear();
+
+		for (uint32_t i = 0; i < _imageCount; i++)
+		{
+			presentSemaphores.push_back(context->GetDevice().createSemaphore(vk::SemaphoreCreateInfo()));
+		}
+
+		swapchainFirstFrame = frameNumber + 1;
+	}
+
+	uint64_t FramePacer::BeginFrame(vk::SwapchainKHR _swapchain)
+	{
+		frameNumber++;
+
+		auto waitStart = std::chrono::steady_clock::now();
+		double presentWait = 0.0;
+
+		if (frameNumber > framesInFlight)
+		{
+			uint64_t target = frameNumber - framesInFlight;
+
+			if (mode == FramePacingMode::PresentWait && target >= swapchainFirstFrame && target <= lastPresented)
+			{
+				auto presentStart = std::chrono::steady_clock::now();
+
+				vk::Result result = context->WaitForPresent(_swapchain, target, PRESENT_WAIT_TIMEOUT);
+				if (result != vk::Result::eSuccess && result != vk::Result::eTimeout && result != vk::Result::eSuboptimalKHR && result != vk::Result::eErrorOutOfDateKHR)
+				{
+					LOG_WARNING(MF("Waiting for the present of frame ", target, " failed (", vk::to_string(result), ")"));
+				}
+
+				presentWait = MillisecondsSince(presentStart);
+			}
+
+			vk::SemaphoreWaitInfo waitInfo({}, 1, &timeline, &target);
+
+			if (context->GetDevice().waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max()) != vk::Result::eSuccess)
+			{
+				LOG_ERROR(MF("Failed to wait for frame ", target));
+				throw std::runtime_error("Failed to wait for the frame timeline");
+			}
+
+			ReadTimestamps(target); // Complete now, and its slot isn't reset before frameNumber + MAX_FRAMES_IN_FLIGHT - framesInFlight
+		}
+
+		metrics.cpuWaitMs = MillisecondsSince(waitStart);
+		metrics.presentWaitMs = presentWait;
+
+		return frameNumber;
+	}
+
+	void FramePacer::AbandonFrame(vk::Queue _queue)
+	{
+		// Queued behind every earlier submit, unlike a host signal which could overtake frames still running
+		uint64_t value = frameNumber;
+		vk::TimelineSemaphoreSubmitInfo timelineInfo(0, nullptr, 1, &value);
+
+		vk::SubmitInfo submitInfo;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &timeline;
+
+		if (_queue.submit(1, &submitInfo, nullptr) != vk::Result::eSuccess)
+		{
+			throw std::runtime_error("Failed to signal an abandoned frame");
+		}
+	}
+
+	void FramePacer::WriteBeginTimestamp(vk::CommandBuffer _commandBuffer)
+	{
+		if (!timestamps) return;
+
+		uint32_t slot = GetSlot();
+		slotFrames[slot] = frameNumber;
+
+		_commandBuffer.resetQueryPool(timestamps, slot * 2, 2);
+		_commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestamps, slot * 2);
+	}
+
+	void FramePacer::WriteEndTimestamp(vk::CommandBuffer _commandBuffer) const
+	{
+		if (!timestamps) return;
+
+		_commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestamps, GetSlot() * 2 + 1);
+	}
+
+	void FramePacer::ReadTimestamps(uint64_t _frame)
+	{
+		uint32_t slot = static_cast<uint32_t>(_frame % MAX_FRAMES_IN_FLIGHT);
+		if (!timestamps || slotFrames[slot] != _frame) return;
+
+		uint64_t ticks[2];
+		if (context->GetDevice().getQueryPoolResults(timestamps, slot * 2, 2, sizeof(ticks), ticks, sizeof(uint64_t), vk::QueryResultFlagBits::e64) != vk::Result::eSuccess) return;
+
+		uint64_t begin = ticks[0] & timestampMask;
+		uint64_t end = ticks[1] & timestampMask;
+		if (end < begin) return; // Wrapped around
+
+		metrics.gpuFrameMs = (end - begin) * timestampPeriod / 1e6;
+		metrics.gpuIdleMs = (lastGpuFrame + 1 == _frame && begin > lastGpuEnd) ? (begin - lastGpuEnd) * timestampPeriod / 1e6 : 0.0;
+		metrics.gpuFrame = _frame;
+
+		lastGpuEnd = end;
+		lastGpuFrame = _frame;
+	}
+
+	void FramePacer::Submit(vk::Queue _queue, vk::CommandBuffer _commandBuffer, vk::Semaphore _acquireSemaphore, uint32_t _imageIndex)
+	{
+		vk::Semaphore waitSemaphores[] = { _acquireSemaphore };
+		vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+		vk::Semaphore signalSemaphores[] = { timeline, presentSemaphores.at(_imageIndex) };
+		uint64_t signalValues[] = { frameNumber, 0 }; // Ignored for the binary present semaphore
+
+		vk::TimelineSemaphoreSubmitInfo timelineInfo(0, nullptr, 2, signalValues);
+
+		vk::SubmitInfo submitInfo;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = waitSemaphores;
+		submitInfo.pWaitDstStageMask = waitStages;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &_commandBuffer;
+		submitInfo.signalSemaphoreCount = 2;
+		submitInfo.pSignalSemaphores = signalSemaphores;
+
+		if (_queue.submit(1, &submitInfo, nullptr) != vk::Result::eSuccess)
+		{
+			throw std::runtime_error("Failed to submit command buffer");
+		}
+	}
+
+	vk::Result FramePacer::Present(vk::Queue _queue, vk::SwapchainKHR _swapchain, uint32_t _imageIndex)
+	{
+		vk::PresentInfoKHR presentInfo;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = &presentSemaphores.at(_imageIndex);
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = &_swapchain;
+		presentInfo.pImageIndices = &_imageIndex;
+
+		// Always tagged, so switching to PresentWait has ids to wait on right away
+		vk::PresentIdKHR presentId(1, &frameNumber);
+		if (context->SupportsPresentWait()) presentInfo.pNext = &presentId;
+
+		vk::Result result = _queue.presentKHR(presentInfo);
+		lastPresented = frameNumber;
+
+		return result;
+	}
+
+	void FramePacer::SetFramesInFlight(uint32_t _count)
+	{
+		uint32_t count = std::clamp<uint32_t>(_count, 1, MAX_FRAMES_IN_FLIGHT);
+		if (count != _count) LOG_WARNING(MF("Frames in flight clamped to ", count, ", requested ", _count));
+
+		framesInFlight = count;
+		LOG_TRACE(MF("Pacing with ", framesInFlight, " frames in flight"));
+	}
+
+	void FramePacer::SetMode(FramePacingMode _mode)
+	{
+		if (_mode == FramePacingMode::PresentWait && !context->SupportsPresentWait())
+		{
+			LOG_WARNING("Present wait unsupported, pacing on the GPU only");
+			_mode = FramePacingMode::Throughput;
+		}
+
+		mode = _mode;
+	}
+}
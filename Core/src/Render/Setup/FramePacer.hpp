@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../../pch.hpp"
+#include "../../Context/VulkanContext.hpp"
+
+namespace cp
+{
+	enum class FramePacingMode : uint8_t
+	{
+		Throughput, // Only bounded by the frames in flight, the CPU runs as far ahead of the GPU as they allow
+		PresentWait // Also waits until the display showed the frame framesInFlight presents ago, lowest latency under vsync
+	};
+
+	struct FramePacingMetrics
+	{
+		double cpuWaitMs = 0.0; // Render thread blocked before the frame could start, the GPU or display is the bottleneck when it grows
+		double presentWaitMs = 0.0; // Part of cpuWaitMs spent waiting on the display
+		double gpuFrameMs = 0.0; // First to last command of the frame
+		double gpuIdleMs = 0.0; // GPU starved between the previous frame and this one, the CPU is the bottleneck when it grows
+		uint64_t gpuFrame = 0; // Frame the GPU times belong to, they lag the CPU by the frames in flight, 0 without timestamp support
+	};
+
+	// Paces frames on a single timeline semaphore, the submit of frame N signals N
+	// Beginning frame N waits for N - framesInFlight, which also frees the frame slot N uses, so slots need no fence of their own
+	class FramePacer
+	{
+	public:
+		static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3; // Frame slots, the pipeline and bindless retire delays assume no more frames are in flight
+
+	private:
+		cp::VulkanContext* context;
+
+		vk::Semaphore timeline;
+		uint64_t frameNumber = 0; // Last frame begun, starting at 1 so the initial value 0 means nothing completed
+		uint32_t framesInFlight = 2;
+		FramePacingMode mode = FramePacingMode::Throughput;
+
+		std::vector<vk::Semaphore> presentSemaphores; // Per swapchain image, free again once the presentation engine hands that image back
+		uint64_t swapchainFirstFrame = 1; // Present ids below it went to a previous swapchain and are never waited on
+		uint64_t lastPresented = 0;
+
+		vk::QueryPool timestamps; // Begin and end per slot, null when the graphics queue can't write timestamps
+		double timestampPeriod = 0.0; // Nanoseconds per tick
+		uint64_t timestampMask = ~0ull;
+		std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> slotFrames{}; // Frame whose timestamps each slot holds
+		uint64_t lastGpuEnd = 0;
+		uint64_t lastGpuFrame = 0;
+
+		FramePacingMetrics metrics;
+
+		void ReadTimestamps(uint64_t _frame);
+
+	public:
+		NO_COPY(FramePacer)
+
+		FramePacer(cp::VulkanContext* _context);
+		~FramePacer();
+
+		void CreatePresentSemaphores(uint32_t _imageCount); // With every swapchain creation, the device must be idle
+
+		uint64_t BeginFrame(vk::SwapchainKHR _swapchain); // Blocks as the mode requires, returns the new frame number
+		void AbandonFrame(vk::Queue _queue); // Nothing will be submitted for the current frame, signals its value so later frames don't wait forever
+
+		void WriteBeginTimestamp(vk::CommandBuffer _commandBuffer); // First and last commands of the frame command buffer
+		void WriteEndTimestamp(vk::CommandBuffer _commandBuffer) const;
+
+		void Submit(vk::Queue _queue, vk::CommandBuffer _commandBuffer, vk::Semaphore _acquireSemaphore, uint32_t _imageIndex);
+		vk::Result Present(vk::Queue _queue, vk::SwapchainKHR _swapchain, uint32_t _imageIndex);
+
+		void SetFramesInFlight(uint32_t _count); // From the next BeginFrame, 1 for the lowest latency, more for throughput
+		void SetMode(FramePacingMode _mode); // PresentWait falls back to Throughput without VK_KHR_present_wait
+
+		inline uint32_t GetSlot() const { return static_cast<uint32_t>(frameNumber % MAX_FRAMES_IN_FLIGHT); }
+		inline uint64_t GetFrameNumber() const { return frameNumber; }
+		inline uint32_t GetFramesInFlight() const { return framesInFlight; }
+		inline FramePacingMode GetMode() const { return mode; }
+		inline const FramePacingMetrics& GetMetrics() const { return metrics; }
+	};
+}
@@ -45,6 +45,8 @@ namespace cp
 
 	void RenderTarget::Build(const uint32_t& _layerCount)
 	{
+		if (!renderPass) return;
+
 		std::vector<vk::ImageView> attachmentViews;
 
 		for (const auto& attachment : attachments)
@@ -63,9 +65,126 @@ namespace cp
 		framebuffer = context->GetDevice().createFramebuffer(framebufferInfo);
 	}
 
+	void RenderTarget::BeginRendering(vk::CommandBuffer _commandBuffer, const std::vector<vk::ClearValue>& _clearValues, vk::RenderingFlags _flags, uint32_t _layerCount)
+	{
+		std::vector<vk::RenderingAttachmentInfo> colorAttachments;
+		std::optional<vk::RenderingAttachmentInfo> depthAttachment;
+		std::optional<vk::RenderingAttachmentInfo> stencilAttachment;
+
+		std::vector<vk::ImageMemoryBarrier> barriers;
+		vk::PipelineStageFlags srcStages;
+		vk::PipelineStageFlags dstStages;
+
+		for (size_t i = 0; i < attachments.size(); i++)
+		{
+			const auto& attachment = attachments[i];
+			bool clear = i < _clearValues.size();
+			bool color = static_cast<bool>(attachment->GetAspect() & vk::ImageAspectFlagBits::eColor);
+			vk::ImageLayout attachmentLayout = color ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+			// A cleared attachment doesn't need its previous content, undefined lets the driver skip preserving it
+			vk::ImageMemoryBarrier barrier;
+			barrier.oldLayout = clear ? vk::ImageLayout::eUndefined : attachment->layout;
+			barrier.newLayout = attachmentLayout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = attachment->GetImage();
+			barrier.subresourceRange = vk::ImageSubresourceRange(attachment->GetAspect(), 0, 1, 0, _layerCount);
+
+			// Waits on the previous use of the attachment, as an attachment or sampled by a later pass
+			if (color)
+			{
+				barrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+				barrier.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | (clear ? vk::AccessFlags() : vk::AccessFlagBits::eColorAttachmentRead);
+				srcStages |= vk::PipelineStageFlagBits::eColorAttachmentOutput;
+				dstStages |= vk::PipelineStageFlagBits::eColorAttachmentOutput;
+			}
+			else
+			{
+				barrier.srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+				barrier.dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentRead;
+				srcStages |= vk::PipelineStageFlagBits::eLateFragmentTests;
+				dstStages |= vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+			}
+			if (attachment->IsSampled()) srcStages |= vk::PipelineStageFlagBits::eFragmentShader;
+
+			barriers.push_back(barrier);
+			attachment->layout = attachmentLayout;
+
+			vk::RenderingAttachmentInfo info;
+			info.imageView = attachment->GetImageView();
+			info.imageLayout = attachmentLayout;
+			info.loadOp = clear ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eLoad;
+			info.storeOp = color || attachment->IsSampled() ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+			if (clear) info.clearValue = _clearValues[i];
+
+			if (color) colorAttachments.push_back(info);
+			if (attachment->GetAspect() & vk::ImageAspectFlagBits::eDepth) depthAttachment = info;
+			if (attachment->GetAspect() & vk::ImageAspectFlagBits::eStencil) stencilAttachment = info;
+		}
+
+		vk::RenderingInfo renderingInfo;
+		renderingInfo.flags = _flags;
+		renderingInfo.renderArea = vk::Rect2D({ 0, 0 }, extent);
+		renderingInfo.layerCount = _layerCount;
+		renderingInfo.setColorAttachments(colorAttachments);
+		renderingInfo.pDepthAttachment = depthAttachment ? &*depthAttachment : nullptr;
+		renderingInfo.pStencilAttachment = stencilAttachment ? &*stencilAttachment : nullptr;
+
+		if (!barriers.empty()) _commandBuffer.pipelineBarrier(srcStages, dstStages, {}, nullptr, nullptr, barriers);
+
+		context->BeginRendering(_commandBuffer, renderingInfo);
+	}
+
+	void RenderTarget::EndRendering(vk::CommandBuffer _commandBuffer, uint32_t _layerCount)
+	{
+		context->EndRendering(_commandBuffer);
+
+		std::vector<vk::ImageMemoryBarrier> barriers;
+		vk::PipelineStageFlags srcStages;
+		vk::PipelineStageFlags dstStages;
+
+		for (const auto& attachment : attachments)
+		{
+			bool color = static_cast<bool>(attachment->GetAspect() & vk::ImageAspectFlagBits::eColor);
+
+			vk::ImageMemoryBarrier barrier;
+			barrier.oldLayout = attachment->layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = attachment->GetImage();
+			barrier.subresourceRange = vk::ImageSubresourceRange(attachment->GetAspect(), 0, 1, 0, _layerCount);
+			barrier.srcAccessMask = color ? vk::AccessFlagBits::eColorAttachmentWrite : vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+			vk::PipelineStageFlags srcStage = color ? vk::PipelineStageFlagBits::eColorAttachmentOutput : vk::PipelineStageFlagBits::eLateFragmentTests;
+
+			if (attachment->isSwapchain)
+			{
+				// The present semaphore orders the presentation engine, no destination access needed
+				barrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+				dstStages |= vk::PipelineStageFlagBits::eBottomOfPipe;
+			}
+			else if (attachment->IsSampled())
+			{
+				barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+				barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+				dstStages |= vk::PipelineStageFlagBits::eFragmentShader;
+			}
+			else
+			{
+				continue; // Stays in its attachment layout for the next BeginRendering
+			}
+
+			srcStages |= srcStage;
+			barriers.push_back(barrier);
+			attachment->layout = barrier.newLayout;
+		}
+
+		if (!barriers.empty()) _commandBuffer.pipelineBarrier(srcStages, dstStages, {}, nullptr, nullptr, barriers);
+	}
+
 	void RenderTarget::Cleanup()
 	{
-		context->GetDevice().destroyFramebuffer(framebuffer);
+		if (framebuffer) context->GetDevice().destroyFramebuffer(framebuffer);
 	}
 
 	RenderTargetAttachment::RenderTargetAttachment(cp::VulkanContext* _context, const vk::Extent2D& _extent, const vk::Format& _format, const vk::ImageUsageFlags _usage, const vk::ImageAspectFlags& _aspectFlags, const bool& _shouldCreateSampler, const uint32_t& _layerCount)
@@ -90,11 +209,13 @@ namespace cp
 		device.destroyImageView(imageView);
 		if(!isSwapchain) device.destroyImage(image);
 		device.freeMemory(imageMemory);
-		if (sampler != VK_NULL_HANDLE) device.destroySampler(sampler);
 	}
 
 	void RenderTargetAttachment::Build(cp::VulkanContext*& _context, const vk::Extent2D& _extent, const vk::Format& _format, const vk::ImageUsageFlags _usage, const vk::ImageAspectFlags& _aspectFlags, const bool& _shouldCreateSampler, const uint32_t& _layerCount)
 	{
+		format = _format;
+		aspect = _aspectFlags;
+
 		vk::ImageCreateInfo imageInfo;
 		imageInfo.imageType = vk::ImageType::e2D;
 		imageInfo.extent = vk::Extent3D(_extent.width, _extent.height, 1);
@@ -133,25 +254,15 @@ namespace cp
 
 		if (_shouldCreateSampler)
 		{
-			vk::SamplerCreateInfo samplerInfo;
-			samplerInfo.magFilter = vk::Filter::eLinear;
-			samplerInfo.minFilter = vk::Filter::eLinear;
-			samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
-			samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
-			samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
-			samplerInfo.compareEnable = VK_TRUE;
-			samplerInfo.compareOp = vk::CompareOp::eLessOrEqual;
-			samplerInfo.borderColor = vk::BorderColor::eFloatOpaqueWhite;
-			samplerInfo.unnormalizedCoordinates = VK_FALSE;
-			samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
-
-			sampler = _context->GetDevice().createSampler(samplerInfo);
+			sampler = _context->GetSamplerCache()->GetOrCreateSampler(cp::SamplerDescription::DepthCompare());
 		}
 	}
 	
 	void RenderTargetAttachment::Build(cp::VulkanContext*& _context, const vk::Image& _image, const vk::Format& _format, const vk::ImageAspectFlags& _aspectFlags, const bool& _shouldCreateSampler, const uint32_t& _layerCount)
 	{
 		image = _image;
+		format = _format;
+		aspect = _aspectFlags;
 
 		vk::ImageViewCreateInfo viewInfo;
 		viewInfo.image = image;
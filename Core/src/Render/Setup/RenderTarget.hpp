@@ -13,7 +13,10 @@ namespace cp
 		vk::Image image;
 		vk::ImageView imageView;
 		vk::DeviceMemory imageMemory;
-		vk::Sampler sampler = VK_NULL_HANDLE;
+		vk::Sampler sampler = VK_NULL_HANDLE; // Shared, owned by the context SamplerCache
+		vk::Format format = vk::Format::eUndefined;
+		vk::ImageAspectFlags aspect;
+		vk::ImageLayout layout = vk::ImageLayout::eUndefined; // Left by the last recorded RenderTarget::EndRendering, recording order is assumed to be submission order
 
 		cp::VulkanContext* context;
 
@@ -32,6 +35,12 @@ namespace cp
 		inline constexpr const vk::ImageView& GetImageView() const { return imageView; }
 		inline constexpr const vk::DeviceMemory& GetImageMemory() const { return imageMemory; }
 		inline constexpr const vk::Sampler& GetSampler() const { return sampler; }
+		inline constexpr vk::Format GetFormat() const { return format; }
+		inline constexpr vk::ImageAspectFlags GetAspect() const { return aspect; }
+		inline constexpr vk::ImageLayout GetLayout() const { return layout; }
+		inline constexpr bool IsSampled() const { return static_cast<bool>(sampler); }
+
+		friend class RenderTarget;
 	};
 
 	class RenderTarget
@@ -54,7 +63,13 @@ namespace cp
 		void AddAttachment(const vk::Image& _image, const vk::Format& _format, const vk::ImageUsageFlags _usage, const vk::ImageAspectFlags& _aspectFlags);
 		void AddAttachment(std::shared_ptr<RenderTargetAttachment>& _attachment);
 
-		void Build(const uint32_t& _layerCount = 1);
+		void Build(const uint32_t& _layerCount = 1); // No framebuffer without a render pass, dynamic rendering binds the views at record time
+
+		// Dynamic rendering counterpart of beginRenderPass, transitions every attachment to its attachment optimal layout first
+		// _clearValues follow the attachment order, attachments past its end are loaded instead of cleared, cleared ones discard their previous content
+		// Color and sampled attachments are stored, depth only attachments are never read after the pass and aren't
+		void BeginRendering(vk::CommandBuffer _commandBuffer, const std::vector<vk::ClearValue>& _clearValues, vk::RenderingFlags _flags = {}, uint32_t _layerCount = 1);
+		void EndRendering(vk::CommandBuffer _commandBuffer, uint32_t _layerCount = 1); // Swapchain images go to PresentSrcKHR, sampled attachments to ShaderReadOnlyOptimal
 
 		void Cleanup();
 
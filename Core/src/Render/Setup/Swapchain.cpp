@@ -46,26 +46,33 @@ void cp::Swapchain::CreateData()
 	swapchain = context->GetDevice().createSwapchainKHR(createInfo);
 
 	frames.clear();
+	renderTargets.clear();
+
+	// Slots are cycled by frame number, images in whatever order the presentation engine hands them out
+	for (uint32 i = 0; i < cp::FramePacer::MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		frames.push_back(new Frame(context));
+	}
 
 	std::vector<vk::Image> images = context->GetDevice().getSwapchainImagesKHR(swapchain);
-	frames.reserve(images.size());
+	renderTargets.reserve(images.size());
 
 	auto depthRTA = std::make_shared<RenderTargetAttachment>(context, extent, 
 			Helper::Format::FindDepthFormat(context->GetPhysicalDevice()), vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::ImageAspectFlagBits::eDepth);
 
 	for (auto image : images)
 	{
-		Frame* frame = new Frame(context);
 		RenderTarget* rt = new RenderTarget(*context, extent, mainRenderPass);
-		frame->AddRenderTarget(rt);
 		auto colorRTA = std::make_shared<RenderTargetAttachment>(context, image, surfaceFormat.format, vk::ImageAspectFlagBits::eColor);
 		colorRTA->isSwapchain = true;
 		rt->AddAttachment(depthRTA);
 		rt->AddAttachment(colorRTA);
 		rt->Build();
-		
-		frames.push_back(frame);
+
+		renderTargets.push_back(rt);
 	}
+
+	pacer->CreatePresentSemaphores(static_cast<uint32>(images.size()));
 }
 
 void cp::Swapchain::QuerySupport()
@@ -122,6 +129,7 @@ cp::Swapchain::Swapchain(cp::VulkanContext* _context, vk::SurfaceKHR& _surface,
 {
 	context = _context;
 	platform = _platform;
+	pacer = std::make_unique<cp::FramePacer>(context);
 	Setup();
 }
 
@@ -147,8 +155,8 @@ void cp::Swapchain::Create(vk::RenderPass _mainRenderPass)
 {
 	if(!mainRenderPass) mainRenderPass = _mainRenderPass;
 	CreateData();
-	maxFramesInFlight = static_cast<uint32>(frames.size());
-	currentFrame = 0;
+	currentFrame = pacer->GetSlot();
+	currentImage = 0;
 }
 
 void cp::Swapchain::Recreate()
@@ -182,8 +190,16 @@ void cp::Swapchain::Cleanup()
 {
 	context->GetDevice().destroySwapchainKHR(swapchain);
 
+	for (auto renderTarget : renderTargets)
+	{
+		delete renderTarget;
+	}
+
 	for (auto frame : frames)
 	{
 		delete frame;
 	}
+
+	renderTargets.clear();
+	frames.clear();
 }
@@ -2,10 +2,12 @@
 
 #include "../../pch.hpp"
 #include "../../Context/VulkanContext.hpp"
+#include "FramePacer.hpp"
 
 namespace cp
 {
 	class Frame;
+	class RenderTarget;
 
 	class Swapchain
 	{
@@ -23,11 +25,14 @@ namespace cp
 		vk::PresentModeKHR presentMode;
 		vk::Extent2D extent;
 
-		std::vector<Frame*> frames;
+		std::vector<Frame*> frames; // Frame slots, as many as the pacer can have in flight
+		std::vector<RenderTarget*> renderTargets; // Per swapchain image
 		vk::RenderPass mainRenderPass;
 
-		uint32 currentFrame;
-		uint32 maxFramesInFlight;
+		std::unique_ptr<cp::FramePacer> pacer;
+
+		uint32 currentFrame = 0;
+		uint32 currentImage = 0; // Acquired for the current frame, unrelated to the frame slot
 
 		void CreateData();
 
@@ -55,13 +60,18 @@ namespace cp
 		inline constexpr std::vector<Frame*>& GetFrames() { return frames; }
 		inline constexpr Frame* GetCurrentFrame() { return frames[currentFrame]; }
 		inline constexpr uint32 GetCurrentFrameIndex() { return currentFrame; }
-		inline constexpr uint32 GetMaxFramesInFlight() { return maxFramesInFlight; }
+		inline uint32 GetMaxFramesInFlight() const { return pacer->GetFramesInFlight(); }
 		inline constexpr uint32 GetFrameCount() { return static_cast<uint32>(frames.size()); }
+		inline constexpr RenderTarget* GetRenderTarget(uint32 _imageIndex) { return renderTargets[_imageIndex]; }
+		inline constexpr RenderTarget* GetCurrentRenderTarget() { return renderTargets[currentImage]; }
+		inline constexpr uint32 GetCurrentImageIndex() { return currentImage; }
+		inline cp::FramePacer* GetFramePacer() const { return pacer.get(); }
 		inline constexpr vk::SurfaceCapabilitiesKHR& GetSurfaceCapabilities() { return surfaceCapabilities; }
 		inline constexpr std::vector<vk::SurfaceFormatKHR>& GetSurfaceFormats() { return surfaceFormats; }
 		inline constexpr std::vector<vk::PresentModeKHR>& GetPresentModes() { return presentModes; }
 		inline constexpr vk::RenderPass& GetMainRenderPass() { return mainRenderPass; }
 
 		inline constexpr void SetCurrentFrame(uint32 _currentFrame) { currentFrame = _currentFrame; }
+		inline constexpr void SetCurrentImage(uint32 _currentImage) { currentImage = _currentImage; }
 	};
 }
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "pch.hpp"
+#include "CookedAsset.hpp"
+
+bool cp::CookedAsset::IsUpToDate(const std::string& _sourcePath, const std::string& _cookedPath, uint32_t _magic, uint32_t _version)
+{
+	std::error_code error;
+
+	if (!std::filesystem::exists(_cookedPath, error))
+	{
+		return false;
+	}
+
+	auto sourceTime = std::filesystem::last_write_time(_sourcePath, error);
+	bool sourceMissing = static_cast<bool>(error); // Source is gone, the cooked file is all we have
+
+	if (!sourceMissing)
+	{
+		auto cookedTime = std::filesystem::last_write_time(_cookedPath, error);
+		if (error || cookedTime < sourceTime) return false;
+	}
+
+	// A file from an older cooker is re-cooked instead of failing to open
+	Preamble preamble{};
+	std::ifstream file(_cookedPath, std::ios::binary);
+	if (!file.read(reinterpret_cast<char*>(&preamble), sizeof(preamble))) return sourceMissing;
+
+	return preamble.magic == _magic && (preamble.version == _version || sourceMissing);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../pch.hpp"
+
+namespace cp
+{
+	// Rules shared by every cooked asset format (.cpmesh, .cptex)
+	namespace CookedAsset
+	{
+		// Every cooked header starts with these two fields
+		struct Preamble
+		{
+			uint32_t magic;
+			uint32_t version;
+		};
+
+		bool IsUpToDate(const std::string& _sourcePath, const std::string& _cookedPath, uint32_t _magic, uint32_t _version); // True when the cooked file exists, is at least as recent as its source and was written by this version of its cooker
+	}
+}
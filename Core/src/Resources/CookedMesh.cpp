@@ -0,0 +1,161 @@
+#include "pch.hpp"
+#include "CookedMesh.hpp"
+
+static_assert(std::is_trivially_copyable_v<cp::CookedMesh::Header>, "Cooked mesh header must be trivially copyable");
+static_assert(std::is_trivially_copyable_v<cp::Submesh>, "Submesh must be trivially copyable to be stored in a cooked mesh");
+static_assert(std::is_trivially_copyable_v<cp::MeshLOD>, "MeshLOD must be trivially copyable to be stored in a cooked mesh");
+static_assert(offsetof(cp::CookedMesh::Header, version) == offsetof(cp::CookedAsset::Preamble, version), "Cooked mesh header must start with the cooked asset preamble");
+
+namespace
+{
+	uint64_t AlignUp(uint64_t _value, uint64_t _alignment)
+	{
+		return (_value + _alignment - 1) & ~(_alignment - 1);
+	}
+}
+
+std::string cp::CookedMesh::GetCookedPath(const std::string& _sourcePath)
+{
+	return _sourcePath + EXTENSION;
+}
+
+bool cp::CookedMesh::IsUpToDate(const std::string& _sourcePath, const std::string& _cookedPath)
+{
+	return CookedAsset::IsUpToDate(_sourcePath, _cookedPath, MAGIC, VERSION);
+}
+
+bool cp::CookedMesh::Write(const std::string& _cookedPath, VertexFormat _vertexFormat, uint32_t _vertexCount, const void* _vertexData, uint32_t _indexSize, uint32_t _indexCount, const void* _indexData, const std::vector<Submesh>& _submeshes, const std::vector<MeshLOD>& _lods, const std::vector<std::string>& _materialSlots, const MeshBounds& _bounds)
+{
+	Header header{};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.vertexStride = GetVertexStride(_vertexFormat);
+	header.vertexFormat = static_cast<uint32_t>(_vertexFormat);
+	header.indexSize = _indexSize;
+	header.vertexCount = _vertexCount;
+	header.indexCount = _indexCount;
+	header.submeshCount = static_cast<uint32_t>(_submeshes.size());
+	header.materialSlotCount = static_cast<uint32_t>(_materialSlots.size());
+	header.lodCount = static_cast<uint32_t>(_lods.size());
+	header.bounds = _bounds;
+
+	header.submeshOffset = AlignUp(sizeof(Header), ALIGNMENT);
+	header.lodOffset = AlignUp(header.submeshOffset + sizeof(Submesh) * _submeshes.size(), ALIGNMENT);
+	header.vertexOffset = AlignUp(header.lodOffset + sizeof(MeshLOD) * _lods.size(), ALIGNMENT);
+	header.indexOffset = AlignUp(header.vertexOffset + static_cast<uint64_t>(header.vertexStride) * _vertexCount, ALIGNMENT);
+	header.materialSlotOffset = AlignUp(header.indexOffset + static_cast<uint64_t>(_indexSize) * _indexCount, ALIGNMENT);
+
+	std::string slotTable;
+	for (const std::string& slot : _materialSlots)
+	{
+		uint32_t length = static_cast<uint32_t>(slot.size());
+		slotTable.append(reinterpret_cast<const char*>(&length), sizeof(uint32_t));
+		slotTable.append(slot);
+	}
+
+	header.fileSize = header.materialSlotOffset + slotTable.size();
+
+	// Write to a temporary file first so a crash mid-write never leaves a truncated cooked mesh behind
+	std::string tempPath = _cookedPath + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		LOG_WARNING(MF("Failed to open cooked mesh for writing: ", _cookedPath));
+		return false;
+	}
+
+	auto writePadded = [&file](const void* _data, uint64_t _size, uint64_t _targetOffset)
+	{
+		uint64_t current = static_cast<uint64_t>(file.tellp());
+		static constexpr char zeros[ALIGNMENT] = {};
+		file.write(zeros, static_cast<std::streamsize>(_targetOffset - current));
+		file.write(static_cast<const char*>(_data), static_cast<std::streamsize>(_size));
+	};
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	writePadded(_submeshes.data(), sizeof(Submesh) * _submeshes.size(), header.submeshOffset);
+	writePadded(_lods.data(), sizeof(MeshLOD) * _lods.size(), header.lodOffset);
+	writePadded(_vertexData, static_cast<uint64_t>(header.vertexStride) * _vertexCount, header.vertexOffset);
+	writePadded(_indexData, static_cast<uint64_t>(_indexSize) * _indexCount, header.indexOffset);
+	writePadded(slotTable.data(), slotTable.size(), header.materialSlotOffset);
+
+	bool success = file.good();
+	file.close();
+
+	std::error_code error;
+	if (success)
+	{
+		std::filesystem::rename(tempPath, _cookedPath, error);
+		success = !error;
+	}
+
+	if (!success)
+	{
+		std::filesystem::remove(tempPath, error);
+		LOG_WARNING(MF("Failed to write cooked mesh: ", _cookedPath));
+	}
+
+	return success;
+}
+
+bool cp::CookedMesh::Open(const std::string& _cookedPath, View& _view)
+{
+	if (!_view.file.Open(_cookedPath))
+	{
+		return false;
+	}
+
+	const size_t size = _view.file.GetSize();
+	const Header* header = _view.file.As<Header>();
+
+	bool valid = size >= sizeof(Header)
+		&& header->magic == MAGIC
+		&& header->version == VERSION
+		&& header->fileSize == size
+		&& header->vertexStride == GetVertexStride(static_cast<VertexFormat>(header->vertexFormat))
+		&& header->submeshOffset + sizeof(Submesh) * header->submeshCount <= header->lodOffset
+		&& header->lodOffset + sizeof(MeshLOD) * header->lodCount <= header->vertexOffset
+		&& header->vertexOffset + static_cast<uint64_t>(header->vertexStride) * header->vertexCount <= header->indexOffset
+		&& header->indexOffset + static_cast<uint64_t>(header->indexSize) * header->indexCount <= header->materialSlotOffset
+		&& header->materialSlotOffset <= size;
+
+	// Slot names are the only variable-sized block, they are read eagerly so the rest of the engine never touches the mapping
+	_view.materialSlots.clear();
+	uint64_t cursor = valid ? header->materialSlotOffset : 0;
+	for (uint32_t i = 0; valid && i < header->materialSlotCount; i++)
+	{
+		if (cursor + sizeof(uint32_t) > size)
+		{
+			valid = false;
+			break;
+		}
+
+		uint32_t length = *_view.file.As<uint32_t>(cursor);
+		cursor += sizeof(uint32_t);
+
+		if (cursor + length > size)
+		{
+			valid = false;
+			break;
+		}
+
+		_view.materialSlots.emplace_back(_view.file.As<char>(cursor), length);
+		cursor += length;
+	}
+
+	if (!valid)
+	{
+		LOG_WARNING(MF("Cooked mesh is invalid or outdated, it will be recooked: ", _cookedPath));
+		_view.file.Close();
+		return false;
+	}
+
+	_view.header = header;
+	_view.submeshes = _view.file.As<Submesh>(header->submeshOffset);
+	_view.lods = _view.file.As<MeshLOD>(header->lodOffset);
+	_view.vertexData = _view.file.As<void>(header->vertexOffset);
+	_view.indexData = _view.file.As<void>(header->indexOffset);
+
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../pch.hpp"
+#include "../Util/MappedFile.hpp"
+#include "CookedAsset.hpp"
+#include "Mesh.hpp"
+
+namespace cp
+{
+	// Binary layout of a cooked mesh (.cpmesh) :
+	// [Header][Submesh * submeshCount][MeshLOD * lodCount][vertex blob][index blob][material slot names]
+	// Every block starts on an ALIGNMENT boundary so the blobs can be copied straight from the mapped file
+	namespace CookedMesh
+	{
+		inline constexpr uint32_t MAGIC = 0x48534D43; // "CMSH"
+		inline constexpr uint32_t VERSION = 5;
+		inline constexpr uint64_t ALIGNMENT = 16;
+		inline constexpr const char* EXTENSION = ".cpmesh";
+
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+
+			uint32_t vertexStride;
+			uint32_t indexSize;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint32_t submeshCount;
+			uint32_t materialSlotCount;
+			uint32_t vertexFormat; // cp::VertexFormat the vertex blob is encoded with
+			uint32_t lodCount;
+
+			uint64_t submeshOffset;
+			uint64_t lodOffset;
+			uint64_t vertexOffset;
+			uint64_t indexOffset;
+			uint64_t materialSlotOffset; // Each slot name is stored as a uint32_t length followed by its characters
+			uint64_t fileSize;
+
+			MeshBounds bounds;
+		};
+
+		struct View
+		{
+			MappedFile file;
+
+			const Header* header = nullptr;
+			const Submesh* submeshes = nullptr;
+			const MeshLOD* lods = nullptr;
+			const void* vertexData = nullptr;
+			const void* indexData = nullptr;
+			std::vector<std::string> materialSlots;
+		};
+
+		std::string GetCookedPath(const std::string& _sourcePath);
+		bool IsUpToDate(const std::string& _sourcePath, const std::string& _cookedPath); // See CookedAsset::IsUpToDate
+
+		bool Write(const std::string& _cookedPath, VertexFormat _vertexFormat, uint32_t _vertexCount, const void* _vertexData, uint32_t _indexSize, uint32_t _indexCount, const void* _indexData, const std::vector<Submesh>& _submeshes, const std::vector<MeshLOD>& _lods, const std::vector<std::string>& _materialSlots, const MeshBounds& _bounds);
+		bool Open(const std::string& _cookedPath, View& _view); // Maps the file and validates the header, only the material slot names are copied out of the mapping
+	}
+}
@@ -0,0 +1,138 @@
+#include "pch.hpp"
+#include "CookedTexture.hpp"
+
+static_assert(std::is_trivially_copyable_v<cp::CookedTexture::Header>, "Cooked texture header must be trivially copyable");
+static_assert(std::is_trivially_copyable_v<cp::CookedTexture::Level>, "Cooked texture level must be trivially copyable");
+static_assert(offsetof(cp::CookedTexture::Header, version) == offsetof(cp::CookedAsset::Preamble, version), "Cooked texture header must start with the cooked asset preamble");
+
+namespace
+{
+	uint64_t AlignUp(uint64_t _value, uint64_t _alignment)
+	{
+		return (_value + _alignment - 1) & ~(_alignment - 1);
+	}
+}
+
+std::string cp::CookedTexture::GetCookedPath(const std::string& _sourcePath)
+{
+	return _sourcePath + EXTENSION;
+}
+
+bool cp::CookedTexture::IsUpToDate(const std::string& _sourcePath, const std::string& _cookedPath)
+{
+	return CookedAsset::IsUpToDate(_sourcePath, _cookedPath, MAGIC, VERSION);
+}
+
+bool cp::CookedTexture::Write(const std::string& _cookedPath, TextureCompression _compression, bool _srgb, const std::vector<TextureLevel>& _levels)
+{
+	if (_levels.empty())
+	{
+		return false;
+	}
+
+	Header header{};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.format = static_cast<uint32_t>(TextureEncoder::GetFormat(_compression, _srgb));
+	header.compression = static_cast<uint32_t>(_compression);
+	header.srgb = _srgb ? 1 : 0;
+	header.width = _levels[0].width;
+	header.height = _levels[0].height;
+	header.mipCount = static_cast<uint32_t>(_levels.size());
+	header.levelOffset = AlignUp(sizeof(Header), ALIGNMENT);
+	header.dataOffset = AlignUp(header.levelOffset + sizeof(Level) * _levels.size(), ALIGNMENT);
+
+	std::vector<Level> levels(_levels.size());
+	uint64_t offset = header.dataOffset;
+	for (size_t i = 0; i < _levels.size(); i++)
+	{
+		offset = AlignUp(offset, ALIGNMENT);
+		levels[i] = { offset, _levels[i].data.size(), _levels[i].width, _levels[i].height };
+		offset += _levels[i].data.size();
+	}
+	header.fileSize = offset;
+
+	std::string tempPath = _cookedPath + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		LOG_WARNING(MF("Failed to open cooked texture for writing: ", _cookedPath));
+		return false;
+	}
+
+	auto writePadded = [&file](const void* _data, uint64_t _size, uint64_t _targetOffset)
+	{
+		uint64_t current = static_cast<uint64_t>(file.tellp());
+		static constexpr char zeros[ALIGNMENT] = {};
+		file.write(zeros, static_cast<std::streamsize>(_targetOffset - current));
+		file.write(static_cast<const char*>(_data), static_cast<std::streamsize>(_size));
+	};
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	writePadded(levels.data(), sizeof(Level) * levels.size(), header.levelOffset);
+	for (size_t i = 0; i < _levels.size(); i++)
+	{
+		writePadded(_levels[i].data.data(), levels[i].size, levels[i].offset);
+	}
+
+	bool success = file.good();
+	file.close();
+
+	std::error_code error;
+	if (success)
+	{
+		std::filesystem::rename(tempPath, _cookedPath, error);
+		success = !error;
+	}
+
+	if (!success)
+	{
+		std::filesystem::remove(tempPath, error);
+		LOG_WARNING(MF("Failed to write cooked texture: ", _cookedPath));
+	}
+
+	return success;
+}
+
+bool cp::CookedTexture::Open(const std::string& _cookedPath, View& _view)
+{
+	if (!_view.file.Open(_cookedPath))
+	{
+		return false;
+	}
+
+	const size_t size = _view.file.GetSize();
+	const Header* header = _view.file.As<Header>();
+
+	bool valid = size >= sizeof(Header)
+		&& header->magic == MAGIC
+		&& header->version == VERSION
+		&& header->fileSize == size
+		&& header->mipCount > 0
+		&& header->levelOffset + sizeof(Level) * header->mipCount <= header->dataOffset
+		&& header->dataOffset <= size;
+
+	const Level* levels = valid ? _view.file.As<Level>(header->levelOffset) : nullptr;
+	for (uint32_t i = 0; valid && i < header->mipCount; i++)
+	{
+		const TextureCompression compression = static_cast<TextureCompression>(header->compression);
+		valid = levels[i].offset >= header->dataOffset
+			&& levels[i].offset + levels[i].size <= size
+			&& levels[i].size == TextureEncoder::GetLevelSize(compression, levels[i].width, levels[i].height);
+	}
+
+	if (!valid)
+	{
+		LOG_WARNING(MF("Cooked texture is invalid or outdated, it will be recooked: ", _cookedPath));
+		_view.file.Close();
+		return false;
+	}
+
+	_view.header = header;
+	_view.levels = levels;
+	_view.data = _view.file.As<uint8_t>(levels[0].offset);
+	_view.dataSize = header->fileSize - levels[0].offset;
+
+	return true;
+}
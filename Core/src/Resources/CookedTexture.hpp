@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../pch.hpp"
+#include "../Util/MappedFile.hpp"
+#include "CookedAsset.hpp"
+#include "TextureEncoder.hpp"
+
+namespace cp
+{
+	// Binary layout of a cooked texture (.cptex) :
+	// [Header][Level * mipCount][level 0 data][level 1 data]...
+	// Levels are stored largest first and contiguously, so the whole chain is uploaded with a single staging copy
+	namespace CookedTexture
+	{
+		inline constexpr uint32_t MAGIC = 0x58455443; // "CTEX"
+		inline constexpr uint32_t VERSION = 1;
+		inline constexpr uint64_t ALIGNMENT = 16;
+		inline constexpr const char* EXTENSION = ".cptex";
+
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+
+			uint32_t format; // vk::Format of the levels
+			uint32_t compression; // cp::TextureCompression the levels are encoded with
+			uint32_t srgb;
+			uint32_t width;
+			uint32_t height;
+			uint32_t mipCount;
+
+			uint64_t levelOffset;
+			uint64_t dataOffset;
+			uint64_t fileSize;
+		};
+
+		struct Level
+		{
+			uint64_t offset; // From the start of the file
+			uint64_t size;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		struct View
+		{
+			MappedFile file;
+
+			const Header* header = nullptr;
+			const Level* levels = nullptr;
+			const uint8_t* data = nullptr; // Start of level 0, every level lives in [data, data + dataSize)
+			uint64_t dataSize = 0;
+		};
+
+		std::string GetCookedPath(const std::string& _sourcePath);
+		bool IsUpToDate(const std::string& _sourcePath, const std::string& _cookedPath); // See CookedAsset::IsUpToDate
+
+		bool Write(const std::string& _cookedPath, TextureCompression _compression, bool _srgb, const std::vector<TextureLevel>& _levels); // _levels must already be encoded with _compression
+		bool Open(const std::string& _cookedPath, View& _view);
+	}
+}
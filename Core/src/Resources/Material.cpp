@@ -5,6 +5,8 @@
 #include "MaterialInstance.hpp"
 
 #include "Util/Serializers/ISerializer.hpp"
+#include "Util/ShaderCompiler/ShaderCompilerService.hpp"
+#include "Util/ShaderCompiler/ShaderHotReloader.hpp"
 
 std::unordered_map<cp::MaterialFieldType, size_t> cp::Material::MaterialFieldSizeMap = {
 	{ cp::MaterialFieldType::Bool, sizeof(bool) },
@@ -25,12 +27,21 @@ cp::Material::Material(const cp::VulkanContext* _context) :
 
 cp::Material::~Material()
 {
+	if (cp::ShaderHotReloader* reloader = cp::ShaderHotReloader::Get()) reloader->Untrack(this);
+
+	ReleaseVariants(); // Before the layouts they share with the base pipelines
+	ReleasePreviousPipelines(true);
+
+	bool pending = false;
+	for (const auto& [name, pipelineData] : pipelineDatas) pending |= !rpRequirements.at(name).useDefaultShader && pipelineData->pending;
+	if (pending) context->GetPipelinesManager()->WaitIdle(); // The workers still read the layouts we are about to unload
+
 	for (auto& [name, pipelineData] : pipelineDatas)
 	{
 		if (rpRequirements.at(name).useDefaultShader) continue; // Skip if the material is using the default shader
 
 		if (pipelineData->pipelineLayout) context->GetLayoutsManager()->UnloadLayout(pipelineData->pipelineLayout); // Unload the previous layout if it exists
-		if (pipelineData->pipeline) context->GetPipelinesManager()->DestroyPipeline({ this->moduleName + "_" + name }); // Unload the previous pipeline if it exists
+		if (pipelineConfigs.count(name)) context->GetPipelinesManager()->DestroyPipeline(pipelineConfigs.at(name)); // Release the material reference on the pipeline, compiled or not
 	}
 
 	//for (auto& [name, desc] : descriptors)
@@ -39,6 +50,175 @@ cp::Material::~Material()
 	//}
 }
 
+const cp::PipelineData* cp::Material::GetPipelineData(const std::string& _rpName) const
+{
+	auto it = pipelineDatas.find(_rpName);
+	if (it == pipelineDatas.end()) return nullptr;
+
+	if (it->second->IsReady()) return it->second;
+
+	auto previous = previousPipelines.find(_rpName);
+	if (previous != previousPipelines.end()) return previous->second.pipelineData; // Hot reload, the replaced pipeline draws until its successor is ready
+
+	auto fallback = fallbackPipelines.find(_rpName);
+	return fallback != fallbackPipelines.end() ? fallback->second : nullptr; // nullptr : skip the draw until the pipeline is ready
+}
+
+const cp::PipelineData* cp::Material::GetVariantPipelineData(const std::string& _rpName, uint32_t _keywordMask)
+{
+	uint32_t keywordsMask = keywords.size() >= MAX_KEYWORDS ? ~0u : (1u << keywords.size()) - 1;
+	_keywordMask &= keywordsMask;
+
+	if (_keywordMask == 0 || !renderer) return GetPipelineData(_rpName);
+
+	auto it = variants.find(_keywordMask);
+	if (it == variants.end())
+	{
+		it = variants.emplace(_keywordMask, MaterialVariant()).first;
+
+		uint32_t compiledMask = _keywordMask & ~GetSpecializationMask();
+		if (compiledMask != 0)
+		{
+			LOG_TRACE(MF("Compiling variant ", _keywordMask, " of material [", moduleName, "]"));
+			it->second.compilation = cp::ShaderCompilerService::Get().Submit(cp::SlangCompiler::MakeMaterialRequest(*this, compiledMask));
+		}
+		else
+		{
+			CreateVariantPipelines(_keywordMask, it->second); // Specialization only, the material SPIR-V is reused as is
+		}
+	}
+
+	MaterialVariant& variant = it->second;
+
+	if (variant.compilation.valid() && variant.compilation.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		uint32_t compiledMask = _keywordMask & ~GetSpecializationMask();
+		const cp::ShaderCompileResult& result = variant.compilation.get();
+
+		if (result.success && cp::SlangCompiler::WriteSpirV(GetVariantSpirVPath(compiledMask), result.spirv))
+		{
+			CreateVariantPipelines(_keywordMask, variant);
+		}
+		else
+		{
+			LOG_ERROR(MF("Variant ", _keywordMask, " of material [", moduleName, "] failed to compile, using the base material"));
+			variant.failed = true;
+		}
+
+		variant.compilation = {};
+	}
+
+	auto pipelineIt = variant.pipelineDatas.find(_rpName);
+	if (pipelineIt != variant.pipelineDatas.end() && pipelineIt->second->IsReady()) return pipelineIt->second;
+
+	return GetPipelineData(_rpName); // The base material renders until the variant is ready
+}
+
+uint32_t cp::Material::GetKeywordMask(const std::vector<std::string>& _enabledKeywords) const
+{
+	uint32_t mask = 0;
+
+	for (uint32_t i = 0; i < keywords.size() && i < MAX_KEYWORDS; i++)
+	{
+		if (std::find(_enabledKeywords.begin(), _enabledKeywords.end(), keywords[i].name) != _enabledKeywords.end())
+			mask |= 1u << i;
+	}
+
+	return mask;
+}
+
+uint32_t cp::Material::GetSpecializationMask() const
+{
+	uint32_t mask = 0;
+
+	for (uint32_t i = 0; i < keywords.size() && i < MAX_KEYWORDS; i++)
+	{
+		if (keywords[i].specialization) mask |= 1u << i;
+	}
+
+	return mask;
+}
+
+std::string cp::Material::GetVariantSpirVPath(uint32_t _compiledMask) const
+{
+	std::string basePath = shaderPath.substr(0, shaderPath.find_last_of('.'));
+	return _compiledMask == 0 ? basePath + ".spv" : MF(basePath, "_", _compiledMask, ".spv");
+}
+
+void cp::Material::CreateVariantPipelines(uint32_t _keywordMask, MaterialVariant& _variant)
+{
+	std::string baseSpirV = std::filesystem::path(GetVariantSpirVPath(0)).lexically_normal().string();
+	std::string variantSpirV = GetVariantSpirVPath(_keywordMask & ~GetSpecializationMask());
+
+	for (const auto& [name, config] : pipelineConfigs) // Only the passes the material compiled its own pipeline for
+	{
+		const std::string& shaderFile = rpRequirements.at(name).customShaderPath;
+
+		// Passes drawn with another shader keep it, only the specialization constants apply to them
+		bool usesMaterialShader = std::filesystem::path(shaderFile).lexically_normal().string() == baseSpirV;
+
+		cp::PipelineData& pipelineData = CreatePassPipeline(name, usesMaterialShader ? variantSpirV : shaderFile, _keywordMask);
+		_variant.pipelineDatas[name] = &pipelineData;
+		_variant.pipelineConfigs[name] = pipelineData.config;
+	}
+}
+
+void cp::Material::ReleaseVariants()
+{
+	cp::PipelinesManager* pipelinesManager = context->GetPipelinesManager();
+
+	bool pending = false;
+	for (const auto& [mask, variant] : variants)
+	{
+		for (const auto& [name, pipelineData] : variant.pipelineDatas) pending |= pipelineData->pending;
+	}
+
+	if (pending) pipelinesManager->WaitIdle(); // Workers still read the layout they share with the base pipelines
+
+	for (const auto& [mask, variant] : variants)
+	{
+		for (const auto& [name, pipelineData] : variant.pipelineDatas) context->GetLayoutsManager()->UnloadLayout(pipelineData->pipelineLayout); // Each variant pipeline took a layout reference
+		for (const auto& [name, config] : variant.pipelineConfigs) pipelinesManager->DestroyPipeline(config);
+	}
+
+	variants.clear(); // Compilations still in flight finish in the service, nobody reads their result
+}
+
+bool cp::Material::ReleasePreviousPipelines(bool _force)
+{
+	for (auto it = previousPipelines.begin(); it != previousPipelines.end();)
+	{
+		auto current = pipelineDatas.find(it->first);
+
+		// A successor that failed to compile keeps the previous pipeline drawing until the next reload
+		if (!_force && current != pipelineDatas.end() && !current->second->IsReady())
+		{
+			++it;
+			continue;
+		}
+
+		std::string rpName = it->first;
+		++it;
+		ReleasePreviousPipeline(rpName);
+	}
+
+	return previousPipelines.empty();
+}
+
+void cp::Material::ReleasePreviousPipeline(const std::string& _rpName)
+{
+	auto it = previousPipelines.find(_rpName);
+	if (it == previousPipelines.end()) return;
+
+	vk::PipelineLayout layout = it->second.pipelineData->pipelineLayout;
+
+	if (layout) context->GetLayoutsManager()->UnloadLayout(layout); // Layouts are reference counted, the current pipeline holds its own reference even when it is the same layout
+
+	context->GetPipelinesManager()->DestroyPipeline(it->second.config); // Retired, frames in flight may still draw with it
+
+	previousPipelines.erase(it);
+}
+
 void cp::Material::BindMaterial(vk::CommandBuffer& _command)
 {
 	//_command.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelineData->pipeline);
@@ -46,8 +226,6 @@ void cp::Material::BindMaterial(vk::CommandBuffer& _command)
 
 void cp::Material::Reload(cp::RendererPrototype& _renderer)
 {
-	auto ValueOrDefault = [](const std::string& str, const std::string& defaultValue) { return str.empty() ? defaultValue : str; }; // This lambda is used to check if the string is empty and return the default value if it is
-
 	// Since this function in called when a material is loaded in the scene and needs to be reloaded
 	// we can generate the descriptor set layouts and pipeline layout here
 
@@ -56,6 +234,11 @@ void cp::Material::Reload(cp::RendererPrototype& _renderer)
 	//	desc.GenerateDescriptorSetLayout(context); //This (re)generate the descriptor set layout
 	//}
 
+	renderer = &_renderer;
+	if (cp::ShaderHotReloader* reloader = cp::ShaderHotReloader::Get()) reloader->Track(this);
+
+	ReleaseVariants(); // Built from the previous shader and layouts, they are requested again on their next use
+
 	CreateDescriptorSetLayouts(); // Create the descriptor set layouts based on the current descriptors
 
 	cp::LayoutsManager* layoutsManager = context->GetLayoutsManager();
@@ -79,72 +262,128 @@ void cp::Material::Reload(cp::RendererPrototype& _renderer)
 
 		if (pipelineDatas.find(name) != pipelineDatas.end()) // Check if the pipeline data already exists
 		{
-			//In this case, we unload the previous layout and pipeline
-			if (pipelineDatas[name]->pipelineLayout) layoutsManager->UnloadLayout(pipelineDatas[name]->pipelineLayout); // Unload the previous layout if it exists
-			if (pipelineDatas[name]->pipeline) pipelinesManager->DestroyPipeline({ this->moduleName + "_" + name }); // Unload the previous pipeline if it exists
+			if (pipelineConfigs.count(name) && pipelineDatas[name]->IsReady())
+			{
+				// Kept with its layout until the new pipeline is ready, see ReleasePreviousPipelines
+				ReleasePreviousPipeline(name);
+				previousPipelines[name] = { pipelineDatas[name], pipelineConfigs.at(name) };
+			}
+			else
+			{
+				//In this case, we unload the previous layout and pipeline
+				if (pipelineDatas[name]->pending) pipelinesManager->WaitIdle(); // The worker still reads the layout we are about to destroy
+				if (pipelineDatas[name]->pipelineLayout) layoutsManager->UnloadLayout(pipelineDatas[name]->pipelineLayout); // Unload the previous layout if it exists
+				if (pipelineConfigs.count(name)) pipelinesManager->DestroyPipeline(pipelineConfigs.at(name)); // Unload the previous pipeline, a pending one is dropped once its job finishes
+			}
+
+			pipelineDatas.erase(name);
+			pipelineConfigs.erase(name);
 		}
 
-		vk::PipelineLayout pipelineLayout = layoutsManager->GetOrCreateLayout(descriptorSetLayouts, {}); // Create the new layout // TODO : Add PushConstants support
-
-		cp::PipelineCreateData pipelineCreateData;
-		pipelineCreateData.config = { this->moduleName + "_" + name }; // Create a unique moduleName for the pipeline
-		pipelineCreateData.createInfo.layout = pipelineLayout;
-		pipelineCreateData.createInfo.renderPass = _renderer.GetRenderPass(name).GetRenderPass();
-		pipelineCreateData.shaderFile = rpRequirement.customShaderPath;
-		
-		pipelineCreateData.mains = { 
-			{ vk::ShaderStageFlagBits::eVertex, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::Vertex], "Vertex_Default") },
-			{ vk::ShaderStageFlagBits::eFragment, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::Fragment], "Fragment_Default") },
-			{ vk::ShaderStageFlagBits::eGeometry, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::Geometry], "Geometry_Default") },
-			{ vk::ShaderStageFlagBits::eTessellationControl, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::TessellationControl], "TessellationControl_Default") },
-			{ vk::ShaderStageFlagBits::eTessellationEvaluation, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::TessellationEvaluation], "TessellationEvaluation_Default") },
-			{ vk::ShaderStageFlagBits::eMeshEXT, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::Mesh], "Mesh_Default") },
-			{ vk::ShaderStageFlagBits::eCompute, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::Compute], "Compute_Default") }
-		};
-		pipelineCreateData.descriptorSetLayouts = descriptorSetLayouts;
-
-		std::vector<vk::DynamicState> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
-
-		vk::PipelineColorBlendAttachmentState* colorBlendAttachment = new vk::PipelineColorBlendAttachmentState;
-		colorBlendAttachment->colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
-		colorBlendAttachment->blendEnable = pipelineCreationData.enableBlending;
-		colorBlendAttachment->srcColorBlendFactor = pipelineCreationData.srcColorBlendFactor;
-		colorBlendAttachment->dstColorBlendFactor = pipelineCreationData.dstColorBlendFactor;
-		colorBlendAttachment->colorBlendOp = pipelineCreationData.colorBlendOp;
-		colorBlendAttachment->srcAlphaBlendFactor = pipelineCreationData.srcAlphaBlendFactor;
-		colorBlendAttachment->dstAlphaBlendFactor = pipelineCreationData.dstAlphaBlendFactor;
-		colorBlendAttachment->alphaBlendOp = pipelineCreationData.alphaBlendOp;
-
-		vk::VertexInputBindingDescription* bindingDescription = new vk::VertexInputBindingDescription(0, sizeof(cp::Vertex), vk::VertexInputRate::eVertex);
-
-		vk::VertexInputAttributeDescription* attributeDescriptions = new vk::VertexInputAttributeDescription[5];
-		attributeDescriptions[0] = vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(cp::Vertex, position));
-		attributeDescriptions[1] = vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(cp::Vertex, normal));
-		attributeDescriptions[2] = vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32Sfloat, offsetof(cp::Vertex, uv));
-		attributeDescriptions[3] = vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32G32B32Sfloat, offsetof(cp::Vertex, tangent));
-		attributeDescriptions[4] = vk::VertexInputAttributeDescription(4, 0, vk::Format::eR32G32B32Sfloat, offsetof(cp::Vertex, bitangent));
-
-		pipelineCreateData.createInfo.subpass = 0; // TODO IMPORTANT : Add support for multiple subpasses
-		pipelineCreateData.createInfo.pDynamicState = new vk::PipelineDynamicStateCreateInfo(vk::PipelineDynamicStateCreateFlags(), static_cast<uint32_t>(dynamicStates.size()), dynamicStates.data());
-		pipelineCreateData.createInfo.pDepthStencilState = new vk::PipelineDepthStencilStateCreateInfo(vk::PipelineDepthStencilStateCreateFlags(), pipelineCreationData.depthTestEnable, pipelineCreationData.depthWriteEnable, pipelineCreationData.depthCompareOp);
-		pipelineCreateData.createInfo.pViewportState = new vk::PipelineViewportStateCreateInfo(vk::PipelineViewportStateCreateFlags(), 1, nullptr, 1, nullptr);
-		pipelineCreateData.createInfo.pRasterizationState = new vk::PipelineRasterizationStateCreateInfo(vk::PipelineRasterizationStateCreateFlags(), VK_FALSE, VK_FALSE, pipelineCreationData.polygonMode, pipelineCreationData.cullMode, pipelineCreationData.frontFace, pipelineCreationData.depthBiasEnable, pipelineCreationData.depthBiasConstantFactor, pipelineCreationData.depthBiasClamp, pipelineCreationData.depthBiasSlopeFactor, 1.0f);
-		pipelineCreateData.createInfo.pMultisampleState = new vk::PipelineMultisampleStateCreateInfo(vk::PipelineMultisampleStateCreateFlags(), pipelineCreationData.rasterizationSamples, pipelineCreationData.sampleShadingEnable, 1.0f, nullptr, VK_FALSE, VK_FALSE);
-		pipelineCreateData.createInfo.pColorBlendState = new vk::PipelineColorBlendStateCreateInfo({}, VK_FALSE, vk::LogicOp::eCopy, 1, colorBlendAttachment, { 0.f, 0.f, 0.f, 0.f });
-		pipelineCreateData.createInfo.pInputAssemblyState = new vk::PipelineInputAssemblyStateCreateInfo(vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList, VK_FALSE);
-		pipelineCreateData.createInfo.pVertexInputState = new vk::PipelineVertexInputStateCreateInfo(vk::PipelineVertexInputStateCreateFlags(), 1, bindingDescription, 5, attributeDescriptions);
-
-		//pipelineCreateData.createInfo.pTessellationState = new vk::PipelineTessellationStateCreateInfo(vk::PipelineTessellationStateCreateFlags(), 3); // TODO : Add support for tessellation
-
-		pipelineDatas.insert({ name, &pipelinesManager->CreatePipeline(pipelineCreateData) }); // Create the pipeline and store it in the map
+		// Compiled in the background, GetPipelineData hands out the render pass default pipeline meanwhile
+		cp::PipelineData& pipelineData = CreatePassPipeline(name, rpRequirement.customShaderPath, 0);
+		pipelineDatas.insert({ name, &pipelineData });
+		pipelineConfigs[name] = pipelineData.config;
+
+		if (_renderer.GetRenderPass(name).GetDefaultPipeline().has_value())
+			fallbackPipelines[name] = _renderer.GetRenderPass(name).GetDefaultPipeline().value();
 	}
 }
 
+cp::PipelineData& cp::Material::CreatePassPipeline(const std::string& _rpName, const std::string& _shaderFile, uint32_t _keywordMask)
+{
+	auto ValueOrDefault = [](const std::string& str, const std::string& defaultValue) { return str.empty() ? defaultValue : str; }; // This lambda is used to check if the string is empty and return the default value if it is
+
+	RenderPassRequirement& rpRequirement = rpRequirements.at(_rpName);
+	uint32_t specializationMask = _keywordMask & GetSpecializationMask();
+
+	std::vector<vk::PushConstantRange> pushConstantRanges = shaderReflection->GetPushConstantRanges(); // Per draw values, pushed instead of written to a descriptor
+	vk::PipelineLayout pipelineLayout = context->GetLayoutsManager()->GetOrCreateLayout(descriptorSetLayouts, descriptorSetBindings, pushConstantRanges); // Create the new layout, or reference the one with the same content
+
+	cp::PipelineCreateData pipelineCreateData;
+	pipelineCreateData.config.name = this->moduleName + "_" + _rpName + (_keywordMask ? MF("_", _keywordMask) : "");
+	pipelineCreationData.AppendState(pipelineCreateData.config); // Materials with the same state and shader share the pipeline
+	pipelineCreateData.config.AppendState(specializationMask);
+	pipelineCreateData.createInfo.layout = pipelineLayout;
+	pipelineCreateData.layoutKey = context->GetLayoutsManager()->GetLayoutKey(pipelineLayout);
+	const cp::Renderpass& renderPass = renderer->GetRenderPass(_rpName);
+	pipelineCreateData.createInfo.renderPass = renderPass.GetRenderPass();
+	if (!renderPass.IsDynamic()) pipelineCreateData.renderPassKey = renderPass.GetDescription().GetCompatibilityKey(pipelineCreateData.createInfo.subpass);
+	pipelineCreateData.shaderFile = _shaderFile;
+	
+	pipelineCreateData.mains = { 
+		{ vk::ShaderStageFlagBits::eVertex, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::Vertex], "Vertex_Default") },
+		{ vk::ShaderStageFlagBits::eFragment, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::Fragment], "Fragment_Default") },
+		{ vk::ShaderStageFlagBits::eGeometry, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::Geometry], "Geometry_Default") },
+		{ vk::ShaderStageFlagBits::eTessellationControl, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::TessellationControl], "TessellationControl_Default") },
+		{ vk::ShaderStageFlagBits::eTessellationEvaluation, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::TessellationEvaluation], "TessellationEvaluation_Default") },
+		{ vk::ShaderStageFlagBits::eMeshEXT, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::Mesh], "Mesh_Default") },
+		{ vk::ShaderStageFlagBits::eCompute, ValueOrDefault(rpRequirement.customEntryPoints[cp::ShaderStages::Compute], "Compute_Default") }
+	};
+	pipelineCreateData.descriptorSetLayouts = descriptorSetLayouts;
+	pipelineCreateData.pushConstantRanges = pushConstantRanges;
+
+	auto state = std::make_shared<cp::GraphicsPipelineState>(); // Owned by the create data, it outlives this function while the pipeline compiles
+	state->dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+
+	vk::PipelineColorBlendAttachmentState colorBlendAttachment;
+	colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+	colorBlendAttachment.blendEnable = pipelineCreationData.enableBlending;
+	colorBlendAttachment.srcColorBlendFactor = pipelineCreationData.srcColorBlendFactor;
+	colorBlendAttachment.dstColorBlendFactor = pipelineCreationData.dstColorBlendFactor;
+	colorBlendAttachment.colorBlendOp = pipelineCreationData.colorBlendOp;
+	colorBlendAttachment.srcAlphaBlendFactor = pipelineCreationData.srcAlphaBlendFactor;
+	colorBlendAttachment.dstAlphaBlendFactor = pipelineCreationData.dstAlphaBlendFactor;
+	colorBlendAttachment.alphaBlendOp = pipelineCreationData.alphaBlendOp;
+	state->colorBlendAttachments = { colorBlendAttachment };
+
+	const cp::VertexInputDescription& vertexInput = cp::GetVertexInputDescription(pipelineCreationData.vertexFormat);
+	state->vertexBindings = { vertexInput.binding };
+	state->vertexAttributes = vertexInput.attributes;
+
+	state->depthStencilState = vk::PipelineDepthStencilStateCreateInfo(vk::PipelineDepthStencilStateCreateFlags(), pipelineCreationData.depthTestEnable, pipelineCreationData.depthWriteEnable, pipelineCreationData.depthCompareOp);
+	state->viewportState = vk::PipelineViewportStateCreateInfo(vk::PipelineViewportStateCreateFlags(), 1, nullptr, 1, nullptr);
+	state->rasterizationState = vk::PipelineRasterizationStateCreateInfo(vk::PipelineRasterizationStateCreateFlags(), VK_FALSE, VK_FALSE, pipelineCreationData.polygonMode, pipelineCreationData.cullMode, pipelineCreationData.frontFace, pipelineCreationData.depthBiasEnable, pipelineCreationData.depthBiasConstantFactor, pipelineCreationData.depthBiasClamp, pipelineCreationData.depthBiasSlopeFactor, 1.0f);
+	state->multisampleState = vk::PipelineMultisampleStateCreateInfo(vk::PipelineMultisampleStateCreateFlags(), pipelineCreationData.rasterizationSamples, pipelineCreationData.sampleShadingEnable, 1.0f, nullptr, VK_FALSE, VK_FALSE);
+	state->colorBlendState = vk::PipelineColorBlendStateCreateInfo({}, VK_FALSE, vk::LogicOp::eCopy, 0, nullptr, { 0.f, 0.f, 0.f, 0.f });
+	state->inputAssemblyState = vk::PipelineInputAssemblyStateCreateInfo(vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList, VK_FALSE);
+
+	//state->tessellationState = vk::PipelineTessellationStateCreateInfo(vk::PipelineTessellationStateCreateFlags(), 3); // TODO : Add support for tessellation
+
+	// Every specialization keyword gets a value, so the constant ids the shader declares always resolve
+	for (uint32_t i = 0; i < keywords.size(); i++)
+	{
+		if (!keywords[i].specialization) continue;
+
+		state->specializationEntries.push_back(vk::SpecializationMapEntry(i, static_cast<uint32_t>(state->specializationData.size() * sizeof(uint32_t)), sizeof(uint32_t)));
+		state->specializationData.push_back((specializationMask >> i) & 1u ? VK_TRUE : VK_FALSE);
+	}
+
+	pipelineCreateData.createInfo.subpass = 0; // TODO IMPORTANT : Add support for multiple subpasses
+
+	// Compiled against the formats alone, every pass with the same attachments shares the pipeline
+	if (renderPass.IsDynamic()) state->attachmentFormats = renderPass.GetDescription().GetAttachmentFormats();
+	pipelineCreateData.state = state;
+
+	return context->GetPipelinesManager()->CreatePipelineAsync(pipelineCreateData);
+}
+
 void cp::Material::Serialize(cp::ISerializer& _serializer) const
 {
 	_serializer.WriteString("Name", moduleName);
 	_serializer.WriteString("ShaderPath", shaderPath);
 	_serializer.WriteInt("Shader Stages", static_cast<int>(shaderStages));
+	_serializer.WriteInt("Vertex Format", static_cast<int>(pipelineCreationData.vertexFormat));
+
+	std::vector<std::string> keywordNames; // In order, a keyword index is its bit and its constant_id
+	std::vector<std::string> specializationNames;
+	for (const auto& keyword : keywords)
+	{
+		keywordNames.push_back(keyword.name);
+		if (keyword.specialization) specializationNames.push_back(keyword.name);
+	}
+	_serializer.WriteStringArray("Keywords", keywordNames.size(), keywordNames.data());
+	_serializer.WriteStringArray("Specialization Keywords", specializationNames.size(), specializationNames.data());
 
 	_serializer.BeginObjectArrayWriting("RenderPass Requirements");
 
@@ -177,6 +416,28 @@ void cp::Material::Deserialize(ISerializer& _serializer)
 	moduleName = _serializer.ReadString("Name", "Unknown");
 	shaderPath = _serializer.ReadString("ShaderPath", "");
 	shaderStages = static_cast<uint16_t>(_serializer.ReadInt("Shader Stages", 0));
+	pipelineCreationData.vertexFormat = static_cast<cp::VertexFormat>(_serializer.ReadInt("Vertex Format", static_cast<int>(cp::VertexFormat::Standard)));
+
+	auto [keywordCount, keywordNames] = _serializer.ReadStringArray("Keywords");
+	auto [specializationCount, specializationNames] = _serializer.ReadStringArray("Specialization Keywords");
+
+	keywords.clear();
+	for (size_t i = 0; i < keywordCount; i++)
+	{
+		if (keywords.size() == MAX_KEYWORDS)
+		{
+			LOG_WARNING(MF("Material [", moduleName, "] declares more than ", MAX_KEYWORDS, " keywords, the rest are ignored"));
+			break;
+		}
+
+		MaterialKeyword keyword;
+		keyword.name = keywordNames[i];
+		keyword.specialization = std::find(specializationNames, specializationNames + specializationCount, keyword.name) != specializationNames + specializationCount;
+		keywords.push_back(keyword);
+	}
+
+	delete[] keywordNames;
+	delete[] specializationNames;
 
 	size_t elements = _serializer.BeginObjectArrayReading("RenderPass Requirements");
 
@@ -209,6 +470,42 @@ void cp::Material::Deserialize(ISerializer& _serializer)
 	_serializer.EndObject();
 }
 
+void cp::PipelineCreationData::AppendState(cp::PipelineConfig& _config) const
+{
+	_config.AppendState(vertexFormat);
+
+	_config.AppendState(polygonMode);
+	_config.AppendState(static_cast<VkCullModeFlags>(cullMode));
+	_config.AppendState(frontFace);
+	_config.AppendState(depthBiasEnable);
+	_config.AppendState(depthBiasConstantFactor);
+	_config.AppendState(depthBiasClamp);
+	_config.AppendState(depthBiasSlopeFactor);
+
+	_config.AppendState(rasterizationSamples);
+	_config.AppendState(sampleShadingEnable);
+
+	_config.AppendState(depthTestEnable);
+	_config.AppendState(depthWriteEnable);
+	_config.AppendState(depthCompareOp);
+	_config.AppendState(stencilTestEnable);
+	_config.AppendState(operations.failOp);
+	_config.AppendState(operations.passOp);
+	_config.AppendState(operations.depthFailOp);
+	_config.AppendState(operations.compareOp);
+	_config.AppendState(operations.compareMask);
+	_config.AppendState(operations.writeMask);
+	_config.AppendState(operations.reference);
+
+	_config.AppendState(enableBlending);
+	_config.AppendState(srcColorBlendFactor);
+	_config.AppendState(dstColorBlendFactor);
+	_config.AppendState(colorBlendOp);
+	_config.AppendState(srcAlphaBlendFactor);
+	_config.AppendState(dstAlphaBlendFactor);
+	_config.AppendState(alphaBlendOp);
+}
+
 std::vector<std::string> cp::Material::GetUniqueEntryPoints() const
 {
 	std::vector<std::string> entryPoints;
@@ -230,15 +527,10 @@ std::vector<std::string> cp::Material::GetUniqueEntryPoints() const
 
 void cp::Material::CreateDescriptorSetLayouts()
 {
-	if (descriptorSetLayouts.size() > 0)
-	{
-		LOG_WARNING("Material already has descriptor set layouts, they will be destroyed");
-		for (auto& layout : descriptorSetLayouts)
-		{
-			context->GetDevice().destroyDescriptorSetLayout(layout); // Destroy the previous descriptor set layout
-		}
-		descriptorSetLayouts.clear();
-	}
+	// Destroyed once the new ones exist, pipeline layouts created from them don't need them anymore
+	std::vector<vk::DescriptorSetLayout> previousLayouts = std::move(descriptorSetLayouts);
+	descriptorSetLayouts.clear();
+	descriptorSetBindings.clear();
 
 	std::sort(shaderReflection->resources.begin(), shaderReflection->resources.end(), [](const ShaderResource& a, const ShaderResource& b) {
 		return a.set < b.set && a.binding < b.binding;
@@ -251,6 +543,8 @@ void cp::Material::CreateDescriptorSetLayouts()
 
 	for (const auto& resource : shaderReflection->resources)
 	{
+		if (resource.kind == ShaderResourceKind::PushConstant) continue; // Part of the pipeline layout, not of a set
+
 		if (lastSetIndex != resource.set)
 		{
 			if (lastSetIndex != ~(0ull)) // If this is not the first set
@@ -258,6 +552,7 @@ void cp::Material::CreateDescriptorSetLayouts()
 				layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size()); // Set the binding count for the layout info
 				layoutInfo.pBindings = bindings.data(); // Set the bindings for the layout info
 				descriptorSetLayouts.push_back(context->GetDevice().createDescriptorSetLayout(layoutInfo)); // Create the descriptor set layout for the previous set
+				descriptorSetBindings.push_back(std::move(bindings));
 				bindings.clear(); // Clear the bindings for the next set
 			}
 
@@ -278,6 +573,13 @@ void cp::Material::CreateDescriptorSetLayouts()
 		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size()); // Set the binding count for the layout info
 		layoutInfo.pBindings = bindings.data(); // Set the bindings for the layout info
 		descriptorSetLayouts.push_back(context->GetDevice().createDescriptorSetLayout(layoutInfo)); // Create the descriptor set layout for the last set
+		descriptorSetBindings.push_back(bindings);
+	}
+
+	for (auto& layout : previousLayouts)
+	{
+		context->GetDescriptorSetManager()->ReleaseLayout(layout);
+		context->GetDevice().destroyDescriptorSetLayout(layout); // Destroy the previous descriptor set layout
 	}
 
 	if (descriptorSetLayouts.empty())
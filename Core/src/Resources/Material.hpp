@@ -3,10 +3,14 @@
 #include "../pch.hpp"
 #include "../Context/VulkanContext.hpp"
 
+#include <future>
+
 #include "../Util/Serializers/Serializable.hpp"
 
 #include "../Util/ShaderCompiler/SlangCompiler.hpp"
 
+#include "VertexFormat.hpp"
+
 namespace cp
 {
 	class RendererPrototype;
@@ -30,9 +34,7 @@ namespace cp
 	struct PipelineCreationData
 	{
 		//Vertex Input
-		// VI Format
-		// Input Rate
-		// Binding Slots
+		cp::VertexFormat vertexFormat = cp::VertexFormat::Standard; // Compact formats need the shader to decode its inputs (see VertexCompression.slang)
 
 		//Rasterization
 		vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
@@ -62,6 +64,8 @@ namespace cp
 		vk::BlendFactor srcAlphaBlendFactor = vk::BlendFactor::eOne;
 		vk::BlendFactor dstAlphaBlendFactor = vk::BlendFactor::eZero;
 		vk::BlendOp alphaBlendOp = vk::BlendOp::eAdd;
+
+		void AppendState(cp::PipelineConfig& _config) const; // Every field, so materials with the same state and shader share the pipeline
 	};
 
 	enum class ShaderStages : uint16_t
@@ -98,6 +102,30 @@ namespace cp
 		void Deserialize(ISerializer& _serializer) override;
 	};
 
+	// A feature the shader can toggle, its bit in a keyword mask is its index in the material keyword list
+	// Compiled keywords are #defined to 0 or 1 and produce a SPIR-V variant, specialization keywords are
+	// a bool specialization constant with constant_id = index that the driver folds at pipeline creation
+	struct MaterialKeyword
+	{
+		std::string name;
+		bool specialization = false;
+	};
+
+	struct PreviousPipeline
+	{
+		cp::PipelineData* pipelineData;
+		cp::PipelineConfig config;
+	};
+
+	struct MaterialVariant
+	{
+		std::shared_future<cp::ShaderCompileResult> compilation; // Valid until the SPIR-V is written and the pipelines are queued
+		bool failed = false;
+
+		std::unordered_map<std::string, cp::PipelineData*> pipelineDatas;
+		std::unordered_map<std::string, cp::PipelineConfig> pipelineConfigs;
+	};
+
 	class Material : public ISerializable
 	{
 	protected:
@@ -111,24 +139,53 @@ namespace cp
 		cp::ShaderReflection* shaderReflection = nullptr;
 
 		std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+		std::vector<std::vector<vk::DescriptorSetLayoutBinding>> descriptorSetBindings; // What each of descriptorSetLayouts was created with, the pipeline layout is keyed by it
 		PipelineCreationData pipelineCreationData;
 		std::unordered_map<std::string, RenderPassRequirement> rpRequirements;
 
 		std::unordered_map<std::string, cp::PipelineData*> pipelineDatas; // The pipeline data used by the material (if we need to reload the material)
+		std::unordered_map<std::string, cp::PipelineConfig> pipelineConfigs; // Keys of the pipelines the material owns a reference to, per render pass
+		std::unordered_map<std::string, cp::PipelineData*> fallbackPipelines; // Render pass default pipelines, used while ours compile
+		std::unordered_map<std::string, PreviousPipeline> previousPipelines; // Pipelines replaced by a Reload, drawn until their successor is ready
+
+		std::vector<MaterialKeyword> keywords;
+		std::unordered_map<uint32_t, MaterialVariant> variants; // Keyed by keyword mask, mask 0 is the material itself (pipelineDatas)
 
 		const cp::VulkanContext* context;
+		cp::RendererPrototype* renderer = nullptr; // Set by Reload, variants are built against the same render passes
+
+		cp::PipelineData& CreatePassPipeline(const std::string& _rpName, const std::string& _shaderFile, uint32_t _keywordMask);
+
+		void CreateVariantPipelines(uint32_t _keywordMask, MaterialVariant& _variant);
+		void ReleaseVariants();
+		void ReleasePreviousPipeline(const std::string& _rpName);
 
 	public:
+		static constexpr uint32_t MAX_KEYWORDS = 32;
+
 		Material(const cp::VulkanContext* _context);
 		virtual ~Material();
 
 		virtual void BindMaterial(vk::CommandBuffer& _command);
 
+		const cp::PipelineData* GetPipelineData(const std::string& _rpName) const; // Falls back to the render pass default pipeline while compiling, nullptr if there is none
+		const cp::PipelineData* GetVariantPipelineData(const std::string& _rpName, uint32_t _keywordMask); // Requests the variant on first use, falls back to GetPipelineData until it is ready, render thread only
+
+		uint32_t GetKeywordMask(const std::vector<std::string>& _enabledKeywords) const; // Unknown names are ignored
+		uint32_t GetSpecializationMask() const;
+		std::string GetVariantSpirVPath(uint32_t _compiledMask) const; // Mask 0 is the .spv next to the source
+
+		inline std::vector<MaterialKeyword>& GetKeywords() { return keywords; }
+		inline const std::vector<MaterialKeyword>& GetKeywords() const { return keywords; }
+
 		inline bool HasShaderStage(const ShaderStages& _stage) const { return (shaderStages & static_cast<uint16_t>(_stage)) != 0; }
 		inline void AddShaderStage(const ShaderStages& _stage) { shaderStages |= static_cast<uint16_t>(_stage); }
 		inline void RemoveShaderStage(const ShaderStages& _stage) { shaderStages &= ~static_cast<uint16_t>(_stage); }
 
 		virtual void Reload(cp::RendererPrototype& _renderer);
+		bool ReleasePreviousPipelines(bool _force = false); // Frees the replaced pipelines whose successor is ready, true once none are left
+
+		inline cp::RendererPrototype* GetRenderer() const { return renderer; } // nullptr until the first Reload
 
 		virtual void Serialize(ISerializer& _serializer) const override;
 		virtual void Deserialize(ISerializer& _serializer) override;
@@ -148,6 +205,9 @@ namespace cp
 
 		inline uint16_t GetShaderStages() const { return shaderStages; }
 
+		inline PipelineCreationData& GetPipelineCreationData() { return pipelineCreationData; }
+		inline const PipelineCreationData& GetPipelineCreationData() const { return pipelineCreationData; }
+
 		inline ShaderReflection* GetShaderReflection() const { return shaderReflection; }
 		inline void SetShaderReflection(ShaderReflection* _reflection) { shaderReflection = _reflection; };
 
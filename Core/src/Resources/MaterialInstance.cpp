@@ -5,6 +5,18 @@
 
 #include "Util/Serializers/JsonSerializer.hpp"
 #include "ResourceManager.hpp"
+#include "Texture.hpp"
+#include "TextureStreamer.hpp"
+
+std::unordered_map<size_t, std::weak_ptr<cp::SharedMaterialParameters>> cp::MaterialInstance::sharedParameters;
+
+cp::SharedMaterialParameters::~SharedMaterialParameters()
+{
+	if (bindless)
+	{
+		bindless->FreeMaterialBlock(bindlessBlock);
+	}
+}
 
 cp::MaterialInstance::MaterialInstance(const cp::VulkanContext* _context)
 {
@@ -13,6 +25,8 @@ cp::MaterialInstance::MaterialInstance(const cp::VulkanContext* _context)
 
 cp::MaterialInstance::~MaterialInstance()
 {
+	ReleaseParameters();
+
 	/*for (auto& [name, desc] : descriptorSets)
 	{
 		context->GetDescriptorSetManager()->DestroyOrphanedDescriptorSet(desc.descriptorSet);
@@ -29,6 +43,8 @@ void cp::MaterialInstance::Serialize(ISerializer& _serializer) const
 		return;
 	}
 
+	_serializer.WriteStringArray("Keywords", keywords.size(), keywords.data());
+
 	_serializer.BeginObjectArrayWriting("Resources");
 	for (const auto& resource : resources)
 	{
@@ -65,6 +81,10 @@ void cp::MaterialInstance::Deserialize(ISerializer& _serializer)
 		return;
 	}
 
+	auto [keywordCount, keywordNames] = _serializer.ReadStringArray("Keywords");
+	keywords.assign(keywordNames, keywordNames + keywordCount);
+	delete[] keywordNames;
+
 	size_t elements = _serializer.BeginObjectArrayReading("Resources");
 	
 	for (uint64_t i = 0; i < elements; i++)
@@ -91,6 +111,8 @@ std::vector<cp::MaterialInstanceResource> cp::MaterialInstance::CreateMaterialIn
 
 	for (const auto& resource : material->GetShaderReflection()->resources)
 	{
+		if (resource.kind == ShaderResourceKind::PushConstant) continue; // Pushed per draw by the renderer, instances hold no data for them
+
 		MaterialInstanceResource instanceResource;
 		instanceResource.name = resource.name;
 		instanceResource.kind = resource.kind;
@@ -167,6 +189,7 @@ void cp::MaterialInstance::ValidateData()
 
 		it->fields = validatedFields; // Update the fields with validated ones
 		it->kind = correctRes.kind; // Update the kind in case it was changed
+		if (!it->IsTexture()) it->texture.reset();
 		it->associatedResource = correctRes.associatedResource; // Update the associated resource pointer
 
 		LOG_DEBUG(MF("Resource ", it->name, " validated with ", it->fields.size(), " fields."));
@@ -189,13 +212,274 @@ void cp::MaterialInstance::ValidateData()
 	LOG_DEBUG(MF("Validating resources, removing stale ones..."));
 
 	resources.erase(std::remove_if(resources.begin(), resources.end(), [&](const MaterialInstanceResource& res) {
-		return material->GetShaderReflection()->resources.end() == std::find_if(material->GetShaderReflection()->resources.begin(), material->GetShaderReflection()->resources.end(),
-			[&res](const ShaderResource& correctRes) {
+		return correctResources.end() == std::find_if(correctResources.begin(), correctResources.end(),
+			[&res](const MaterialInstanceResource& correctRes) {
 				return res.name == correctRes.name && res.set == correctRes.set && res.binding == correctRes.binding;
 			});
 		}), resources.end());
 
 	LOG_DEBUG(MF("Validation complete, ", resources.size(), " resources remaining after validation."));
+
+	keywordMask = material->GetKeywordMask(keywords); // Keywords the material no longer declares are kept but ignored
+
+	ShareParameters();
+}
+
+const cp::PipelineData* cp::MaterialInstance::GetPipelineData(const std::string& _rpName)
+{
+	return material ? material->GetVariantPipelineData(_rpName, keywordMask) : nullptr;
+}
+
+void cp::MaterialInstance::SetKeywordEnabled(const std::string& _keyword, bool _enabled)
+{
+	auto it = std::find(keywords.begin(), keywords.end(), _keyword);
+
+	if (_enabled && it == keywords.end()) keywords.push_back(_keyword);
+	else if (!_enabled && it != keywords.end()) keywords.erase(it);
+
+	if (!material) return;
+
+	uint32_t mask = material->GetKeywordMask(keywords);
+	if (mask == keywordMask) return;
+
+	keywordMask = mask;
+	ShareParameters(); // The mask is part of the sharing key, leaves the instances of the old variant and joins those of the new one
+}
+
+std::vector<uint8_t> cp::MaterialInstance::PackParameters()
+{
+	// std430 friendly layout, every constant buffer starts on a 16 bytes boundary
+	size_t size = 0;
+	for (auto& resource : resources)
+	{
+		if (resource.kind != cp::ShaderResourceKind::ConstantBuffer) continue;
+
+		resource.bindlessOffset = static_cast<uint32_t>(size);
+		size += (resource.packedData.size() + 15) & ~size_t(15);
+	}
+
+	std::vector<uint8_t> data(size, 0);
+
+	for (const auto& resource : resources)
+	{
+		if (resource.kind != cp::ShaderResourceKind::ConstantBuffer || resource.packedData.empty()) continue;
+
+		std::memcpy(data.data() + resource.bindlessOffset, resource.packedData.data(), resource.packedData.size());
+	}
+
+	return data;
+}
+
+std::vector<const cp::Texture*> cp::MaterialInstance::CollectTextures() const
+{
+	std::vector<const cp::Texture*> textures;
+
+	for (const auto& resource : resources)
+	{
+		if (resource.IsTexture()) textures.push_back(resource.texture.get());
+	}
+
+	return textures;
+}
+
+size_t cp::MaterialInstance::HashParameters(const std::vector<uint8_t>& _data, const std::vector<const cp::Texture*>& _textures) const
+{
+	size_t hash = 0;
+
+	Helper::Hash::CombineHashes(hash, associatedMaterial);
+	Helper::Hash::CombineHashes(hash, keywordMask);
+
+	// The layout is part of the key, two materials can pack different resources into the same bytes
+	for (const auto& resource : resources)
+	{
+		Helper::Hash::CombineHashes(hash, resource.name);
+		Helper::Hash::CombineHashes(hash, resource.set);
+		Helper::Hash::CombineHashes(hash, resource.binding);
+		Helper::Hash::CombineHashes(hash, static_cast<uint32_t>(resource.kind));
+	}
+
+	Helper::Hash::CombineHashes(hash, std::string_view(reinterpret_cast<const char*>(_data.data()), _data.size()));
+
+	for (const cp::Texture* texture : _textures)
+	{
+		Helper::Hash::CombineHashes(hash, texture);
+	}
+
+	return hash == 0 ? 1 : hash; // 0 marks detached parameters
+}
+
+void cp::MaterialInstance::ShareParameters()
+{
+	std::vector<uint8_t> data = PackParameters();
+	std::vector<const cp::Texture*> textures = CollectTextures();
+	size_t hash = HashParameters(data, textures);
+
+	if (parameters && parameters->hash == hash && parameters->data == data && parameters->textures == textures) return;
+
+	ReleaseParameters();
+
+	// Identical instances collapse onto the first one loaded, the hash is only a hint, the bytes are compared
+	auto it = sharedParameters.find(hash);
+	if (it != sharedParameters.end())
+	{
+		std::shared_ptr<SharedMaterialParameters> shared = it->second.lock();
+
+		if (shared && shared->data == data && shared->textures == textures)
+		{
+			LOG_TRACE(MF("Material instance of [", associatedMaterial, "] shares the parameters of ", shared->users.size(), " other instances"));
+
+			parameters = shared;
+			parameters->users.push_back(this);
+			return;
+		}
+	}
+
+	parameters = std::make_shared<SharedMaterialParameters>();
+	parameters->hash = hash;
+	parameters->data = std::move(data);
+	parameters->textures = std::move(textures);
+	parameters->users.push_back(this);
+
+	if (cp::BindlessManager* bindless = context ? context->GetBindlessManager() : nullptr; bindless && !parameters->data.empty())
+	{
+		parameters->bindless = bindless;
+		parameters->bindlessBlock = bindless->AllocateMaterialBlock(parameters->data.size());
+		bindless->WriteMaterialBlock(parameters->bindlessBlock, parameters->data.data(), parameters->data.size());
+	}
+
+	sharedParameters[hash] = parameters;
+}
+
+void cp::MaterialInstance::ReleaseParameters()
+{
+	if (!parameters) return;
+
+	auto& users = parameters->users;
+	users.erase(std::remove(users.begin(), users.end(), this), users.end());
+
+	size_t hash = parameters->hash;
+	parameters.reset(); // The last user frees the bindless block
+
+	auto it = sharedParameters.find(hash);
+	if (it != sharedParameters.end() && it->second.expired())
+	{
+		sharedParameters.erase(it);
+	}
+}
+
+void cp::MaterialInstance::DetachParameters()
+{
+	if (!parameters || parameters->hash == 0) return;
+
+	if (parameters->users.size() == 1)
+	{
+		// Sole user, edited in place but no longer found by instances loaded with the old content
+		auto it = sharedParameters.find(parameters->hash);
+		if (it != sharedParameters.end() && (it->second.expired() || it->second.lock() == parameters)) sharedParameters.erase(it); // A colliding hash may point to other parameters
+		parameters->hash = 0;
+		return;
+	}
+
+	LOG_TRACE(MF("Material instance of [", associatedMaterial, "] stops sharing its parameters before an edit"));
+
+	std::shared_ptr<SharedMaterialParameters> copy = std::make_shared<SharedMaterialParameters>();
+	copy->data = parameters->data;
+	copy->textures = parameters->textures;
+	copy->users.push_back(this);
+
+	if (parameters->bindless)
+	{
+		copy->bindless = parameters->bindless;
+		copy->bindlessBlock = copy->bindless->AllocateMaterialBlock(copy->data.size());
+		copy->bindless->WriteMaterialBlock(copy->bindlessBlock, copy->data.data(), copy->data.size());
+	}
+
+	ReleaseParameters();
+	parameters = copy;
+}
+
+void cp::MaterialInstance::UploadField(const MaterialInstanceResource& _resource, const MaterialInstanceField& _field)
+{
+	if (!parameters || _resource.kind != cp::ShaderResourceKind::ConstantBuffer) return;
+
+	size_t offset = _resource.bindlessOffset + _field.offset;
+	if (offset + _field.data.size() > parameters->data.size()) return;
+
+	std::memcpy(parameters->data.data() + offset, _resource.packedData.data() + _field.offset, _field.data.size());
+
+	// The block index changes when frames in flight still read the old one, draws recorded from now on use GetBindlessMaterialIndex
+	if (parameters->bindless)
+	{
+		parameters->bindless->UpdateMaterialBlock(parameters->bindlessBlock, parameters->data.data(), parameters->data.size());
+	}
+}
+
+bool cp::MaterialInstance::SetFieldData(const std::string& _resource, const std::string& _field, const void* _data, size_t _size)
+{
+	for (size_t i = 0; i < resources.size(); i++)
+	{
+		if (resources[i].name != _resource) continue;
+
+		auto& fields = resources[i].fields;
+		auto it = std::find_if(fields.begin(), fields.end(), [&_field](const MaterialInstanceField& field) { return field.name == _field; });
+
+		if (it == fields.end()) break;
+
+		if (it->data.size() != _size)
+		{
+			LOG_ERROR(MF("Field ", _resource, ".", _field, " is ", it->data.size(), " bytes, got ", _size));
+			return false;
+		}
+
+		std::memcpy(it->data.data(), _data, _size);
+		CommitField(i, it - fields.begin());
+		return true;
+	}
+
+	LOG_WARNING(MF("Material instance has no field ", _resource, ".", _field));
+	return false;
+}
+
+void cp::MaterialInstance::CommitField(size_t _resourceIndex, size_t _fieldIndex)
+{
+	// A widget can outlive a revalidation that removed its field
+	if (_resourceIndex >= resources.size() || _fieldIndex >= resources[_resourceIndex].fields.size()) return;
+
+	MaterialInstanceResource& resource = resources[_resourceIndex];
+
+	if (resource.WriteField(_fieldIndex))
+	{
+		DetachParameters(); // ShareParameters joins an identical instance again on the next validation
+		UploadField(resource, resource.fields[_fieldIndex]);
+	}
+}
+
+bool cp::MaterialInstance::SetTexture(const std::string& _resource, const std::shared_ptr<cp::Texture>& _texture)
+{
+	auto it = std::find_if(resources.begin(), resources.end(), [&_resource](const MaterialInstanceResource& resource) { return resource.name == _resource; });
+
+	if (it == resources.end() || !it->IsTexture())
+	{
+		LOG_WARNING(MF("Material instance has no texture ", _resource));
+		return false;
+	}
+
+	if (it->texture == _texture) return true;
+
+	it->texture = _texture;
+	ShareParameters(); // Textures are part of the sharing key, the instance joins or leaves the matching parameters
+	return true;
+}
+
+void cp::MaterialInstance::ReportTextureUsage(float _screenPixels) const
+{
+	cp::TextureStreamer* streamer = cp::TextureStreamer::Get();
+	if (!streamer) return;
+
+	for (const auto& resource : resources)
+	{
+		if (resource.texture && resource.texture->IsStreaming()) streamer->ReportUsage(resource.texture.get(), _screenPixels);
+	}
 }
 
 QWidget* cp::MaterialInstance::CreateMaterialInstanceWidget(QWidget* _parent)
@@ -203,17 +487,29 @@ QWidget* cp::MaterialInstance::CreateMaterialInstanceWidget(QWidget* _parent)
 	QWidget* widget = new QWidget(_parent);
 	QVBoxLayout* layout = new QVBoxLayout(widget);
 
-	for (const auto& resource : resources)
+	for (size_t i = 0; i < resources.size(); i++)
 	{
+		const auto& resource = resources[i];
+
 		QGroupBox* resourceGroup = new QGroupBox(QString::fromStdString(resource.name), widget);
 		QVBoxLayout* resourceLayout = new QVBoxLayout(resourceGroup);
 
-		for (const auto& field : resource.fields)
+		for (size_t j = 0; j < resource.fields.size(); j++)
 		{
+			const auto& field = resource.fields[j];
+
 			if (!field.associatedField) continue;
 			void* dataPtr = field.GetDataPtr();
 			if (!dataPtr) continue;
 			QWidget* fieldWidget = Helper::Material::CreateMaterialFieldWidget(widget, *field.associatedField, dataPtr);
+			if (!fieldWidget) continue;
+
+			// The widget already wrote into the field, only its bytes are copied to the GPU
+			if (cp::ComponentField* componentField = qobject_cast<cp::ComponentField*>(fieldWidget))
+			{
+				QObject::connect(componentField, &cp::ComponentField::ValueChanged, widget, [this, i, j] { CommitField(i, j); });
+			}
+
 			resourceLayout->addWidget(fieldWidget);
 		}
 
@@ -251,6 +547,7 @@ void cp::MaterialInstanceResource::Serialize(ISerializer& _serializer) const
 	_serializer.WriteInt("Binding", binding);
 	_serializer.WriteInt("Set", set);
 	_serializer.WriteInt("Kind", static_cast<int>(kind));
+	if (texture) _serializer.WriteString("Texture", cp::ResourceManager::Get()->GetResourcePath(texture));
 
 	_serializer.BeginObjectArrayWriting("Fields");
 	for (const auto& field : fields)
@@ -269,6 +566,9 @@ void cp::MaterialInstanceResource::Deserialize(ISerializer& _serializer)
 	set = _serializer.ReadInt("Set", 0);
 	kind = static_cast<cp::ShaderResourceKind>(_serializer.ReadInt("Kind", static_cast<int>(cp::ShaderResourceKind::Unknown)));
 
+	std::string texturePath = _serializer.ReadString("Texture", "");
+	if (!texturePath.empty()) texture = cp::ResourceManager::Get()->GetOrLoad<cp::Texture>(texturePath);
+
 	size_t elements = _serializer.BeginObjectArrayReading("Fields");
 	for (uint64_t i = 0; i < elements; i++)
 	{
@@ -281,9 +581,10 @@ void cp::MaterialInstanceResource::Deserialize(ISerializer& _serializer)
 	_serializer.EndObjectArray();
 }
 
-void cp::MaterialInstanceResource::CollectFields(const ShaderField& field, const std::string& prefix, std::vector<MaterialInstanceField>& fields) const
+void cp::MaterialInstanceResource::CollectFields(const ShaderField& field, const std::string& prefix, std::vector<MaterialInstanceField>& fields, size_t baseOffset) const
 {
 	std::string fullName = prefix.empty() ? field.name : prefix + "." + field.name;
+	size_t offset = baseOffset + (field.offset == size_t(-1) ? 0 : field.offset); // Reflected offsets are relative to the enclosing struct
 
 	if (field.fields.empty())
 	{
@@ -291,13 +592,14 @@ void cp::MaterialInstanceResource::CollectFields(const ShaderField& field, const
 		instanceField.name = fullName;
 		instanceField.data.resize(field.size);
 		instanceField.associatedField = &field;
+		instanceField.offset = offset;
 		fields.push_back(instanceField);
 	}
 	else
 	{
 		for (const auto& subField : field.fields)
 		{
-			CollectFields(subField, fullName, fields);
+			CollectFields(subField, fullName, fields, offset);
 		}
 	}
 }
@@ -313,7 +615,7 @@ void cp::MaterialInstanceResource::Repack()
 	{
 		if (!field.associatedField) continue;
 
-		size_t offset = field.associatedField->offset;
+		size_t offset = field.offset;
 		if (offset + field.data.size() > packedData.size())
 		{
 			LOG_ERROR(MF("Field ", field.name, " exceeds packed data size"));
@@ -325,3 +627,19 @@ void cp::MaterialInstanceResource::Repack()
 		std::memcpy(packedData.data() + offset, field.data.data(), field.data.size() * sizeof(uint8_t));
 	}
 }
+
+bool cp::MaterialInstanceResource::WriteField(size_t _fieldIndex)
+{
+	if (!associatedResource || associatedResource->kind != cp::ShaderResourceKind::ConstantBuffer) return false;
+
+	const MaterialInstanceField& field = fields[_fieldIndex];
+
+	if (!field.associatedField || field.offset + field.data.size() > packedData.size())
+	{
+		LOG_ERROR(MF("Field ", field.name, " exceeds packed data size"));
+		return false;
+	}
+
+	std::memcpy(packedData.data() + field.offset, field.data.data(), field.data.size());
+	return true;
+}
\ No newline at end of file
@@ -10,12 +10,14 @@
 namespace cp
 {
 	class Material;
+	class Texture;
 
 	struct MaterialInstanceField : public ISerializable
 	{
 		std::string name;
 		std::vector<uint8_t> data;
 		const cp::ShaderField* associatedField; // Pointer to the associated field in the material
+		size_t offset = 0; // Byte offset in the packed constant buffer, offsets of the enclosing structs included
 
 		void Serialize(ISerializer& _serializer) const override;
 		void Deserialize(ISerializer& _serializer) override;
@@ -34,13 +36,35 @@ namespace cp
 
 		std::vector<MaterialInstanceField> fields; // Fields that are part of this resource
 		std::vector<uint8_t> packedData;
+		uint32_t bindlessOffset = 0; // Byte offset of packedData inside the instance bindless material block
+		std::shared_ptr<cp::Texture> texture; // TextureResource and CombinedImageSampler resources only
+
+		inline bool IsTexture() const { return kind == cp::ShaderResourceKind::TextureResource || kind == cp::ShaderResourceKind::CombinedImageSampler; }
 
 		void Serialize(ISerializer& _serializer) const override;
 		void Deserialize(ISerializer& _serializer) override;
 
-		void CollectFields(const ShaderField& field, const std::string& prefix, std::vector<MaterialInstanceField>& fields) const;
+		void CollectFields(const ShaderField& field, const std::string& prefix, std::vector<MaterialInstanceField>& fields, size_t baseOffset = 0) const;
 
 		void Repack();
+		bool WriteField(size_t _fieldIndex); // Copies one field into packedData without repacking the others
+	};
+
+	class MaterialInstance;
+
+	// GPU side of a material instance, every instance with the same material, keywords and parameters shares one
+	struct SharedMaterialParameters
+	{
+		size_t hash = 0; // 0 once detached for editing, it is then no longer registered for sharing
+		std::vector<uint8_t> data; // Every constant buffer back to back, as laid out in the bindless block
+		std::vector<const cp::Texture*> textures; // Compared along with data, instances only share when they sample the same textures
+		cp::BindlessMaterialBlock bindlessBlock;
+		cp::BindlessManager* bindless = nullptr;
+		std::vector<cp::MaterialInstance*> users; // The first one stands for all of them in instance groups
+
+		SharedMaterialParameters() = default;
+		~SharedMaterialParameters();
+		NO_COPY(SharedMaterialParameters)
 	};
 
 	class MaterialInstance : public ISerializable
@@ -51,10 +75,25 @@ namespace cp
 
 		std::vector<MaterialInstanceResource> resources; // Resources that are part of this material instance
 
+		std::vector<std::string> keywords; // Enabled material keywords, resolved to keywordMask by ValidateData
+		uint32_t keywordMask = 0;
+
+		std::shared_ptr<SharedMaterialParameters> parameters;
+
 		const VulkanContext* context;
 
+		static std::unordered_map<size_t, std::weak_ptr<SharedMaterialParameters>> sharedParameters; // Content hash -> parameters, render thread only
+
+		std::vector<uint8_t> PackParameters(); // Assigns the bindlessOffset of each constant buffer
+		std::vector<const cp::Texture*> CollectTextures() const;
+		size_t HashParameters(const std::vector<uint8_t>& _data, const std::vector<const cp::Texture*>& _textures) const;
+		void ShareParameters(); // Joins the parameters with the same content or uploads new ones, the bindless block is skipped without a BindlessManager
+		void ReleaseParameters();
+		void DetachParameters(); // Copy on write, called before an edit so the instances sharing the old parameters keep them
+		void UploadField(const MaterialInstanceResource& _resource, const MaterialInstanceField& _field); // Updates the field bytes in data, then the bindless block without touching one frames in flight read
+
 	public:
-		MaterialInstance(const VulkanContext* _context);
+		MaterialInstance(const VulkanContext* _context); // Without a context the parameters stay CPU side, they are still shared
 		virtual ~MaterialInstance();
 
 		void Serialize(ISerializer& _serializer) const override;
@@ -64,6 +103,12 @@ namespace cp
 
 		void ValidateData();
 
+		bool SetFieldData(const std::string& _resource, const std::string& _field, const void* _data, size_t _size); // Edits one parameter in place, a shared instance gets its own copy first
+		void CommitField(size_t _resourceIndex, size_t _fieldIndex); // After writing to MaterialInstanceField::data directly, e.g. from an editor widget
+
+		bool SetTexture(const std::string& _resource, const std::shared_ptr<cp::Texture>& _texture);
+		void ReportTextureUsage(float _screenPixels) const; // Once per visible draw, forwards its on-screen size to the TextureStreamer for every streamed texture
+
 #ifdef IN_EDITOR
 		QWidget* CreateMaterialInstanceWidget(QWidget* _parent);
 #endif
@@ -72,6 +117,18 @@ namespace cp
 
 		virtual void BindMaterialInstance(vk::CommandBuffer _command) = 0;*/
 
+		inline uint32_t GetBindlessMaterialIndex() const { return parameters ? parameters->bindlessBlock.GetIndex() : 0; } // BindlessDrawConstants::materialOffset
+		inline bool HasBindlessData() const { return parameters && parameters->bindlessBlock.IsValid(); }
+
+		inline MaterialInstance* GetSharedInstance() { return parameters && !parameters->users.empty() ? parameters->users.front() : this; } // Same pointer for identical instances, group draws by it
+		inline bool IsShared() const { return parameters && parameters->users.size() > 1; }
+
+		const cp::PipelineData* GetPipelineData(const std::string& _rpName); // The material variant matching the enabled keywords, render thread only, resolve it before a ParallelRecorder::Record
+
+		void SetKeywordEnabled(const std::string& _keyword, bool _enabled);
+		inline bool IsKeywordEnabled(const std::string& _keyword) const { return std::find(keywords.begin(), keywords.end(), _keyword) != keywords.end(); }
+		inline constexpr uint32_t GetKeywordMask() const { return keywordMask; }
+
 		inline std::shared_ptr<Material> GetMaterial() const { return material; }
 		inline std::string GetAssociatedMaterial() const { return associatedMaterial; }
 
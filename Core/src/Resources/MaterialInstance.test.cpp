@@ -0,0 +1,181 @@
+#include "pch.hpp"
+#include "MaterialInstance.hpp"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+	// One constant buffer "Surface" holding a single float "roughness", as reflected by Slang
+	cp::ShaderResource MakeSurfaceBuffer()
+	{
+		cp::ShaderField roughness;
+		roughness.name = "roughness";
+		roughness.typeName = "float";
+		roughness.size = sizeof(float);
+		roughness.offset = 0;
+		roughness.alignment = sizeof(float);
+		roughness.stride = sizeof(float);
+
+		cp::ShaderResource buffer;
+		buffer.name = "Surface";
+		buffer.kind = cp::ShaderResourceKind::ConstantBuffer;
+		buffer.binding = 0;
+		buffer.set = 1;
+		buffer.typeName = "Surface";
+		buffer.field.name = "Surface";
+		buffer.field.size = 16;
+		buffer.field.offset = 0;
+		buffer.field.alignment = 16;
+		buffer.field.stride = 16;
+		buffer.field.fields = { roughness };
+
+		return buffer;
+	}
+
+	const cp::ShaderResource SURFACE_BUFFER = MakeSurfaceBuffer();
+
+	// No context, so no bindless block, the sharing and copy on write logic is the same
+	class TestMaterialInstance : public cp::MaterialInstance
+	{
+	public:
+		TestMaterialInstance(const std::string& _material, float _roughness) : cp::MaterialInstance(nullptr)
+		{
+			associatedMaterial = _material;
+
+			cp::MaterialInstanceField field;
+			field.name = "roughness";
+			field.associatedField = &SURFACE_BUFFER.field.fields[0];
+			field.offset = 0;
+			field.data.resize(sizeof(float));
+			std::memcpy(field.data.data(), &_roughness, sizeof(float));
+
+			cp::MaterialInstanceResource resource;
+			resource.name = SURFACE_BUFFER.name;
+			resource.kind = SURFACE_BUFFER.kind;
+			resource.binding = SURFACE_BUFFER.binding;
+			resource.set = SURFACE_BUFFER.set;
+			resource.associatedResource = &SURFACE_BUFFER;
+			resource.fields = { field };
+			resource.Repack();
+
+			resources.push_back(std::move(resource));
+			ShareParameters(); // What ValidateData ends with
+		}
+
+		using cp::MaterialInstance::ShareParameters;
+
+		inline const cp::SharedMaterialParameters* GetParameters() const { return parameters.get(); }
+
+		float GetSharedRoughness() const
+		{
+			float roughness;
+			std::memcpy(&roughness, parameters->data.data() + resources[0].bindlessOffset, sizeof(float));
+			return roughness;
+		}
+	};
+}
+
+TEST(MaterialInstanceSharing, IdenticalInstancesShare)
+{
+	TestMaterialInstance a("Rock.mat", 0.5f);
+	TestMaterialInstance b("Rock.mat", 0.5f);
+
+	EXPECT_EQ(a.GetParameters(), b.GetParameters());
+	EXPECT_TRUE(a.IsShared());
+	EXPECT_EQ(a.GetSharedInstance(), b.GetSharedInstance());
+	EXPECT_EQ(a.GetSharedInstance(), &a); // The first one loaded stands for all of them
+}
+
+TEST(MaterialInstanceSharing, DifferentContentDoesNotShare)
+{
+	TestMaterialInstance a("Rock.mat", 0.5f);
+	TestMaterialInstance b("Rock.mat", 0.75f);
+	TestMaterialInstance c("Moss.mat", 0.5f); // Same bytes, another material
+
+	EXPECT_NE(a.GetParameters(), b.GetParameters());
+	EXPECT_NE(a.GetParameters(), c.GetParameters());
+	EXPECT_FALSE(a.IsShared());
+	EXPECT_NE(a.GetSharedInstance(), b.GetSharedInstance());
+}
+
+TEST(MaterialInstanceSharing, LastUserReleasesTheParameters)
+{
+	{
+		TestMaterialInstance a("Rock.mat", 0.5f);
+		TestMaterialInstance b("Rock.mat", 0.5f);
+		ASSERT_TRUE(a.IsShared());
+	}
+
+	TestMaterialInstance c("Rock.mat", 0.5f);
+	EXPECT_FALSE(c.IsShared()); // Nobody left to share with, the registry entry went with them
+	EXPECT_EQ(c.GetSharedInstance(), &c);
+}
+
+TEST(MaterialInstanceSharing, EditCopiesSharedParameters)
+{
+	TestMaterialInstance a("Rock.mat", 0.5f);
+	TestMaterialInstance b("Rock.mat", 0.5f);
+	const cp::SharedMaterialParameters* shared = a.GetParameters();
+
+	float roughness = 0.9f;
+	ASSERT_TRUE(b.SetFieldData("Surface", "roughness", &roughness, sizeof(float)));
+
+	EXPECT_EQ(a.GetParameters(), shared); // The others keep the old parameters
+	EXPECT_NE(b.GetParameters(), shared);
+	EXPECT_FLOAT_EQ(a.GetSharedRoughness(), 0.5f);
+	EXPECT_FLOAT_EQ(b.GetSharedRoughness(), 0.9f);
+	EXPECT_FALSE(a.IsShared());
+	EXPECT_FALSE(b.IsShared());
+}
+
+TEST(MaterialInstanceSharing, SoleUserEditsInPlace)
+{
+	TestMaterialInstance a("Rock.mat", 0.5f);
+	const cp::SharedMaterialParameters* parameters = a.GetParameters();
+
+	float roughness = 0.9f;
+	ASSERT_TRUE(a.SetFieldData("Surface", "roughness", &roughness, sizeof(float)));
+
+	EXPECT_EQ(a.GetParameters(), parameters);
+	EXPECT_FLOAT_EQ(a.GetSharedRoughness(), 0.9f);
+	EXPECT_EQ(parameters->hash, 0u); // Detached, no longer found by content
+
+	TestMaterialInstance b("Rock.mat", 0.5f); // Old content, must not pick up the edited parameters
+	EXPECT_NE(b.GetParameters(), parameters);
+	EXPECT_FLOAT_EQ(b.GetSharedRoughness(), 0.5f);
+
+	TestMaterialInstance c("Rock.mat", 0.9f); // New content, not shared until a is validated again
+	EXPECT_NE(c.GetParameters(), parameters);
+}
+
+TEST(MaterialInstanceSharing, RevalidationSharesAgain)
+{
+	TestMaterialInstance a("Rock.mat", 0.5f);
+	TestMaterialInstance b("Rock.mat", 0.5f);
+
+	float roughness = 0.9f;
+	ASSERT_TRUE(b.SetFieldData("Surface", "roughness", &roughness, sizeof(float)));
+	TestMaterialInstance c("Rock.mat", 0.9f);
+	EXPECT_NE(b.GetParameters(), c.GetParameters());
+
+	b.ShareParameters();
+	EXPECT_EQ(b.GetParameters(), c.GetParameters());
+	EXPECT_TRUE(c.IsShared());
+
+	roughness = 0.5f;
+	ASSERT_TRUE(b.SetFieldData("Surface", "roughness", &roughness, sizeof(float)));
+	b.ShareParameters();
+	EXPECT_EQ(b.GetParameters(), a.GetParameters());
+	EXPECT_FALSE(c.IsShared());
+}
+
+TEST(MaterialInstanceSharing, UnknownFieldsAreRejected)
+{
+	TestMaterialInstance a("Rock.mat", 0.5f);
+	float roughness = 0.9f;
+	double wide = 0.9;
+
+	EXPECT_FALSE(a.SetFieldData("Surface", "metallic", &roughness, sizeof(float)));
+	EXPECT_FALSE(a.SetFieldData("Surface", "roughness", &wide, sizeof(double)));
+	EXPECT_FLOAT_EQ(a.GetSharedRoughness(), 0.5f);
+}
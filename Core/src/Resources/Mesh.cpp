@@ -1,38 +1,158 @@
 #include "pch.hpp"
 #include "Mesh.hpp"
+#include "CookedMesh.hpp"
+
+#include "../Util/Serializers/JsonSerializer.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <meshoptimizer.h>
+
+namespace
+{
+	cp::MeshBounds ComputeBounds(const std::vector<cp::Vertex>& _vertices)
+	{
+		cp::MeshBounds bounds;
+
+		if (!_vertices.empty())
+		{
+			bounds.min = bounds.max = _vertices[0].position;
+			for (const cp::Vertex& vertex : _vertices)
+			{
+				bounds.min = glm::min(bounds.min, vertex.position);
+				bounds.max = glm::max(bounds.max, vertex.position);
+			}
+		}
+
+		return bounds;
+	}
+
+	// Deduplicates the vertices of every submesh, then reorders its indices for the post-transform cache and overdraw and its vertices for fetch locality
+	void OptimizeSubmeshes(std::vector<cp::Vertex>& _vertices, std::vector<uint32_t>& _indices, std::vector<cp::Submesh>& _submeshes)
+	{
+		std::vector<cp::Vertex> optimizedVertices;
+		std::vector<uint32_t> optimizedIndices;
+		optimizedVertices.reserve(_vertices.size());
+		optimizedIndices.reserve(_indices.size());
+
+		for (cp::Submesh& submesh : _submeshes)
+		{
+			if (submesh.vertexCount == 0 || submesh.indexCount == 0)
+			{
+				submesh = { static_cast<uint32_t>(optimizedIndices.size()), 0, static_cast<int32_t>(optimizedVertices.size()), submesh.materialSlot, 0 };
+				continue;
+			}
+
+			const cp::Vertex* sourceVertices = _vertices.data() + submesh.vertexOffset;
+			const uint32_t* sourceIndices = _indices.data() + submesh.firstIndex;
+
+			std::vector<uint32_t> remap(submesh.vertexCount);
+			size_t vertexCount = meshopt_generateVertexRemap(remap.data(), sourceIndices, submesh.indexCount, sourceVertices, submesh.vertexCount, sizeof(cp::Vertex));
+
+			std::vector<cp::Vertex> vertices(vertexCount);
+			std::vector<uint32_t> indices(submesh.indexCount);
+			meshopt_remapVertexBuffer(vertices.data(), sourceVertices, submesh.vertexCount, sizeof(cp::Vertex), remap.data());
+			meshopt_remapIndexBuffer(indices.data(), sourceIndices, submesh.indexCount, remap.data());
+
+			meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), vertexCount);
+			meshopt_optimizeOverdraw(indices.data(), indices.data(), indices.size(), &vertices[0].position.x, vertexCount, sizeof(cp::Vertex), 1.05f);
+			vertexCount = meshopt_optimizeVertexFetch(vertices.data(), indices.data(), indices.size(), vertices.data(), vertexCount, sizeof(cp::Vertex));
+
+			submesh.firstIndex = static_cast<uint32_t>(optimizedIndices.size());
+			submesh.vertexOffset = static_cast<int32_t>(optimizedVertices.size());
+			submesh.vertexCount = static_cast<uint32_t>(vertexCount);
+
+			optimizedVertices.insert(optimizedVertices.end(), vertices.begin(), vertices.begin() + vertexCount);
+			optimizedIndices.insert(optimizedIndices.end(), indices.begin(), indices.end());
+		}
+
+		_vertices = std::move(optimizedVertices);
+		_indices = std::move(optimizedIndices);
+	}
+
+	// Builds a chain of quadric-simplified LODs per submesh, their indices are appended after every full resolution range and reuse the submesh vertices
+	void GenerateLODs(const std::vector<cp::Vertex>& _vertices, std::vector<uint32_t>& _indices, std::vector<cp::Submesh>& _submeshes, std::vector<cp::MeshLOD>& _lods, uint32_t _lodCount, float _reduction)
+	{
+		std::vector<uint32_t> lodIndices;
+		_lods.clear();
+
+		for (cp::Submesh& submesh : _submeshes)
+		{
+			submesh.firstLOD = static_cast<uint32_t>(_lods.size());
+			_lods.push_back({ submesh.firstIndex, submesh.indexCount, 0.0f });
+
+			if (submesh.indexCount > 0 && submesh.vertexCount > 0)
+			{
+				const float* positions = &_vertices[submesh.vertexOffset].position.x;
+				const float scale = meshopt_simplifyScale(positions, submesh.vertexCount, sizeof(cp::Vertex));
+				const uint32_t* source = _indices.data() + submesh.firstIndex;
+
+				std::vector<uint32_t> simplified(submesh.indexCount);
+				size_t previousCount = submesh.indexCount;
+
+				for (uint32_t level = 1; level < _lodCount; level++)
+				{
+					// Every level is simplified from the full resolution mesh so errors don't accumulate along the chain
+					const size_t targetCount = static_cast<size_t>(submesh.indexCount * std::pow(_reduction, static_cast<float>(level))) / 3 * 3;
+					float error = 0.0f;
+					const size_t count = meshopt_simplify(simplified.data(), source, submesh.indexCount, positions, submesh.vertexCount, sizeof(cp::Vertex), targetCount, 0.05f, 0, &error);
+
+					if (count == 0 || count > previousCount * 9 / 10) break; // The simplifier hit its error limit, more levels would be near duplicates
+
+					meshopt_optimizeVertexCache(simplified.data(), simplified.data(), count, submesh.vertexCount);
+
+					_lods.push_back({ static_cast<uint32_t>(_indices.size() + lodIndices.size()), static_cast<uint32_t>(count), error * scale });
+					lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.begin() + count);
+					previousCount = count;
+				}
+			}
+
+			submesh.lodCount = static_cast<uint32_t>(_lods.size()) - submesh.firstLOD;
+		}
+
+		_indices.insert(_indices.end(), lodIndices.begin(), lodIndices.end());
+	}
+}
+
 cp::Mesh::Mesh(const cp::VulkanContext& _context, const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices)
+	: Mesh(_context, _vertices, _indices, { { 0, static_cast<uint32_t>(_indices.size()), 0, 0, static_cast<uint32_t>(_vertices.size()) } }, { "Default" })
+{
+
+}
+
+cp::Mesh::Mesh(const cp::VulkanContext& _context, const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, const std::vector<Submesh>& _submeshes, const std::vector<std::string>& _materialSlots)
 {
 	this->vertices = _vertices;
 	this->indices = _indices;
 	this->context = &_context;
+	this->indexCount = static_cast<uint32_t>(indices.size());
+	this->submeshes = _submeshes;
+	this->materialSlots = _materialSlots;
+	this->bounds = ComputeBounds(vertices);
 
-	vk::DeviceSize vertexBufferSize = sizeof(Vertex) * vertices.size();
-	vk::DeviceSize indexBufferSize = sizeof(uint32_t) * indices.size();
-
-	vk::Buffer stagingVertexBuffer;
-	vk::DeviceMemory stagingVertexBufferMemory;
-	vk::Buffer stagingIndexBuffer;
-	vk::DeviceMemory stagingIndexBufferMemory;
-
-	stagingVertexBuffer = Helper::Memory::CreateBuffer(_context.GetDevice(), _context.GetPhysicalDevice(), vertexBufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible, stagingVertexBufferMemory);
-	stagingIndexBuffer = Helper::Memory::CreateBuffer(_context.GetDevice(), _context.GetPhysicalDevice(), indexBufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible, stagingIndexBufferMemory);
+	BuildLODTable();
 
-	Helper::Memory::MapMemory(_context.GetDevice(), stagingVertexBufferMemory, vertexBufferSize, vertices.data());
-	Helper::Memory::MapMemory(_context.GetDevice(), stagingIndexBufferMemory, indexBufferSize, indices.data());
+	UploadBuffers(vertices.data(), sizeof(Vertex) * vertices.size(), indices.data(), sizeof(uint32_t) * indices.size());
+}
 
-	vertexBuffer = Helper::Memory::CreateBuffer(_context.GetDevice(), _context.GetPhysicalDevice(), vertexBufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBufferMemory);
-	indexBuffer = Helper::Memory::CreateBuffer(_context.GetDevice(), _context.GetPhysicalDevice(), indexBufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indexBufferMemory);
+cp::Mesh::Mesh(const cp::VulkanContext& _context, VertexFormat _vertexFormat, const void* _vertexData, vk::DeviceSize _vertexDataSize, const void* _indexData, uint32_t _indexCount, vk::IndexType _indexType, const std::vector<Submesh>& _submeshes, const std::vector<MeshLOD>& _lods, const std::vector<std::string>& _materialSlots, const MeshBounds& _bounds)
+{
+	this->context = &_context;
+	this->vertexFormat = _vertexFormat;
+	this->indexCount = _indexCount;
+	this->indexType = _indexType;
+	this->submeshes = _submeshes;
+	this->lods = _lods;
+	this->materialSlots = _materialSlots;
+	this->bounds = _bounds;
 
-	Helper::Memory::CopyBuffer(_context.GetDevice(), _context.GetCommandPool(), _context.GetDevice().getQueue(_context.GetQueueFamilyIndices().graphicsFamily.value(), 0), stagingVertexBuffer, vertexBuffer, vertexBufferSize);
-	Helper::Memory::CopyBuffer(_context.GetDevice(), _context.GetCommandPool(), _context.GetDevice().getQueue(_context.GetQueueFamilyIndices().graphicsFamily.value(), 0), stagingIndexBuffer, indexBuffer, indexBufferSize);
+	BuildLODTable();
 
-	Helper::Memory::DestroyBuffer(_context.GetDevice(), stagingVertexBuffer, stagingVertexBufferMemory);
-	Helper::Memory::DestroyBuffer(_context.GetDevice(), stagingIndexBuffer, stagingIndexBufferMemory);
+	UploadBuffers(_vertexData, _vertexDataSize, _indexData, (_indexType == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t)) * _indexCount);
 }
 
 cp::Mesh::~Mesh()
@@ -42,10 +162,155 @@ cp::Mesh::~Mesh()
 	Helper::Memory::DestroyBuffer(context->GetDevice(), indexBuffer, indexBufferMemory);
 }
 
+void cp::Mesh::BuildLODTable()
+{
+	if (lods.empty()) // Meshes built without LODs only get their full resolution level
+	{
+		for (Submesh& submesh : submeshes)
+		{
+			submesh.firstLOD = static_cast<uint32_t>(lods.size());
+			submesh.lodCount = 1;
+			lods.push_back({ submesh.firstIndex, submesh.indexCount, 0.0f });
+		}
+	}
+
+	uint32_t levelCount = 0;
+	for (const Submesh& submesh : submeshes)
+	{
+		levelCount = std::max(levelCount, submesh.lodCount);
+	}
+
+	lodErrors.assign(levelCount, 0.0f);
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		for (uint32_t i = 0; i < submeshes.size(); i++)
+		{
+			lodErrors[level] = std::max(lodErrors[level], GetSubmeshLOD(i, level).error);
+		}
+	}
+}
+
+uint32_t cp::Mesh::SelectLOD(float _distance, float _projectionScale, float _maxScreenError) const
+{
+	if (lodErrors.size() <= 1) return 0;
+
+	const float distance = std::max(_distance, 1e-4f);
+
+	for (uint32_t lod = GetLODCount() - 1; lod > 0; lod--)
+	{
+		if (lodErrors[lod] * _projectionScale / distance <= _maxScreenError)
+		{
+			return lod;
+		}
+	}
+
+	return 0;
+}
+
+void cp::Mesh::UploadBuffers(const void* _vertexData, vk::DeviceSize _vertexDataSize, const void* _indexData, vk::DeviceSize _indexDataSize)
+{
+	const vk::Device& device = context->GetDevice();
+	const vk::PhysicalDevice& physicalDevice = context->GetPhysicalDevice();
+
+	// Vertices and indices share a single staging buffer and a single submission
+	vk::DeviceMemory stagingBufferMemory;
+	vk::Buffer stagingBuffer = Helper::Memory::CreateBuffer(device, physicalDevice, _vertexDataSize + _indexDataSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible, stagingBufferMemory);
+
+	Helper::Memory::MapMemory(device, stagingBufferMemory, _vertexDataSize, 0, _vertexData);
+	Helper::Memory::MapMemory(device, stagingBufferMemory, _indexDataSize, _vertexDataSize, _indexData);
+
+	vertexBuffer = Helper::Memory::CreateBuffer(device, physicalDevice, _vertexDataSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBufferMemory);
+	indexBuffer = Helper::Memory::CreateBuffer(device, physicalDevice, _indexDataSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indexBufferMemory);
+
+	vk::CommandBuffer commandBuffer = Helper::CommandBuffer::BeginSingleTimeCommands(device, context->GetCommandPool());
+	commandBuffer.copyBuffer(stagingBuffer, vertexBuffer, vk::BufferCopy(0, 0, _vertexDataSize));
+	commandBuffer.copyBuffer(stagingBuffer, indexBuffer, vk::BufferCopy(_vertexDataSize, 0, _indexDataSize));
+	Helper::CommandBuffer::EndSingleTimeCommands(device, context->GetCommandPool(), device.getQueue(context->GetQueueFamilyIndices().graphicsFamily.value(), 0), commandBuffer);
+
+	Helper::Memory::DestroyBuffer(device, stagingBuffer, stagingBufferMemory);
+}
+
+glm::mat4 cp::Mesh::GetDequantizationMatrix() const
+{
+	if (vertexFormat != VertexFormat::CompactQuantized) return glm::mat4(1.0f);
+
+	const glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+	const glm::vec3 extent = glm::max((bounds.max - bounds.min) * 0.5f, glm::vec3(1e-6f)); // Must match the extent used by cp::EncodeVertices
+
+	return glm::scale(glm::translate(glm::mat4(1.0f), center), extent);
+}
+
+std::string cp::MeshImportSettings::GetSettingsPath(const std::string& _sourcePath)
+{
+	return _sourcePath + ".import";
+}
+
+cp::MeshImportSettings cp::MeshImportSettings::Read(const std::string& _sourcePath)
+{
+	MeshImportSettings settings;
+
+	const std::string settingsPath = GetSettingsPath(_sourcePath);
+	std::error_code error;
+	if (!std::filesystem::exists(settingsPath, error)) return settings;
+
+	try
+	{
+		cp::JsonSerializer serializer;
+		serializer.Read(settingsPath);
+
+		settings.vertexFormat = static_cast<VertexFormat>(serializer.ReadInt("Vertex Format", static_cast<int>(settings.vertexFormat)));
+		settings.optimize = serializer.ReadBool("Optimize", settings.optimize);
+		settings.lodCount = static_cast<uint32_t>(std::max(serializer.ReadInt("LOD Count", static_cast<int>(settings.lodCount)), 1));
+		settings.lodReduction = serializer.ReadFloat("LOD Reduction", settings.lodReduction);
+	}
+	catch (const std::exception& e)
+	{
+		LOG_WARNING(MF("Invalid mesh import settings [", settingsPath, "], using the defaults : ", e.what()));
+		return MeshImportSettings();
+	}
+
+	return settings;
+}
+
+void cp::MeshImportSettings::Write(const std::string& _sourcePath) const
+{
+	cp::JsonSerializer serializer;
+	serializer.WriteInt("Vertex Format", static_cast<int>(vertexFormat));
+	serializer.WriteBool("Optimize", optimize);
+	serializer.WriteInt("LOD Count", static_cast<int>(lodCount));
+	serializer.WriteFloat("LOD Reduction", lodReduction);
+	serializer.Write(GetSettingsPath(_sourcePath));
+}
+
 std::shared_ptr<cp::Mesh> cp::Mesh::LoadMesh(const cp::VulkanContext& _context, const std::string& _path)
 {
+	return LoadMeshWithSettings(_context, _path, MeshImportSettings::Read(_path));
+}
+
+std::shared_ptr<cp::Mesh> cp::Mesh::LoadMeshWithSettings(const cp::VulkanContext& _context, const std::string& _path, const MeshImportSettings& _settings)
+{
+	const std::string cookedPath = cp::CookedMesh::GetCookedPath(_path);
+
+	// Edited settings re-cook the mesh, a missing settings file counts as up to date
+	if (cp::CookedMesh::IsUpToDate(_path, cookedPath) && cp::CookedMesh::IsUpToDate(MeshImportSettings::GetSettingsPath(_path), cookedPath))
+	{
+		cp::CookedMesh::View view;
+
+		if (cp::CookedMesh::Open(cookedPath, view) && view.header->vertexFormat == static_cast<uint32_t>(_settings.vertexFormat) && (view.header->indexSize == sizeof(uint16_t) || view.header->indexSize == sizeof(uint32_t)))
+		{
+			const cp::CookedMesh::Header& header = *view.header;
+			std::vector<Submesh> submeshes(view.submeshes, view.submeshes + header.submeshCount);
+			std::vector<MeshLOD> lods(view.lods, view.lods + header.lodCount);
+
+			LOG_INFO(MF("Loaded cooked mesh: ", cookedPath, " with ", header.vertexCount, " vertices, ", header.indexCount, " indexes and ", header.submeshCount, " submeshes"));
+
+			return std::make_shared<cp::Mesh>(_context, _settings.vertexFormat, view.vertexData, static_cast<vk::DeviceSize>(header.vertexStride) * header.vertexCount, view.indexData, header.indexCount, header.indexSize == sizeof(uint16_t) ? vk::IndexType::eUint16 : vk::IndexType::eUint32, submeshes, lods, view.materialSlots, header.bounds);
+		}
+	}
+
+	// The cooked mesh is missing, stale or unreadable: import the source through Assimp and cook it for the next load
 	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(_path, aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_FlipUVs);
+	const aiScene* scene = importer.ReadFile(_path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace | aiProcess_FlipUVs);
 
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 	{
@@ -54,41 +319,125 @@ std::shared_ptr<cp::Mesh> cp::Mesh::LoadMesh(const cp::VulkanContext& _context,
 		return nullptr;
 	}
 
-	aiMesh* mesh = scene->mMeshes[0];
-
 	std::vector<cp::Vertex> vertices;
 	std::vector<uint32_t> indexes;
+	std::vector<cp::Submesh> submeshes;
+	std::vector<std::string> materialSlots;
+
+	materialSlots.reserve(scene->mNumMaterials);
+	for (uint32_t i = 0; i < scene->mNumMaterials; i++)
+	{
+		materialSlots.push_back(scene->mMaterials[i]->GetName().C_Str());
+	}
+
+	if (materialSlots.empty())
+	{
+		materialSlots.push_back("Default");
+	}
 
-	for (uint32_t i = 0; i < mesh->mNumVertices; i++)
+	// Every mesh referenced by a node becomes a submesh, with the node hierarchy transform baked into its vertices
+	std::function<void(const aiNode*, const aiMatrix4x4&)> processNode = [&](const aiNode* _node, const aiMatrix4x4& _parentTransform)
 	{
-		cp::Vertex vertex;
-		vertex.position = { mesh->mVertices[i].x, -mesh->mVertices[i].y, -mesh->mVertices[i].z };
-		vertex.normal = { mesh->mNormals[i].x, -mesh->mNormals[i].y, -mesh->mNormals[i].z };
-		vertex.tangent = { mesh->mTangents[i].x, -mesh->mTangents[i].y, -mesh->mTangents[i].z };
-		vertex.bitangent = { mesh->mBitangents[i].x, -mesh->mBitangents[i].y, -mesh->mBitangents[i].z };
+		const aiMatrix4x4 transform = _parentTransform * _node->mTransformation;
+
+		const aiMatrix3x3 linearTransform = aiMatrix3x3(transform);
+		aiMatrix3x3 normalTransform = linearTransform;
+		normalTransform.Inverse().Transpose();
 
-		if (mesh->mTextureCoords[0])
+		for (uint32_t m = 0; m < _node->mNumMeshes; m++)
 		{
-			vertex.uv = { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
+			const aiMesh* mesh = scene->mMeshes[_node->mMeshes[m]];
+
+			cp::Submesh submesh;
+			submesh.firstIndex = static_cast<uint32_t>(indexes.size());
+			submesh.vertexOffset = static_cast<int32_t>(vertices.size());
+			submesh.materialSlot = std::min(mesh->mMaterialIndex, static_cast<uint32_t>(materialSlots.size() - 1));
+			submesh.vertexCount = mesh->mNumVertices;
+
+			vertices.resize(vertices.size() + mesh->mNumVertices);
+
+			for (uint32_t i = 0; i < mesh->mNumVertices; i++)
+			{
+				const aiVector3D position = transform * mesh->mVertices[i];
+				const aiVector3D normal = mesh->HasNormals() ? (normalTransform * mesh->mNormals[i]).Normalize() : aiVector3D(0.0f, 1.0f, 0.0f);
+				const aiVector3D tangent = mesh->HasTangentsAndBitangents() ? (linearTransform * mesh->mTangents[i]).Normalize() : aiVector3D(1.0f, 0.0f, 0.0f);
+				const aiVector3D bitangent = mesh->HasTangentsAndBitangents() ? (linearTransform * mesh->mBitangents[i]).Normalize() : aiVector3D(0.0f, 0.0f, 1.0f);
+
+				cp::Vertex& vertex = vertices[submesh.vertexOffset + i];
+				vertex.position = { position.x, -position.y, -position.z };
+				vertex.normal = { normal.x, -normal.y, -normal.z };
+				vertex.tangent = { tangent.x, -tangent.y, -tangent.z };
+				vertex.bitangent = { bitangent.x, -bitangent.y, -bitangent.z };
+
+				if (mesh->mTextureCoords[0])
+				{
+					vertex.uv = { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
+				}
+				else
+				{
+					vertex.uv = { 0.0f, 0.0f };
+				}
+			}
+
+			indexes.reserve(indexes.size() + static_cast<size_t>(mesh->mNumFaces) * 3);
+			for (uint32_t i = 0; i < mesh->mNumFaces; i++)
+			{
+				const aiFace& face = mesh->mFaces[i];
+				indexes.insert(indexes.end(), face.mIndices, face.mIndices + face.mNumIndices);
+			}
+
+			submesh.indexCount = static_cast<uint32_t>(indexes.size()) - submesh.firstIndex;
+			submeshes.push_back(submesh);
 		}
-		else
+
+		for (uint32_t c = 0; c < _node->mNumChildren; c++)
 		{
-			vertex.uv = { 0.0f, 0.0f };
+			processNode(_node->mChildren[c], transform);
 		}
+	};
+
+	processNode(scene->mRootNode, aiMatrix4x4());
 
-		vertices.push_back(vertex);
+	if (submeshes.empty())
+	{
+		LOG_ERROR("Model contains no meshes: " + _path);
+		throw std::runtime_error("Model contains no meshes: " + _path);
+		return nullptr;
 	}
 
-	for (uint32_t i = 0; i < mesh->mNumFaces; i++)
+	if (_settings.optimize)
 	{
-		aiFace face = mesh->mFaces[i];
-		for (uint32_t j = 0; j < face.mNumIndices; j++)
-		{
-			indexes.push_back(face.mIndices[j]);
-		}
+		OptimizeSubmeshes(vertices, indexes, submeshes);
+	}
+
+	std::vector<cp::MeshLOD> lods;
+	GenerateLODs(vertices, indexes, submeshes, lods, std::max(_settings.lodCount, 1u), _settings.lodReduction);
+
+	LOG_INFO("Loaded mesh: " + _path + " with " + std::to_string(vertices.size()) + " vertices, " + std::to_string(indexes.size()) + " indexes and " + std::to_string(submeshes.size()) + " submeshes");
+
+	const cp::MeshBounds bounds = ComputeBounds(vertices);
+	const std::vector<uint8_t> vertexData = cp::EncodeVertices(_settings.vertexFormat, vertices, bounds);
+
+	// Indices are relative to their submesh vertexOffset, so 16-bit indices only require every submesh to stay under 65536 vertices
+	const bool useShortIndices = std::all_of(submeshes.begin(), submeshes.end(), [](const cp::Submesh& _submesh) { return _submesh.vertexCount < 65536; });
+	const vk::IndexType indexType = useShortIndices ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+	const uint32_t indexSize = useShortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	std::vector<uint16_t> shortIndexes;
+	if (useShortIndices)
+	{
+		shortIndexes.assign(indexes.begin(), indexes.end());
 	}
 
-	LOG_INFO("Loaded mesh: " + _path + " with " + std::to_string(vertices.size()) + " vertices and " + std::to_string(indexes.size()) + " indexes");
+	const void* indexData = useShortIndices ? static_cast<const void*>(shortIndexes.data()) : static_cast<const void*>(indexes.data());
+	const uint32_t indexCount = static_cast<uint32_t>(indexes.size());
+
+	std::shared_ptr<cp::Mesh> loadedMesh = std::make_shared<cp::Mesh>(_context, _settings.vertexFormat, vertexData.data(), vertexData.size(), indexData, indexCount, indexType, submeshes, lods, materialSlots, bounds);
+
+	if (cp::CookedMesh::Write(cookedPath, _settings.vertexFormat, static_cast<uint32_t>(vertices.size()), vertexData.data(), indexSize, indexCount, indexData, submeshes, lods, materialSlots, bounds))
+	{
+		LOG_INFO(MF("Cooked mesh: ", cookedPath));
+	}
 
-	return std::make_shared<cp::Mesh>(_context, vertices, indexes);
+	return loadedMesh;
 }
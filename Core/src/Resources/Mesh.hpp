@@ -2,6 +2,7 @@
 
 #include "../pch.hpp"
 #include "../Context/VulkanContext.hpp"
+#include "VertexFormat.hpp"
 
 namespace cp
 {
@@ -14,11 +15,57 @@ namespace cp
 		glm::vec3 bitangent;
 	};
 
+	struct MeshBounds
+	{
+		glm::vec3 min = glm::vec3(0.0f);
+		glm::vec3 max = glm::vec3(0.0f);
+	};
+
+	struct Submesh
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		int32_t vertexOffset = 0;
+		uint32_t materialSlot = 0;
+		uint32_t vertexCount = 0;
+		uint32_t firstLOD = 0; // Index into the mesh LOD table, the first entry is the full resolution range above
+		uint32_t lodCount = 1;
+	};
+
+	struct MeshLOD
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		float error = 0.0f; // Simplification error in mesh units, LODs are selected from its projected size
+	};
+
+	// Per asset, stored next to the source as <source>.import, editing it re-cooks the mesh on the next load
+	struct MeshImportSettings
+	{
+		VertexFormat vertexFormat = VertexFormat::Standard; // Must match the vertexFormat of the materials drawing the mesh
+		bool optimize = true; // Vertex dedup, vertex cache / overdraw / vertex fetch reordering
+		uint32_t lodCount = 4; // Including the full resolution level, 1 disables LOD generation
+		float lodReduction = 0.5f; // Triangle ratio between two consecutive LODs
+
+		static std::string GetSettingsPath(const std::string& _sourcePath);
+		static MeshImportSettings Read(const std::string& _sourcePath); // Defaults when the asset has no settings file
+		void Write(const std::string& _sourcePath) const;
+	};
+
 	class Mesh
 	{
 	protected:
 		std::vector<Vertex> vertices;
-		std::vector<uint32_t> indices;
+		std::vector<uint32_t> indices; // CPU copies are only kept when the mesh is built from vectors, cooked meshes upload straight from the mapped file
+
+		std::vector<Submesh> submeshes; // Every submesh lives in the shared vertex/index buffers, indices are relative to its vertexOffset
+		std::vector<std::string> materialSlots;
+		std::vector<MeshLOD> lods;
+		std::vector<float> lodErrors; // Worst error of every LOD level across all submeshes
+		MeshBounds bounds;
+		uint32_t indexCount = 0;
+		vk::IndexType indexType = vk::IndexType::eUint32;
+		VertexFormat vertexFormat = VertexFormat::Standard;
 
 		vk::Buffer vertexBuffer;
 		vk::DeviceMemory vertexBufferMemory;
@@ -29,11 +76,29 @@ namespace cp
 
 	public:
 		Mesh(const cp::VulkanContext& _context, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		Mesh(const cp::VulkanContext& _context, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<Submesh>& _submeshes, const std::vector<std::string>& _materialSlots);
+		Mesh(const cp::VulkanContext& _context, VertexFormat _vertexFormat, const void* _vertexData, vk::DeviceSize _vertexDataSize, const void* _indexData, uint32_t _indexCount, vk::IndexType _indexType, const std::vector<Submesh>& _submeshes, const std::vector<MeshLOD>& _lods, const std::vector<std::string>& _materialSlots, const MeshBounds& _bounds);
 		~Mesh();
 
 		inline constexpr const std::vector<Vertex>& GetVertices() const { return vertices; }
 		inline constexpr const std::vector<uint32_t>& GetIndices() const { return indices; }
-		inline constexpr const uint32_t GetIndexCount() const { return static_cast<const uint32_t>(indices.size()); }
+		inline constexpr const uint32_t GetIndexCount() const { return indexCount; }
+		inline constexpr vk::IndexType GetIndexType() const { return indexType; } // eUint16 when every submesh has less than 65536 vertices
+		inline constexpr const std::vector<Submesh>& GetSubmeshes() const { return submeshes; }
+		inline constexpr const Submesh& GetSubmesh(uint32_t _index) const { return submeshes[_index]; }
+		inline constexpr const std::vector<MeshLOD>& GetLODs() const { return lods; }
+		inline constexpr uint32_t GetLODCount() const { return static_cast<uint32_t>(lodErrors.size()); }
+		inline constexpr const MeshLOD& GetSubmeshLOD(uint32_t _submesh, uint32_t _lod) const { return lods[submeshes[_submesh].firstLOD + std::min(_lod, submeshes[_submesh].lodCount - 1)]; }
+		inline constexpr const std::vector<std::string>& GetMaterialSlots() const { return materialSlots; }
+		inline constexpr uint32_t GetMaterialSlotCount() const { return static_cast<uint32_t>(materialSlots.size()); }
+		inline constexpr const MeshBounds& GetBounds() const { return bounds; }
+		inline constexpr VertexFormat GetVertexFormat() const { return vertexFormat; }
+
+		glm::mat4 GetDequantizationMatrix() const; // Must be applied before the model matrix when the mesh uses VertexFormat::CompactQuantized, identity otherwise
+
+		// Returns the coarsest LOD whose error stays under _maxScreenError (fraction of the screen height)
+		// _distance is in mesh units (divide by the instance scale), _projectionScale is Camera::GetLODProjectionScale()
+		uint32_t SelectLOD(float _distance, float _projectionScale, float _maxScreenError = 0.001f) const;
 
 		inline constexpr vk::Buffer GetVertexBuffer() const { return vertexBuffer; }
 		inline constexpr vk::Buffer& GetVertexBuffer() { return vertexBuffer; }
@@ -41,6 +106,11 @@ namespace cp
 		inline constexpr vk::Buffer GetIndexBuffer() const { return indexBuffer; }
 		inline constexpr vk::DeviceMemory GetIndexBufferMemory() const { return indexBufferMemory; }
 
-		static std::shared_ptr<Mesh> LoadMesh(const cp::VulkanContext& _context, const std::string& _path);
+		static std::shared_ptr<Mesh> LoadMesh(const cp::VulkanContext& _context, const std::string& _path); // Loads the cooked version of the mesh with the asset import settings, cooking it first if it is missing or older than the source or its settings
+		static std::shared_ptr<Mesh> LoadMeshWithSettings(const cp::VulkanContext& _context, const std::string& _path, const MeshImportSettings& _settings);
+
+	private:
+		void BuildLODTable();
+		void UploadBuffers(const void* _vertexData, vk::DeviceSize _vertexDataSize, const void* _indexData, vk::DeviceSize _indexDataSize);
 	};
 }
\ No newline at end of file
@@ -49,6 +49,19 @@ namespace cp
 			return it->second;
 		}
 
+		std::vector<std::shared_ptr<T>> GetResources() const
+		{
+			std::vector<std::shared_ptr<T>> all;
+			all.reserve(resources.size());
+
+			for (const auto& resource : resources)
+			{
+				all.push_back(resource.second);
+			}
+
+			return all;
+		}
+
 		T* GetRawResource(const std::string& name)
 		{
 			auto it = resources.find(name);
@@ -238,6 +251,19 @@ namespace cp
 			return resourceType->GetResource(name);
 		}
 
+		template<class T>
+		std::vector<std::shared_ptr<T>> GetAll()
+		{
+			ResourceType<T>* resourceType = GetResourceType<T>();
+			if (!resourceType)
+			{
+				throw std::runtime_error("Resource type not found");
+				return {};
+			}
+
+			return resourceType->GetResources();
+		}
+
 		template<class T>
 		std::shared_ptr<T> GetOrLoad(const std::string& _name, const std::string& _path = "")
 		{
@@ -1,51 +1,329 @@
 #include "pch.hpp"
 
 #include "Texture.hpp"
+#include "TextureStreamer.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+cp::TextureImportSettings cp::Texture::defaultImportSettings;
+
+namespace
+{
+	vk::BufferImageCopy MakeRegion(vk::DeviceSize _offset, uint32_t _mipLevel, uint32_t _width, uint32_t _height)
+	{
+		vk::BufferImageCopy region;
+		region.bufferOffset = _offset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		region.imageSubresource.mipLevel = _mipLevel;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = vk::Offset3D(0, 0, 0);
+		region.imageExtent = vk::Extent3D(_width, _height, 1);
+		return region;
+	}
+
+	cp::TextureCompression ResolveCompression(const cp::VulkanContext& _context, const std::string& _path, cp::TextureCompression _compression)
+	{
+		if (_compression != cp::TextureCompression::None && !_context.SupportsBlockCompression())
+		{
+			LOG_WARNING(MF("Block compressed formats are not supported by the device, texture: ", _path, " is loaded uncompressed"));
+			return cp::TextureCompression::None;
+		}
+
+		return _compression;
+	}
+
+	bool MatchesSettings(const cp::CookedTexture::Header& _header, cp::TextureCompression _compression, const cp::TextureImportSettings& _settings)
+	{
+		const uint32_t expectedMips = _settings.generateMips ? cp::TextureEncoder::GetMipCount(_header.width, _header.height) : 1;
+		return _header.compression == static_cast<uint32_t>(_compression) && (_header.srgb != 0) == _settings.srgb && _header.mipCount == expectedMips;
+	}
+
+	// Decodes the source image, builds its mip chain and encodes every level, the cooked file is written next to the source
+	bool CookTexture(const std::string& _path, const std::string& _cookedPath, cp::TextureCompression _compression, const cp::TextureImportSettings& _settings, std::vector<cp::TextureLevel>& _levels, int& _channels)
+	{
+		int width, height;
+		stbi_uc* pixels = stbi_load(_path.c_str(), &width, &height, &_channels, STBI_rgb_alpha);
+
+		if (!pixels)
+		{
+			LOG_ERROR("Failed to load texture image: " + _path);
+			return false;
+		}
+
+		if (_settings.generateMips)
+		{
+			_levels = cp::TextureEncoder::GenerateMipChain(pixels, width, height, _settings.srgb);
+		}
+		else
+		{
+			_levels.clear();
+			_levels.push_back({ static_cast<uint32_t>(width), static_cast<uint32_t>(height), std::vector<uint8_t>(pixels, pixels + static_cast<size_t>(width) * height * 4) });
+		}
+
+		stbi_image_free(pixels);
+
+		for (cp::TextureLevel& level : _levels)
+		{
+			level.data = cp::TextureEncoder::Compress(_compression, level);
+		}
+
+		return cp::CookedTexture::Write(_cookedPath, _compression, _settings.srgb, _levels);
+	}
+}
+
 cp::Texture::~Texture()
 {
 	auto device = context->GetDevice();
 
-	device.destroySampler(sampler);
+	if (cp::BindlessManager* bindless = context->GetBindlessManager())
+	{
+		bindless->ReleaseTexture(bindlessIndex);
+		bindless->ReleaseSampler(bindlessSamplerIndex);
+	}
+
 	device.destroyImageView(imageView);
 	device.freeMemory(imageMemory);
 	device.destroyImage(image);
 }
 
+void cp::Texture::Upload(const void* _data, vk::DeviceSize _dataSize, const std::vector<vk::BufferImageCopy>& _regions, bool _generateMips)
+{
+	const vk::Device device = context->GetDevice();
+	const vk::PhysicalDevice physicalDevice = context->GetPhysicalDevice();
+	const vk::Queue queue = device.getQueue(context->GetQueueFamilyIndices().graphicsFamily.value(), 0);
+
+	// Streaming textures only allocate the resident part of their chain
+	const uint32_t imageWidth = std::max(static_cast<uint32_t>(width) >> residentMip, 1u);
+	const uint32_t imageHeight = std::max(static_cast<uint32_t>(height) >> residentMip, 1u);
+	const uint32_t imageLevels = mipLevels - residentMip;
+
+	vk::Buffer buffer;
+	vk::DeviceMemory bufferMemory;
+	buffer = Helper::Memory::CreateBuffer(device, physicalDevice, _dataSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, bufferMemory);
+	Helper::Memory::MapMemory(device, bufferMemory, _dataSize, _data);
+
+	vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+	if (_generateMips || streamingSource) usage |= vk::ImageUsageFlagBits::eTransferSrc; // Blit source for the next level, or copy source when the streamer reallocates
+
+	Helper::Image::CreateImage(device, physicalDevice, imageWidth, imageHeight, format, vk::ImageTiling::eOptimal, usage, vk::MemoryPropertyFlagBits::eDeviceLocal, image, imageMemory, imageLevels);
+	Helper::Image::TransitionImageLayout(device, context->GetCommandPool(), queue, image, format, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, imageLevels);
+
+	vk::CommandBuffer commandBuffer = Helper::CommandBuffer::BeginSingleTimeCommands(device, context->GetCommandPool());
+	commandBuffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, static_cast<uint32_t>(_regions.size()), _regions.data());
+	Helper::CommandBuffer::EndSingleTimeCommands(device, context->GetCommandPool(), queue, commandBuffer);
+
+	if (_generateMips)
+	{
+		Helper::Image::GenerateMipmaps(device, physicalDevice, context->GetCommandPool(), queue, image, format, imageWidth, imageHeight, imageLevels);
+	}
+	else
+	{
+		Helper::Image::TransitionImageLayout(device, context->GetCommandPool(), queue, image, format, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, imageLevels);
+	}
+
+	Helper::Memory::DestroyBuffer(device, buffer, bufferMemory);
+
+	Helper::Image::CreateImageView(device, image, format, vk::ImageAspectFlagBits::eColor, imageView, imageLevels);
+	samplerDescription = cp::SamplerDescription::ForTexture(mipLevels);
+	RefreshSampler();
+}
+
+void cp::Texture::RefreshSampler()
+{
+	cp::SamplerDescription description = samplerDescription;
+
+	// The image starts at the resident mip, levels between it and the uploaded mip are not filled yet
+	if (streamingSource)
+	{
+		description.minLod = std::max(description.minLod, static_cast<float>(uploadedMip - residentMip));
+	}
+
+	sampler = context->GetSamplerCache()->GetOrCreateSampler(description);
+
+	// A new view or sampler moves the texture to new bindless slots, frames in flight keep reading the old ones until they are recycled
+	if (cp::BindlessManager* bindless = context->GetBindlessManager())
+	{
+		if (bindlessIndex == cp::BindlessManager::INVALID_INDEX)
+			bindlessIndex = bindless->RegisterTexture(imageView);
+		else if (bindlessView != imageView)
+			bindlessIndex = bindless->ReplaceTexture(bindlessIndex, imageView);
+		bindlessView = imageView;
+
+		if (bindlessSampler != sampler)
+		{
+			uint32_t samplerIndex = bindless->RegisterSampler(sampler); // Before releasing the old one, so a shared sampler keeps its slot
+			bindless->ReleaseSampler(bindlessSamplerIndex);
+			bindlessSamplerIndex = samplerIndex;
+			bindlessSampler = sampler;
+		}
+	}
+}
+
+void cp::Texture::SetSamplerDescription(const cp::SamplerDescription& _description)
+{
+	samplerDescription = _description;
+	RefreshSampler();
+}
+
 std::shared_ptr<cp::Texture> cp::Texture::LoadTexture(const cp::VulkanContext& _context, const std::string& _path)
 {
+	return LoadTextureWithSettings(_context, _path, defaultImportSettings);
+}
+
+std::shared_ptr<cp::Texture> cp::Texture::LoadTextureWithSettings(const cp::VulkanContext& _context, const std::string& _path, const TextureImportSettings& _settings)
+{
+	if (_settings.stream)
+	{
+		return LoadStreamingTexture(_context, _path, _settings);
+	}
+
 	std::shared_ptr<Texture> texture = std::make_shared<Texture>(&_context);
-	stbi_uc* pixels = stbi_load(_path.c_str(), &texture->width, &texture->height, &texture->channels, STBI_rgb_alpha);
 
-	if (!pixels)
+	const TextureCompression compression = ResolveCompression(_context, _path, _settings.compression);
+	const std::string cookedPath = cp::CookedTexture::GetCookedPath(_path);
+
+	if (_settings.cook && cp::CookedTexture::IsUpToDate(_path, cookedPath))
+	{
+		cp::CookedTexture::View view;
+
+		if (cp::CookedTexture::Open(cookedPath, view) && MatchesSettings(*view.header, compression, _settings))
+		{
+			const cp::CookedTexture::Header& header = *view.header;
+
+			texture->width = static_cast<int>(header.width);
+			texture->height = static_cast<int>(header.height);
+			texture->channels = 4;
+			texture->mipLevels = header.mipCount;
+			texture->format = static_cast<vk::Format>(header.format);
+
+			std::vector<vk::BufferImageCopy> regions(header.mipCount);
+			for (uint32_t i = 0; i < header.mipCount; i++)
+			{
+				regions[i] = MakeRegion(view.levels[i].offset - view.levels[0].offset, i, view.levels[i].width, view.levels[i].height);
+			}
+
+			texture->Upload(view.data, view.dataSize, regions, false);
+
+			LOG_INFO(MF("Cooked texture: ", cookedPath, " loaded (", texture->width, "x", texture->height, ", ", texture->mipLevels, " mips)"));
+
+			return texture;
+		}
+	}
+
+	if (!_settings.cook)
+	{
+		stbi_uc* pixels = stbi_load(_path.c_str(), &texture->width, &texture->height, &texture->channels, STBI_rgb_alpha);
+
+		if (!pixels)
+		{
+			LOG_ERROR("Failed to load texture image: " + _path);
+			return nullptr;
+		}
+
+		const uint32_t width = static_cast<uint32_t>(texture->width);
+		const uint32_t height = static_cast<uint32_t>(texture->height);
+
+		// Uncooked fallback : upload the base level and let the GPU blit the rest of the chain
+		texture->format = TextureEncoder::GetFormat(TextureCompression::None, _settings.srgb);
+		texture->mipLevels = _settings.generateMips ? TextureEncoder::GetMipCount(width, height) : 1;
+
+		texture->Upload(pixels, static_cast<vk::DeviceSize>(width) * height * 4, { MakeRegion(0, 0, width, height) }, texture->mipLevels > 1);
+		stbi_image_free(pixels);
+
+		LOG_INFO(MF("Texture: ", _path, " loaded (", texture->width, "x", texture->height, ")"));
+
+		return texture;
+	}
+
+	std::vector<TextureLevel> levels;
+	if (!CookTexture(_path, cookedPath, compression, _settings, levels, texture->channels) && levels.empty())
 	{
-		LOG_ERROR("Failed to load texture image: " + _path);
 		return nullptr;
 	}
 
-	vk::DeviceSize imageSize = texture->width * texture->height * 4;
+	texture->width = static_cast<int>(levels[0].width);
+	texture->height = static_cast<int>(levels[0].height);
 
-	vk::Buffer buffer;
-	vk::DeviceMemory bufferMemory;
-	buffer = Helper::Memory::CreateBuffer(_context.GetDevice(), _context.GetPhysicalDevice(), imageSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, bufferMemory);
-	Helper::Memory::MapMemory(_context.GetDevice(), bufferMemory, imageSize, (void*)pixels);
+	// Same layout as the cooked file, so fresh imports go through the exact same upload path
+	std::vector<uint8_t> data;
+	std::vector<vk::BufferImageCopy> regions(levels.size());
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		data.resize((data.size() + cp::CookedTexture::ALIGNMENT - 1) & ~(cp::CookedTexture::ALIGNMENT - 1));
+		regions[i] = MakeRegion(data.size(), static_cast<uint32_t>(i), levels[i].width, levels[i].height);
+		data.insert(data.end(), levels[i].data.begin(), levels[i].data.end());
+	}
+
+	texture->format = TextureEncoder::GetFormat(compression, _settings.srgb);
+	texture->mipLevels = static_cast<uint32_t>(levels.size());
+	texture->Upload(data.data(), data.size(), regions, false);
+
+	LOG_INFO(MF("Texture: ", _path, " imported and cooked (", texture->width, "x", texture->height, ", ", texture->mipLevels, " mips)"));
+
+	return texture;
+}
+
+std::shared_ptr<cp::Texture> cp::Texture::LoadStreamingTexture(const cp::VulkanContext& _context, const std::string& _path, const TextureImportSettings& _settings)
+{
+	TextureImportSettings settings = _settings;
+	settings.stream = false;
+	settings.cook = true;
+	settings.generateMips = true;
 
-	stbi_image_free(pixels);
+	cp::TextureStreamer* streamer = cp::TextureStreamer::Get();
+	if (!streamer)
+	{
+		LOG_WARNING(MF("Texture streamer was not created, texture: ", _path, " is fully loaded"));
+		return LoadTextureWithSettings(_context, _path, settings);
+	}
+
+	const TextureCompression compression = ResolveCompression(_context, _path, settings.compression);
+	const std::string cookedPath = cp::CookedTexture::GetCookedPath(_path);
+
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>(&_context);
+	std::unique_ptr<cp::CookedTexture::View> view = std::make_unique<cp::CookedTexture::View>();
+
+	texture->channels = 4;
+	if (!cp::CookedTexture::IsUpToDate(_path, cookedPath) || !cp::CookedTexture::Open(cookedPath, *view) || !MatchesSettings(*view->header, compression, settings))
+	{
+		// Streaming reads every level straight from the cooked file, so it has to exist before anything is uploaded
+		view->file.Close();
 
-	Helper::Image::CreateImage(_context.GetDevice(), _context.GetPhysicalDevice(), texture->width, texture->height, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, texture->image, texture->imageMemory);
-	Helper::Image::TransitionImageLayout(_context.GetDevice(), _context.GetCommandPool(), _context.GetDevice().getQueue(_context.GetQueueFamilyIndices().graphicsFamily.value(), 0), texture->image, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-	Helper::Image::CopyBufferToImage(_context.GetDevice(), _context.GetCommandPool(), _context.GetDevice().getQueue(_context.GetQueueFamilyIndices().graphicsFamily.value(), 0), buffer, texture->image, texture->width, texture->height);
-	Helper::Image::TransitionImageLayout(_context.GetDevice(), _context.GetCommandPool(), _context.GetDevice().getQueue(_context.GetQueueFamilyIndices().graphicsFamily.value(), 0), texture->image, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+		std::vector<TextureLevel> levels;
+		if (!CookTexture(_path, cookedPath, compression, settings, levels, texture->channels) || !cp::CookedTexture::Open(cookedPath, *view))
+		{
+			LOG_ERROR(MF("Failed to cook streaming texture: ", _path));
+			return nullptr;
+		}
+	}
+
+	const cp::CookedTexture::Header& header = *view->header;
+
+	texture->width = static_cast<int>(header.width);
+	texture->height = static_cast<int>(header.height);
+	texture->mipLevels = header.mipCount;
+	texture->format = static_cast<vk::Format>(header.format);
+	texture->residentMip = streamer->GetTailMip(header.mipCount);
+	texture->uploadedMip = texture->residentMip;
+
+	// Only the mip tail is uploaded now, the streamer brings in finer levels once the renderer reports the texture as visible
+	const cp::CookedTexture::Level* tail = view->levels + texture->residentMip;
+	std::vector<vk::BufferImageCopy> regions(header.mipCount - texture->residentMip);
+	for (uint32_t i = texture->residentMip; i < header.mipCount; i++)
+	{
+		regions[i - texture->residentMip] = MakeRegion(view->levels[i].offset - tail->offset, i - texture->residentMip, view->levels[i].width, view->levels[i].height);
+	}
 
-	Helper::Memory::DestroyBuffer(_context.GetDevice(), buffer, bufferMemory);
+	texture->streamingSource = std::move(view);
+	texture->Upload(texture->streamingSource->file.As<uint8_t>(tail->offset), header.fileSize - tail->offset, regions, false);
 
-	Helper::Image::CreateImageView(_context.GetDevice(), texture->image, vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor, texture->imageView);
-	Helper::Image::CreateSampler(_context.GetDevice(), _context.GetPhysicalDevice(), texture->sampler);
+	streamer->Register(texture);
 
-	LOG_INFO(MF("Texture: ", _path, " loaded (", texture->width, "x", texture->height, ")"));
+	LOG_INFO(MF("Streaming texture: ", cookedPath, " loaded (", texture->width, "x", texture->height, ", ", texture->mipLevels - texture->residentMip, "/", texture->mipLevels, " mips resident)"));
 
 	return texture;
 }
@@ -2,36 +2,84 @@
 
 #include "../pch.hpp"
 #include "../Context/VulkanContext.hpp"
+#include "TextureEncoder.hpp"
+#include "CookedTexture.hpp"
 
 namespace cp
 {
+	struct TextureImportSettings
+	{
+		TextureCompression compression = TextureCompression::None; // Falls back to None when the device lacks BC support
+		bool srgb = true; // Color textures, disable for normal / data maps
+		bool generateMips = true;
+		bool cook = true; // Cook into a .cptex next to the source, otherwise mips are blitted on the GPU at every load
+		bool stream = false; // Only the smallest mips are loaded, the TextureStreamer raises residency from usage feedback. Implies cook and generateMips
+	};
+
 	class Texture
 	{
 	private:
 		int width;
 		int height;
 		int channels;
+		uint32_t mipLevels = 1; // Full chain, even when only part of it is resident
+		vk::Format format = vk::Format::eR8G8B8A8Srgb;
+
+		uint32_t residentMip = 0; // Finest level allocated on the GPU, level 0 of the image is this level
+		uint32_t uploadedMip = 0; // Finest level whose data is uploaded, the sampler minLod hides the levels in between
+		std::unique_ptr<cp::CookedTexture::View> streamingSource; // Kept mapped for as long as the texture streams
 
 		vk::Image image;
 		vk::DeviceMemory imageMemory;
 
 		vk::ImageView imageView;
-		vk::Sampler sampler;
+		vk::Sampler sampler; // Owned by the context SamplerCache
+		cp::SamplerDescription samplerDescription;
+
+		uint32_t bindlessIndex = cp::BindlessManager::INVALID_INDEX; // Slot in the global texture array, when the context has a BindlessManager
+		uint32_t bindlessSamplerIndex = cp::BindlessManager::INVALID_INDEX;
+		vk::ImageView bindlessView; // What the slots above were registered with, RefreshSampler only replaces them when these change
+		vk::Sampler bindlessSampler;
 
 		const cp::VulkanContext* context;
 
+		static TextureImportSettings defaultImportSettings;
+
+		static std::shared_ptr<Texture> LoadStreamingTexture(const cp::VulkanContext& _context, const std::string& _path, const TextureImportSettings& _settings);
+
+		void RefreshSampler(); // Fetches the sampler matching samplerDescription, with minLod clamped to the uploaded mips when streaming, and refreshes the bindless slot
+
+		void Upload(const void* _data, vk::DeviceSize _dataSize, const std::vector<vk::BufferImageCopy>& _regions, bool _generateMips); // Every region is copied from one staging buffer in a single submit
+
+		friend class TextureStreamer;
+
 	public:
 		Texture(const cp::VulkanContext* _context) : context(_context) {}
 		~Texture();
 
 		static std::shared_ptr<Texture> LoadTexture(const cp::VulkanContext& _context, const std::string& _path);
+		static std::shared_ptr<Texture> LoadTextureWithSettings(const cp::VulkanContext& _context, const std::string& _path, const TextureImportSettings& _settings);
+
+		static inline void SetDefaultImportSettings(const TextureImportSettings& _settings) { defaultImportSettings = _settings; }
+		static inline const TextureImportSettings& GetDefaultImportSettings() { return defaultImportSettings; }
 
 		inline constexpr const vk::Image GetImage() const { return image; }
 		inline constexpr const vk::ImageView GetImageView() const { return imageView; }
 		inline constexpr const vk::Sampler GetSampler() const { return sampler; }
+		inline const cp::SamplerDescription& GetSamplerDescription() const { return samplerDescription; }
+		void SetSamplerDescription(const cp::SamplerDescription& _description);
 
 		inline constexpr int GetWidth() const { return width; }
 		inline constexpr int GetHeight() const { return height; }
 		inline constexpr int GetChannels() const { return channels; }
+		inline constexpr uint32_t GetMipLevels() const { return mipLevels; }
+		inline constexpr vk::Format GetFormat() const { return format; }
+
+		inline bool IsStreaming() const { return streamingSource != nullptr; }
+		inline constexpr uint32_t GetResidentMip() const { return residentMip; }
+		inline constexpr uint32_t GetUploadedMip() const { return uploadedMip; }
+
+		inline constexpr uint32_t GetBindlessIndex() const { return bindlessIndex; }
+		inline constexpr uint32_t GetBindlessSamplerIndex() const { return bindlessSamplerIndex; }
 	};
 }
\ No newline at end of file
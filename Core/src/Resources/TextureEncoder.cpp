@@ -0,0 +1,447 @@
+#include "pch.hpp"
+#include "TextureEncoder.hpp"
+
+#include <climits>
+#include <cfloat>
+
+namespace
+{
+	struct Block
+	{
+		uint8_t pixels[16][4]; // RGBA, row major
+	};
+
+	float SrgbToLinear(float _value)
+	{
+		return _value <= 0.04045f ? _value / 12.92f : std::pow((_value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float _value)
+	{
+		return _value <= 0.0031308f ? _value * 12.92f : 1.055f * std::pow(_value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	uint8_t ToByte(float _value)
+	{
+		return static_cast<uint8_t>(std::clamp(_value * 255.0f + 0.5f, 0.0f, 255.0f));
+	}
+
+	Block FetchBlock(const cp::TextureLevel& _level, uint32_t _blockX, uint32_t _blockY)
+	{
+		Block block;
+
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				// Blocks overlapping the edge of small mips repeat their last row / column
+				const uint32_t px = std::min(_blockX * 4 + x, _level.width - 1);
+				const uint32_t py = std::min(_blockY * 4 + y, _level.height - 1);
+				std::memcpy(block.pixels[y * 4 + x], &_level.data[(static_cast<size_t>(py) * _level.width + px) * 4], 4);
+			}
+		}
+
+		return block;
+	}
+
+	// Endpoints along the principal axis of the block colors, bounding box corners miss anti-correlated channels
+	void ComputeEndpoints(const Block& _block, int _channels, int _low[4], int _high[4])
+	{
+		float mean[4] = {};
+		for (const auto& pixel : _block.pixels)
+		{
+			for (int c = 0; c < _channels; c++) mean[c] += pixel[c] / 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (const auto& pixel : _block.pixels)
+		{
+			for (int a = 0; a < _channels; a++)
+			{
+				for (int b = 0; b < _channels; b++)
+				{
+					covariance[a][b] += (pixel[a] - mean[a]) * (pixel[b] - mean[b]);
+				}
+			}
+		}
+
+		// A few power iterations are enough to converge on 16 pixels
+		float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = 0; a < _channels; a++)
+			{
+				for (int b = 0; b < _channels; b++) next[a] += covariance[a][b] * axis[b];
+				length = std::max(length, std::abs(next[a]));
+			}
+
+			if (length < 1e-6f) break;
+			for (int a = 0; a < _channels; a++) axis[a] = next[a] / length;
+		}
+
+		float minProjection = FLT_MAX, maxProjection = -FLT_MAX;
+		for (const auto& pixel : _block.pixels)
+		{
+			float projection = 0.0f;
+			for (int c = 0; c < _channels; c++) projection += (pixel[c] - mean[c]) * axis[c];
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		float axisLengthSquared = 0.0f;
+		for (int c = 0; c < _channels; c++) axisLengthSquared += axis[c] * axis[c];
+		if (axisLengthSquared < 1e-12f) axisLengthSquared = 1.0f;
+
+		for (int c = 0; c < _channels; c++)
+		{
+			_low[c] = std::clamp(static_cast<int>(mean[c] + axis[c] * minProjection / axisLengthSquared + 0.5f), 0, 255);
+			_high[c] = std::clamp(static_cast<int>(mean[c] + axis[c] * maxProjection / axisLengthSquared + 0.5f), 0, 255);
+		}
+	}
+
+	uint16_t To565(const int _color[3])
+	{
+		return static_cast<uint16_t>(((_color[0] * 31 + 127) / 255) << 11 | ((_color[1] * 63 + 127) / 255) << 5 | ((_color[2] * 31 + 127) / 255));
+	}
+
+	void From565(uint16_t _packed, int _color[3])
+	{
+		const int r = (_packed >> 11) & 31, g = (_packed >> 5) & 63, b = _packed & 31;
+		_color[0] = (r << 3) | (r >> 2);
+		_color[1] = (g << 2) | (g >> 4);
+		_color[2] = (b << 3) | (b >> 2);
+	}
+
+	int ColorDistance(const int _a[3], const uint8_t _b[4])
+	{
+		const int dr = _a[0] - _b[0], dg = _a[1] - _b[1], db = _a[2] - _b[2];
+		return dr * dr + dg * dg + db * db;
+	}
+
+	// BC1 color block, always in 4-color mode so it can also be used as the color half of BC3
+	void EncodeColorBlock(const Block& _block, uint8_t* _out)
+	{
+		int minColor[4];
+		int maxColor[4];
+		ComputeEndpoints(_block, 3, minColor, maxColor);
+
+		uint16_t color0 = To565(maxColor);
+		uint16_t color1 = To565(minColor);
+
+		if (color0 < color1) std::swap(color0, color1);
+
+		uint32_t indices = 0;
+
+		if (color0 != color1)
+		{
+			int palette[4][3];
+			From565(color0, palette[0]);
+			From565(color1, palette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0;
+				int bestDistance = ColorDistance(palette[0], _block.pixels[i]);
+				for (int p = 1; p < 4; p++)
+				{
+					const int distance = ColorDistance(palette[p], _block.pixels[i]);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= static_cast<uint32_t>(best) << (i * 2);
+			}
+		}
+
+		std::memcpy(_out, &color0, 2);
+		std::memcpy(_out + 2, &color1, 2);
+		std::memcpy(_out + 4, &indices, 4);
+	}
+
+	// BC4 block for one channel of the pixels, in 8 value mode
+	void EncodeChannelBlock(const Block& _block, int _channel, uint8_t* _out)
+	{
+		int minValue = 255, maxValue = 0;
+		for (const auto& pixel : _block.pixels)
+		{
+			minValue = std::min(minValue, static_cast<int>(pixel[_channel]));
+			maxValue = std::max(maxValue, static_cast<int>(pixel[_channel]));
+		}
+
+		_out[0] = static_cast<uint8_t>(maxValue);
+		_out[1] = static_cast<uint8_t>(minValue);
+
+		uint64_t indices = 0;
+
+		if (maxValue != minValue)
+		{
+			int palette[8] = { maxValue, minValue };
+			for (int p = 1; p < 7; p++)
+			{
+				palette[p + 1] = ((7 - p) * maxValue + p * minValue) / 7;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0;
+				int bestDistance = std::abs(palette[0] - _block.pixels[i][_channel]);
+				for (int p = 1; p < 8; p++)
+				{
+					const int distance = std::abs(palette[p] - _block.pixels[i][_channel]);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= static_cast<uint64_t>(best) << (i * 3);
+			}
+		}
+
+		for (int b = 0; b < 6; b++)
+		{
+			_out[2 + b] = static_cast<uint8_t>(indices >> (b * 8));
+		}
+	}
+
+	class BitWriter
+	{
+	private:
+		uint8_t* out;
+		uint32_t position = 0;
+
+	public:
+		BitWriter(uint8_t* _out) : out(_out) { std::memset(out, 0, 16); }
+
+		void Write(uint32_t _value, uint32_t _bits)
+		{
+			for (uint32_t b = 0; b < _bits; b++, position++)
+			{
+				out[position / 8] |= static_cast<uint8_t>(((_value >> b) & 1) << (position % 8));
+			}
+		}
+	};
+
+	// BC7 mode 6 : one subset, RGBA 7 bit endpoints with a p-bit each and 4 bit indices
+	void EncodeBC7Block(const Block& _block, uint8_t* _out)
+	{
+		static constexpr int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		int endpoints[2][4];
+		ComputeEndpoints(_block, 4, endpoints[0], endpoints[1]);
+
+		// Quantize every endpoint to 7 bits + shared p-bit, keeping whichever p-bit gives the smallest error
+		int quantized[2][4];
+		int pBits[2];
+		int decoded[2][4];
+		for (int e = 0; e < 2; e++)
+		{
+			int bestError = INT_MAX;
+			for (int p = 0; p < 2; p++)
+			{
+				int error = 0;
+				int candidate[4];
+				for (int c = 0; c < 4; c++)
+				{
+					candidate[c] = std::clamp((endpoints[e][c] - p + 1) >> 1, 0, 127);
+					const int value = (candidate[c] << 1) | p;
+					error += (value - endpoints[e][c]) * (value - endpoints[e][c]);
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					pBits[e] = p;
+					for (int c = 0; c < 4; c++)
+					{
+						quantized[e][c] = candidate[c];
+						decoded[e][c] = (candidate[c] << 1) | p;
+					}
+				}
+			}
+		}
+
+		int indices[16];
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			int bestError = INT_MAX;
+			for (int w = 0; w < 16; w++)
+			{
+				int error = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					const int value = ((64 - weights[w]) * decoded[0][c] + weights[w] * decoded[1][c] + 32) >> 6;
+					error += (value - _block.pixels[i][c]) * (value - _block.pixels[i][c]);
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					best = w;
+				}
+			}
+			indices[i] = best;
+		}
+
+		// The anchor index is stored with its most significant bit implied to be 0
+		if (indices[0] & 8)
+		{
+			std::swap(quantized[0], quantized[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (int& index : indices) index = 15 - index;
+		}
+
+		BitWriter writer(_out);
+		writer.Write(1 << 6, 7); // Mode 6
+		for (int c = 0; c < 4; c++)
+		{
+			writer.Write(quantized[0][c], 7);
+			writer.Write(quantized[1][c], 7);
+		}
+		writer.Write(pBits[0], 1);
+		writer.Write(pBits[1], 1);
+		writer.Write(indices[0], 3);
+		for (int i = 1; i < 16; i++)
+		{
+			writer.Write(indices[i], 4);
+		}
+	}
+}
+
+vk::Format cp::TextureEncoder::GetFormat(TextureCompression _compression, bool _srgb)
+{
+	switch (_compression)
+	{
+	case TextureCompression::BC1: return _srgb ? vk::Format::eBc1RgbaSrgbBlock : vk::Format::eBc1RgbaUnormBlock;
+	case TextureCompression::BC3: return _srgb ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+	case TextureCompression::BC4: return vk::Format::eBc4UnormBlock;
+	case TextureCompression::BC5: return vk::Format::eBc5UnormBlock;
+	case TextureCompression::BC7: return _srgb ? vk::Format::eBc7SrgbBlock : vk::Format::eBc7UnormBlock;
+	default: return _srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+	}
+}
+
+uint64_t cp::TextureEncoder::GetLevelSize(TextureCompression _compression, uint32_t _width, uint32_t _height)
+{
+	const uint64_t blocks = static_cast<uint64_t>((_width + 3) / 4) * ((_height + 3) / 4);
+
+	switch (_compression)
+	{
+	case TextureCompression::BC1:
+	case TextureCompression::BC4: return blocks * 8;
+	case TextureCompression::BC3:
+	case TextureCompression::BC5:
+	case TextureCompression::BC7: return blocks * 16;
+	default: return static_cast<uint64_t>(_width) * _height * 4;
+	}
+}
+
+uint32_t cp::TextureEncoder::GetMipCount(uint32_t _width, uint32_t _height)
+{
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(_width, _height)))) + 1;
+}
+
+std::vector<cp::TextureLevel> cp::TextureEncoder::GenerateMipChain(const uint8_t* _pixels, uint32_t _width, uint32_t _height, bool _srgb)
+{
+	std::array<float, 256> toLinear;
+	for (int i = 0; i < 256; i++)
+	{
+		toLinear[i] = _srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+	}
+
+	std::vector<TextureLevel> levels(GetMipCount(_width, _height));
+	levels[0] = { _width, _height, std::vector<uint8_t>(_pixels, _pixels + static_cast<size_t>(_width) * _height * 4) };
+
+	for (size_t level = 1; level < levels.size(); level++)
+	{
+		const TextureLevel& source = levels[level - 1];
+		TextureLevel& target = levels[level];
+		target.width = std::max(source.width / 2, 1u);
+		target.height = std::max(source.height / 2, 1u);
+		target.data.resize(static_cast<size_t>(target.width) * target.height * 4);
+
+		for (uint32_t y = 0; y < target.height; y++)
+		{
+			for (uint32_t x = 0; x < target.width; x++)
+			{
+				float sum[4] = {};
+				for (uint32_t sy = 0; sy < 2; sy++)
+				{
+					for (uint32_t sx = 0; sx < 2; sx++)
+					{
+						const uint32_t px = std::min(x * 2 + sx, source.width - 1);
+						const uint32_t py = std::min(y * 2 + sy, source.height - 1);
+						const uint8_t* pixel = &source.data[(static_cast<size_t>(py) * source.width + px) * 4];
+
+						for (int c = 0; c < 3; c++) sum[c] += toLinear[pixel[c]];
+						sum[3] += pixel[3] / 255.0f; // Alpha is always linear
+					}
+				}
+
+				uint8_t* out = &target.data[(static_cast<size_t>(y) * target.width + x) * 4];
+				for (int c = 0; c < 3; c++) out[c] = ToByte(_srgb ? LinearToSrgb(sum[c] * 0.25f) : sum[c] * 0.25f);
+				out[3] = ToByte(sum[3] * 0.25f);
+			}
+		}
+	}
+
+	return levels;
+}
+
+std::vector<uint8_t> cp::TextureEncoder::Compress(TextureCompression _compression, const TextureLevel& _level)
+{
+	if (_compression == TextureCompression::None)
+	{
+		return _level.data;
+	}
+
+	std::vector<uint8_t> output(GetLevelSize(_compression, _level.width, _level.height));
+
+	const uint32_t blocksX = (_level.width + 3) / 4;
+	const uint32_t blocksY = (_level.height + 3) / 4;
+	const size_t blockSize = output.size() / (static_cast<size_t>(blocksX) * blocksY);
+
+	for (uint32_t by = 0; by < blocksY; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksX; bx++)
+		{
+			const Block block = FetchBlock(_level, bx, by);
+			uint8_t* out = &output[(static_cast<size_t>(by) * blocksX + bx) * blockSize];
+
+			switch (_compression)
+			{
+			case TextureCompression::BC1:
+				EncodeColorBlock(block, out);
+				break;
+			case TextureCompression::BC3:
+				EncodeChannelBlock(block, 3, out);
+				EncodeColorBlock(block, out + 8);
+				break;
+			case TextureCompression::BC4:
+				EncodeChannelBlock(block, 0, out);
+				break;
+			case TextureCompression::BC5:
+				EncodeChannelBlock(block, 0, out);
+				EncodeChannelBlock(block, 1, out + 8);
+				break;
+			case TextureCompression::BC7:
+				EncodeBC7Block(block, out);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	return output;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../pch.hpp"
+
+namespace cp
+{
+	enum class TextureCompression : uint8_t
+	{
+		None = 0, // RGBA8
+		BC1 = 1, // RGB + 1 bit alpha, 4 bpp
+		BC3 = 2, // RGBA, 8 bpp
+		BC4 = 3, // Single channel, 4 bpp
+		BC5 = 4, // Two channels (normal maps), 8 bpp
+		BC7 = 5, // RGBA, 8 bpp, encoded with mode 6 only
+	};
+
+	struct TextureLevel
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint8_t> data;
+	};
+
+	// CPU side of the texture cooking : mip chain generation and block compression of RGBA8 pixels
+	namespace TextureEncoder
+	{
+		vk::Format GetFormat(TextureCompression _compression, bool _srgb);
+		uint64_t GetLevelSize(TextureCompression _compression, uint32_t _width, uint32_t _height);
+		uint32_t GetMipCount(uint32_t _width, uint32_t _height);
+
+		std::vector<TextureLevel> GenerateMipChain(const uint8_t* _pixels, uint32_t _width, uint32_t _height, bool _srgb); // Box filter, averaged in linear space when _srgb is set
+		std::vector<uint8_t> Compress(TextureCompression _compression, const TextureLevel& _level);
+	}
+}
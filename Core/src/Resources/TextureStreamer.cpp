@@ -0,0 +1,397 @@
+#include "pch.hpp"
+#include "TextureStreamer.hpp"
+#include "Texture.hpp"
+
+cp::TextureStreamer* cp::TextureStreamer::instance = nullptr;
+
+namespace
+{
+	void ImageBarrier(vk::CommandBuffer _commandBuffer, vk::Image _image, uint32_t _baseMip, uint32_t _levelCount, vk::ImageLayout _oldLayout, vk::ImageLayout _newLayout, vk::AccessFlags _srcAccess, vk::AccessFlags _dstAccess, vk::PipelineStageFlags _srcStage, vk::PipelineStageFlags _dstStage)
+	{
+		vk::ImageMemoryBarrier barrier;
+		barrier.oldLayout = _oldLayout;
+		barrier.newLayout = _newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = _image;
+		barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, _baseMip, _levelCount, 0, 1);
+		barrier.srcAccessMask = _srcAccess;
+		barrier.dstAccessMask = _dstAccess;
+
+		_commandBuffer.pipelineBarrier(_srcStage, _dstStage, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+}
+
+cp::TextureStreamer* cp::TextureStreamer::Create(const cp::VulkanContext& _context, const TextureStreamingSettings& _settings)
+{
+	if (!instance)
+	{
+		instance = new cp::TextureStreamer(_context, _settings);
+		LOG_INFO(MF("Texture Streamer created with a ", _settings.budget / (1024 * 1024), " MB budget"));
+	}
+
+	return instance;
+}
+
+cp::TextureStreamer* cp::TextureStreamer::Get()
+{
+	return instance;
+}
+
+void cp::TextureStreamer::Cleanup()
+{
+	const vk::Device device = context->GetDevice();
+
+	ReleaseUploads(true);
+
+	for (const RetiredImage& image : retired)
+	{
+		device.destroyImageView(image.view);
+		device.freeMemory(image.memory);
+		device.destroyImage(image.image);
+	}
+
+	retired.clear();
+	entries.clear();
+	residentMemory = 0;
+}
+
+uint32_t cp::TextureStreamer::GetTailMip(uint32_t _mipCount) const
+{
+	return _mipCount > settings.tailMipCount ? _mipCount - settings.tailMipCount : 0;
+}
+
+vk::DeviceSize cp::TextureStreamer::GetMemory(const Texture& _texture, uint32_t _firstMip)
+{
+	vk::DeviceSize size = 0;
+	for (uint32_t i = _firstMip; i < _texture.mipLevels; i++)
+	{
+		size += _texture.streamingSource->levels[i].size;
+	}
+
+	return size;
+}
+
+void cp::TextureStreamer::Register(const std::shared_ptr<Texture>& _texture)
+{
+	if (!_texture || !_texture->IsStreaming())
+	{
+		LOG_WARNING("Only textures loaded with TextureImportSettings::stream can be streamed");
+		return;
+	}
+
+	// A texture freed since the last Update may have left its entry at the same address
+	auto it = entries.find(_texture.get());
+	if (it != entries.end())
+	{
+		residentMemory -= it->second.residentBytes;
+	}
+
+	Entry& entry = entries[_texture.get()];
+	entry.texture = _texture;
+	entry.requestedPixels = 0.0f;
+	entry.wantedMip = _texture->residentMip;
+	entry.lastUsedFrame = frame;
+	entry.residentBytes = GetMemory(*_texture, _texture->residentMip);
+
+	residentMemory += entry.residentBytes;
+}
+
+void cp::TextureStreamer::ReportUsage(const Texture* _texture, float _screenPixels)
+{
+	auto it = entries.find(_texture);
+	if (it != entries.end())
+	{
+		it->second.requestedPixels = std::max(it->second.requestedPixels, _screenPixels);
+	}
+}
+
+void cp::TextureStreamer::Update()
+{
+	const vk::Device device = context->GetDevice();
+
+	frame++;
+
+	ReleaseUploads(false);
+
+	while (!retired.empty() && retired.front().frame + settings.framesInFlight <= frame)
+	{
+		const RetiredImage& image = retired.front();
+		device.destroyImageView(image.view);
+		device.freeMemory(image.memory);
+		device.destroyImage(image.image);
+		retired.pop_front();
+	}
+
+	struct Candidate
+	{
+		std::shared_ptr<Texture> texture;
+		const Entry* entry;
+		uint32_t wantedMip;
+		uint32_t tailMip;
+	};
+
+	std::vector<Candidate> candidates;
+	candidates.reserve(entries.size());
+	vk::DeviceSize wantedMemory = 0;
+
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		Entry& entry = it->second;
+		std::shared_ptr<Texture> texture = entry.texture.lock();
+
+		if (!texture)
+		{
+			residentMemory -= entry.residentBytes;
+			it = entries.erase(it);
+			continue;
+		}
+
+		const uint32_t tailMip = GetTailMip(texture->mipLevels);
+
+		if (entry.requestedPixels > 0.0f)
+		{
+			// One texel per pixel : every halving of the on-screen size allows one coarser level
+			const float texels = static_cast<float>(std::max(texture->width, texture->height));
+			const float mip = std::floor(std::log2(std::max(texels / entry.requestedPixels, 1.0f)));
+			entry.wantedMip = std::min(static_cast<uint32_t>(mip), tailMip);
+			entry.lastUsedFrame = frame;
+		}
+		else if (frame - entry.lastUsedFrame > settings.unusedFramesBeforeDrop)
+		{
+			entry.wantedMip = tailMip;
+		}
+
+		entry.requestedPixels = 0.0f;
+
+		wantedMemory += GetMemory(*texture, entry.wantedMip);
+		candidates.push_back({ texture, &entry, entry.wantedMip, tailMip });
+		++it;
+	}
+
+	// Over budget : coarsen the least recently used textures first, biggest first among equals
+	if (wantedMemory > settings.budget)
+	{
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& _a, const Candidate& _b)
+			{
+				if (_a.entry->lastUsedFrame != _b.entry->lastUsedFrame) return _a.entry->lastUsedFrame < _b.entry->lastUsedFrame;
+				return GetMemory(*_a.texture, _a.wantedMip) > GetMemory(*_b.texture, _b.wantedMip);
+			});
+
+		bool progress = true;
+		while (wantedMemory > settings.budget && progress)
+		{
+			progress = false;
+			for (Candidate& candidate : candidates)
+			{
+				if (wantedMemory <= settings.budget) break;
+				if (candidate.wantedMip >= candidate.tailMip) continue;
+
+				wantedMemory -= candidate.texture->streamingSource->levels[candidate.wantedMip].size;
+				candidate.wantedMip++;
+				progress = true;
+			}
+		}
+	}
+
+	// Drops first so their memory is released before other textures grow
+	for (Candidate& candidate : candidates)
+	{
+		if (candidate.wantedMip > candidate.texture->residentMip) Reallocate(*candidate.texture, candidate.wantedMip);
+	}
+
+	for (Candidate& candidate : candidates)
+	{
+		if (candidate.wantedMip < candidate.texture->residentMip) Reallocate(*candidate.texture, candidate.wantedMip);
+	}
+
+	// Pending levels are uploaded smallest first across every texture, so many textures sharpen a little before one gets sharp
+	for (uint32_t upload = 0; upload < settings.maxUploadsPerUpdate; upload++)
+	{
+		Candidate* next = nullptr;
+		vk::DeviceSize nextSize = 0;
+
+		for (Candidate& candidate : candidates)
+		{
+			Texture& texture = *candidate.texture;
+			if (texture.uploadedMip <= texture.residentMip) continue;
+
+			const vk::DeviceSize size = texture.streamingSource->levels[texture.uploadedMip - 1].size;
+			if (!next || size < nextSize)
+			{
+				next = &candidate;
+				nextSize = size;
+			}
+		}
+
+		if (!next) break;
+
+		UploadNextMip(*next->texture);
+	}
+
+	SubmitUploads();
+}
+
+void cp::TextureStreamer::Reallocate(Texture& _texture, uint32_t _residentMip)
+{
+	const vk::Device device = context->GetDevice();
+
+	const uint32_t oldResidentMip = _texture.residentMip;
+	const uint32_t keptMip = std::max(_texture.uploadedMip, _residentMip); // Finest uploaded level that survives the move
+	const uint32_t levelCount = _texture.mipLevels - _residentMip;
+
+	vk::Image image;
+	vk::DeviceMemory imageMemory;
+	Helper::Image::CreateImage(device, context->GetPhysicalDevice(), std::max(static_cast<uint32_t>(_texture.width) >> _residentMip, 1u), std::max(static_cast<uint32_t>(_texture.height) >> _residentMip, 1u), _texture.format, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, image, imageMemory, levelCount);
+
+	std::vector<vk::ImageCopy> copies;
+	for (uint32_t level = keptMip; level < _texture.mipLevels; level++)
+	{
+		const cp::CookedTexture::Level& source = _texture.streamingSource->levels[level];
+
+		vk::ImageCopy copy;
+		copy.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - oldResidentMip, 0, 1);
+		copy.dstSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - _residentMip, 0, 1);
+		copy.extent = vk::Extent3D(source.width, source.height, 1);
+		copies.push_back(copy);
+	}
+
+	const uint32_t keptLevels = _texture.mipLevels - keptMip;
+	const uint32_t oldFirstKept = keptMip - oldResidentMip;
+
+	vk::CommandBuffer commandBuffer = GetUploadCommandBuffer(_texture);
+
+	ImageBarrier(commandBuffer, image, 0, levelCount, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer);
+	ImageBarrier(commandBuffer, _texture.image, oldFirstKept, keptLevels, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal, vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferRead, vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer);
+
+	commandBuffer.copyImage(_texture.image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, static_cast<uint32_t>(copies.size()), copies.data());
+
+	// Levels that are not uploaded yet are transitioned too, the view covers them even though minLod keeps them unsampled
+	ImageBarrier(commandBuffer, image, 0, levelCount, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+	ImageBarrier(commandBuffer, _texture.image, oldFirstKept, keptLevels, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eShaderRead, vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+
+	// Read by the batch submitted at the end of this Update, which completes before the image is destroyed framesInFlight frames later
+	Retire(_texture.image, _texture.imageMemory, _texture.imageView);
+
+	_texture.image = image;
+	_texture.imageMemory = imageMemory;
+	_texture.residentMip = _residentMip;
+	_texture.uploadedMip = keptMip;
+
+	Helper::Image::CreateImageView(device, image, _texture.format, vk::ImageAspectFlagBits::eColor, _texture.imageView, levelCount);
+	_texture.RefreshSampler();
+
+	Entry& entry = entries[&_texture];
+	residentMemory -= entry.residentBytes;
+	entry.residentBytes = GetMemory(_texture, _residentMip);
+	residentMemory += entry.residentBytes;
+}
+
+void cp::TextureStreamer::UploadNextMip(Texture& _texture)
+{
+	const vk::Device device = context->GetDevice();
+
+	const uint32_t level = _texture.uploadedMip - 1;
+	const uint32_t imageLevel = level - _texture.residentMip;
+	const cp::CookedTexture::Level& source = _texture.streamingSource->levels[level];
+
+	vk::Buffer buffer;
+	vk::DeviceMemory bufferMemory;
+	buffer = Helper::Memory::CreateBuffer(device, context->GetPhysicalDevice(), source.size, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, bufferMemory);
+	Helper::Memory::MapMemory(device, bufferMemory, source.size, _texture.streamingSource->file.As<void>(source.offset));
+
+	vk::BufferImageCopy region;
+	region.bufferOffset = 0;
+	region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, imageLevel, 0, 1);
+	region.imageOffset = vk::Offset3D(0, 0, 0);
+	region.imageExtent = vk::Extent3D(source.width, source.height, 1);
+
+	vk::CommandBuffer commandBuffer = GetUploadCommandBuffer(_texture);
+	recording.staging.emplace_back(buffer, bufferMemory);
+
+	ImageBarrier(commandBuffer, _texture.image, imageLevel, 1, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferDstOptimal, vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer);
+	commandBuffer.copyBufferToImage(buffer, _texture.image, vk::ImageLayout::eTransferDstOptimal, 1, &region);
+	ImageBarrier(commandBuffer, _texture.image, imageLevel, 1, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+
+	_texture.uploadedMip = level;
+	_texture.RefreshSampler();
+}
+
+void cp::TextureStreamer::Retire(vk::Image _image, vk::DeviceMemory _memory, vk::ImageView _view)
+{
+	retired.push_back({ _image, _memory, _view, frame });
+}
+
+vk::CommandBuffer cp::TextureStreamer::GetUploadCommandBuffer(Texture& _texture)
+{
+	auto it = entries.find(&_texture);
+	if (it != entries.end()) recording.textures.push_back(it->second.texture.lock());
+
+	if (!recording.commandBuffer)
+	{
+		vk::CommandBufferAllocateInfo allocInfo;
+		allocInfo.commandPool = context->GetCommandPool();
+		allocInfo.level = vk::CommandBufferLevel::ePrimary;
+		allocInfo.commandBufferCount = 1;
+
+		recording.commandBuffer = context->GetDevice().allocateCommandBuffers(allocInfo)[0];
+		recording.commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+	}
+
+	return recording.commandBuffer;
+}
+
+void cp::TextureStreamer::SubmitUploads()
+{
+	if (!recording.commandBuffer) return;
+
+	const vk::Device device = context->GetDevice();
+	const vk::Queue queue = device.getQueue(context->GetQueueFamilyIndices().graphicsFamily.value(), 0);
+
+	recording.commandBuffer.end();
+	recording.fence = device.createFence(vk::FenceCreateInfo());
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &recording.commandBuffer;
+
+	if (queue.submit(1, &submitInfo, recording.fence) != vk::Result::eSuccess)
+	{
+		LOG_ERROR("Failed to submit texture uploads");
+		throw std::runtime_error("Failed to submit texture uploads");
+	}
+
+	pendingUploads.push_back(std::move(recording));
+	recording = UploadBatch();
+}
+
+void cp::TextureStreamer::ReleaseUploads(bool _wait)
+{
+	const vk::Device device = context->GetDevice();
+
+	while (!pendingUploads.empty())
+	{
+		UploadBatch& batch = pendingUploads.front();
+
+		if (_wait)
+		{
+			if (device.waitForFences(1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max()) != vk::Result::eSuccess)
+			{
+				throw std::runtime_error("Failed to wait for texture uploads");
+			}
+		}
+		else if (device.getFenceStatus(batch.fence) != vk::Result::eSuccess)
+		{
+			break; // Batches complete in submission order
+		}
+
+		for (auto& [buffer, memory] : batch.staging)
+		{
+			Helper::Memory::DestroyBuffer(device, buffer, memory);
+		}
+
+		device.destroyFence(batch.fence);
+		device.freeCommandBuffers(context->GetCommandPool(), batch.commandBuffer);
+		pendingUploads.pop_front();
+	}
+}
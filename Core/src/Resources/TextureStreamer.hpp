@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../pch.hpp"
+#include "../Context/VulkanContext.hpp"
+
+namespace cp
+{
+	class Texture;
+
+	struct TextureStreamingSettings
+	{
+		vk::DeviceSize budget = 512ull * 1024 * 1024; // Bytes of texture data streamed textures may keep resident, mip tails included
+		uint32_t tailMipCount = 6; // Smallest levels loaded with the texture and never evicted (32x32 and below)
+		uint32_t maxUploadsPerUpdate = 4; // Mip levels uploaded per Update, spreads big residency changes over several frames
+		uint32_t unusedFramesBeforeDrop = 120; // Textures not reported for this many frames fall back to their mip tail
+		uint32_t framesInFlight = 3; // Replaced images are destroyed once no recorded frame can reference them anymore
+	};
+
+	// Keeps streaming textures (TextureImportSettings::stream) within a global memory budget
+	// The renderer reports how big every visible texture is on screen, Update then raises or drops residency per texture
+	// Higher mips are uploaded smallest first, the texture sampler minLod is clamped until they all arrived (samplers come from the SamplerCache, so this only swaps handles)
+	// Uploads are submitted on the graphics queue without waiting, frames submitted later are ordered after them by the upload barriers
+	// Usage comes from InstanceGroupBuilder (fed by the editor viewport). No live draw path samples Texture views yet, material descriptor sets don't bind them and the bindless set is unbound, so streaming only manages residency for now
+	class TextureStreamer
+	{
+	private:
+		struct Entry
+		{
+			std::weak_ptr<Texture> texture;
+			float requestedPixels = 0.0f; // Largest on-screen size reported since the last Update
+			uint32_t wantedMip = 0;
+			uint64_t lastUsedFrame = 0;
+			vk::DeviceSize residentBytes = 0;
+		};
+
+		struct RetiredImage
+		{
+			vk::Image image;
+			vk::DeviceMemory memory;
+			vk::ImageView view;
+			uint64_t frame;
+		};
+
+		// Everything one Update records, staging buffers are freed once its fence signaled
+		struct UploadBatch
+		{
+			vk::CommandBuffer commandBuffer;
+			vk::Fence fence;
+			std::vector<std::pair<vk::Buffer, vk::DeviceMemory>> staging;
+			std::vector<std::shared_ptr<Texture>> textures; // Kept alive until the copies into their images completed
+		};
+
+		TextureStreamingSettings settings;
+		std::unordered_map<const Texture*, Entry> entries;
+		std::deque<RetiredImage> retired;
+
+		UploadBatch recording; // Null command buffer until the first upload of the current Update
+		std::deque<UploadBatch> pendingUploads;
+
+		uint64_t frame = 0;
+		vk::DeviceSize residentMemory = 0;
+
+		const cp::VulkanContext* context;
+
+		static TextureStreamer* instance;
+
+		TextureStreamer(const cp::VulkanContext& _context, const TextureStreamingSettings& _settings) : settings(_settings), context(&_context) {}
+
+		static vk::DeviceSize GetMemory(const Texture& _texture, uint32_t _firstMip);
+
+		void Reallocate(Texture& _texture, uint32_t _residentMip); // Moves the texture to a new image covering [_residentMip, mipCount), already uploaded levels are copied over
+		void UploadNextMip(Texture& _texture);
+		void Retire(vk::Image _image, vk::DeviceMemory _memory, vk::ImageView _view);
+
+		vk::CommandBuffer GetUploadCommandBuffer(Texture& _texture); // Begins the batch of this Update on first use
+		void SubmitUploads();
+		void ReleaseUploads(bool _wait); // Frees the batches whose fence signaled, or all of them after waiting
+
+	public:
+		NO_COPY(TextureStreamer)
+
+		static TextureStreamer* Create(const cp::VulkanContext& _context, const TextureStreamingSettings& _settings = {});
+		static TextureStreamer* Get(); // nullptr when streaming is disabled, streaming textures are then fully loaded
+		void Cleanup();
+
+		void Register(const std::shared_ptr<Texture>& _texture);
+		void ReportUsage(const Texture* _texture, float _screenPixels); // _screenPixels : size of the texture on screen along its largest axis
+
+		void Update(); // Once per frame, after submitting
+
+		uint32_t GetTailMip(uint32_t _mipCount) const;
+
+		inline void SetBudget(vk::DeviceSize _budget) { settings.budget = _budget; }
+		inline constexpr vk::DeviceSize GetBudget() const { return settings.budget; }
+		inline constexpr vk::DeviceSize GetResidentMemory() const { return residentMemory; }
+		inline const TextureStreamingSettings& GetSettings() const { return settings; }
+	};
+}
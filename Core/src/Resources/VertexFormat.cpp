@@ -0,0 +1,135 @@
+#include "pch.hpp"
+#include "VertexFormat.hpp"
+#include "Mesh.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+static_assert(sizeof(cp::CompactVertex) == 24, "CompactVertex must stay tightly packed");
+static_assert(sizeof(cp::CompactQuantizedVertex) == 20, "CompactQuantizedVertex must stay tightly packed");
+
+namespace
+{
+	int16_t PackSnorm16(float _value)
+	{
+		return static_cast<int16_t>(std::round(std::clamp(_value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	int8_t PackSnorm8(float _value)
+	{
+		return static_cast<int8_t>(std::round(std::clamp(_value, -1.0f, 1.0f) * 127.0f));
+	}
+
+	glm::i16vec2 EncodeOctahedral(const glm::vec3& _normal)
+	{
+		glm::vec3 n = _normal / (std::abs(_normal.x) + std::abs(_normal.y) + std::abs(_normal.z) + 1e-20f);
+		glm::vec2 encoded = glm::vec2(n.x, n.y);
+
+		if (n.z < 0.0f)
+		{
+			encoded.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+			encoded.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+		}
+
+		return { PackSnorm16(encoded.x), PackSnorm16(encoded.y) };
+	}
+
+	glm::i8vec4 EncodeTangent(const cp::Vertex& _vertex)
+	{
+		const float sign = glm::dot(glm::cross(_vertex.normal, _vertex.tangent), _vertex.bitangent) < 0.0f ? -1.0f : 1.0f;
+		return { PackSnorm8(_vertex.tangent.x), PackSnorm8(_vertex.tangent.y), PackSnorm8(_vertex.tangent.z), PackSnorm8(sign) };
+	}
+
+	glm::u16vec2 EncodeUV(const glm::vec2& _uv)
+	{
+		return { glm::packHalf1x16(_uv.x), glm::packHalf1x16(_uv.y) };
+	}
+
+	cp::VertexInputDescription MakeDescription(uint32_t _stride, std::vector<vk::VertexInputAttributeDescription> _attributes)
+	{
+		return { vk::VertexInputBindingDescription(0, _stride, vk::VertexInputRate::eVertex), std::move(_attributes) };
+	}
+}
+
+uint32_t cp::GetVertexStride(VertexFormat _format)
+{
+	switch (_format)
+	{
+	case VertexFormat::Compact: return sizeof(CompactVertex);
+	case VertexFormat::CompactQuantized: return sizeof(CompactQuantizedVertex);
+	default: return sizeof(Vertex);
+	}
+}
+
+const cp::VertexInputDescription& cp::GetVertexInputDescription(VertexFormat _format)
+{
+	static const VertexInputDescription standard = MakeDescription(sizeof(Vertex), {
+		vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, position)),
+		vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, normal)),
+		vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, uv)),
+		vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, tangent)),
+		vk::VertexInputAttributeDescription(4, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, bitangent)),
+	});
+
+	static const VertexInputDescription compact = MakeDescription(sizeof(CompactVertex), {
+		vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(CompactVertex, position)),
+		vk::VertexInputAttributeDescription(1, 0, vk::Format::eR16G16Snorm, offsetof(CompactVertex, normal)),
+		vk::VertexInputAttributeDescription(2, 0, vk::Format::eR16G16Sfloat, offsetof(CompactVertex, uv)),
+		vk::VertexInputAttributeDescription(3, 0, vk::Format::eR8G8B8A8Snorm, offsetof(CompactVertex, tangent)),
+	});
+
+	static const VertexInputDescription compactQuantized = MakeDescription(sizeof(CompactQuantizedVertex), {
+		vk::VertexInputAttributeDescription(0, 0, vk::Format::eR16G16B16A16Snorm, offsetof(CompactQuantizedVertex, position)),
+		vk::VertexInputAttributeDescription(1, 0, vk::Format::eR16G16Snorm, offsetof(CompactQuantizedVertex, normal)),
+		vk::VertexInputAttributeDescription(2, 0, vk::Format::eR16G16Sfloat, offsetof(CompactQuantizedVertex, uv)),
+		vk::VertexInputAttributeDescription(3, 0, vk::Format::eR8G8B8A8Snorm, offsetof(CompactQuantizedVertex, tangent)),
+	});
+
+	switch (_format)
+	{
+	case VertexFormat::Compact: return compact;
+	case VertexFormat::CompactQuantized: return compactQuantized;
+	default: return standard;
+	}
+}
+
+std::vector<uint8_t> cp::EncodeVertices(VertexFormat _format, const std::vector<Vertex>& _vertices, const MeshBounds& _bounds)
+{
+	std::vector<uint8_t> data(static_cast<size_t>(GetVertexStride(_format)) * _vertices.size());
+
+	switch (_format)
+	{
+	case VertexFormat::Compact:
+	{
+		CompactVertex* out = reinterpret_cast<CompactVertex*>(data.data());
+		for (size_t i = 0; i < _vertices.size(); i++)
+		{
+			out[i].position = _vertices[i].position;
+			out[i].normal = EncodeOctahedral(_vertices[i].normal);
+			out[i].uv = EncodeUV(_vertices[i].uv);
+			out[i].tangent = EncodeTangent(_vertices[i]);
+		}
+		break;
+	}
+	case VertexFormat::CompactQuantized:
+	{
+		const glm::vec3 center = (_bounds.min + _bounds.max) * 0.5f;
+		const glm::vec3 extent = glm::max((_bounds.max - _bounds.min) * 0.5f, glm::vec3(1e-6f));
+
+		CompactQuantizedVertex* out = reinterpret_cast<CompactQuantizedVertex*>(data.data());
+		for (size_t i = 0; i < _vertices.size(); i++)
+		{
+			const glm::vec3 quantized = (_vertices[i].position - center) / extent;
+			out[i].position = { PackSnorm16(quantized.x), PackSnorm16(quantized.y), PackSnorm16(quantized.z), PackSnorm16(1.0f) };
+			out[i].normal = EncodeOctahedral(_vertices[i].normal);
+			out[i].uv = EncodeUV(_vertices[i].uv);
+			out[i].tangent = EncodeTangent(_vertices[i]);
+		}
+		break;
+	}
+	default:
+		std::memcpy(data.data(), _vertices.data(), data.size());
+		break;
+	}
+
+	return data;
+}
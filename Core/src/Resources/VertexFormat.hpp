@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../pch.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+namespace cp
+{
+	struct Vertex;
+	struct MeshBounds;
+
+	enum class VertexFormat : uint8_t
+	{
+		Standard = 0, // cp::Vertex, 56 bytes
+		Compact = 1, // cp::CompactVertex, 24 bytes
+		CompactQuantized = 2, // cp::CompactQuantizedVertex, 20 bytes, positions are dequantized with Mesh::GetDequantizationMatrix()
+	};
+
+	// Normal is octahedral encoded, the bitangent is rebuilt in the shader from cross(normal, tangent.xyz) * tangent.w
+	struct CompactVertex
+	{
+		glm::vec3 position;
+		glm::i16vec2 normal; // R16G16Snorm
+		glm::u16vec2 uv; // R16G16Sfloat
+		glm::i8vec4 tangent; // R8G8B8A8Snorm, w is the bitangent sign
+	};
+
+	struct CompactQuantizedVertex
+	{
+		glm::i16vec4 position; // R16G16B16A16Snorm, [-1, 1] inside the mesh bounds
+		glm::i16vec2 normal;
+		glm::u16vec2 uv;
+		glm::i8vec4 tangent;
+	};
+
+	struct VertexInputDescription
+	{
+		vk::VertexInputBindingDescription binding;
+		std::vector<vk::VertexInputAttributeDescription> attributes;
+	};
+
+	uint32_t GetVertexStride(VertexFormat _format);
+	const VertexInputDescription& GetVertexInputDescription(VertexFormat _format); // Descriptions are static, pointers into them stay valid for pipeline creation
+
+	std::vector<uint8_t> EncodeVertices(VertexFormat _format, const std::vector<Vertex>& _vertices, const MeshBounds& _bounds);
+}
@@ -0,0 +1,177 @@
+#include "pch.hpp"
+#include "FileWatcher.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace cp
+{
+	FileWatcher::FileWatcher(std::chrono::milliseconds _pollInterval) : pollInterval(_pollInterval)
+	{
+#ifdef __linux__
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+		if (inotifyFd < 0)
+		{
+			LOG_ERROR(MF("Failed to initialize inotify (errno ", errno, ")"));
+			throw std::runtime_error("Failed to initialize inotify");
+		}
+#endif
+
+		running = true;
+		thread = std::thread(&FileWatcher::Run, this);
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+		running = false;
+		thread.join();
+
+#ifdef __linux__
+		close(inotifyFd);
+#endif
+	}
+
+	void FileWatcher::Watch(const std::string& _directory)
+	{
+		std::error_code error;
+		std::string directory = std::filesystem::weakly_canonical(_directory, error).string();
+
+		if (!std::filesystem::is_directory(directory, error))
+		{
+			LOG_WARNING(MF("Cannot watch [", _directory, "], not a directory"));
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (std::find(directories.begin(), directories.end(), directory) != directories.end()) return;
+		directories.push_back(directory);
+
+#ifdef __linux__
+		AddWatch(directory);
+#else
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+		{
+			if (entry.is_regular_file(error)) snapshot[entry.path().string()] = entry.last_write_time(error);
+		}
+#endif
+
+		LOG_TRACE(MF("Watching [", directory, "]"));
+	}
+
+	std::vector<std::string> FileWatcher::Poll()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::vector<std::string> changed(changes.begin(), changes.end());
+		changes.clear();
+
+		return changed;
+	}
+
+#ifdef __linux__
+	void FileWatcher::AddWatch(const std::string& _directory)
+	{
+		const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+		int descriptor = inotify_add_watch(inotifyFd, _directory.c_str(), mask);
+		if (descriptor < 0)
+		{
+			LOG_WARNING(MF("Failed to watch [", _directory, "] (errno ", errno, ")"));
+			return;
+		}
+
+		watchDescriptors[descriptor] = _directory;
+
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(_directory, error))
+		{
+			if (entry.is_directory(error)) AddWatch(entry.path().string());
+		}
+	}
+
+	void FileWatcher::ReadEvents()
+	{
+		alignas(inotify_event) char buffer[4096];
+
+		while (true)
+		{
+			ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+			if (length <= 0) return; // EAGAIN, everything pending was read
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			for (char* it = buffer; it < buffer + length;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(it);
+				it += sizeof(inotify_event) + event->len;
+
+				auto directory = watchDescriptors.find(event->wd);
+				if (directory == watchDescriptors.end() || event->len == 0) continue;
+
+				std::string path = (std::filesystem::path(directory->second) / event->name).string();
+
+				if (event->mask & IN_ISDIR)
+				{
+					if (event->mask & (IN_CREATE | IN_MOVED_TO)) AddWatch(path);
+					continue;
+				}
+
+				if (event->mask & IN_CREATE) continue; // Followed by IN_CLOSE_WRITE once the content is there
+
+				changes.insert(path);
+			}
+		}
+	}
+
+	void FileWatcher::Run()
+	{
+		pollfd descriptor = { inotifyFd, POLLIN, 0 };
+
+		while (running)
+		{
+			// The timeout only bounds how long the destructor waits
+			if (poll(&descriptor, 1, static_cast<int>(pollInterval.count())) > 0 && (descriptor.revents & POLLIN))
+			{
+				ReadEvents();
+			}
+		}
+	}
+#else
+	void FileWatcher::Scan()
+	{
+		std::error_code error;
+
+		for (const auto& directory : directories)
+		{
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+			{
+				if (!entry.is_regular_file(error)) continue;
+
+				auto writeTime = entry.last_write_time(error);
+				auto [it, inserted] = snapshot.try_emplace(entry.path().string(), writeTime);
+
+				if (!inserted && it->second == writeTime) continue;
+
+				it->second = writeTime;
+				changes.insert(it->first);
+			}
+		}
+	}
+
+	void FileWatcher::Run()
+	{
+		while (running)
+		{
+			std::this_thread::sleep_for(pollInterval);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			Scan();
+		}
+	}
+#endif
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../pch.hpp"
+
+#include <atomic>
+
+namespace cp
+{
+	// Reports files written, created or renamed under the watched directories (recursively)
+	// Uses inotify on Linux and timestamp polling elsewhere, events are gathered on a background thread and drained by Poll
+	class FileWatcher
+	{
+	private:
+		std::thread thread;
+		std::atomic<bool> running = false;
+		std::chrono::milliseconds pollInterval;
+
+		std::mutex mutex;
+		std::vector<std::string> directories;
+		std::unordered_set<std::string> changes; // Weakly canonical paths, an editor saving a file often fires several events
+
+#ifdef __linux__
+		int inotifyFd = -1;
+		std::unordered_map<int, std::string> watchDescriptors;
+
+		void AddWatch(const std::string& _directory); // The directory and every subdirectory, inotify is not recursive
+		void ReadEvents();
+#else
+		std::unordered_map<std::string, std::filesystem::file_time_type> snapshot;
+
+		void Scan();
+#endif
+
+		void Run();
+
+	public:
+		NO_COPY(FileWatcher)
+
+		FileWatcher(std::chrono::milliseconds _pollInterval = std::chrono::milliseconds(250));
+		~FileWatcher();
+
+		void Watch(const std::string& _directory);
+
+		std::vector<std::string> Poll(); // Files changed since the last call
+	};
+}
@@ -0,0 +1,124 @@
+#include "pch.hpp"
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI // wingdi.h defines ERROR, which breaks LOG_ERROR
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+cp::MappedFile::MappedFile(const std::string& _path)
+{
+	Open(_path);
+}
+
+cp::MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool cp::MappedFile::Open(const std::string& _path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LOG_ERROR(MF("Failed to open file for mapping: ", _path));
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		LOG_ERROR(MF("Cannot map empty or unreadable file: ", _path));
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!mapping)
+	{
+		CloseHandle(file);
+		LOG_ERROR(MF("Failed to create file mapping: ", _path));
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!view)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		LOG_ERROR(MF("Failed to map view of file: ", _path));
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = static_cast<const uint8_t*>(view);
+	size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int fd = open(_path.c_str(), O_RDONLY);
+
+	if (fd < 0)
+	{
+		LOG_ERROR(MF("Failed to open file for mapping: ", _path));
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close(fd);
+		LOG_ERROR(MF("Cannot map empty or unreadable file: ", _path));
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (view == MAP_FAILED)
+	{
+		close(fd);
+		LOG_ERROR(MF("Failed to map file: ", _path));
+		return false;
+	}
+
+	madvise(view, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+
+	fileDescriptor = fd;
+	data = static_cast<const uint8_t*>(view);
+	size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+	return true;
+}
+
+void cp::MappedFile::Close()
+{
+	if (!data) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(static_cast<HANDLE>(mappingHandle));
+	CloseHandle(static_cast<HANDLE>(fileHandle));
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(data), size);
+	close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+
+	data = nullptr;
+	size = 0;
+}
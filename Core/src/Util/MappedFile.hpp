@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../pch.hpp"
+
+namespace cp
+{
+	class MappedFile
+	{
+	private:
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+
+	public:
+		MappedFile() = default;
+		MappedFile(const std::string& _path);
+		~MappedFile();
+
+		NO_COPY(MappedFile)
+
+		bool Open(const std::string& _path); // Maps the whole file read-only, returns false if the file couldn't be opened or mapped
+		void Close();
+
+		inline bool IsOpen() const { return data != nullptr; }
+		inline const uint8_t* GetData() const { return data; }
+		inline size_t GetSize() const { return size; }
+
+		template<typename T>
+		inline const T* As(size_t _offset = 0) const { return reinterpret_cast<const T*>(data + _offset); }
+	};
+}
@@ -373,12 +373,19 @@ bool cp::JsonSerializer::BeginObjectReading(const std::string& _name)
 
 std::tuple<size_t, std::string*> cp::JsonSerializer::ReadStringArray(const std::string& _name)
 {
-	size_t size = data[_name].size();
+	if (!objectStack.back()->contains(_name) || !objectStack.back()->operator[](_name).is_array())
+	{
+		return std::make_tuple(0, nullptr);
+	}
+
+	const json& values = objectStack.back()->operator[](_name);
+
+	size_t size = values.size();
 	std::string* array = new std::string[size];
 
 	for (size_t i = 0; i < size; i++)
 	{
-		array[i] = data[_name][i].get<std::string>();
+		array[i] = values[i].get<std::string>();
 	}
 
 	return std::make_tuple(size, array);
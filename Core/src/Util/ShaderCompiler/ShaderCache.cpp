@@ -0,0 +1,211 @@
+#include "pch.hpp"
+#include "ShaderCache.hpp"
+
+#include <regex>
+#include <iomanip>
+
+#include "SlangCompiler.hpp"
+#include "../Serializers/JsonSerializer.hpp"
+
+namespace
+{
+	std::string ReadFile(const std::string& _path)
+	{
+		std::ifstream file(_path, std::ios::binary);
+		if (!file.is_open()) return {};
+
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		return buffer.str();
+	}
+
+	// Slang maps module names to files by turning '.' into '/' and '_' into '-', keep the literal name as a first guess
+	std::vector<std::string> ImportCandidates(const std::string& _name)
+	{
+		if (_name.ends_with(".slang")) return { _name };
+
+		std::string path = _name;
+		std::replace(path.begin(), path.end(), '.', '/');
+
+		std::string dashed = path;
+		std::replace(dashed.begin(), dashed.end(), '_', '-');
+
+		return { path + ".slang", dashed + ".slang" };
+	}
+
+	std::optional<std::filesystem::path> Resolve(const std::vector<std::string>& _candidates, const std::filesystem::path& _includerDirectory, const std::vector<std::string>& _searchPaths)
+	{
+		std::error_code error;
+
+		for (const auto& candidate : _candidates)
+		{
+			if (std::filesystem::exists(_includerDirectory / candidate, error))
+				return std::filesystem::weakly_canonical(_includerDirectory / candidate, error);
+
+			for (const auto& searchPath : _searchPaths)
+			{
+				if (std::filesystem::exists(std::filesystem::path(searchPath) / candidate, error))
+					return std::filesystem::weakly_canonical(std::filesystem::path(searchPath) / candidate, error);
+			}
+		}
+
+		return std::nullopt;
+	}
+}
+
+cp::ShaderCache& cp::ShaderCache::Get()
+{
+	static ShaderCache instance("Cache/Shaders");
+	return instance;
+}
+
+std::string cp::ShaderCache::GetEntryPath(size_t _key, const std::string& _extension) const
+{
+	std::stringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << _key << _extension;
+	return (std::filesystem::path(directory) / name.str()).string();
+}
+
+std::vector<std::string> cp::ShaderCache::CollectDependencies(const std::string& _sourcePath, const std::vector<std::string>& _searchPaths)
+{
+	static const std::regex includePattern(R"re(^\s*#\s*include\s*[<"]([^>"]+)[>"])re");
+	static const std::regex importPattern(R"re(^\s*(?:import|__include)\s+"?([A-Za-z0-9_.\-/]+)"?\s*;)re");
+
+	std::error_code error;
+	std::vector<std::string> dependencies;
+	std::unordered_set<std::string> visited;
+	std::vector<std::filesystem::path> toScan = { std::filesystem::weakly_canonical(_sourcePath, error) };
+
+	while (!toScan.empty())
+	{
+		std::filesystem::path current = toScan.back();
+		toScan.pop_back();
+
+		if (!visited.insert(current.string()).second) continue;
+		dependencies.push_back(current.string());
+
+		std::ifstream file(current);
+		std::string line;
+
+		while (std::getline(file, line))
+		{
+			std::smatch match;
+			std::vector<std::string> candidates;
+
+			if (std::regex_search(line, match, includePattern))
+				candidates = { match[1].str() };
+			else if (std::regex_search(line, match, importPattern))
+				candidates = ImportCandidates(match[1].str());
+			else
+				continue;
+
+			if (auto resolved = Resolve(candidates, current.parent_path(), _searchPaths))
+				toScan.push_back(*resolved);
+			// Unresolved names are builtin modules or errors Slang will report, nothing to hash either way
+		}
+	}
+
+	return dependencies;
+}
+
+size_t cp::ShaderCache::ComputeKey(const ShaderCompileRequest& _request, const std::string& _compilerTag, const std::vector<std::string>& _searchPaths) const
+{
+	size_t key = 0;
+
+	Helper::Hash::CombineHashes(key, VERSION);
+	Helper::Hash::CombineHashes(key, _compilerTag);
+	Helper::Hash::CombineHashes(key, _request.profile);
+	Helper::Hash::CombineHashes(key, _request.moduleName);
+
+	for (const auto& macro : _request.macros)
+	{
+		Helper::Hash::CombineHashes(key, macro.name);
+		Helper::Hash::CombineHashes(key, macro.value);
+	}
+
+	// Contents only, moving a project around keeps its cache valid
+	for (const auto& dependency : CollectDependencies(_request.sourcePath, _searchPaths))
+	{
+		Helper::Hash::CombineHashes(key, ReadFile(dependency));
+	}
+
+	return key;
+}
+
+bool cp::ShaderCache::Load(size_t _key, ShaderCompileResult& _result) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::string spirvPath = GetEntryPath(_key, ".spv");
+	std::string reflectionPath = GetEntryPath(_key, ".json");
+
+	std::error_code error;
+	if (!std::filesystem::exists(spirvPath, error) || !std::filesystem::exists(reflectionPath, error))
+	{
+		return false;
+	}
+
+	std::string spirv = ReadFile(spirvPath);
+	if (spirv.empty()) return false;
+
+	try
+	{
+		cp::JsonSerializer serializer;
+		serializer.Read(reflectionPath);
+
+		_result.reflection = ShaderReflection();
+		if (serializer.BeginObjectReading("Reflection"))
+		{
+			_result.reflection.Deserialize(serializer);
+			serializer.EndObject();
+		}
+
+		auto [dependencyCount, dependencies] = serializer.ReadStringArray("Dependencies");
+		_result.dependencies.assign(dependencies, dependencies + dependencyCount);
+		delete[] dependencies;
+	}
+	catch (const std::exception& e)
+	{
+		LOG_WARNING(MF("Corrupted shader cache entry [", reflectionPath, "] : ", e.what()));
+		return false;
+	}
+
+	_result.spirv.assign(spirv.begin(), spirv.end());
+	_result.success = true;
+	_result.fromCache = true;
+
+	return true;
+}
+
+void cp::ShaderCache::Store(size_t _key, const ShaderCompileResult& _result) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	std::string spirvPath = GetEntryPath(_key, ".spv");
+	std::string reflectionPath = GetEntryPath(_key, ".json");
+
+	// Reflection first, Load only trusts an entry once its .spv exists
+	cp::JsonSerializer serializer;
+	serializer.BeginObjectWriting("Reflection");
+	_result.reflection.Serialize(serializer);
+	serializer.EndObject();
+	serializer.WriteStringArray("Dependencies", _result.dependencies.size(), _result.dependencies.data());
+	serializer.Write(reflectionPath);
+
+	std::string tempPath = spirvPath + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		LOG_WARNING(MF("Failed to write shader cache entry: ", spirvPath));
+		return;
+	}
+
+	file.write(_result.spirv.data(), static_cast<std::streamsize>(_result.spirv.size()));
+	file.close();
+
+	std::filesystem::rename(tempPath, spirvPath, error);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../../pch.hpp"
+
+namespace cp
+{
+	struct ShaderCompileRequest;
+	struct ShaderCompileResult;
+
+	// Content addressed store of compiled shaders, keyed by everything that can change the SPIR-V :
+	// the source text, every file it includes or imports (transitively), the macros, the profile and the compiler build / options
+	// Each entry is <key>.spv next to <key>.json (reflection and dependency list), a hit skips Slang entirely
+	class ShaderCache
+	{
+	private:
+		std::string directory;
+		mutable std::mutex mutex; // Entries are written by compiler worker threads
+
+		ShaderCache(const std::string& _directory) : directory(_directory) {}
+
+		std::string GetEntryPath(size_t _key, const std::string& _extension) const;
+
+	public:
+		static constexpr uint32_t VERSION = 1;
+
+		NO_COPY(ShaderCache)
+
+		static ShaderCache& Get();
+
+		size_t ComputeKey(const ShaderCompileRequest& _request, const std::string& _compilerTag, const std::vector<std::string>& _searchPaths) const;
+
+		bool Load(size_t _key, ShaderCompileResult& _result) const;
+		void Store(size_t _key, const ShaderCompileResult& _result) const;
+
+		static std::vector<std::string> CollectDependencies(const std::string& _sourcePath, const std::vector<std::string>& _searchPaths); // Scans #include and import statements, _sourcePath first
+
+		inline void SetDirectory(const std::string& _directory) { directory = _directory; }
+		inline const std::string& GetDirectory() const { return directory; }
+	};
+}
@@ -0,0 +1,157 @@
+#include "pch.hpp"
+#include "ShaderCache.hpp"
+
+#include "SlangCompiler.hpp"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+	// A scratch shader project, removed with the fixture
+	class ShaderCacheFiles : public ::testing::Test
+	{
+	protected:
+		std::filesystem::path root;
+
+		void SetUp() override
+		{
+			const auto* test = ::testing::UnitTest::GetInstance()->current_test_info();
+			root = std::filesystem::temp_directory_path() / "CoreTests" / "ShaderCache" / test->name();
+			std::filesystem::remove_all(root);
+			std::filesystem::create_directories(root);
+		}
+
+		void TearDown() override
+		{
+			std::error_code error;
+			std::filesystem::remove_all(root, error);
+		}
+
+		std::string Write(const std::filesystem::path& _relativePath, const std::string& _content) const
+		{
+			std::filesystem::path path = root / _relativePath;
+			std::filesystem::create_directories(path.parent_path());
+
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			file << _content;
+
+			return std::filesystem::weakly_canonical(path).string();
+		}
+
+		cp::ShaderCompileRequest MakeRequest(const std::string& _sourcePath) const
+		{
+			cp::ShaderCompileRequest request;
+			request.moduleName = "Material";
+			request.sourcePath = _sourcePath;
+			return request;
+		}
+	};
+}
+
+TEST_F(ShaderCacheFiles, DependenciesAreTransitive)
+{
+	std::string material = Write("Material.slang", "#include \"Common.slang\"\nimport Lighting;\n");
+	std::string common = Write("Common.slang", "float4 White() { return 1; }\n");
+	std::string lighting = Write("Lighting.slang", "  import shared.light_math;\n");
+	std::string lightMath = Write("Library/shared/light-math.slang", "float Lambert(float x) { return x; }\n"); // Found through the search path, '_' spelled '-'
+
+	std::vector<std::string> dependencies = cp::ShaderCache::CollectDependencies(material, { (root / "Library").string() });
+
+	ASSERT_FALSE(dependencies.empty());
+	EXPECT_EQ(dependencies.front(), material);
+
+	std::set<std::string> found(dependencies.begin(), dependencies.end());
+	EXPECT_EQ(found, std::set<std::string>({ material, common, lighting, lightMath }));
+	EXPECT_EQ(found.size(), dependencies.size());
+}
+
+TEST_F(ShaderCacheFiles, CyclesAndUnresolvedNamesTerminate)
+{
+	std::string a = Write("A.slang", "#include \"B.slang\"\nimport slang_builtin_module;\n");
+	std::string b = Write("B.slang", "#include \"A.slang\"\n#include \"Missing.slang\"\n");
+
+	std::vector<std::string> dependencies = cp::ShaderCache::CollectDependencies(a, {});
+
+	EXPECT_EQ(dependencies, std::vector<std::string>({ a, b }));
+}
+
+TEST_F(ShaderCacheFiles, KeyFollowsEveryDependency)
+{
+	std::string material = Write("Material.slang", "#include \"Common.slang\"\n");
+	Write("Common.slang", "float4 White() { return 1; }\n");
+
+	const cp::ShaderCache& cache = cp::ShaderCache::Get();
+	cp::ShaderCompileRequest request = MakeRequest(material);
+	size_t key = cache.ComputeKey(request, "compiler", {});
+
+	EXPECT_EQ(cache.ComputeKey(request, "compiler", {}), key);
+
+	Write("Common.slang", "float4 White() { return 0.5; }\n"); // Only an include changes
+	size_t edited = cache.ComputeKey(request, "compiler", {});
+	EXPECT_NE(edited, key);
+
+	Write("Common.slang", "float4 White() { return 1; }\n");
+	EXPECT_EQ(cache.ComputeKey(request, "compiler", {}), key);
+}
+
+TEST_F(ShaderCacheFiles, KeyFollowsTheRequest)
+{
+	std::string material = Write("Material.slang", "float4 main() { return 1; }\n");
+
+	const cp::ShaderCache& cache = cp::ShaderCache::Get();
+	cp::ShaderCompileRequest request = MakeRequest(material);
+	size_t key = cache.ComputeKey(request, "compiler", {});
+
+	EXPECT_NE(cache.ComputeKey(request, "other compiler", {}), key);
+
+	cp::ShaderCompileRequest macro = request;
+	macro.macros.push_back({ "USE_NORMAL_MAP", "1" });
+	EXPECT_NE(cache.ComputeKey(macro, "compiler", {}), key);
+
+	cp::ShaderCompileRequest value = request;
+	value.macros.push_back({ "USE_NORMAL_MAP", "0" });
+	EXPECT_NE(cache.ComputeKey(value, "compiler", {}), cache.ComputeKey(macro, "compiler", {}));
+
+	cp::ShaderCompileRequest profile = request;
+	profile.profile = "spirv_1_5";
+	EXPECT_NE(cache.ComputeKey(profile, "compiler", {}), key);
+}
+
+TEST_F(ShaderCacheFiles, KeyIgnoresWhereTheProjectLives)
+{
+	std::string material = Write("First/Material.slang", "#include \"Common.slang\"\n");
+	Write("First/Common.slang", "float4 White() { return 1; }\n");
+	std::string moved = Write("Second/Material.slang", "#include \"Common.slang\"\n");
+	Write("Second/Common.slang", "float4 White() { return 1; }\n");
+
+	const cp::ShaderCache& cache = cp::ShaderCache::Get();
+	EXPECT_EQ(cache.ComputeKey(MakeRequest(material), "compiler", {}), cache.ComputeKey(MakeRequest(moved), "compiler", {}));
+}
+
+TEST_F(ShaderCacheFiles, StoredEntriesLoadBack)
+{
+	cp::ShaderCache& cache = cp::ShaderCache::Get();
+	std::string directory = cache.GetDirectory();
+	cache.SetDirectory((root / "Cache").string());
+
+	cp::ShaderCompileResult result;
+	result.success = true;
+	result.spirv = { 0x03, 0x02, 0x23, 0x07, 0x00, 0x01 };
+	result.dependencies = { "Material.slang", "Common.slang" };
+
+	cp::ShaderCompileResult missing;
+	EXPECT_FALSE(cache.Load(42, missing));
+
+	cache.Store(42, result);
+
+	cp::ShaderCompileResult loaded;
+	ASSERT_TRUE(cache.Load(42, loaded));
+	EXPECT_TRUE(loaded.success);
+	EXPECT_TRUE(loaded.fromCache);
+	EXPECT_EQ(loaded.spirv, result.spirv);
+	EXPECT_EQ(loaded.dependencies, result.dependencies);
+
+	EXPECT_FALSE(cache.Load(43, missing));
+
+	cache.SetDirectory(directory);
+}
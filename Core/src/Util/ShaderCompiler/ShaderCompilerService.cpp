@@ -0,0 +1,147 @@
+#include "pch.hpp"
+#include "ShaderCompilerService.hpp"
+
+#include "ShaderCache.hpp"
+
+#include "Resources/Material.hpp"
+
+namespace cp
+{
+	ShaderCompilerService::ShaderCompilerService(uint32_t _threadCount)
+	{
+		ShaderCache::Get(); // Built first so it outlives the workers writing to it
+
+		workers = std::make_unique<cp::ThreadPool>(_threadCount);
+
+		LOG_TRACE(MF("Shader compiler service started with ", workers->GetThreadCount(), " threads"));
+	}
+
+	ShaderCompilerService::~ShaderCompilerService()
+	{
+		workers.reset();
+	}
+
+	ShaderCompilerService& ShaderCompilerService::Get()
+	{
+		static ShaderCompilerService instance(0);
+		return instance;
+	}
+
+	size_t ShaderCompilerService::ComputeRequestKey(const ShaderCompileRequest& _request)
+	{
+		size_t key = 0;
+
+		Helper::Hash::CombineHashes(key, _request.moduleName);
+		Helper::Hash::CombineHashes(key, _request.sourcePath);
+		Helper::Hash::CombineHashes(key, _request.profile);
+
+		for (const auto& macro : _request.macros)
+		{
+			Helper::Hash::CombineHashes(key, macro.name);
+			Helper::Hash::CombineHashes(key, macro.value);
+		}
+
+		// A save while the previous version compiles must not be answered with the old result
+		std::error_code error;
+		auto writeTime = std::filesystem::last_write_time(_request.sourcePath, error);
+		Helper::Hash::CombineHashes(key, writeTime.time_since_epoch().count());
+
+		return key;
+	}
+
+	SlangCompiler& ShaderCompilerService::GetThreadCompiler()
+	{
+		// Created on the first job each worker runs, destroyed with the thread
+		static thread_local std::unique_ptr<SlangCompiler> compiler;
+
+		if (!compiler)
+		{
+			compiler = std::make_unique<SlangCompiler>();
+		}
+
+		return *compiler;
+	}
+
+	std::shared_future<ShaderCompileResult> ShaderCompilerService::Submit(const ShaderCompileRequest& _request)
+	{
+		size_t key = ComputeRequestKey(_request);
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = inFlight.find(key);
+		if (it != inFlight.end())
+		{
+			LOG_TRACE(MF("Shader [", _request.moduleName, "] is already compiling, sharing its result"));
+			return it->second;
+		}
+
+		auto promise = std::make_shared<std::promise<ShaderCompileResult>>();
+		std::shared_future<ShaderCompileResult> future = promise->get_future().share();
+		inFlight[key] = future;
+
+		workers->Submit([this, key, request = _request, promise]() {
+			ShaderCompileResult result;
+
+			try
+			{
+				result = GetThreadCompiler().CompileCached(request);
+			}
+			catch (const std::exception& e)
+			{
+				LOG_ERROR(MF("Failed to compile shader [", request.moduleName, "] : ", e.what()));
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				inFlight.erase(key);
+			}
+
+			promise->set_value(std::move(result));
+		});
+
+		return future;
+	}
+
+	bool ShaderCompilerService::CompileMaterial(Material& _material)
+	{
+		std::shared_future<ShaderCompileResult> future = Submit(SlangCompiler::MakeMaterialRequest(_material));
+		return SlangCompiler::ApplyMaterialResult(_material, future.get());
+	}
+
+	size_t ShaderCompilerService::CompileMaterials(const std::vector<Material*>& _materials)
+	{
+		std::vector<std::shared_future<ShaderCompileResult>> futures;
+		futures.reserve(_materials.size());
+
+		for (Material* material : _materials)
+		{
+			futures.push_back(Submit(SlangCompiler::MakeMaterialRequest(*material)));
+		}
+
+		size_t succeeded = 0;
+
+		// Materials are not thread safe, only the compilation itself runs on the workers
+		for (size_t i = 0; i < _materials.size(); i++)
+		{
+			const ShaderCompileResult& result = futures[i].get();
+
+			if (SlangCompiler::ApplyMaterialResult(*_materials[i], result))
+			{
+				succeeded++;
+			}
+			else
+			{
+				LOG_ERROR(MF("Failed to compile material [", _materials[i]->GetName(), "]"));
+			}
+		}
+
+		LOG_INFO(MF("Compiled ", succeeded, "/", _materials.size(), " materials"));
+
+		return succeeded;
+	}
+
+	void ShaderCompilerService::WaitIdle()
+	{
+		workers->WaitIdle();
+	}
+}
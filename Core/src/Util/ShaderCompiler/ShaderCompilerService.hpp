@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../../pch.hpp"
+
+#include <future>
+
+#include "SlangCompiler.hpp"
+#include "../ThreadPool.hpp"
+
+namespace cp
+{
+	class Material;
+
+	// Compiles shaders on a pool of worker threads, each one owning its own SlangCompiler since a Slang global session can't be shared between threads
+	// Identical requests submitted while one is still in flight share its future instead of compiling twice
+	class ShaderCompilerService
+	{
+	private:
+		std::unique_ptr<cp::ThreadPool> workers;
+
+		std::mutex mutex;
+		std::unordered_map<size_t, std::shared_future<ShaderCompileResult>> inFlight;
+
+		ShaderCompilerService(uint32_t _threadCount);
+
+		static size_t ComputeRequestKey(const ShaderCompileRequest& _request);
+		static SlangCompiler& GetThreadCompiler();
+
+	public:
+		NO_COPY(ShaderCompilerService)
+
+		~ShaderCompilerService();
+
+		static ShaderCompilerService& Get();
+
+		std::shared_future<ShaderCompileResult> Submit(const ShaderCompileRequest& _request);
+
+		bool CompileMaterial(Material& _material); // Blocks until the material is compiled
+		size_t CompileMaterials(const std::vector<Material*>& _materials); // Compiles in parallel then applies the results on the calling thread, returns how many succeeded
+
+		void WaitIdle();
+
+		inline size_t GetThreadCount() const { return workers->GetThreadCount(); }
+	};
+}
@@ -0,0 +1,149 @@
+#include "pch.hpp"
+#include "ShaderHotReloader.hpp"
+
+#include "ShaderCache.hpp"
+#include "ShaderCompilerService.hpp"
+
+#include "Resources/Material.hpp"
+#include "Resources/MaterialInstance.hpp"
+#include "Resources/ResourceManager.hpp"
+
+cp::ShaderHotReloader* cp::ShaderHotReloader::instance = nullptr;
+
+cp::ShaderHotReloader* cp::ShaderHotReloader::Create()
+{
+	if (!instance)
+	{
+		instance = new cp::ShaderHotReloader();
+		LOG_INFO("Shader hot reload enabled");
+	}
+
+	return instance;
+}
+
+cp::ShaderHotReloader* cp::ShaderHotReloader::Get()
+{
+	return instance;
+}
+
+void cp::ShaderHotReloader::Destroy()
+{
+	delete instance;
+	instance = nullptr;
+}
+
+void cp::ShaderHotReloader::Watch(const std::string& _directory)
+{
+	watcher.Watch(_directory);
+}
+
+void cp::ShaderHotReloader::Track(cp::Material* _material)
+{
+	if (!materials.insert(_material).second) return;
+
+	SetDependencies(_material, cp::ShaderCache::CollectDependencies(_material->GetShaderPath(), cp::SlangCompiler::GetSearchPaths()));
+}
+
+void cp::ShaderHotReloader::Untrack(cp::Material* _material)
+{
+	if (materials.erase(_material) == 0) return;
+
+	RemoveDependencies(_material);
+	swapping.erase(_material);
+
+	pending.erase(std::remove_if(pending.begin(), pending.end(), [_material](const PendingCompile& _compile) { return _compile.material == _material; }), pending.end());
+}
+
+void cp::ShaderHotReloader::SetDependencies(cp::Material* _material, const std::vector<std::string>& _dependencies)
+{
+	RemoveDependencies(_material);
+
+	for (const auto& dependency : _dependencies)
+	{
+		dependents[dependency].insert(_material);
+	}
+}
+
+void cp::ShaderHotReloader::RemoveDependencies(cp::Material* _material)
+{
+	for (auto it = dependents.begin(); it != dependents.end();)
+	{
+		it->second.erase(_material);
+		it = it->second.empty() ? dependents.erase(it) : std::next(it);
+	}
+}
+
+void cp::ShaderHotReloader::ApplyResult(cp::Material* _material, const ShaderCompileResult& _result)
+{
+	if (!_result.success)
+	{
+		LOG_ERROR(MF("Hot reload of [", _material->GetName(), "] failed, keeping the current shader"));
+		return;
+	}
+
+	SetDependencies(_material, _result.dependencies); // An edit may have added or removed includes
+
+	if (!cp::SlangCompiler::ApplyMaterialResult(*_material, _result)) return;
+
+	// Instances point into the reflection that was just replaced
+	if (cp::ResourceManager* resources = cp::ResourceManager::Get())
+	{
+		if (auto* instances = resources->GetResourceType<cp::MaterialInstance>())
+		{
+			for (auto& materialInstance : instances->GetResources())
+			{
+				if (materialInstance && materialInstance->GetMaterial().get() == _material) materialInstance->ValidateData();
+			}
+		}
+	}
+
+	if (_material->GetRenderer())
+	{
+		_material->Reload(*_material->GetRenderer());
+		swapping.insert(_material);
+	}
+
+	LOG_INFO(MF("Hot reloaded [", _material->GetName(), "]"));
+}
+
+void cp::ShaderHotReloader::Update()
+{
+	// Edited files to the materials built from them
+	std::unordered_set<cp::Material*> affected;
+
+	for (const auto& path : watcher.Poll())
+	{
+		auto it = dependents.find(path);
+		if (it != dependents.end()) affected.insert(it->second.begin(), it->second.end());
+	}
+
+	for (cp::Material* material : affected)
+	{
+		LOG_TRACE(MF("Recompiling [", material->GetName(), "] after an edit"));
+
+		// A newer edit supersedes the compile still running for the previous one
+		pending.erase(std::remove_if(pending.begin(), pending.end(), [material](const PendingCompile& _compile) { return _compile.material == material; }), pending.end());
+		pending.push_back({ material, cp::ShaderCompilerService::Get().Submit(cp::SlangCompiler::MakeMaterialRequest(*material)) });
+	}
+
+	// Finished compiles queue their pipelines, PipelinesManager::Update publishes them at the end of this frame
+	for (auto it = pending.begin(); it != pending.end();)
+	{
+		if (it->compilation.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		PendingCompile compile = std::move(*it);
+		it = pending.erase(it);
+
+		ApplyResult(compile.material, compile.compilation.get());
+	}
+
+	// The replaced pipelines are retired once nothing draws with them anymore
+	for (auto it = swapping.begin(); it != swapping.end();)
+	{
+		it = (*it)->ReleasePreviousPipelines() ? swapping.erase(it) : std::next(it);
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../../pch.hpp"
+
+#include <future>
+
+#include "SlangCompiler.hpp"
+#include "../FileWatcher.hpp"
+
+namespace cp
+{
+	class Material;
+
+	// Recompiles the materials affected by a shader edit in the background and swaps their pipelines in at a frame boundary
+	// Materials register themselves on Reload, an edited file maps to its materials through the dependency lists of their last compile
+	class ShaderHotReloader
+	{
+	private:
+		struct PendingCompile
+		{
+			cp::Material* material;
+			std::shared_future<ShaderCompileResult> compilation;
+		};
+
+		static ShaderHotReloader* instance;
+
+		cp::FileWatcher watcher;
+
+		std::unordered_set<cp::Material*> materials;
+		std::unordered_map<std::string, std::unordered_set<cp::Material*>> dependents; // Source, included or imported file -> materials compiled from it
+		std::vector<PendingCompile> pending;
+		std::unordered_set<cp::Material*> swapping; // Reloaded, their previous pipelines draw until the new ones are ready
+
+		ShaderHotReloader() = default;
+
+		void SetDependencies(cp::Material* _material, const std::vector<std::string>& _dependencies);
+		void RemoveDependencies(cp::Material* _material);
+		void ApplyResult(cp::Material* _material, const ShaderCompileResult& _result);
+
+	public:
+		NO_COPY(ShaderHotReloader)
+
+		static ShaderHotReloader* Create();
+		static ShaderHotReloader* Get(); // nullptr when hot reload is disabled
+		static void Destroy();
+
+		void Watch(const std::string& _directory);
+
+		void Track(cp::Material* _material);
+		void Untrack(cp::Material* _material);
+
+		void Update(); // Once per frame on the render thread, before the pipelines manager publishes its pipelines
+
+		inline size_t GetPendingCount() const { return pending.size(); }
+	};
+}
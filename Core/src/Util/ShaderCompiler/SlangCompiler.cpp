@@ -3,6 +3,8 @@
 
 #include <spirv-tools/linker.hpp>
 
+#include "ShaderCache.hpp"
+
 #include "Resources/Material.hpp"
 
 namespace cp
@@ -76,23 +78,27 @@ namespace cp
 		return field;
 	}
 
+	std::vector<std::string> SlangCompiler::searchPaths;
+	std::vector<std::string> SlangCompiler::sharedModules;
+	std::mutex SlangCompiler::configurationMutex;
+
 	SlangCompiler::SlangCompiler()
 	{
 		if (createGlobalSession(globalSession.writeRef()) != SLANG_OK)
-			//Note : The global session is not thread-safe as of now, for each thread used to compile, we need to create a new one
+			//Note : The global session is not thread-safe, the ShaderCompilerService keeps one compiler per worker thread
 		{
 			LOG_ERROR("Failed to create global session");
 			throw std::runtime_error("Failed to create global session");
 		}
 	}
 
-	bool SlangCompiler::CompileMaterialSlangToSpirV(cp::Material& _material)
+	ComPtr<ISession> SlangCompiler::CreateSession(const ShaderCompileRequest& _request, const std::vector<std::string>& _searchPaths)
 	{
 		SessionDesc sessionDesc;
 
 		TargetDesc targetDesc;
 		targetDesc.format = SLANG_SPIRV;
-		targetDesc.profile = globalSession->findProfile("spirv_1_6");
+		targetDesc.profile = globalSession->findProfile(_request.profile.c_str());
 
 		CompilerOptionEntry compilerOptions[] = {
 			{ CompilerOptionName::VulkanUseEntryPointName, {.intValue0 = 1 } },
@@ -104,29 +110,138 @@ namespace cp
 		sessionDesc.targets = &targetDesc;
 		sessionDesc.targetCount = 1;
 
-		//std::string shaderModulePath = Project::GetProjectPath() + "/ShaderModules";
-		//const char* searchPaths[] = { shaderModulePath.c_str() }; //TODO : Add user defined search paths
-		//sessionDesc.searchPaths = searchPaths;
-		//sessionDesc.searchPathCount = 1;
+		std::vector<const char*> paths;
+		for (const auto& path : _searchPaths)
+		{
+			paths.push_back(path.c_str());
+		}
+		sessionDesc.searchPaths = paths.data();
+		sessionDesc.searchPathCount = static_cast<SlangInt>(paths.size());
 
-		PreprocessorMacroDesc macros[] = { { "CP_DEBUG", "1" } }; //TODO : Add user defined macros
-		sessionDesc.preprocessorMacros = macros;
-		sessionDesc.preprocessorMacroCount = 1;
+		std::vector<PreprocessorMacroDesc> macros;
+		for (const auto& macro : _request.macros)
+		{
+			macros.push_back({ macro.name.c_str(), macro.value.c_str() });
+		}
+		sessionDesc.preprocessorMacros = macros.data();
+		sessionDesc.preprocessorMacroCount = static_cast<SlangInt>(macros.size());
 
 		ComPtr<ISession> session;
 		if (globalSession->createSession(sessionDesc, session.writeRef()) != SLANG_OK)
 		{
 			LOG_ERROR("Failed to create session");
-			return false;
+			return nullptr;
+		}
+
+		return session;
+	}
+
+	ISession* SlangCompiler::GetSession(const ShaderCompileRequest& _request, const std::vector<std::string>& _dependencies, const std::vector<std::string>& _searchPaths, const std::vector<std::string>& _sharedModules)
+	{
+		// Macros are part of the session, each macro set gets its own
+		size_t key = 0;
+		Helper::Hash::CombineHashes(key, _request.profile);
+		for (const auto& macro : _request.macros)
+		{
+			Helper::Hash::CombineHashes(key, macro.name);
+			Helper::Hash::CombineHashes(key, macro.value);
+		}
+
+		size_t configuration = 0;
+		for (const auto& path : _searchPaths) Helper::Hash::CombineHashes(configuration, path);
+		for (const auto& name : _sharedModules) Helper::Hash::CombineHashes(configuration, name);
+
+		std::error_code error;
+
+		auto it = sessions.find(key);
+		if (it != sessions.end())
+		{
+			SharedSession& shared = it->second;
+			bool stale = shared.configuration != configuration || shared.compileCount >= SESSION_RECYCLE_COMPILES;
+
+			// Imported modules are parsed once per session, an edit to any of them means starting over
+			for (auto fileIt = shared.loadedFiles.begin(); !stale && fileIt != shared.loadedFiles.end(); ++fileIt)
+			{
+				stale = std::filesystem::last_write_time(fileIt->first, error) != fileIt->second;
+			}
+
+			if (stale)
+			{
+				LOG_TRACE(MF("Recreating Slang session after ", shared.compileCount, " compiles"));
+				sessions.erase(it);
+				it = sessions.end();
+			}
+		}
+
+		if (it == sessions.end())
+		{
+			SharedSession shared;
+			shared.session = CreateSession(_request, _searchPaths);
+			shared.configuration = configuration;
+
+			if (!shared.session)
+			{
+				return nullptr;
+			}
+
+			for (const auto& name : _sharedModules)
+			{
+				ComPtr<IBlob> diagnostics;
+				IModule* module = shared.session->loadModule(name.c_str(), diagnostics.writeRef());
+
+				if (!module)
+				{
+					LOG_WARNING(MF("Failed to preload shared module [", name, "]", diagnostics ? MF(" : ", static_cast<const char*>(diagnostics->getBufferPointer())) : ""));
+					continue;
+				}
+
+				if (const char* path = module->getFilePath())
+				{
+					shared.loadedFiles[path] = std::filesystem::last_write_time(path, error);
+				}
+			}
+
+			it = sessions.emplace(key, std::move(shared)).first;
+		}
+
+		// The source itself is loaded under a per-content name, everything else it pulls in stays in the session
+		for (size_t i = 1; i < _dependencies.size(); i++)
+		{
+			it->second.loadedFiles.try_emplace(_dependencies[i], std::filesystem::last_write_time(_dependencies[i], error));
+		}
+
+		it->second.compileCount++;
+
+		return it->second.session.get();
+	}
+
+	ShaderCompileResult SlangCompiler::Compile(const ShaderCompileRequest& _request)
+	{
+		return Compile(_request, GetSearchPaths(), GetSharedModules());
+	}
+
+	ShaderCompileResult SlangCompiler::Compile(const ShaderCompileRequest& _request, const std::vector<std::string>& _searchPaths, const std::vector<std::string>& _sharedModules)
+	{
+		ShaderCompileResult compileResult;
+		compileResult.dependencies = cp::ShaderCache::CollectDependencies(_request.sourcePath, _searchPaths);
+
+		ISession* session = GetSession(_request, compileResult.dependencies, _searchPaths, _sharedModules);
+		if (!session)
+		{
+			return compileResult;
 		}
 
 		ComPtr<IModule> module;
 		{
 			ComPtr<IBlob> diagnostics;
-			const char* moduleName = _material.GetName().c_str();
-			const char* modulePath = _material.GetShaderPath().c_str();
-			std::string source = Helper::File::FileContentToString(_material.GetShaderPath());
-			module = session->loadModuleFromSourceString(moduleName, modulePath, source.c_str(), diagnostics.writeRef());
+			std::string source = Helper::File::FileContentToString(_request.sourcePath);
+
+			// The session keeps every module it loaded, a name per source version keeps an edited material from resolving to its stale module
+			std::stringstream moduleName;
+			moduleName << _request.moduleName << "_" << std::hex << std::hash<std::string>{}(source);
+
+			const char* modulePath = _request.sourcePath.c_str();
+			module = session->loadModuleFromSourceString(moduleName.str().c_str(), modulePath, source.c_str(), diagnostics.writeRef());
 
 			if (diagnostics)
 			{
@@ -136,7 +251,7 @@ namespace cp
 			if (!module)
 			{
 				LOG_ERROR("Failed to load module");
-				return false;
+				return compileResult;
 			}
 		}
 
@@ -171,7 +286,7 @@ namespace cp
 				LOG_ERROR("Failed to create component type: " + std::string(static_cast<const char*>(diagnostics->getBufferPointer())));
 			}
 
-			SLANG_RETURN_FALSE_ON_FAIL(result);
+			if (SLANG_FAILED(result)) return compileResult;
 		}
 
 		ComPtr<IComponentType> linkedProgram;
@@ -184,7 +299,7 @@ namespace cp
 				LOG_ERROR("Failed to link program: " + std::string(static_cast<const char*>(diagnostics->getBufferPointer())));
 			}
 
-			SLANG_RETURN_FALSE_ON_FAIL(result);
+			if (SLANG_FAILED(result)) return compileResult;
 		}
 
 		ComPtr<IBlob> compiledCode;
@@ -197,7 +312,7 @@ namespace cp
 				LOG_ERROR("Failed to get compiled code: " + std::string(static_cast<const char*>(diagnostics->getBufferPointer())));
 			}
 
-			SLANG_RETURN_FALSE_ON_FAIL(result);
+			if (SLANG_FAILED(result)) return compileResult;
 		}
 
 		LOG_INFO(MF("Defined entry points: ", module->getDefinedEntryPointCount()));
@@ -209,26 +324,12 @@ namespace cp
 			LOG_INFO(MF("Entry point name: ", entryPoint->getFunctionReflection()->getName()));
 		}
 
-		std::string outputPath = _material.GetShaderPath();
-		outputPath = outputPath.substr(0, outputPath.find_last_of('.')) + ".spv";
-		std::ofstream outputFile(outputPath, std::ios::binary);
-		if (!outputFile.is_open())
-		{
-			LOG_ERROR("Failed to open output file");
-			return false;
-		}
-
-		size_t codeSize = compiledCode->getBufferSize();
 		const char* codeData = static_cast<const char*>(compiledCode->getBufferPointer());
-
-		outputFile.write(codeData, codeSize);
-		outputFile.close();
-
-		LOG_INFO("Compiled code written to " + outputPath);
+		compileResult.spirv.assign(codeData, codeData + compiledCode->getBufferSize());
 
 		//DEBUG LOG INFOS
 
-		ShaderReflection* shaderReflection = new ShaderReflection();
+		ShaderReflection* shaderReflection = &compileResult.reflection;
 		ProgramLayout* programLayout = linkedProgram->getLayout(0);
 
 		LOG_INFO(MF("Compiled shader has ", programLayout->getParameterCount(), " parameters"));
@@ -245,6 +346,13 @@ namespace cp
 			resource.typeName = paramLayout->getTypeLayout()->getName();
 			resource.kind = DetermineResourceKind(paramLayout->getTypeLayout());
 
+			if (paramLayout->getCategory() == ParameterCategory::PushConstantBuffer) // [[vk::push_constant]], its type layout alone reads as a constant buffer
+			{
+				resource.kind = ShaderResourceKind::PushConstant;
+				resource.binding = 0;
+				resource.set = 0;
+			}
+
 			if(paramLayout->getTypeLayout()->getElementTypeLayout())
 				resource.field = ExtractFieldInfo(paramLayout->getTypeLayout()->getElementTypeLayout());
 
@@ -303,6 +411,153 @@ namespace cp
 			entryPoint.name = entryPointLayout->getName();
 			entryPoint.stage = EntryPointShaderStage(entryPointLayout->getStage());
 			shaderReflection->entryPoints.push_back(entryPoint);
+
+			// Uniform entry point parameters are packed into a push constant block only this stage reads
+			ShaderResource entryPointConstants;
+			entryPointConstants.name = entryPoint.name + "_Constants";
+			entryPointConstants.kind = ShaderResourceKind::PushConstant;
+			entryPointConstants.binding = 0;
+			entryPointConstants.set = 0;
+			entryPointConstants.stages = static_cast<uint16_t>(entryPoint.stage);
+			entryPointConstants.field.name = entryPointConstants.name;
+			entryPointConstants.field.size = 0;
+			entryPointConstants.field.alignment = 4;
+			entryPointConstants.field.stride = 0;
+
+			for (unsigned int j = 0; j < entryPointLayout->getParameterCount(); j++)
+			{
+				VariableLayoutReflection* paramLayout = entryPointLayout->getParameterByIndex(j);
+				if (paramLayout->getCategory() != ParameterCategory::Uniform) continue; // Varying inputs and system values
+
+				ShaderField field = ExtractFieldInfo(paramLayout->getTypeLayout());
+				field.name = paramLayout->getName();
+				field.offset = paramLayout->getOffset(SLANG_PARAMETER_CATEGORY_UNIFORM);
+
+				entryPointConstants.field.size = std::max(entryPointConstants.field.size, field.offset + field.size);
+				entryPointConstants.field.fields.push_back(field);
+			}
+
+			if (!entryPointConstants.field.fields.empty())
+			{
+				entryPointConstants.typeName = entryPointConstants.name;
+				entryPointConstants.field.typeName = entryPointConstants.name;
+				entryPointConstants.field.stride = entryPointConstants.field.size;
+				shaderReflection->resources.push_back(entryPointConstants);
+			}
+		}
+
+		// A global push constant block is visible to every stage of the program
+		uint16_t programStages = 0;
+		for (const auto& entryPoint : shaderReflection->entryPoints)
+		{
+			programStages |= static_cast<uint16_t>(entryPoint.stage);
+		}
+
+		for (auto& resource : shaderReflection->resources)
+		{
+			if (resource.kind == ShaderResourceKind::PushConstant && resource.stages == 0) resource.stages = programStages;
+		}
+
+		compileResult.success = true;
+
+		return compileResult;
+	}
+
+	ShaderCompileResult SlangCompiler::CompileCached(const ShaderCompileRequest& _request)
+	{
+		cp::ShaderCache& cache = cp::ShaderCache::Get();
+
+		std::vector<std::string> paths = GetSearchPaths(); // One copy for the key and the compile, a concurrent SetSearchPaths can't make them disagree
+		std::vector<std::string> modules = GetSharedModules();
+
+		size_t key = cache.ComputeKey(_request, GetCompilerTag(), paths);
+
+		ShaderCompileResult result;
+		if (cache.Load(key, result))
+		{
+			LOG_TRACE(MF("Shader cache hit for [", _request.moduleName, "]"));
+			return result;
+		}
+
+		result = Compile(_request, paths, modules);
+
+		if (result.success)
+		{
+			cache.Store(key, result);
+		}
+
+		return result;
+	}
+
+	ShaderCompileRequest SlangCompiler::MakeMaterialRequest(const cp::Material& _material, uint32_t _keywordMask)
+	{
+		ShaderCompileRequest request;
+		request.moduleName = _material.GetName();
+		request.sourcePath = _material.GetShaderPath();
+		request.macros = { { "CP_DEBUG", "1" } };
+
+		// Always defined, shaders test them with #if
+		const auto& keywords = _material.GetKeywords();
+		for (uint32_t i = 0; i < keywords.size(); i++)
+		{
+			if (keywords[i].specialization) continue;
+			request.macros.push_back({ keywords[i].name, (_keywordMask >> i) & 1u ? "1" : "0" });
+		}
+
+		return request;
+	}
+
+	bool SlangCompiler::WriteSpirV(const std::string& _path, const std::vector<char>& _spirv)
+	{
+		std::error_code error;
+		if (std::filesystem::file_size(_path, error) == _spirv.size() && !error)
+		{
+			std::ifstream existing(_path, std::ios::binary);
+			std::vector<char> content(_spirv.size());
+			existing.read(content.data(), static_cast<std::streamsize>(content.size()));
+
+			if (content == _spirv) return true; // Untouched, the pipelines manager keeps its in-memory copy
+		}
+
+		std::ofstream outputFile(_path, std::ios::binary | std::ios::trunc);
+		if (!outputFile.is_open())
+		{
+			LOG_ERROR("Failed to open output file");
+			return false;
+		}
+
+		outputFile.write(_spirv.data(), static_cast<std::streamsize>(_spirv.size()));
+		outputFile.close();
+
+		LOG_INFO("Compiled code written to " + _path);
+
+		return true;
+	}
+
+	std::string SlangCompiler::GetCompilerTag() const
+	{
+		return MF(globalSession->getBuildTagString(), "_", OPTIONS_VERSION);
+	}
+
+	bool SlangCompiler::CompileMaterialSlangToSpirV(cp::Material& _material)
+	{
+		ShaderCompileResult result = CompileCached(MakeMaterialRequest(_material));
+		return ApplyMaterialResult(_material, result);
+	}
+
+	bool SlangCompiler::ApplyMaterialResult(cp::Material& _material, const ShaderCompileResult& _result)
+	{
+		if (!_result.success)
+		{
+			return false;
+		}
+
+		std::string outputPath = _material.GetShaderPath();
+		outputPath = outputPath.substr(0, outputPath.find_last_of('.')) + ".spv";
+
+		if (!WriteSpirV(outputPath, _result.spirv))
+		{
+			return false;
 		}
 
 		if (_material.GetShaderReflection() != nullptr)
@@ -310,7 +565,7 @@ namespace cp
 			delete _material.GetShaderReflection();
 		}
 
-		_material.SetShaderReflection(shaderReflection);
+		_material.SetShaderReflection(new ShaderReflection(_result.reflection)); // Copied, futures hand the same result to every waiter
 
 		return true;
 	}
@@ -504,6 +759,7 @@ namespace cp
 		_serializer.WriteInt("set", set);
 		_serializer.WriteString("typeName", typeName);
 		_serializer.WriteInt("kind", static_cast<int>(kind));
+		if (kind == ShaderResourceKind::PushConstant) _serializer.WriteInt("stages", stages);
 
 		_serializer.BeginObjectWriting("field");
 		field.Serialize(_serializer);
@@ -517,6 +773,7 @@ namespace cp
 		set = _serializer.ReadInt("set", set);
 		typeName = _serializer.ReadString("typeName", typeName);
 		kind = static_cast<ShaderResourceKind>(_serializer.ReadInt("kind", static_cast<int>(kind)));
+		stages = static_cast<uint16_t>(_serializer.ReadInt("stages", stages));
 
 		if (_serializer.BeginObjectReading("field"))
 		{
@@ -546,6 +803,26 @@ namespace cp
 		_serializer.EndObjectArray();
 	}
 
+	std::vector<vk::PushConstantRange> ShaderReflection::GetPushConstantRanges() const
+	{
+		// Vulkan forbids two ranges sharing a stage, so every block is merged into a single range covering all of them
+		vk::PushConstantRange range(static_cast<vk::ShaderStageFlagBits>(0), 0, 0);
+
+		for (const auto& resource : resources)
+		{
+			if (resource.kind != ShaderResourceKind::PushConstant) continue;
+
+			range.stageFlags |= Helper::Material::GetShaderStageFlags(resource.stages);
+			range.size = std::max(range.size, static_cast<uint32_t>(resource.field.size));
+		}
+
+		if (!range.stageFlags || range.size == 0) return {};
+
+		range.size = (range.size + 3) & ~3u; // Sizes must be a multiple of 4
+
+		return { range };
+	}
+
 	void ShaderReflection::Deserialize(ISerializer& _serializer)
 	{
 		size_t resourceCount = _serializer.BeginObjectArrayReading("resources");
@@ -53,6 +53,7 @@ namespace cp
 		uint32_t set;
 		std::string typeName;
 		ShaderField field;
+		uint16_t stages = 0; // ShaderStages reading it, only filled for push constants
 
 		void Serialize(ISerializer& _serializer) const override;
 		void Deserialize(ISerializer& _serializer) override;
@@ -72,23 +73,85 @@ namespace cp
 		std::vector<ShaderResource> resources;
 		std::vector<EntryPoint> entryPoints;
 
+		std::vector<vk::PushConstantRange> GetPushConstantRanges() const; // Empty when the program has no push constants
+
 		void Serialize(ISerializer& _serializer) const override;
 		void Deserialize(ISerializer& _serializer) override;
 		//TODO : Make destructor
 	};
 
+	struct ShaderMacro
+	{
+		std::string name;
+		std::string value;
+	};
+
+	struct ShaderCompileRequest
+	{
+		std::string moduleName;
+		std::string sourcePath;
+		std::vector<ShaderMacro> macros;
+		std::string profile = "spirv_1_6";
+	};
+
+	struct ShaderCompileResult
+	{
+		bool success = false;
+		std::vector<char> spirv;
+		ShaderReflection reflection;
+		std::vector<std::string> dependencies; // Source file first, then every file it includes or imports, transitively
+		bool fromCache = false;
+	};
+
 	class SlangCompiler
 	{
 	protected:
+		// A long lived session, shared modules are parsed and type checked once instead of once per material
+		struct SharedSession
+		{
+			ComPtr<ISession> session;
+			size_t configuration = 0; // Search paths and shared modules it was created with
+			uint32_t compileCount = 0;
+			std::unordered_map<std::string, std::filesystem::file_time_type> loadedFiles; // Files the session holds parsed, checked before each compile
+		};
+
 		ComPtr<IGlobalSession> globalSession;
+		std::unordered_map<size_t, SharedSession> sessions; // Per profile and macro set
+
+		static std::vector<std::string> searchPaths;
+		static std::vector<std::string> sharedModules;
+		static std::mutex configurationMutex; // Guards searchPaths and sharedModules, compiles work on a copy taken when they start
+
+		ComPtr<ISession> CreateSession(const ShaderCompileRequest& _request, const std::vector<std::string>& _searchPaths);
+		ISession* GetSession(const ShaderCompileRequest& _request, const std::vector<std::string>& _dependencies, const std::vector<std::string>& _searchPaths, const std::vector<std::string>& _sharedModules);
+		ShaderCompileResult Compile(const ShaderCompileRequest& _request, const std::vector<std::string>& _searchPaths, const std::vector<std::string>& _sharedModules);
 
 		ShaderResourceKind DetermineResourceKind(TypeLayoutReflection* layout);
 		ShaderField ExtractFieldInfo(TypeLayoutReflection* typeLayout);
 
 	public:
+		static constexpr uint32_t OPTIONS_VERSION = 2; // Bump when the session options below change, invalidates every cached shader
+		static constexpr uint32_t SESSION_RECYCLE_COMPILES = 64; // Sessions never unload modules, recreating them bounds the memory held by old material versions
+
 		SlangCompiler();
+
+		ShaderCompileResult Compile(const ShaderCompileRequest& _request); // Always runs Slang
+		ShaderCompileResult CompileCached(const ShaderCompileRequest& _request); // Goes through the ShaderCache, Slang only runs on a miss
 		bool CompileMaterialSlangToSpirV(Material& _material);
 
+		static bool ApplyMaterialResult(Material& _material, const ShaderCompileResult& _result); // Writes the .spv next to the source and replaces the material reflection, not thread safe
+
+		static ShaderCompileRequest MakeMaterialRequest(const Material& _material, uint32_t _keywordMask = 0); // Compiled keywords become macros, specialization keywords are left to the pipeline
+		static bool WriteSpirV(const std::string& _path, const std::vector<char>& _spirv); // Skips the write when the file already holds this code
+
+		std::string GetCompilerTag() const; // Slang build and options version, part of every cache key
+
+		static inline void SetSearchPaths(const std::vector<std::string>& _paths) { std::lock_guard lock(configurationMutex); searchPaths = _paths; } // Compiles already running keep the previous paths
+		static inline std::vector<std::string> GetSearchPaths() { std::lock_guard lock(configurationMutex); return searchPaths; }
+
+		static inline void SetSharedModules(const std::vector<std::string>& _modules) { std::lock_guard lock(configurationMutex); sharedModules = _modules; } // Module names preloaded in every session, resolved through the search paths
+		static inline std::vector<std::string> GetSharedModules() { std::lock_guard lock(configurationMutex); return sharedModules; }
+
 #ifdef IN_EDITOR
 		static QWidget* CreateFieldWidget(const ShaderField& field, QWidget* parent);
 		static QWidget* CreateResourceWidget(const ShaderResource& resource, QWidget* parent, const bool& _showEngineSets = false);
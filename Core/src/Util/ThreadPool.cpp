@@ -0,0 +1,86 @@
+#include "pch.hpp"
+#include "ThreadPool.hpp"
+
+namespace cp
+{
+	ThreadPool::ThreadPool(uint32_t _threadCount)
+	{
+		if (_threadCount == 0)
+		{
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			_threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		workers.reserve(_threadCount);
+		for (uint32_t i = 0; i < _threadCount; i++)
+		{
+			workers.emplace_back(&ThreadPool::WorkerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+
+		jobAvailable.notify_all();
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::Submit(std::function<void()> _job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(_job));
+		}
+
+		jobAvailable.notify_one();
+	}
+
+	void ThreadPool::WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this]() { return jobs.empty() && runningJobs == 0; });
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+				if (jobs.empty()) return; // Stopping, and everything queued ran
+
+				job = std::move(jobs.front());
+				jobs.pop_front();
+				runningJobs++;
+			}
+
+			try
+			{
+				job();
+			}
+			catch (const std::exception& e)
+			{
+				LOG_ERROR(MF("Job threw an exception: ", e.what()));
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				runningJobs--;
+			}
+
+			idle.notify_all();
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../pch.hpp"
+
+#include <condition_variable>
+
+namespace cp
+{
+	// Fixed set of worker threads consuming a FIFO of jobs
+	class ThreadPool
+	{
+	private:
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> jobs;
+
+		std::mutex mutex;
+		std::condition_variable jobAvailable;
+		std::condition_variable idle;
+
+		size_t runningJobs = 0;
+		bool stopping = false;
+
+		void WorkerLoop();
+
+	public:
+		NO_COPY(ThreadPool)
+
+		ThreadPool(uint32_t _threadCount = 0); // 0 : one thread per hardware thread, minus the calling one
+		~ThreadPool();
+
+		void Submit(std::function<void()> _job);
+		void WaitIdle(); // Blocks until every submitted job has finished
+
+		inline size_t GetThreadCount() const { return workers.size(); }
+	};
+}
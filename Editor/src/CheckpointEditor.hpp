@@ -131,6 +131,15 @@ namespace cp {
 
 			outFile << CurrentProject.ToJson().dump(4);
 			outFile.close();
+
+			std::string shadersPath = CurrentProject.GetResourcePath() + "/Shaders";
+			cp::SlangCompiler::SetSearchPaths({ shadersPath, CurrentProject.GetResourcePath() });
+
+			std::vector<std::string> sharedModules;
+			if (std::filesystem::exists(shadersPath + "/Constants.slang")) sharedModules.push_back("Constants");
+			cp::SlangCompiler::SetSharedModules(sharedModules);
+
+			if (cp::ShaderHotReloader* reloader = cp::ShaderHotReloader::Get()) reloader->Watch(shadersPath);
 		}
 	};
 }
\ No newline at end of file
@@ -7,7 +7,25 @@
 struct MeshRenderer : public cp::IComponentBase
 {
 	std::shared_ptr<cp::Mesh> mesh;
-	std::shared_ptr<cp::MaterialInstance> materialInstance;
+	std::vector<std::shared_ptr<cp::MaterialInstance>> materialInstances; // One per mesh material slot
+
+	std::shared_ptr<cp::MaterialInstance> GetMaterialInstance(uint32_t _slot) const
+	{
+		if (_slot < materialInstances.size() && materialInstances[_slot]) return materialInstances[_slot];
+		return materialInstances.empty() ? nullptr : materialInstances[0]; // Unassigned slots fall back to the first one
+	}
+
+	std::vector<cp::MaterialInstance*> GetSlotInstances() const // For cp::InstanceGroupBuilder::Add
+	{
+		std::vector<cp::MaterialInstance*> instances;
+		for (const auto& materialInstance : materialInstances) instances.push_back(materialInstance.get());
+		return instances;
+	}
+
+	void ResizeMaterialSlots()
+	{
+		materialInstances.resize(mesh ? std::max(mesh->GetMaterialSlotCount(), 1u) : 1u);
+	}
 
 	class Helper : public cp::ComponentBaseHelper<MeshRenderer>
 	{
@@ -16,9 +34,10 @@ struct MeshRenderer : public cp::IComponentBase
 			_component.mesh = _mesh;
 		}
 
-		void SetMaterialInstance(MeshRenderer& _component, std::shared_ptr<cp::MaterialInstance> _materialInstance)
+		void SetMaterialInstance(MeshRenderer& _component, std::shared_ptr<cp::MaterialInstance> _materialInstance, uint32_t _slot = 0)
 		{
-			_component.materialInstance = _materialInstance;
+			if (_slot >= _component.materialInstances.size()) _component.materialInstances.resize(_slot + 1);
+			_component.materialInstances[_slot] = _materialInstance;
 		}
 	};
 };
@@ -33,6 +52,13 @@ public:
 		MeshRenderer& component = static_cast<MeshRenderer&>(this->component);
 		std::string meshRelativePath = Project::GetResourceRelativePath(cp::ResourceManager::Get()->GetResourceType<cp::Mesh>()->GetResourcePath(component.mesh));
 		_serializer.WriteString("mesh", meshRelativePath);
+
+		std::vector<std::string> materialInstancePaths;
+		for (const auto& materialInstance : component.materialInstances)
+		{
+			materialInstancePaths.push_back(materialInstance ? Project::GetResourceRelativePath(cp::ResourceManager::Get()->GetResourceType<cp::MaterialInstance>()->GetResourcePath(materialInstance)) : "");
+		}
+		_serializer.WriteStringArray("materialInstances", materialInstancePaths.size(), materialInstancePaths.data());
 	}
 
 	void Deserialize(cp::ISerializer& _serializer) override
@@ -40,6 +66,16 @@ public:
 		MeshRenderer& component = static_cast<MeshRenderer&>(this->component);
 		std::string fullMeshPath = Project::GetResourcePath() + "/" + _serializer.ReadString("mesh", "");
 		if(!fullMeshPath.empty()) component.mesh = cp::ResourceManager::Get()->GetOrLoad<cp::Mesh>(fullMeshPath);
+
+		auto [count, paths] = _serializer.ReadStringArray("materialInstances");
+		component.materialInstances.clear();
+		for (size_t i = 0; i < count; i++)
+		{
+			component.materialInstances.push_back(paths[i].empty() ? nullptr : cp::ResourceManager::Get()->GetOrLoad<cp::MaterialInstance>(Project::GetResourcePath() + "/" + paths[i]));
+		}
+		delete[] paths;
+
+		component.ResizeMaterialSlots();
 	}
 };
 
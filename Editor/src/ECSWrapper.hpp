@@ -33,6 +33,9 @@ namespace cp {
 			return components;
 		}
 
+		Transform* GetTransform() const { return transform; }
+		MeshRenderer* GetMeshRenderer() const { return meshRenderer; }
+
 	protected:
 		std::vector<cp::IComponentBase*> components;
 
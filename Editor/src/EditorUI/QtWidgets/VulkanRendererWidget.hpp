@@ -19,6 +19,7 @@ namespace cp {
             QTimer renderTimer;
 
 			cp::Camera* editorCamera = nullptr;
+			cp::InstanceGroupBuilder instanceGroupBuilder;
 
 			bool surfaceExposed = false;
 
@@ -90,11 +91,31 @@ namespace cp {
 				surfaceExposed = true;
             }
 
+            void AddEntity(cp::EntityAsset& _entity)
+            {
+                Transform* transform = _entity.GetTransform();
+                MeshRenderer* meshRenderer = _entity.GetMeshRenderer();
+
+                if (_entity.visible && transform && meshRenderer && meshRenderer->mesh)
+                {
+                    glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), transform->position) * glm::mat4_cast(transform->rotation) * glm::scale(glm::mat4(1.0f), transform->scale);
+                    instanceGroupBuilder.Add(*meshRenderer->mesh, meshRenderer->GetSlotInstances(), modelMatrix);
+                }
+
+                for (auto& child : _entity.children) AddEntity(child);
+            }
+
             void UpdateRender()
             {
                 if (renderer)
                 {
-                    renderer->Render({});
+                    if (scene)
+                    {
+                        instanceGroupBuilder.SetView(editorCamera->GetPosition(), editorCamera->GetLODProjectionScale(), static_cast<float>(renderer->GetSwapchain()->GetExtent().height));
+                        for (cp::EntityAsset* entity : scene->entities) AddEntity(*entity);
+                    }
+
+                    renderer->Render(instanceGroupBuilder.Build());
                 }
 
                 renderTimer.start();
@@ -42,8 +42,13 @@ class MeshRendererView : public cp::ComponentView<MeshRenderer> {
 		auto container = factory->CreateContainer();
 		auto meshSelector = factory->CreateMeshSelector(&component->mesh, "Mesh");
 		container->AddChild(meshSelector.release());
-		auto materialSelector = factory->CreateMaterialInstanceSelector(&component->materialInstance, "Material Instance");
-		container->AddChild(materialSelector.release());
+		component->ResizeMaterialSlots(); // Selectors keep pointers into the vector, it must not be resized while the view is alive
+		for (uint32_t slot = 0; slot < component->materialInstances.size(); slot++)
+		{
+			std::string label = component->mesh && slot < component->mesh->GetMaterialSlotCount() ? component->mesh->GetMaterialSlots()[slot] : "Material Instance";
+			auto materialSelector = factory->CreateMaterialInstanceSelector(&component->materialInstances[slot], label);
+			container->AddChild(materialSelector.release());
+		}
 		container->SetSpacing(2);
 		return container.release();
 	}
@@ -116,6 +121,8 @@ int main(int argc, char* args[])
 	cp::CheckpointEditor::SetupVulkanContext();
 
 	cp::ResourceManager::Create(cp::CheckpointEditor::VulkanCtx);
+	cp::TextureStreamer::Create(cp::CheckpointEditor::VulkanCtx);
+	cp::ShaderHotReloader::Create();
 	cp::ResourceManager::Get()->RegisterResourceType<cp::Mesh>();
 	cp::ResourceManager::Get()->GetResourceType<cp::Mesh>()->SetLoader(std::bind(&cp::Mesh::LoadMesh, std::placeholders::_1, std::placeholders::_2));
 	cp::ResourceManager::Get()->RegisterResourceType<cp::Texture>();
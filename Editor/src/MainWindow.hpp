@@ -48,6 +48,8 @@ protected:
 		QAction* openConsoleAction = windowMenu->addAction("Console");
 		QAction* openFileExplorerAction = windowMenu->addAction("File explorer");
 
+		QAction* recompileShadersAction = toolsMenu->addAction("Recompile all shaders");
+
 		connect(newAction, &QAction::triggered, [=] {
 			// Create new project
 			});
@@ -98,6 +100,16 @@ protected:
 			CreateFileExplorerDockWidget(false);
 			});
 
+		connect(recompileShadersAction, &QAction::triggered, [=] {
+			std::vector<cp::Material*> materials;
+			for (auto& material : cp::ResourceManager::Get()->GetAll<cp::Material>())
+			{
+				if (material) materials.push_back(material.get());
+			}
+
+			cp::ShaderCompilerService::Get().CompileMaterials(materials);
+			});
+
 		setMenuBar(menuBar);
 	}
 
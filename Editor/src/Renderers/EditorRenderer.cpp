@@ -82,18 +82,28 @@ void cp::EditorRenderer::RenderFrame(const std::vector<cp::InstanceGroup>& _inst
 	commandBuffer.setViewport(0, vp);
 	commandBuffer.setScissor(0, scissor);
 
-	std::string currentPassName = "Main";
-	vk::RenderPass currentPass = renderPasses.at(currentPassName).GetRenderPass();
+	cp::RenderTarget* renderTarget = swapchain->GetCurrentRenderTarget();
+	const bool dynamicRendering = context->UsesDynamicRendering();
 
-	vk::RenderPassBeginInfo rpInfo = {};
-	rpInfo.renderPass = currentPass;
-	rpInfo.framebuffer = swapchain->GetCurrentFrame()->GetMainRenderTarget()->GetFramebuffer();
-	rpInfo.renderArea.offset = vk::Offset2D{ 0, 0 };
-	rpInfo.renderArea.extent = swapchain->GetExtent();
-	rpInfo.clearValueCount = static_cast<uint32_t>(rpClearValues.size());
-	rpInfo.pClearValues = rpClearValues.data();
+	if (dynamicRendering)
+	{
+		renderTarget->BeginRendering(commandBuffer, rpClearValues); // Same clears as the main render pass, the swapchain image ends up in PresentSrcKHR
+	}
+	else
+	{
+		std::string currentPassName = "Main";
+		vk::RenderPass currentPass = renderPasses.at(currentPassName).GetRenderPass();
+
+		vk::RenderPassBeginInfo rpInfo = {};
+		rpInfo.renderPass = currentPass;
+		rpInfo.framebuffer = renderTarget->GetFramebuffer();
+		rpInfo.renderArea.offset = vk::Offset2D{ 0, 0 };
+		rpInfo.renderArea.extent = swapchain->GetExtent();
+		rpInfo.clearValueCount = static_cast<uint32_t>(rpClearValues.size());
+		rpInfo.pClearValues = rpClearValues.data();
 
-	commandBuffer.beginRenderPass(rpInfo, vk::SubpassContents::eInline);
+		commandBuffer.beginRenderPass(rpInfo, vk::SubpassContents::eInline);
+	}
 
 	cp::Mesh* currentMesh = nullptr;
 	cp::Material* currentMaterial = nullptr;
@@ -121,11 +131,15 @@ void cp::EditorRenderer::RenderFrame(const std::vector<cp::InstanceGroup>& _inst
 		{
 			currentMesh = instanceGroup.mesh;
 			commandBuffer.bindVertexBuffers(0, 1, &currentMesh->GetVertexBuffer(), &offset);
-			commandBuffer.bindIndexBuffer(currentMesh->GetIndexBuffer(), 0, vk::IndexType::eUint32);
+			commandBuffer.bindIndexBuffer(currentMesh->GetIndexBuffer(), 0, currentMesh->GetIndexType());
 		}
 
-		commandBuffer.drawIndexed(instanceGroup.mesh->GetIndexCount(), instanceGroup.transforms.size(), 0, 0, instanceGroup.instanceOffset);
+		const cp::MeshLOD& lod = currentMesh->GetSubmeshLOD(instanceGroup.submeshIndex, instanceGroup.lod);
+		commandBuffer.drawIndexed(lod.indexCount, instanceGroup.transforms.size(), lod.firstIndex, currentMesh->GetSubmesh(instanceGroup.submeshIndex).vertexOffset, instanceGroup.instanceOffset);
 	}*/
 
-	commandBuffer.endRenderPass();
+	if (dynamicRendering)
+		renderTarget->EndRendering(commandBuffer);
+	else
+		commandBuffer.endRenderPass();
 }
\ No newline at end of file
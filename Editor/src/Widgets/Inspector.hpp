@@ -350,15 +350,13 @@ public:
 		layout->addWidget(compileButton);
 
 		connect(compileButton, &QPushButton::clicked, [=] {
-			cp::SlangCompiler compiler;
-
 			if (!mat)
 			{
 				LOG_ERROR("Material is null");
 				return;
 			}
 			
-			if (compiler.CompileMaterialSlangToSpirV(*mat))
+			if (cp::ShaderCompilerService::Get().CompileMaterial(*mat))
 			{
 				LOG_INFO("Compiled shader to SPIR-V");
 			}
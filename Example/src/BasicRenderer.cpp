@@ -70,12 +70,13 @@ void BasicRenderer::RenderFrame(const std::vector<Render::InstanceGroup>& _insta
 			{
 				currentMesh = instanceGroup.mesh;
 				commandBuffer.bindVertexBuffers(0, 1, &currentMesh->GetVertexBuffer(), &offset);
-				commandBuffer.bindIndexBuffer(currentMesh->GetIndexBuffer(), 0, vk::IndexType::eUint32);
+				commandBuffer.bindIndexBuffer(currentMesh->GetIndexBuffer(), 0, currentMesh->GetIndexType());
 			}
 
 			Helper::Memory::MapMemory(context->GetDevice(), instancedBufferMemory, sizeof(Render::TransformData) * instanceGroup.transforms.size(), instanceGroup.instanceOffset * sizeof(Render::TransformData), instanceGroup.transforms.data());
 
-			commandBuffer.drawIndexed(instanceGroup.mesh->GetIndexCount(), instanceGroup.transforms.size(), 0, 0, instanceGroup.instanceOffset);
+			const auto& lod = currentMesh->GetSubmeshLOD(instanceGroup.submeshIndex, instanceGroup.lod);
+			commandBuffer.drawIndexed(lod.indexCount, instanceGroup.transforms.size(), lod.firstIndex, currentMesh->GetSubmesh(instanceGroup.submeshIndex).vertexOffset, instanceGroup.instanceOffset);
 		}
 	}
 
@@ -98,7 +99,7 @@ void BasicRenderer::RenderFrame(const std::vector<Render::InstanceGroup>& _insta
 
 	vk::RenderPassBeginInfo renderPassInfo = {};
 	renderPassInfo.renderPass = mainRenderPass;
-	renderPassInfo.framebuffer = swapchain->GetCurrentFrame()->GetMainRenderTarget()->GetFramebuffer();
+	renderPassInfo.framebuffer = swapchain->GetCurrentRenderTarget()->GetFramebuffer();
 	renderPassInfo.renderArea.offset = vk::Offset2D{ 0, 0 };
 	renderPassInfo.renderArea.extent = swapchain->GetExtent();
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
@@ -145,14 +146,15 @@ void BasicRenderer::RenderFrame(const std::vector<Render::InstanceGroup>& _insta
 		{
 			currentMesh = instanceGroup.mesh;
 			commandBuffer.bindVertexBuffers(0, 1, &currentMesh->GetVertexBuffer(), &offset);
-			commandBuffer.bindIndexBuffer(currentMesh->GetIndexBuffer(), 0, vk::IndexType::eUint32);
+			commandBuffer.bindIndexBuffer(currentMesh->GetIndexBuffer(), 0, currentMesh->GetIndexType());
 
 			//LOG_DEBUG(MF("Switching mesh [", currentMesh, "]"));
 		}
 
 		//Helper::Memory::MapMemory(context->GetDevice(), instancedBufferMemory, sizeof(Render::TransformData) * instanceGroup.transforms.size(), instanceGroup.instanceOffset * sizeof(Render::TransformData), instanceGroup.transforms.data());
 
-		commandBuffer.drawIndexed(instanceGroup.mesh->GetIndexCount(), instanceGroup.transforms.size(), 0, 0, instanceGroup.instanceOffset);
+		const auto& lod = currentMesh->GetSubmeshLOD(instanceGroup.submeshIndex, instanceGroup.lod);
+		commandBuffer.drawIndexed(lod.indexCount, instanceGroup.transforms.size(), lod.firstIndex, currentMesh->GetSubmesh(instanceGroup.submeshIndex).vertexOffset, instanceGroup.instanceOffset);
 	}
 
 	commandBuffer.endRenderPass();
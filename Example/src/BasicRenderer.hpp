@@ -54,5 +54,7 @@ public:
 
 	virtual void Cleanup() override;
 
+	inline vk::Extent2D GetRenderExtent() { return swapchain->GetExtent(); }
+
 	//inline virtual constexpr Render::Camera* GetMainCamera() override { return directionnalLight; }
 };
\ No newline at end of file
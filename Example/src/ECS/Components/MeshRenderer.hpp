@@ -5,5 +5,15 @@
 struct MeshRenderer
 {
 	Resource::Mesh* mesh = nullptr;
-	Resource::MaterialInstance* materialInstance = nullptr;
+	std::vector<Resource::MaterialInstance*> materialInstances; // One per mesh material slot
+
+	MeshRenderer() = default;
+	MeshRenderer(Resource::Mesh* _mesh, Resource::MaterialInstance* _materialInstance) : mesh(_mesh), materialInstances{ _materialInstance } {}
+	MeshRenderer(Resource::Mesh* _mesh, const std::vector<Resource::MaterialInstance*>& _materialInstances) : mesh(_mesh), materialInstances(_materialInstances) {}
+
+	Resource::MaterialInstance* GetMaterialInstance(uint32_t _slot) const
+	{
+		if (_slot < materialInstances.size() && materialInstances[_slot]) return materialInstances[_slot];
+		return materialInstances.empty() ? nullptr : materialInstances[0]; // Unassigned slots fall back to the first one
+	}
 };
\ No newline at end of file
@@ -75,32 +75,61 @@ std::vector<Render::InstanceGroup> BasicRenderSystem::PrepareInstanceGroups(ECS:
 {
 	std::vector<Render::InstanceGroup> instanceGroups;
 
-	std::unordered_map<std::tuple<Resource::Material*, Resource::Mesh*, Resource::MaterialInstance*>,
+	std::unordered_map<std::tuple<Resource::Material*, Resource::Mesh*, Resource::MaterialInstance*, uint32_t, uint32_t>,
 		std::vector<Render::TransformData>,
-		Helper::Hash::TupleHash<Resource::Material*, Resource::Mesh*, Resource::MaterialInstance*>> data;
+		Helper::Hash::TupleHash<Resource::Material*, Resource::Mesh*, Resource::MaterialInstance*, uint32_t, uint32_t>> data;
+
+	auto& camera = _componentManager.GetComponent<Camera>(renderCamera);
+	const glm::vec3 cameraPosition = glm::vec3(glm::inverse(camera.cameraUBO.view)[3]);
+	const float projectionScale = std::abs(camera.cameraUBO.projection[1][1]) * 0.5f;
+	const float viewportHeight = static_cast<float>(renderer->GetRenderExtent().height);
 
 	for (auto [mesh, transform] : query)
 	{
 		glm::mat4 modelMatrix = transform.GetModelMatrix();
 		glm::mat4 normalMatrix = glm::mat4(transform.GetNormalMatrix());
 
-		data[std::make_tuple(mesh.materialInstance->GetMaterial(), mesh.mesh, mesh.materialInstance)].push_back({ modelMatrix, normalMatrix });
+		// LOD is picked per instance from the projected size of its bounds, instances sharing a LOD end up in the same group
+		const auto& bounds = mesh.mesh->GetBounds();
+		const glm::vec3 worldCenter = glm::vec3(modelMatrix * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+		const float scale = std::max(cp::InstanceGroupBuilder::GetMaxScale(modelMatrix), 1e-4f); // Largest axis, correct under non uniform scale
+		const float distance = std::max(glm::distance(cameraPosition, worldCenter), 1e-4f);
+		const uint32_t lod = mesh.mesh->SelectLOD(distance / scale, projectionScale);
+
+		// Streamed textures follow the projected size of the bounds, assuming the UVs span the mesh once
+		const float screenPixels = glm::length(bounds.max - bounds.min) * scale / distance * projectionScale * viewportHeight;
+		for (Resource::MaterialInstance* materialInstance : mesh.materialInstances)
+		{
+			if (materialInstance) materialInstance->ReportTextureUsage(screenPixels);
+		}
+
+		modelMatrix = modelMatrix * mesh.mesh->GetDequantizationMatrix();
+
+		// Each submesh is drawn with the instance of its material slot, identical parameters resolve to the same shared instance and are drawn in one group
+		const auto& submeshes = mesh.mesh->GetSubmeshes();
+		for (uint32_t submesh = 0; submesh < submeshes.size(); submesh++)
+		{
+			Resource::MaterialInstance* materialInstance = mesh.GetMaterialInstance(submeshes[submesh].materialSlot);
+			if (!materialInstance) continue;
+
+			data[std::make_tuple(materialInstance->GetMaterial(), mesh.mesh, materialInstance->GetSharedInstance(), submesh, lod)].push_back({ modelMatrix, normalMatrix });
+		}
 	}
 
 	uint32_t instanceOffset = 0;
 
 	for (auto& [tuple, tdata] : data)
 	{
-		auto [material, mesh, materialInstance] = tuple;
+		auto [material, mesh, materialInstance, submesh, lod] = tuple;
 
-		instanceGroups.push_back({ material, materialInstance, mesh, tdata, instanceOffset });
+		instanceGroups.push_back({ material, materialInstance, mesh, submesh, lod, tdata, instanceOffset });
 
 		instanceOffset += tdata.size();
 	}
 
 	std::sort(instanceGroups.begin(), instanceGroups.end(), [](const Render::InstanceGroup& a, const Render::InstanceGroup& b)
 		{
-			return a.material < b.material && a.mesh < b.mesh && a.materialInstance < b.materialInstance;
+			return std::tie(a.material, a.materialInstance, a.mesh) < std::tie(b.material, b.materialInstance, b.mesh);
 		});
 
 	return instanceGroups;